@@ -68,7 +68,8 @@ bool CBlockChain::HandleInvoke()
     CBlock blockGenesis;
     pCoreProtocol->GetGenesisBlock(blockGenesis);
 
-    if (!cntrBlock.Initialize(Config()->pathData, blockGenesis.GetHash(), Config()->fDebug, Config()->fAddrTxIndex))
+    if (!cntrBlock.Initialize(Config()->pathData, blockGenesis.GetHash(), Config()->fDebug, Config()->fAddrTxIndex, (std::size_t)StorageConfig()->nBlockCacheSize << 20,
+                              StorageConfig()->nBlockSyncRecords, StorageConfig()->nBlockSyncInterval))
     {
         Error("Failed to initialize container");
         return false;
@@ -267,14 +268,10 @@ bool CBlockChain::GetBlockLocation(const uint256& hashBlock, uint256& hashFork,
 bool CBlockChain::GetBlockHash(const uint256& hashFork, int nHeight, uint256& hashBlock)
 {
     CBlockIndex* pIndex = nullptr;
-    if (!cntrBlock.RetrieveFork(hashFork, &pIndex) || pIndex->GetBlockHeight() < nHeight)
+    if (!cntrBlock.RetrieveForkHeightIndex(hashFork, nHeight, &pIndex))
     {
         return false;
     }
-    while (pIndex != nullptr && pIndex->GetBlockHeight() > nHeight)
-    {
-        pIndex = pIndex->pPrev;
-    }
     while (pIndex != nullptr && pIndex->GetBlockHeight() == nHeight && pIndex->IsExtended())
     {
         pIndex = pIndex->pPrev;
@@ -286,14 +283,10 @@ bool CBlockChain::GetBlockHash(const uint256& hashFork, int nHeight, uint256& ha
 bool CBlockChain::GetBlockHash(const uint256& hashFork, int nHeight, vector<uint256>& vBlockHash)
 {
     CBlockIndex* pIndex = nullptr;
-    if (!cntrBlock.RetrieveFork(hashFork, &pIndex) || pIndex->GetBlockHeight() < nHeight)
+    if (!cntrBlock.RetrieveForkHeightIndex(hashFork, nHeight, &pIndex))
     {
         return false;
     }
-    while (pIndex != nullptr && pIndex->GetBlockHeight() > nHeight)
-    {
-        pIndex = pIndex->pPrev;
-    }
     while (pIndex != nullptr && pIndex->GetBlockHeight() == nHeight)
     {
         vBlockHash.push_back(pIndex->GetBlockHash());
@@ -324,14 +317,10 @@ bool CBlockChain::GetBlockStatus(const uint256& hashBlock, CBlockStatus& status)
 bool CBlockChain::GetLastBlockOfHeight(const uint256& hashFork, const int nHeight, uint256& hashBlock, int64& nTime)
 {
     CBlockIndex* pIndex = nullptr;
-    if (!cntrBlock.RetrieveFork(hashFork, &pIndex) || pIndex->GetBlockHeight() < nHeight)
+    if (!cntrBlock.RetrieveForkHeightIndex(hashFork, nHeight, &pIndex))
     {
         return false;
     }
-    while (pIndex != nullptr && pIndex->GetBlockHeight() > nHeight)
-    {
-        pIndex = pIndex->pPrev;
-    }
     if (pIndex == nullptr || pIndex->GetBlockHeight() != nHeight)
     {
         return false;
@@ -385,6 +374,11 @@ bool CBlockChain::GetBlock(const uint256& hashBlock, CBlock& block)
     return cntrBlock.Retrieve(hashBlock, block);
 }
 
+bool CBlockChain::GetBlockHeader(const uint256& hashBlock, CBlock& header)
+{
+    return cntrBlock.RetrieveHeader(hashBlock, header);
+}
+
 bool CBlockChain::GetBlockEx(const uint256& hashBlock, CBlockEx& block)
 {
     return cntrBlock.Retrieve(hashBlock, block);
@@ -444,6 +438,11 @@ bool CBlockChain::FilterTx(const uint256& hashFork, CTxFilter& filter)
     return cntrBlock.FilterTx(hashFork, filter);
 }
 
+bool CBlockChain::FilterTx(const uint256& hashFork, CTxFilter& filter, CTxFilterCursor& cursor, size_t nMaxBlock)
+{
+    return cntrBlock.FilterTx(hashFork, filter, cursor, nMaxBlock);
+}
+
 bool CBlockChain::FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter)
 {
     return cntrBlock.FilterTx(hashFork, nDepth, filter);
@@ -557,8 +556,7 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
         return ERR_BLOCK_INVALID_FORK;
     }
 
-    // verify tx
-    uint256 mintHeightTxid;
+    // get tx context
     for (const CTransaction& tx : block.vtx)
     {
         uint256 txid = tx.GetHash();
@@ -570,6 +568,25 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
             return err;
         }
 
+        vTxContxt.push_back(txContxt);
+        if (!view.AddTx(txid, tx, block.GetBlockHeight(), txContxt))
+        {
+            Log("AddNewBlock Add block view tx error, txid: %s", txid.ToString().c_str());
+            return ERR_BLOCK_TRANSACTIONS_INVALID;
+        }
+    }
+
+    // verify tx signature in parallel
+    pCoreProtocol->PreVerifyBlockTxSignature(block, vTxContxt, block.GetBlockHeight(), forkid);
+
+    // verify tx
+    uint256 mintHeightTxid;
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction& tx = block.vtx[i];
+        const CTxContxt& txContxt = vTxContxt[i];
+        uint256 txid = tx.GetHash();
+
         // non-defi fork should not exist defi tx
         if (!fDeFiFork && (tx.nType == CTransaction::TX_DEFI_REWARD || tx.nType == CTransaction::TX_DEFI_RELATION || tx.nType == CTransaction::TX_DEFI_MINT_HEIGHT))
         {
@@ -604,7 +621,7 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
 
         if (tx.nType != CTransaction::TX_DEFI_REWARD)
         {
-            err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, block.GetBlockHeight(), forkid, profile);
+            err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, hash, block.GetBlockHeight(), forkid, profile);
             if (err != OK)
             {
                 Log("AddNewBlock Verify BlockTx Error(%s) : %s ", ErrorString(err), txid.ToString().c_str());
@@ -633,13 +650,6 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
             return ERR_BLOCK_TIMESTAMP_OUT_OF_RANGE;
         }
 
-        vTxContxt.push_back(txContxt);
-        if (!view.AddTx(txid, tx, block.GetBlockHeight(), txContxt))
-        {
-            Log("AddNewBlock Add block view tx error, txid: %s", txid.ToString().c_str());
-            return ERR_BLOCK_TRANSACTIONS_INVALID;
-        }
-
         StdTrace("BlockChain", "AddNewBlock: verify tx success, new tx: %s, new block: %s", txid.GetHex().c_str(), hash.GetHex().c_str());
 
         nTotalFee += tx.nTxFee;
@@ -719,6 +729,8 @@ Errno CBlockChain::AddNewBlock(const CBlock& block, CBlockChainUpdate& update)
            block.GetBlockHeight(), GetBlockTypeStr(block.nType, block.txMint.nType).c_str(),
            update.vBlockAddNew.size(), update.vBlockRemove.size(),
            block.vtx.size(), hash.GetHex().c_str(), pIndexFork->GetOriginHash().GetHex().c_str());
+    StdTrace("BlockChain", "AddNewBlock: tx hash saved by memoization: %lu, block: %s",
+             block.GetTxHashSavedCount(), hash.GetHex().c_str());
 
     if (!update.vBlockRemove.empty())
     {
@@ -972,6 +984,11 @@ bool CBlockChain::ListForkUnspent(const uint256& hashFork, const CDestination& d
     return cntrBlock.ListForkUnspent(hashFork, dest, nMax, vUnspent);
 }
 
+bool CBlockChain::ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent)
+{
+    return cntrBlock.ListForkUnspent(hashFork, dest, outBegin, nMax, vUnspent);
+}
+
 bool CBlockChain::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent)
 {
     return cntrBlock.ListForkUnspentBatch(hashFork, nMax, mapUnspent);
@@ -1237,6 +1254,69 @@ uint32 CBlockChain::DPoSTimestamp(const uint256& hashPrev)
     return pCoreProtocol->DPoSTimestamp(pIndexPrev);
 }
 
+Errno CBlockChain::VerifyBlockHeaderProof(const CBlock& header, const uint256& hashAncestor)
+{
+    // The delegate proof of a primary header is checked against the enrolled set the
+    // consensus of its height reads. That set is known only when the enroll block is
+    // stored, hashAncestor is the nearest stored block on the header's branch.
+    // Headers further ahead are checked when their bodies arrive.
+    const int nHeight = header.GetBlockHeight();
+    if (!header.IsPrimary() || nHeight < CONSENSUS_INTERVAL)
+    {
+        return OK;
+    }
+
+    const int nEnrollHeight = nHeight - CONSENSUS_DISTRIBUTE_INTERVAL - 1;
+    CBlockIndex* pIndex = nullptr;
+    if (!cntrBlock.RetrieveIndex(hashAncestor, &pIndex) || pIndex->GetBlockHeight() < nEnrollHeight)
+    {
+        return OK;
+    }
+    while (pIndex->GetBlockHeight() > nEnrollHeight)
+    {
+        pIndex = pIndex->pPrev;
+    }
+
+    CDelegateEnrolled enrolled;
+    if (!GetBlockDelegateEnrolled(pIndex->GetBlockHash(), enrolled))
+    {
+        Log("VerifyBlockHeaderProof : Get delegate enrolled fail, block: %s", pIndex->GetBlockHash().ToString().c_str());
+        return OK;
+    }
+
+    CDelegateAgreement agreement;
+    delegate::CDelegateVerify verifier(enrolled.mapWeight, enrolled.mapEnrollData);
+    map<CDestination, size_t> mapBallot;
+    if (!verifier.VerifyProof(header.vchProof, agreement.nAgreement, agreement.nWeight, mapBallot, pCoreProtocol->DPoSConsensusCheckRepeated(nHeight)))
+    {
+        return ERR_BLOCK_PROOF_OF_STAKE_INVALID;
+    }
+    size_t nEnrollTrust = 0;
+    pCoreProtocol->GetDelegatedBallot(agreement.nAgreement, agreement.nWeight, mapBallot, enrolled.vecAmount,
+                                      pIndex->GetMoneySupply(), agreement.vBallot, nEnrollTrust, nHeight);
+
+    if (agreement.IsProofOfWork())
+    {
+        return OK;
+    }
+    if (!pCoreProtocol->IsDposHeight(nHeight))
+    {
+        return ERR_BLOCK_PROOF_OF_STAKE_INVALID;
+    }
+
+    // the slot time needs the previous block, the signer is known without it
+    CBlockIndex* pIndexPrev = nullptr;
+    if (cntrBlock.RetrieveIndex(header.hashPrev, &pIndexPrev))
+    {
+        return pCoreProtocol->VerifyDelegatedProofOfStake(header, pIndexPrev, agreement);
+    }
+    if (header.txMint.sendTo != agreement.vBallot[0] || header.txMint.nTimeStamp != header.GetBlockTime())
+    {
+        return ERR_BLOCK_PROOF_OF_STAKE_INVALID;
+    }
+    return OK;
+}
+
 Errno CBlockChain::VerifyPowBlock(const CBlock& block, bool& fLongChain)
 {
     uint256 hash = block.GetHash();
@@ -1313,7 +1393,7 @@ Errno CBlockChain::VerifyPowBlock(const CBlock& block, bool& fLongChain)
             Log("VerifyPowBlock Get txContxt Error([%d] %s) : %s ", err, ErrorString(err), txid.ToString().c_str());
             return err;
         }
-        err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, block.GetBlockHeight(), pIndexPrev->GetOriginHash(), profile);
+        err = pCoreProtocol->VerifyBlockTx(tx, txContxt, pIndexPrev, hash, block.GetBlockHeight(), pIndexPrev->GetOriginHash(), profile);
         if (err != OK)
         {
             Log("VerifyPowBlock Verify BlockTx Error(%s) : %s ", ErrorString(err), txid.ToString().c_str());
@@ -1558,6 +1638,11 @@ bool CBlockChain::IsVacantBlockBeforeCreatedForkHeight(const uint256& hashFork,
     return true;
 }
 
+void CBlockChain::GetBlockCacheStat(xengine::CCacheStat& stat)
+{
+    cntrBlock.GetBlockCacheStat(stat);
+}
+
 bool CBlockChain::CheckContainer()
 {
     if (cntrBlock.IsEmpty())
@@ -2508,4 +2593,15 @@ int64 CBlockChain::GetAddressTxList(const uint256& hashFork, const CDestination&
     return cntrBlock.RetrieveAddressTxList(hashFork, dest, nPrevHeight, nPrevTxSeq, nOffset, nCount, vTx);
 }
 
+bool CBlockChain::ListAddressTxPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                    vector<CTxInfo>& vTx, int64& nHeightSeqNext)
+{
+    return cntrBlock.ListAddressTxPage(hashFork, dest, nHeightSeqCursor, fReverse, nCount, vTx, nHeightSeqNext);
+}
+
+bool CBlockChain::GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount)
+{
+    return cntrBlock.GetAddressTxCount(hashFork, dest, nTxCount);
+}
+
 } // namespace bigbang
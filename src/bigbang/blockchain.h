@@ -38,6 +38,7 @@ public:
     bool GetLastBlockTime(const uint256& hashFork, int nDepth, std::vector<int64>& vTime) override;
     bool GetBlock(const uint256& hashBlock, CBlock& block) override;
     bool GetBlockEx(const uint256& hashBlock, CBlockEx& block) override;
+    bool GetBlockHeader(const uint256& hashBlock, CBlock& header) override;
     bool GetOrigin(const uint256& hashFork, CBlock& block) override;
     bool Exists(const uint256& hashBlock) override;
     bool GetTransaction(const uint256& txid, CTransaction& tx) override;
@@ -47,6 +48,7 @@ public:
     bool GetTxUnspent(const uint256& hashFork, const std::vector<CTxIn>& vInput,
                       std::vector<CTxOut>& vOutput) override;
     bool FilterTx(const uint256& hashFork, CTxFilter& filter) override;
+    bool FilterTx(const uint256& hashFork, CTxFilter& filter, CTxFilterCursor& cursor, std::size_t nMaxBlock) override;
     bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter) override;
     bool ListForkContext(std::vector<CForkContext>& vForkCtxt, std::map<uint256, CValidForkId>& mapValidForkId) override;
     Errno AddNewBlock(const CBlock& block, CBlockChainUpdate& update) override;
@@ -58,6 +60,7 @@ public:
     bool GetBlockDelegateEnrolled(const uint256& hashBlock, CDelegateEnrolled& enrolled) override;
     bool GetBlockDelegateAgreement(const uint256& hashBlock, CDelegateAgreement& agreement) override;
     bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent) override;
+    bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent) override;
     bool ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent) override;
     bool GetVotes(const CDestination& destDelegate, int64& nVotes) override;
     bool ListDelegate(uint32 nCount, std::multimap<int64, CDestination>& mapVotes) override;
@@ -69,17 +72,22 @@ public:
     bool ListDelegatePayment(uint32 height, CBlock& block, std::multimap<int64, CDestination>& mapVotes) override;
     uint32 DPoSTimestamp(const uint256& hashPrev) override;
     Errno VerifyPowBlock(const CBlock& block, bool& fLongChain) override;
+    Errno VerifyBlockHeaderProof(const CBlock& header, const uint256& hashAncestor) override;
     bool VerifyBlockForkTx(const uint256& hashPrev, const CTransaction& tx, std::vector<std::pair<CDestination, CForkContext>>& vForkCtxt) override;
     bool CheckForkValidLast(const uint256& hashFork, CBlockChainUpdate& update) override;
     bool VerifyForkRefLongChain(const uint256& hashFork, const uint256& hashForkBlock, const uint256& hashPrimaryBlock) override;
     bool GetPrimaryHeightBlockTime(const uint256& hashLastBlock, int nHeight, uint256& hashBlock, int64& nTime) override;
     bool IsVacantBlockBeforeCreatedForkHeight(const uint256& hashFork, const CBlock& block) override;
+    void GetBlockCacheStat(xengine::CCacheStat& stat) override;
     bool GetDeFiRelation(const uint256& hashFork, const CDestination& destIn, CDestination& parent) override;
     bool ListDeFiRelation(const uint256& hashFork, xengine::CForest<CDestination, CDestination>& relation) override;
     bool InitDeFiRelation(const uint256& hashFork) override;
     bool CheckAddDeFiRelation(const uint256& hashFork, const CDestination& dest, const CDestination& parent) override;
     bool GetAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut) override;
     int64 GetAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) override;
+    bool ListAddressTxPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                           std::vector<CTxInfo>& vTx, int64& nHeightSeqNext) override;
+    bool GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount) override;
 
     /////////////    CheckPoints    /////////////////////
     typedef std::map<int, CCheckPoint> MapCheckPointsType;
@@ -17,6 +17,60 @@ using namespace boost::filesystem;
 namespace bigbang
 {
 
+// Forks keep their tables in separate sub databases, so each fork is checked
+// on its own thread. Returns false if any fork fails.
+static bool CheckForkParallel(map<uint256, CCheckBlockFork>& mapCheckFork,
+                              const boost::function<bool(const uint256&, CCheckBlockFork&)>& fnCheck)
+{
+    vector<map<uint256, CCheckBlockFork>::iterator> vFork;
+    for (auto it = mapCheckFork.begin(); it != mapCheckFork.end(); ++it)
+    {
+        vFork.push_back(it);
+    }
+
+    boost::mutex mtxNext;
+    size_t nNext = 0;
+    bool fRet = true;
+    auto fnWorker = [&]() {
+        for (;;)
+        {
+            map<uint256, CCheckBlockFork>::iterator it;
+            {
+                boost::unique_lock<boost::mutex> lock(mtxNext);
+                if (!fRet || nNext >= vFork.size())
+                {
+                    return;
+                }
+                it = vFork[nNext++];
+            }
+            bool fCheck = false;
+            try
+            {
+                fCheck = fnCheck(it->first, it->second);
+            }
+            catch (exception& e)
+            {
+                StdError("check", "Check fork %s error: %s", it->first.GetHex().c_str(), e.what());
+            }
+            if (!fCheck)
+            {
+                boost::unique_lock<boost::mutex> lock(mtxNext);
+                fRet = false;
+            }
+        }
+    };
+
+    size_t nWorker = min(vFork.size(), (size_t)max(boost::thread::hardware_concurrency(), 1U));
+    boost::thread_group workers;
+    for (size_t i = 1; i < nWorker; i++)
+    {
+        workers.create_thread(fnWorker);
+    }
+    fnWorker();
+    workers.join_all();
+    return fRet;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // CCheckForkUnspentWalker
 
@@ -1233,7 +1287,7 @@ bool CCheckBlockFork::AddBlockUnspent(const CTxOutPoint& txPoint, const CTxOut&
 
 bool CCheckBlockFork::AddBlockSpent(const CTxOutPoint& txPoint)
 {
-    map<CTxOutPoint, CCheckTxOut>::iterator it = mapBlockUnspent.find(txPoint);
+    CCheckUnspentMap::iterator it = mapBlockUnspent.find(txPoint);
     if (it == mapBlockUnspent.end())
     {
         StdLog("check", "Add Block Spent: utxo find fail, utxo: [%d] %s.", txPoint.n, txPoint.hash.GetHex().c_str());
@@ -1245,8 +1299,7 @@ bool CCheckBlockFork::AddBlockSpent(const CTxOutPoint& txPoint)
 
 bool CCheckBlockFork::InheritCopyData(const CCheckBlockFork& fromParent, const CBlockIndex* pJointBlockIndex)
 {
-    mapBlockUnspent.clear();
-    mapBlockUnspent.insert(fromParent.mapBlockUnspent.begin(), fromParent.mapBlockUnspent.end());
+    mapBlockUnspent = fromParent.mapBlockUnspent;
 
     mapParentForkBlockTxIndex.clear();
     mapParentForkBlockTxIndex.insert(fromParent.mapParentForkBlockTxIndex.begin(), fromParent.mapParentForkBlockTxIndex.end());
@@ -1417,7 +1470,7 @@ bool CCheckBlockWalker::Initialize(const string& strPath)
 
     if (fCheckAddrTxIndex)
     {
-        if (!dbAddressTxIndex.Initialize(path(strPath), false))
+        if (!dbAddressTxIndex.Initialize(path(strPath)))
         {
             StdLog("check", "dbAddressTxIndex Initialize fail");
             return false;
@@ -2171,7 +2224,7 @@ CBlockIndex* CCheckBlockWalker::AddNewIndex(const uint256& hash, const CBlock& b
             StdError("check", "AddNewIndex: insert fail, block: %s", hash.GetHex().c_str());
             return nullptr;
         }
-        pIndexNew->phashBlock = &((*mi).first);
+        pIndexNew->hashBlock = hash;
 
         int64 nMoneySupply = block.GetBlockMint();
         uint64 nRandBeacon = block.GetBlockBeacon();
@@ -2212,7 +2265,7 @@ CBlockIndex* CCheckBlockWalker::AddNewIndex(const uint256& hash, const CBlockOut
             delete pIndexNew;
             return nullptr;
         }
-        pIndexNew->phashBlock = &((*mi).first);
+        pIndexNew->hashBlock = hash;
 
         if (objBlockOutline.hashPrev != 0)
         {
@@ -2389,36 +2442,38 @@ bool CCheckBlockWalker::CheckRefBlock()
 
 bool CCheckBlockWalker::CheckSurplusAddressTxIndex(uint64& nTxIndexCount)
 {
-    map<uint256, CCheckBlockFork>::iterator mt = mapCheckFork.begin();
-    for (; mt != mapCheckFork.end(); ++mt)
+    for (const auto& vd : mapCheckFork)
     {
-        nTxIndexCount += mt->second.mapBlockTxInfo.size();
-        if (!mt->second.CheckForkAddressTxIndex(mt->first, 0x7FFFFFFF))
+        nTxIndexCount += vd.second.mapBlockTxInfo.size();
+    }
+
+    return CheckForkParallel(mapCheckFork, [&](const uint256& hashFork, CCheckBlockFork& fork) -> bool {
+        if (!fork.CheckForkAddressTxIndex(hashFork, 0x7FFFFFFF))
         {
-            StdLog("check", "Check address tx index: Check fork address txindex fail, fork: %s", mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Check fork address txindex fail, fork: %s", hashFork.GetHex().c_str());
             return false;
         }
 
-        CCheckAddressTxIndexWalker walker(mt->second.mapBlockTxIndex);
-        if (!dbAddressTxIndex.WalkThrough(mt->first, walker))
+        CCheckAddressTxIndexWalker walker(fork.mapBlockTxIndex);
+        if (!dbAddressTxIndex.WalkThrough(hashFork, walker))
         {
-            StdLog("check", "Check address tx index: Walk through address txindex fail, fork: %s", mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Walk through address txindex fail, fork: %s", hashFork.GetHex().c_str());
             return false;
         }
         if (!walker.vRemove.empty())
         {
-            StdLog("check", "Check address tx index: Remove address txindex count: %lu, fork: %s", walker.vRemove.size(), mt->first.GetHex().c_str());
+            StdLog("check", "Check address tx index: Remove address txindex count: %lu, fork: %s", walker.vRemove.size(), hashFork.GetHex().c_str());
             if (!fOnlyCheck)
             {
-                if (!dbAddressTxIndex.RepairAddressTxIndex(mt->first, vector<pair<CAddrTxIndex, CAddrTxInfo>>(), walker.vRemove))
+                if (!dbAddressTxIndex.RepairAddressTxIndex(hashFork, vector<pair<CAddrTxIndex, CAddrTxInfo>>(), walker.vRemove))
                 {
-                    StdLog("check", "Check address tx index: RepairAddressTxIndex fail, fork: %s", mt->first.GetHex().c_str());
+                    StdLog("check", "Check address tx index: RepairAddressTxIndex fail, fork: %s", hashFork.GetHex().c_str());
                     return false;
                 }
             }
         }
-    }
-    return true;
+        return true;
+    });
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -2516,27 +2571,22 @@ bool CCheckRepairData::FetchBlockData()
 bool CCheckRepairData::CheckRepairUnspent(uint64& nUnspentCount)
 {
     CUnspentDB dbUnspent;
-    if (!dbUnspent.Initialize(path(strDataPath), false))
+    if (!dbUnspent.Initialize(path(strDataPath)))
     {
         StdError("check", "Check repair unspent: dbUnspent Initialize fail");
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
-    {
-        const uint256& hashFork = it->first;
+    bool fRet = CheckForkParallel(objBlockWalker.mapCheckFork, [&](const uint256& hashFork, CCheckBlockFork& fork) -> bool {
         if (!dbUnspent.AddNewFork(hashFork))
         {
             StdError("check", "Check repair unspent: dbUnspent AddNewFork fail.");
-            dbUnspent.Deinitialize();
             return false;
         }
-        CCheckForkUnspentWalker forkUnspentWalker(it->second.mapBlockUnspent);
+        CCheckForkUnspentWalker forkUnspentWalker(fork.mapBlockUnspent);
         if (!dbUnspent.WalkThrough(hashFork, forkUnspentWalker))
         {
             StdError("check", "Check repair unspent: dbUnspent WalkThrough fail.");
-            dbUnspent.Deinitialize();
             return false;
         }
         if (!forkUnspentWalker.CheckForkUnspent())
@@ -2550,42 +2600,40 @@ bool CCheckRepairData::CheckRepairUnspent(uint64& nUnspentCount)
                 if (!dbUnspent.RepairUnspent(hashFork, forkUnspentWalker.vAddUpdate, forkUnspentWalker.vRemove))
                 {
                     StdError("check", "Check repair unspent: Repair unspent fail.");
-                    dbUnspent.Deinitialize();
                     return false;
                 }
             }
         }
-        nUnspentCount += it->second.mapBlockUnspent.size();
-    }
+        return true;
+    });
 
+    for (const auto& vd : objBlockWalker.mapCheckFork)
+    {
+        nUnspentCount += vd.second.mapBlockUnspent.size();
+    }
     dbUnspent.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckRepairAddressUnspent()
 {
     CAddressUnspentDB dbAddressUnspent;
-    if (!dbAddressUnspent.Initialize(path(strDataPath), false))
+    if (!dbAddressUnspent.Initialize(path(strDataPath)))
     {
         StdError("check", "Check address unspent: dbAddress Initialize fail");
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
-    {
-        const uint256& hashFork = it->first;
+    bool fRet = CheckForkParallel(objBlockWalker.mapCheckFork, [&](const uint256& hashFork, CCheckBlockFork& fork) -> bool {
         if (!dbAddressUnspent.AddNewFork(hashFork))
         {
             StdError("check", "Check address unspent: dbAddress AddNewFork fail.");
-            dbAddressUnspent.Deinitialize();
             return false;
         }
-        CCheckAddressUnspentWalker addressUnspentWalker(it->second.mapBlockUnspent);
+        CCheckAddressUnspentWalker addressUnspentWalker(fork.mapBlockUnspent);
         if (!dbAddressUnspent.WalkThrough(hashFork, addressUnspentWalker))
         {
             StdError("check", "Check address unspent: dbAddress WalkThrough fail.");
-            dbAddressUnspent.Deinitialize();
             return false;
         }
         if (!addressUnspentWalker.CheckForkAddressUnspent())
@@ -2599,42 +2647,42 @@ bool CCheckRepairData::CheckRepairAddressUnspent()
                 if (!dbAddressUnspent.RepairAddressUnspent(hashFork, addressUnspentWalker.vAddUpdate, addressUnspentWalker.vRemove))
                 {
                     StdError("check", "Check address unspent: Repair address unspent fail.");
-                    dbAddressUnspent.Deinitialize();
                     return false;
                 }
             }
         }
-        it->second.mapBlockUnspent.clear();
-    }
+        fork.mapBlockUnspent.clear();
+        return true;
+    });
 
     dbAddressUnspent.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckRepairAddress(uint64& nAddressCount)
 {
     CAddressDB dbAddress;
-    if (!dbAddress.Initialize(path(strDataPath), false))
+    if (!dbAddress.Initialize(path(strDataPath)))
     {
         StdError("check", "Check address: dbAddress Initialize fail");
         return false;
     }
 
-    map<uint256, CCheckBlockFork>::iterator it = objBlockWalker.mapCheckFork.begin();
-    for (; it != objBlockWalker.mapCheckFork.end(); ++it)
+    for (const auto& vd : objBlockWalker.mapCheckFork)
     {
-        const uint256& hashFork = it->first;
+        nAddressCount += vd.second.mapBlockAddress.size();
+    }
+
+    bool fRet = CheckForkParallel(objBlockWalker.mapCheckFork, [&](const uint256& hashFork, CCheckBlockFork& fork) -> bool {
         if (!dbAddress.AddNewFork(hashFork))
         {
             StdError("check", "Check address: dbAddress AddNewFork fail.");
-            dbAddress.Deinitialize();
             return false;
         }
-        CCheckAddressWalker checkAddressWalker(it->second.mapBlockAddress);
+        CCheckAddressWalker checkAddressWalker(fork.mapBlockAddress);
         if (!dbAddress.WalkThrough(hashFork, checkAddressWalker))
         {
             StdError("check", "Check address: dbAddress WalkThrough fail.");
-            dbAddress.Deinitialize();
             return false;
         }
         if (!checkAddressWalker.CheckAddress())
@@ -2649,17 +2697,16 @@ bool CCheckRepairData::CheckRepairAddress(uint64& nAddressCount)
                 {
                     StdError("check", "Check address: Repair address fail, update: %lu, remove: %lu, fork: %s",
                              checkAddressWalker.vAddUpdate.size(), checkAddressWalker.vRemove.size(), hashFork.GetHex().c_str());
-                    dbAddress.Deinitialize();
                     return false;
                 }
             }
         }
-        nAddressCount += it->second.mapBlockAddress.size();
-        it->second.mapBlockAddress.clear();
-    }
+        fork.mapBlockAddress.clear();
+        return true;
+    });
 
     dbAddress.Deinitialize();
-    return true;
+    return fRet;
 }
 
 bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
@@ -2671,18 +2718,21 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
         return false;
     }
 
-    map<uint256, vector<pair<uint256, CTxIndex>>> mapTxNew;
-    map<uint256, CCheckBlockFork>::iterator mt = objBlockWalker.mapCheckFork.begin();
-    for (; mt != objBlockWalker.mapCheckFork.end(); ++mt)
+    for (const auto& vd : objBlockWalker.mapCheckFork)
     {
-        if (!dbTxIndex.LoadFork(mt->first))
+        nTxIndexCount += vd.second.mapBlockTxIndex.size();
+    }
+
+    boost::mutex mtxCount;
+    int64 nUpdateTxIndexCount = 0;
+    bool fRet = CheckForkParallel(objBlockWalker.mapCheckFork, [&](const uint256& hashFork, CCheckBlockFork& fork) -> bool {
+        if (!dbTxIndex.LoadFork(hashFork))
         {
             StdLog("check", "Check tx index: dbTxIndex LoadFork fail");
-            dbTxIndex.Deinitialize();
             return false;
         }
-        const uint256& hashFork = mt->first;
-        const auto& mapBlockTxIndex = mt->second.mapBlockTxIndex;
+        vector<pair<uint256, CTxIndex>> vTxNew;
+        const auto& mapBlockTxIndex = fork.mapBlockTxIndex;
         for (auto nt = mapBlockTxIndex.begin(); nt != mapBlockTxIndex.end(); ++nt)
         {
             CTxIndex txIndex;
@@ -2691,7 +2741,7 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
                 StdLog("check", "Check tx index: Retrieve tx index fail, height: %d, tx: %s.",
                        nt->second.nBlockHeight, nt->first.GetHex().c_str());
 
-                mapTxNew[hashFork].push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
+                vTxNew.push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
             }
             else
             {
@@ -2701,35 +2751,33 @@ bool CCheckRepairData::CheckTxIndex(uint64& nTxIndexCount)
                            nt->second.nBlockHeight, nt->first.GetHex().c_str(),
                            txIndex.nFile, txIndex.nOffset, nt->second.nFile, nt->second.nOffset);
 
-                    mapTxNew[hashFork].push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
+                    vTxNew.push_back(make_pair(nt->first, CTxIndex(nt->second.nBlockHeight, nt->second.nFile, nt->second.nOffset)));
                 }
             }
-            ++nTxIndexCount;
         }
-        mt->second.mapBlockTxIndex.clear();
-    }
+        fork.mapBlockTxIndex.clear();
 
-    // repair
-    if (!fOnlyCheck && !mapTxNew.empty())
-    {
-        StdLog("check", "Repair tx index starting");
-        int64 nUpdateTxIndexCount = 0;
-        for (const auto& fork : mapTxNew)
+        // repair
+        if (!fOnlyCheck && !vTxNew.empty())
         {
-            if (!dbTxIndex.Update(fork.first, fork.second, vector<uint256>()))
+            if (!dbTxIndex.Update(hashFork, vTxNew, vector<uint256>()))
             {
-                StdLog("check", "Repair tx index update fail");
-                dbTxIndex.Deinitialize();
+                StdLog("check", "Repair tx index update fail, fork: %s", hashFork.GetHex().c_str());
                 return false;
             }
-            dbTxIndex.Flush(fork.first);
-            nUpdateTxIndexCount += fork.second.size();
+            dbTxIndex.Flush(hashFork);
+            boost::unique_lock<boost::mutex> lock(mtxCount);
+            nUpdateTxIndexCount += vTxNew.size();
         }
+        return true;
+    });
+    if (nUpdateTxIndexCount > 0)
+    {
         StdLog("check", "Repair tx index success, update: %lu", nUpdateTxIndexCount);
     }
 
     dbTxIndex.Deinitialize();
-    return true;
+    return fRet;
 }
 
 ////////////////////////////////////////////////////////////////
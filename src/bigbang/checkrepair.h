@@ -5,6 +5,10 @@
 #ifndef STORAGE_CHECKREPAIR_H
 #define STORAGE_CHECKREPAIR_H
 
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
 #include "address.h"
 #include "addressdb.h"
 #include "addressunspentdb.h"
@@ -87,18 +91,32 @@ public:
     }
 };
 
+class CCheckOutPointHash
+{
+public:
+    std::size_t operator()(const CTxOutPoint& point) const
+    {
+        std::size_t seed = point.hash.Get64();
+        boost::hash_combine(seed, point.n);
+        return seed;
+    }
+};
+
+typedef boost::unordered_map<CTxOutPoint, CCheckTxOut, CCheckOutPointHash> CCheckUnspentMap;
+typedef boost::unordered_set<CTxOutPoint, CCheckOutPointHash> CCheckOutPointSet;
+
 class CCheckForkUnspentWalker : public CForkUnspentDBWalker
 {
 public:
-    CCheckForkUnspentWalker(const map<CTxOutPoint, CCheckTxOut>& mapBlockUnspentIn)
+    CCheckForkUnspentWalker(const CCheckUnspentMap& mapBlockUnspentIn)
       : mapBlockUnspent(mapBlockUnspentIn) {}
 
     bool Walk(const CTxOutPoint& txout, const CTxOut& output) override;
     bool CheckForkUnspent();
 
 protected:
-    const map<CTxOutPoint, CCheckTxOut>& mapBlockUnspent;
-    set<CTxOutPoint> setForkUnspent;
+    const CCheckUnspentMap& mapBlockUnspent;
+    CCheckOutPointSet setForkUnspent;
 
 public:
     vector<CTxUnspent> vAddUpdate;
@@ -108,15 +126,15 @@ public:
 class CCheckAddressUnspentWalker : public CForkAddressUnspentDBWalker
 {
 public:
-    CCheckAddressUnspentWalker(const map<CTxOutPoint, CCheckTxOut>& mapBlockUnspentIn)
+    CCheckAddressUnspentWalker(const CCheckUnspentMap& mapBlockUnspentIn)
       : mapBlockUnspent(mapBlockUnspentIn) {}
 
     bool Walk(const CAddrUnspentKey& out, const CUnspentOut& unspent) override;
     bool CheckForkAddressUnspent();
 
 protected:
-    const map<CTxOutPoint, CCheckTxOut>& mapBlockUnspent;
-    set<CTxOutPoint> setForkUnspent;
+    const CCheckUnspentMap& mapBlockUnspent;
+    CCheckOutPointSet setForkUnspent;
 
 public:
     vector<pair<CAddrUnspentKey, CUnspentOut>> vAddUpdate;
@@ -335,7 +353,7 @@ public:
 class CCheckForkTxPool
 {
 public:
-    CCheckForkTxPool(const map<CTxOutPoint, CCheckTxOut>& mapUnspent)
+    CCheckForkTxPool(const CCheckUnspentMap& mapUnspent)
       : mapChainUnspent(mapUnspent) {}
 
     bool AddTx(const uint256& txid, const CAssembledTx& tx);
@@ -345,7 +363,7 @@ protected:
     bool Unspent(const CTxOutPoint& point, const CTxOut& out);
 
 protected:
-    const map<CTxOutPoint, CCheckTxOut>& mapChainUnspent;
+    const CCheckUnspentMap& mapChainUnspent;
     map<CTxOutPoint, CCheckTxOut> mapTxPoolUnspent;
 };
 
@@ -411,7 +429,7 @@ public:
     map<uint256, CCheckTxIndex> mapParentForkBlockTxIndex;
     map<uint256, CCheckTxIndex> mapBlockTxIndex;
     map<uint256, CCheckTxInfo> mapBlockTxInfo;
-    map<CTxOutPoint, CCheckTxOut> mapBlockUnspent;
+    CCheckUnspentMap mapBlockUnspent;
     map<CDestination, pair<uint256, CAddrInfo>> mapBlockAddress;
     uint64 nCacheTxInfoBlockCount;
     int32 nMintHeight;
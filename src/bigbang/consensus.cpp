@@ -11,6 +11,8 @@
 using namespace std;
 using namespace xengine;
 
+#define DELEGATE_TX_FILTER_BLOCK 1024
+
 namespace bigbang
 {
 
@@ -655,7 +657,21 @@ bool CConsensus::LoadDelegateTx()
     for (map<CDestination, CDelegateContext>::iterator it = mapContext.begin(); it != mapContext.end(); ++it)
     {
         CDelegateTxFilter txFilter((*it).second);
-        if (!pBlockChain->FilterTx(hashGenesis, txFilter) || !pTxPool->FilterTx(hashGenesis, txFilter))
+        // scan in chunks so the block storage lock is not held for the whole chain
+        CTxFilterCursor cursor;
+        while (!cursor.fEnd)
+        {
+            if (!pBlockChain->FilterTx(hashGenesis, txFilter, cursor, DELEGATE_TX_FILTER_BLOCK))
+            {
+                return false;
+            }
+            if (cursor.fRestart)
+            {
+                (*it).second.Clear();
+                cursor.fRestart = false;
+            }
+        }
+        if (!pTxPool->FilterTx(hashGenesis, txFilter))
         {
             return false;
         }
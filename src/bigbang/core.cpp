@@ -24,6 +24,9 @@ using namespace xengine;
 
 static const int64 MAX_CLOCK_DRIFT = 80;
 
+static const std::size_t MAX_VERIFIED_SIGNATURE_CACHE_COUNT = 200000;
+static const std::size_t MAX_VALIDATED_BLOCK_CACHE_COUNT = 4096;
+
 static const int PROOF_OF_WORK_BITS_LOWER_LIMIT = 8;
 static const int PROOF_OF_WORK_BITS_UPPER_LIMIT = 200;
 #ifdef BIGBANG_TESTNET
@@ -208,10 +211,107 @@ static const int32 CHANGE_DPOS_CHAIN_TRUST_HEIGHT = 565620;
 
 namespace bigbang
 {
+///////////////////////////////
+// CCoreWorkerPool
+
+CCoreWorkerPool::CCoreWorkerPool()
+  : pfnTask(nullptr), nTaskTotal(0), nTaskNext(0), nTaskDone(0), fStop(false)
+{
+}
+
+CCoreWorkerPool::~CCoreWorkerPool()
+{
+    Stop();
+}
+
+void CCoreWorkerPool::Start(size_t nWorker)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        fStop = false;
+    }
+    for (size_t i = 0; i < nWorker; i++)
+    {
+        thrWorker.create_thread(boost::bind(&CCoreWorkerPool::Work, this));
+    }
+}
+
+void CCoreWorkerPool::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPool);
+        fStop = true;
+    }
+    condWork.notify_all();
+    thrWorker.join_all();
+}
+
+void CCoreWorkerPool::Execute(size_t nTotal, const boost::function<void(size_t)>& fnTask)
+{
+    boost::unique_lock<boost::mutex> lockExecute(mtxExecute);
+    boost::unique_lock<boost::mutex> lock(mtxPool);
+    pfnTask = &fnTask;
+    nTaskTotal = nTotal;
+    nTaskNext = 0;
+    nTaskDone = 0;
+    condWork.notify_all();
+
+    // without workers the calling thread runs all of them
+    while (nTaskNext < nTaskTotal)
+    {
+        size_t nIndex = nTaskNext++;
+        lock.unlock();
+        RunTask(nIndex);
+        lock.lock();
+        nTaskDone++;
+    }
+    while (nTaskDone < nTaskTotal)
+    {
+        condDone.wait(lock);
+    }
+    pfnTask = nullptr;
+}
+
+void CCoreWorkerPool::Work()
+{
+    boost::unique_lock<boost::mutex> lock(mtxPool);
+    while (!fStop)
+    {
+        if (pfnTask == nullptr || nTaskNext >= nTaskTotal)
+        {
+            condWork.wait(lock);
+            continue;
+        }
+        size_t nIndex = nTaskNext++;
+        lock.unlock();
+        RunTask(nIndex);
+        lock.lock();
+        if (++nTaskDone == nTaskTotal)
+        {
+            condDone.notify_one();
+        }
+    }
+}
+
+void CCoreWorkerPool::RunTask(size_t nIndex)
+{
+    try
+    {
+        (*pfnTask)(nIndex);
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+    }
+}
+
 ///////////////////////////////
 // CCoreProtocol
 
 CCoreProtocol::CCoreProtocol()
+  : cacheVerifiedSig(MAX_VERIFIED_SIGNATURE_CACHE_COUNT),
+    cacheValidatedBlock(MAX_VALIDATED_BLOCK_CACHE_COUNT),
+    cacheProofOfWorkHash(MAX_VALIDATED_BLOCK_CACHE_COUNT)
 {
     nProofOfWorkLowerLimit = PROOF_OF_WORK_BITS_LOWER_LIMIT;
     nProofOfWorkUpperLimit = PROOF_OF_WORK_BITS_UPPER_LIMIT;
@@ -239,9 +339,19 @@ bool CCoreProtocol::HandleInitialize()
     {
         return false;
     }
+    // the calling thread verifies too
+    unsigned int nThreads = boost::thread::hardware_concurrency();
+    poolVerifier.Start(nThreads > 1 ? nThreads - 1 : 1);
     return true;
 }
 
+void CCoreProtocol::HandleDeinitialize()
+{
+    poolVerifier.Stop();
+    pBlockChain = nullptr;
+    pForkManager = nullptr;
+}
+
 Errno CCoreProtocol::Debug(const Errno& err, const char* pszFunc, const char* pszFormat, ...)
 {
     string strFormat(pszFunc);
@@ -427,6 +537,22 @@ Errno CCoreProtocol::ValidateTransaction(const CTransaction& tx, int nHeight)
 }
 
 Errno CCoreProtocol::ValidateBlock(const CBlock& block)
+{
+    // Blocks checked ahead by PreValidateBlock during recovery, keyed by the
+    // whole serialized block so a copy with other signature or tx data misses
+    if (cacheValidatedBlock.GetCount() != 0)
+    {
+        uint256 hashContent = GetBlockContentHash(block);
+        if (cacheValidatedBlock.Exists(hashContent))
+        {
+            cacheValidatedBlock.Remove(hashContent);
+            return OK;
+        }
+    }
+    return CheckBlock(block);
+}
+
+Errno CCoreProtocol::CheckBlock(const CBlock& block)
 {
     // These are checks that are independent of context
     // Only allow CBlock::BLOCK_PRIMARY type in v1.0.0
@@ -505,6 +631,73 @@ Errno CCoreProtocol::ValidateBlock(const CBlock& block)
     return OK;
 }
 
+Errno CCoreProtocol::ValidateBlockHeader(const CBlock& block)
+{
+    // Checks of a block without its transactions, used by headers-first sync
+    // before the body is downloaded. The delegate proof needs the enrolled set and
+    // is checked by the block chain, the rest of the chain context with the body.
+    if (!block.vtx.empty())
+    {
+        return DEBUG(ERR_BLOCK_TRANSACTIONS_INVALID, "header vtx is not empty");
+    }
+    if (block.IsOrigin())
+    {
+        return DEBUG(ERR_BLOCK_TYPE_INVALID, "header type error, type: %d", block.nType);
+    }
+    if (block.GetBlockTime() > GetNetTime() + MAX_CLOCK_DRIFT)
+    {
+        return DEBUG(ERR_BLOCK_TIMESTAMP_OUT_OF_RANGE, "%ld", block.GetBlockTime());
+    }
+
+    if (block.IsVacant())
+    {
+        if (!IsRefVacantHeight(block.GetBlockHeight()))
+        {
+            return ValidateVacantBlock(block);
+        }
+        if (block.txMint.nAmount != 0 || block.txMint.nTxFee != 0 || block.txMint.nType != CTransaction::TX_STAKE
+            || block.txMint.nTimeStamp == 0 || block.txMint.sendTo.IsNull() || block.hashMerkle != 0)
+        {
+            return DEBUG(ERR_BLOCK_TRANSACTIONS_INVALID, "invalid vacant header, nType: %d", block.txMint.nType);
+        }
+    }
+
+    if (!block.txMint.IsMintTx() || ValidateTransaction(block.txMint, block.GetBlockHeight()) != OK)
+    {
+        return DEBUG(ERR_BLOCK_TRANSACTIONS_INVALID, "invalid mint tx, tx type: %d", block.txMint.nType);
+    }
+
+    if (block.IsPrimary() && block.IsProofOfWork())
+    {
+        // The target depends on the chain, only its bounds and the hash are known here
+        if (block.vchProof.size() < CProofOfHashWorkCompact::PROOFHASHWORK_SIZE)
+        {
+            return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "vchProof size error.");
+        }
+        CProofOfHashWorkCompact proof;
+        proof.Load(block.vchProof);
+        if (proof.nAlgo != CM_CRYPTONIGHT || proof.nBits < nProofOfWorkLowerLimit || proof.nBits > nProofOfWorkUpperLimit)
+        {
+            return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "algo or bits error, nAlgo: %d, nBits: %d.", proof.nAlgo, proof.nBits);
+        }
+        if (proof.destMint != block.txMint.sendTo)
+        {
+            return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "destMint error, destMint: %s.", proof.destMint.ToString().c_str());
+        }
+        uint256 hashTarget = (~uint256(uint64(0)) >> proof.nBits);
+        if (GetProofOfWorkHash(block) > hashTarget)
+        {
+            return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "hash error, bits: %d", proof.nBits);
+        }
+    }
+
+    if (!CheckBlockSignature(block))
+    {
+        return DEBUG(ERR_BLOCK_SIGNATURE_INVALID, "Check block signature fail");
+    }
+    return OK;
+}
+
 Errno CCoreProtocol::VerifyForkTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight)
 {
     if (hashFork != GetGenesisBlockHash())
@@ -814,10 +1007,7 @@ Errno CCoreProtocol::VerifyProofOfWork(const CBlock& block, const CBlockIndex* p
 
     uint256 hashTarget = (~uint256(uint64(0)) >> nBits);
 
-    vector<unsigned char> vchProofOfWork;
-    block.GetSerializedProofOfWorkData(vchProofOfWork);
-    uint256 hash = crypto::CryptoPowHash(&vchProofOfWork[0], vchProofOfWork.size());
-
+    uint256 hash = GetProofOfWorkHash(block);
     if (hash > hashTarget)
     {
         return DEBUG(ERR_BLOCK_PROOF_OF_WORK_INVALID, "hash error: proof[%s] vs. target[%s] with bits[%d]",
@@ -895,7 +1085,7 @@ Errno CCoreProtocol::VerifyBlock(const CBlock& block, CBlockIndex* pIndexPrev)
 }
 
 Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev,
-                                   int nBlockHeight, const uint256& fork, const CProfile& profile)
+                                   const uint256& hashBlock, int nBlockHeight, const uint256& fork, const CProfile& profile)
 {
     Errno err = OK;
     const CDestination& destIn = txContxt.destIn;
@@ -1049,7 +1239,7 @@ Errno CCoreProtocol::VerifyBlockTx(const CTransaction& tx, const CTxContxt& txCo
         nBlockHeight -= 1;
     }
 
-    if (!destIn.VerifyTxSignature(tx.GetSignatureHash(), tx.nType, tx.hashAnchor, tx.sendTo, vchSig, nBlockHeight, fork))
+    if (!IsTrustedBlock(hashBlock) && !VerifyTxSignature(tx, destIn, vchSig, nBlockHeight, fork))
     {
         return DEBUG(ERR_TRANSACTION_SIGNATURE_INVALID, "invalid signature");
     }
@@ -1162,7 +1352,7 @@ Errno CCoreProtocol::VerifyTransaction(const CTransaction& tx, const vector<CTxO
         return DEBUG(ERR_TRANSACTION_SIGNATURE_INVALID, "invalid recoreded destination");
     }
 
-    if (!destIn.VerifyTxSignature(tx.GetSignatureHash(), tx.nType, tx.hashAnchor, tx.sendTo, vchSig, nForkHeight + 1, fork))
+    if (!VerifyTxSignature(tx, destIn, vchSig, nForkHeight + 1, fork))
     {
         return DEBUG(ERR_TRANSACTION_SIGNATURE_INVALID, "invalid signature");
     }
@@ -1257,6 +1447,91 @@ Errno CCoreProtocol::VerifyTransaction(const CTransaction& tx, const vector<CTxO
     return OK;
 }
 
+void CCoreProtocol::PreVerifyBlockTxSignature(const CBlock& block, const vector<CTxContxt>& vTxContxt, int nBlockHeight, const uint256& fork)
+{
+    // Signatures are only checked here to warm up cacheVerifiedSig on worker threads,
+    // VerifyBlockTx is still the authoritative check and reports the error.
+    if (IsTrustedBlock(block.GetHash()))
+    {
+        return;
+    }
+    vector<size_t> vIndex;
+    vIndex.reserve(block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size() && i < vTxContxt.size(); i++)
+    {
+        const CTransaction& tx = block.vtx[i];
+        if (tx.nType == CTransaction::TX_DEFI_REWARD || vTxContxt[i].destIn.IsNull())
+        {
+            continue;
+        }
+        vIndex.push_back(i);
+    }
+    if (vIndex.size() < 2)
+    {
+        return;
+    }
+
+    poolVerifier.Execute(vIndex.size(), [&](size_t n) {
+        const size_t i = vIndex[n];
+        const CTransaction& tx = block.vtx[i];
+        const CDestination& destIn = vTxContxt[i].destIn;
+
+        vector<uint8> vchSig;
+        if (!CTemplate::VerifyDestRecorded(tx, nBlockHeight, vchSig))
+        {
+            return;
+        }
+
+        int nHeight = nBlockHeight;
+        CTemplateId tid;
+        if (destIn.GetTemplateId(tid) && tid.GetType() == TEMPLATE_DEXMATCH && nHeight < (int)MATCH_VERIFY_ERROR_HEIGHT)
+        {
+            nHeight -= 1;
+        }
+        VerifyTxSignature(tx, destIn, vchSig, nHeight, fork);
+    });
+}
+
+void CCoreProtocol::PreValidateBlock(const CBlock& block)
+{
+    // Context free checks ahead of AddNewBlock, the results are picked up
+    // from cacheValidatedBlock and cacheProofOfWorkHash. Safe on any thread.
+    if (CheckBlock(block) != OK)
+    {
+        return;
+    }
+    cacheValidatedBlock.AddNew(GetBlockContentHash(block), true);
+    if (block.IsProofOfWork() && block.vchProof.size() >= CProofOfHashWorkCompact::PROOFHASHWORK_SIZE)
+    {
+        GetProofOfWorkHash(block);
+    }
+}
+
+uint256 CCoreProtocol::GetBlockContentHash(const CBlock& block)
+{
+    CBufStream ss;
+    ss << block;
+    return crypto::CryptoHash(ss.GetData(), ss.GetSize());
+}
+
+void CCoreProtocol::SetTrustedBlock(set<uint256>& setBlock)
+{
+    // set when recovery begins and reset when it ends, either way blocks
+    // checked ahead by the previous run are stale
+    {
+        boost::unique_lock<boost::shared_mutex> wlock(rwTrusted);
+        setTrustedBlock.swap(setBlock);
+    }
+    cacheValidatedBlock.Clear();
+}
+
+bool CCoreProtocol::IsTrustedBlock(const uint256& hashBlock)
+{
+    // only blocks of the primary chain anchored by the checkpoints, side branches are checked
+    boost::shared_lock<boost::shared_mutex> rlock(rwTrusted);
+    return (!setTrustedBlock.empty() && setTrustedBlock.count(hashBlock) != 0);
+}
+
 Errno CCoreProtocol::VerifyMintHeightTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight, const CProfile& profile)
 {
     if (profile.nForkType != FORK_TYPE_DEFI)
@@ -1655,6 +1930,10 @@ const std::set<CDestination> CCoreProtocol::GetDeFiBlacklist(const uint256& hash
 
 bool CCoreProtocol::CheckBlockSignature(const CBlock& block)
 {
+    if (IsTrustedBlock(block.GetHash()))
+    {
+        return true;
+    }
     if (block.GetHash() != GetGenesisBlockHash())
     {
         return block.txMint.sendTo.VerifyBlockSignature(block.GetHash(), block.vchSig);
@@ -1987,6 +2266,79 @@ Errno CCoreProtocol::VerifyDeFiRelationTx(const CTransaction& tx, const CDestina
     return OK;
 }
 
+// whether the signature check of destIn reads the height it is verified at
+static bool IsHeightDependentSignature(const CDestination& destIn)
+{
+    CTemplateId tid;
+    if (!destIn.GetTemplateId(tid))
+    {
+        return false;
+    }
+    switch (tid.GetType())
+    {
+    // switch to the defect multi-sign algorithm below HEIGHT_HASH_MULTI_SIGNER
+    case TEMPLATE_WEIGHTED:
+    case TEMPLATE_MULTISIG:
+    // accept other signers outside the execution and end heights
+    case TEMPLATE_PAYMENT:
+    // switch from the deal seller to the seller after nSellerValidHeight
+    case TEMPLATE_DEXMATCH:
+        return true;
+    // pass the height on to the destinations they wrap, which may be any of the above
+    case TEMPLATE_FORK:
+    case TEMPLATE_PROOF:
+    case TEMPLATE_DELEGATE:
+    case TEMPLATE_VOTE:
+    case TEMPLATE_DEXORDER:
+    case TEMPLATE_DEXBBCMAP:
+        return true;
+    // leaves the signature to the exchange tx checks
+    case TEMPLATE_EXCHANGE:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool CCoreProtocol::VerifyTxSignature(const CTransaction& tx, const CDestination& destIn, const vector<uint8>& vchSig, int nHeight, const uint256& fork)
+{
+    // txid commits to tx.vchSig, but the vchSig checked here is taken from it by height,
+    // the height is only keyed for the templates reading it so that an entry added
+    // by the pool is picked up by the block that includes the tx at any later height
+    CBufStream ss;
+    ss << tx.GetHash() << tx.GetSignatureHash() << destIn << fork;
+    if (IsHeightDependentSignature(destIn))
+    {
+        ss << nHeight;
+    }
+    uint256 hashKey = crypto::CryptoHash(ss.GetData(), ss.GetSize());
+    if (cacheVerifiedSig.Exists(hashKey))
+    {
+        return true;
+    }
+
+    if (!destIn.VerifyTxSignature(tx.GetSignatureHash(), tx.nType, tx.hashAnchor, tx.sendTo, vchSig, nHeight, fork))
+    {
+        return false;
+    }
+    cacheVerifiedSig.AddNew(hashKey, true);
+    return true;
+}
+
+uint256 CCoreProtocol::GetProofOfWorkHash(const CBlock& block)
+{
+    uint256 hashBlock = block.GetHash();
+    uint256 hash;
+    if (!cacheProofOfWorkHash.Retrieve(hashBlock, hash))
+    {
+        vector<unsigned char> vchProofOfWork;
+        block.GetSerializedProofOfWorkData(vchProofOfWork);
+        hash = crypto::CryptoPowHash(&vchProofOfWork[0], vchProofOfWork.size());
+        cacheProofOfWorkHash.AddNew(hashBlock, hash);
+    }
+    return hash;
+}
+
 ///////////////////////////////
 // CTestNetCoreProtocol
 
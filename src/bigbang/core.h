@@ -10,6 +10,34 @@
 namespace bigbang
 {
 
+// worker threads kept for the lifetime of the protocol, one batch runs at a time
+class CCoreWorkerPool
+{
+public:
+    CCoreWorkerPool();
+    ~CCoreWorkerPool();
+    void Start(std::size_t nWorker);
+    void Stop();
+    // runs fnTask over [0, nTotal) on the workers and the calling thread
+    void Execute(std::size_t nTotal, const boost::function<void(std::size_t)>& fnTask);
+
+protected:
+    void Work();
+    void RunTask(std::size_t nIndex);
+
+protected:
+    boost::mutex mtxExecute;
+    boost::mutex mtxPool;
+    boost::condition_variable condWork;
+    boost::condition_variable condDone;
+    const boost::function<void(std::size_t)>* pfnTask;
+    std::size_t nTaskTotal;
+    std::size_t nTaskNext;
+    std::size_t nTaskDone;
+    bool fStop;
+    boost::thread_group thrWorker;
+};
+
 class CCoreProtocol : public ICoreProtocol
 {
 public:
@@ -20,14 +48,18 @@ public:
     virtual void GetGenesisBlock(CBlock& block) override;
     virtual Errno ValidateTransaction(const CTransaction& tx, int nHeight) override;
     virtual Errno ValidateBlock(const CBlock& block) override;
+    virtual Errno ValidateBlockHeader(const CBlock& block) override;
     virtual Errno VerifyForkTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight) override;
     virtual Errno VerifyForkRedeem(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork,
                                    const uint256& hashPrevBlock, const vector<uint8>& vchSubSig, const int64 nValueIn) override;
     virtual Errno ValidateOrigin(const CBlock& block, const CProfile& parentProfile, CProfile& forkProfile) override;
 
     virtual Errno VerifyBlock(const CBlock& block, CBlockIndex* pIndexPrev) override;
-    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, int nBlockHeight, const uint256& fork, const CProfile& profile) override;
+    virtual Errno VerifyBlockTx(const CTransaction& tx, const CTxContxt& txContxt, CBlockIndex* pIndexPrev, const uint256& hashBlock, int nBlockHeight, const uint256& fork, const CProfile& profile) override;
     virtual Errno VerifyTransaction(const CTransaction& tx, const std::vector<CTxOut>& vPrevOutput, int nForkHeight, const uint256& fork, const CProfile& profile) override;
+    virtual void PreVerifyBlockTxSignature(const CBlock& block, const std::vector<CTxContxt>& vTxContxt, int nBlockHeight, const uint256& fork) override;
+    virtual void PreValidateBlock(const CBlock& block) override;
+    virtual void SetTrustedBlock(std::set<uint256>& setBlock) override;
     virtual Errno VerifyMintHeightTx(const CTransaction& tx, const CDestination& destIn, const uint256& hashFork, const int nHeight, const CProfile& profile) override;
 
     virtual Errno VerifyProofOfWork(const CBlock& block, const CBlockIndex* pIndexPrev) override;
@@ -52,7 +84,11 @@ public:
 
 protected:
     bool HandleInitialize() override;
+    void HandleDeinitialize() override;
     Errno Debug(const Errno& err, const char* pszFunc, const char* pszFormat, ...);
+    Errno CheckBlock(const CBlock& block);
+    uint256 GetBlockContentHash(const CBlock& block);
+    bool IsTrustedBlock(const uint256& hashBlock);
     bool CheckBlockSignature(const CBlock& block);
     Errno ValidateVacantBlock(const CBlock& block);
     Errno VerifyCertTx(const CTransaction& tx, const CDestination& destIn, const uint256& fork);
@@ -60,6 +96,8 @@ protected:
     Errno VerifyDexOrderTx(const CTransaction& tx, const CDestination& destIn, int64 nValueIn, int nHeight);
     Errno VerifyDexMatchTx(const CTransaction& tx, int64 nValueIn, int nHeight);
     Errno VerifyDeFiRelationTx(const CTransaction& tx, const CDestination& destIn, int nHeight, const uint256& fork);
+    bool VerifyTxSignature(const CTransaction& tx, const CDestination& destIn, const std::vector<uint8>& vchSig, int nHeight, const uint256& fork);
+    uint256 GetProofOfWorkHash(const CBlock& block);
 
 protected:
     uint256 hashGenesisBlock;
@@ -72,6 +110,12 @@ protected:
     int64 nProofOfWorkLowerTargetOfDpos;
     IBlockChain* pBlockChain;
     IForkManager* pForkManager;
+    xengine::CCache<uint256, bool> cacheVerifiedSig;
+    xengine::CCache<uint256, bool> cacheValidatedBlock;
+    xengine::CCache<uint256, uint256> cacheProofOfWorkHash;
+    boost::shared_mutex rwTrusted;
+    std::set<uint256> setTrustedBlock;
+    CCoreWorkerPool poolVerifier;
 };
 
 class CTestNetCoreProtocol : public CCoreProtocol
@@ -20,14 +20,18 @@
 #include "delegatedchn.h"
 #include "dispatcher.h"
 #include "forkmanager.h"
+#include "leveldbeng.h"
 #include "miner.h"
 #include "netchn.h"
 #include "network.h"
+#include "param.h"
 #include "purger.h"
 #include "recovery.h"
 #include "rpcclient.h"
 #include "rpcmod.h"
 #include "service.h"
+#include "snapshot.h"
+#include "timeseries.h"
 #include "txpool.h"
 #include "version.h"
 #include "wallet.h"
@@ -96,6 +100,13 @@ bool CBbEntry::Initialize(int argc, char* argv[])
         return false;
     }
 
+    // export snapshot
+    if (!config.GetConfig()->strExportSnapshot.empty())
+    {
+        ExportSnapshot();
+        return false;
+    }
+
     // list config if in debug mode
     if (config.GetConfig()->fDebug)
     {
@@ -157,8 +168,68 @@ bool CBbEntry::Initialize(int argc, char* argv[])
         return false;
     }
 
-    // check and repair data
-    if (config.GetModeType() == EModeType::MODE_SERVER
+    // database tuning
+    if (config.GetModeType() == EModeType::MODE_SERVER)
+    {
+        const CStorageConfig* pStorageConfig = CastConfigPtr<CStorageConfig*>(config.GetConfig());
+        storage::CLevelDBArguments::SetProfile(storage::CLevelDBArguments::PROFILE_UNSPENT,
+                                               storage::CLevelDBProfile((size_t)pStorageConfig->nUnspentDBCache << 20,
+                                                                        (size_t)pStorageConfig->nUnspentDBBuffer << 20,
+                                                                        pStorageConfig->nUnspentDBFiles));
+        storage::CLevelDBArguments::SetProfile(storage::CLevelDBArguments::PROFILE_ADDRESS,
+                                               storage::CLevelDBProfile((size_t)pStorageConfig->nAddressDBCache << 20,
+                                                                        (size_t)pStorageConfig->nAddressDBBuffer << 20,
+                                                                        pStorageConfig->nAddressDBFiles));
+        storage::CLevelDBArguments::SetProfile(storage::CLevelDBArguments::PROFILE_TXINDEX,
+                                               storage::CLevelDBProfile((size_t)pStorageConfig->nTxIndexDBCache << 20,
+                                                                        (size_t)pStorageConfig->nTxIndexDBBuffer << 20,
+                                                                        pStorageConfig->nTxIndexDBFiles));
+        storage::CLevelDBArguments::SetProfile(storage::CLevelDBArguments::PROFILE_WALLET,
+                                               storage::CLevelDBProfile((size_t)pStorageConfig->nWalletDBCache << 20,
+                                                                        (size_t)pStorageConfig->nWalletDBBuffer << 20,
+                                                                        pStorageConfig->nWalletDBFiles));
+        storage::CLevelDBArguments::SetBloomBits(pStorageConfig->nDBBloomBits);
+    }
+
+    // initialize an empty data directory from snapshot
+    if (config.GetModeType() == EModeType::MODE_SERVER && !config.GetConfig()->strImportSnapshot.empty()
+        && !ImportSnapshot())
+    {
+        return false;
+    }
+
+    // migrate per fork databases into the shared database
+    if (config.GetModeType() == EModeType::MODE_SERVER && config.GetConfig()->fSharedForkDB
+        && !storage::CLevelDBShared::IsSharedLayout(pathData))
+    {
+        StdLog("Bigbang", "Migrate fork databases...");
+        if (!storage::CLevelDBShared::Migrate(pathData))
+        {
+            StdError("Bigbang", "Migrate fork databases fail.");
+            return false;
+        }
+        StdLog("Bigbang", "Migrate fork databases success.");
+    }
+
+    // check and repair data. It rebuilds from the block files, which an imported
+    // snapshot ships from its first block file on only, so it is skipped then
+    bool fPartialBlockFile = false;
+    if (config.GetModeType() == EModeType::MODE_SERVER)
+    {
+        storage::CTimeSeriesCached tsBlock;
+        fPartialBlockFile = (tsBlock.Initialize(pathData / "block", "block") && tsBlock.GetFirstFile() > 1);
+        tsBlock.Deinitialize();
+        if (fPartialBlockFile && config.GetConfig()->fOnlyCheck)
+        {
+            StdError("Bigbang", "Check data fail, block files before %u were left out of the imported snapshot.", tsBlock.GetFirstFile());
+            return false;
+        }
+        if (fPartialBlockFile && config.GetConfig()->fCheckRepair)
+        {
+            StdLog("Bigbang", "Skip check and repair, block files before %u were left out of the imported snapshot.", tsBlock.GetFirstFile());
+        }
+    }
+    if (config.GetModeType() == EModeType::MODE_SERVER && !fPartialBlockFile
         && (config.GetConfig()->fCheckRepair || config.GetConfig()->fOnlyCheck))
     {
         CCheckRepairData check(pathData.string(), config.GetConfig()->fTestNet, config.GetConfig()->fOnlyCheck, config.GetConfig()->fAddrTxIndex);
@@ -326,7 +397,9 @@ bool CBbEntry::InitializeModules(const EModeType& mode)
             {
                 return false;
             }
-            dynamic_cast<CHttpServer*>(pBase)->AddNewHost(GetRPCHostConfig());
+            CHttpServer* pHttpServer = dynamic_cast<CHttpServer*>(pBase);
+            pHttpServer->AddNewHost(GetRPCHostConfig());
+            pHttpServer->SetIoThreadCount(CastConfigPtr<CRPCServerConfig*>(config.GetConfig())->nRPCIOThreads);
 
             if (!AttachModule(new CRPCMod()))
             {
@@ -458,6 +531,110 @@ void CBbEntry::PurgeStorage()
     }
 }
 
+void CBbEntry::ExportSnapshot()
+{
+    path& pathData = config.GetConfig()->pathData;
+
+    if (!TryLockFile((pathData / ".lock").string()))
+    {
+        cerr << "Cannot obtain a lock on data directory " << pathData << "\n"
+             << "Bigbang is probably already running.\n";
+        return;
+    }
+
+    CProofOfWorkParam param(config.GetConfig()->fTestNet);
+
+    CSnapshot snapshot(pathData, param.hashGenesisBlock);
+    CSnapshot::CHeader header;
+    if (snapshot.Export(path(config.GetConfig()->strExportSnapshot), config.GetConfig()->nSnapshotBlockDepth, header))
+    {
+        cout << "Exported snapshot at height " << header.nHeight << ", last block " << header.hashLastBlock.GetHex()
+             << ", block files from " << header.nFirstBlockFile << "\n";
+
+        map<int, uint256> mapCheckPoint;
+        GetSnapshotCheckPoint(param.hashGenesisBlock, mapCheckPoint);
+        auto it = mapCheckPoint.find(header.nHeight);
+        if (it == mapCheckPoint.end() || it->second != header.hashLastBlock)
+        {
+            cout << "Warning: the last block is not a checkpoint, the snapshot can only be imported with -snapshotcheckpoint="
+                 << header.nHeight << ":" << header.hashLastBlock.GetHex() << "\n";
+        }
+    }
+    else
+    {
+        cout << "Failed to export snapshot\n";
+    }
+}
+
+bool CBbEntry::ImportSnapshot()
+{
+    path& pathData = config.GetConfig()->pathData;
+    if (exists(pathData / "blockindex"))
+    {
+        StdLog("Bigbang", "Data directory is not empty, skip snapshot import.");
+        return true;
+    }
+
+    CProofOfWorkParam param(config.GetConfig()->fTestNet);
+    map<int, uint256> mapCheckPoint;
+    if (!GetSnapshotCheckPoint(param.hashGenesisBlock, mapCheckPoint))
+    {
+        StdError("Bigbang", "Invalid -snapshotcheckpoint, expect <height>:<hash>.");
+        return false;
+    }
+    // without a checkpoint past genesis no snapshot tip can be trusted
+    if (mapCheckPoint.rbegin()->first == 0)
+    {
+        StdError("Bigbang", "No checkpoint on this network, -importsnapshot needs -snapshotcheckpoint=<height>:<hash>.");
+        return false;
+    }
+
+    StdLog("Bigbang", "Import snapshot...");
+    CSnapshot snapshot(pathData, param.hashGenesisBlock);
+    CSnapshot::CHeader header;
+    if (!snapshot.Import(path(config.GetConfig()->strImportSnapshot), mapCheckPoint, header))
+    {
+        StdError("Bigbang", "Import snapshot fail.");
+        return false;
+    }
+    StdLog("Bigbang", "Import snapshot success, height: %d, block files from: %u.", header.nHeight, header.nFirstBlockFile);
+    return true;
+}
+
+bool CBbEntry::GetSnapshotCheckPoint(const uint256& hashGenesis, map<int, uint256>& mapCheckPoint)
+{
+    mapCheckPoint.clear();
+#ifndef BIGBANG_TESTNET
+    auto it = mapCheckPointsList.find(hashGenesis);
+    if (it != mapCheckPointsList.end())
+    {
+        mapCheckPoint = it->second;
+    }
+#endif
+    mapCheckPoint.insert(make_pair(0, hashGenesis));
+
+    // the configured snapshot tip is trusted the same way as a built in checkpoint
+    const string& strCheckPoint = config.GetConfig()->strSnapshotCheckPoint;
+    if (!strCheckPoint.empty())
+    {
+        size_t nPos = strCheckPoint.find(':');
+        uint256 hash;
+        int nHeight = 0;
+        if (nPos == string::npos || sscanf(strCheckPoint.substr(0, nPos).c_str(), "%d", &nHeight) != 1 || nHeight <= 0
+            || hash.SetHex(strCheckPoint.substr(nPos + 1)) != strCheckPoint.size() - nPos - 1
+            || CBlock::GetBlockHeightByHash(hash) != nHeight)
+        {
+            return false;
+        }
+        auto mt = mapCheckPoint.insert(make_pair(nHeight, hash)).first;
+        if (mt->second != hash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CBbEntry::Run()
 {
     if (!docker.Run())
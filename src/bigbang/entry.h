@@ -31,6 +31,9 @@ protected:
     xengine::CHttpHostConfig GetRPCHostConfig();
 
     void PurgeStorage();
+    void ExportSnapshot();
+    bool ImportSnapshot();
+    bool GetSnapshotCheckPoint(const uint256& hashGenesis, std::map<int, uint256>& mapCheckPoint);
 
     boost::filesystem::path GetDefaultDataDir();
 
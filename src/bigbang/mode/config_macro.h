@@ -16,6 +16,9 @@
 #define DEFAULT_TESTNET_RPCPORT 9904
 #define DEFAULT_RPC_MAX_CONNECTIONS 5
 #define DEFAULT_RPC_CONNECT_TIMEOUT 600 //120
+#define DEFAULT_RPC_IO_THREADS 1
+#define DEFAULT_RPC_THREADS 4
+#define DEFAULT_RPC_QUEUE_TIMEOUT 30
 
 // network config
 #define DEFAULT_P2PPORT 9901
@@ -24,6 +27,7 @@
 #define DEFAULT_MAX_INBOUNDS 125
 #define DEFAULT_MAX_OUTBOUNDS 10
 #define DEFAULT_CONNECT_TIMEOUT 5
+#define DEFAULT_NET_IO_THREADS 1
 
 // storage config
 #define DEFAULT_DB_CONNECTION 8
@@ -34,6 +34,42 @@ bool CStorageConfig::PostLoad()
         return false;
     }
 
+    if (nBlockCacheSize < 0)
+    {
+        printf("blockcache must be not less than 0!\n");
+        return false;
+    }
+
+    if (nBlockSyncRecords < 0 || nBlockSyncInterval < 0)
+    {
+        printf("blocksyncrecords and blocksyncinterval must be not less than 0!\n");
+        return false;
+    }
+
+    if (nUnspentDBCache < 0 || nAddressDBCache < 0 || nTxIndexDBCache < 0 || nWalletDBCache < 0)
+    {
+        printf("database cache size must be not less than 0!\n");
+        return false;
+    }
+
+    if (nUnspentDBBuffer <= 0 || nAddressDBBuffer <= 0 || nTxIndexDBBuffer <= 0 || nWalletDBBuffer <= 0)
+    {
+        printf("database write buffer size must be greater than 0!\n");
+        return false;
+    }
+
+    if (nUnspentDBFiles <= 0 || nAddressDBFiles <= 0 || nTxIndexDBFiles <= 0 || nWalletDBFiles <= 0)
+    {
+        printf("database max open files must be greater than 0!\n");
+        return false;
+    }
+
+    if (nDBBloomBits < 0)
+    {
+        printf("dbbloombits must be not less than 0!\n");
+        return false;
+    }
+
     return true;
 }
 
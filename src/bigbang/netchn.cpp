@@ -134,6 +134,7 @@ bool CNetChannelPeer::MakeTxInv(const uint256& hashFork, const vector<uint256>&
 // CNetChannel
 
 CNetChannel::CNetChannel()
+  : cacheHeader(MAX_HEADER_CACHE_COUNT)
 {
     pPeerNet = nullptr;
     pCoreProtocol = nullptr;
@@ -888,32 +889,29 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetData& eventGetData)
                 eventGetFail.data.push_back(inv);
             }
         }
-        else if (inv.nType == network::CInv::MSG_BLOCK)
+        else if (inv.nType == network::CInv::MSG_BLOCK || inv.nType == network::CInv::MSG_CMPCT_BLOCK)
         {
             bool fGetRet = false;
             network::CEventPeerBlock eventBlock(nNonce, hashFork);
-            if (hashFork == pCoreProtocol->GetGenesisBlockHash())
+            try
             {
-                try
-                {
-                    boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
-                    CSchedule& sched = GetSchedule(hashFork);
-                    if (sched.GetCachePowBlock(inv.nHash, eventBlock.data))
-                    {
-                        fGetRet = true;
-                    }
-                }
-                catch (exception& e)
-                {
-                    DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetData: ") + e.what());
-                    return true;
-                }
+                fGetRet = GetRelayBlock(hashFork, inv.nHash, eventBlock.data);
             }
-            if (!fGetRet && pBlockChain->GetBlock(inv.nHash, eventBlock.data))
+            catch (exception& e)
             {
-                fGetRet = true;
+                DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetData: ") + e.what());
+                return true;
             }
-            if (fGetRet)
+            if (fGetRet && inv.nType == network::CInv::MSG_CMPCT_BLOCK)
+            {
+                network::CEventPeerCmpctBlock eventCmpctBlock(nNonce, hashFork);
+                eventCmpctBlock.data = CCompactBlock(eventBlock.data, crypto::CryptoGetRand64());
+                pPeerNet->DispatchEvent(&eventCmpctBlock);
+                StdTrace("NetChannel", "CEventPeerGetData: get compact block success, peer: %s, height: %d, block: %s, txs: %lu",
+                         GetPeerAddressInfo(nNonce).c_str(), CBlock::GetBlockHeightByHash(inv.nHash), inv.nHash.GetHex().c_str(),
+                         eventBlock.data.vtx.size());
+            }
+            else if (fGetRet)
             {
                 pPeerNet->DispatchEvent(&eventBlock);
                 StdTrace("NetChannel", "CEventPeerGetData: get block success, peer: %s, height: %d, block: %s",
@@ -1007,6 +1005,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerTx& eventTx)
     uint64 nNonce = eventTx.nNonce;
     uint256& hashFork = eventTx.hashFork;
     CTransaction& tx = eventTx.data;
+    tx.MemoizeHash();
     uint256 txid = tx.GetHash();
 
     try
@@ -1178,11 +1177,33 @@ bool CNetChannel::HandleEvent(network::CEventPeerGetFail& eventGetFail)
         boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
         CSchedule& sched = GetSchedule(hashFork);
 
+        bool fBlockFail = false;
+        bool fHeaderFail = false;
         for (const network::CInv& inv : eventGetFail.data)
         {
             StdTrace("NetChannel", "CEventPeerGetFail: get data fail, peer: %s, inv: [%d] %s",
                      GetPeerAddressInfo(nNonce).c_str(), inv.nType, inv.nHash.GetHex().c_str());
-            sched.CancelAssignedInv(nNonce, inv);
+            if (inv.nType == network::CInv::MSG_BLOCK || inv.nType == network::CInv::MSG_CMPCT_BLOCK)
+            {
+                fHeaderFail |= (sched.GetHeader(inv.nHash) != nullptr);
+                fBlockFail |= sched.CancelAssignedInv(nNonce, network::CInv(network::CInv::MSG_BLOCK, inv.nHash));
+            }
+            else
+            {
+                sched.CancelAssignedInv(nNonce, inv);
+            }
+        }
+        if (fBlockFail)
+        {
+            // One getfail shrinks the window once, however many blocks it lists
+            sched.FailBlockWindow(nNonce);
+        }
+        if (fHeaderFail)
+        {
+            // The peer announced headers it can not deliver, drop the ones only it knows
+            StdLog("NetChannel", "CEventPeerGetFail: peer can not deliver header bodies, peer: %s",
+                   GetPeerAddressInfo(nNonce).c_str());
+            sched.RemovePeerHeader(nNonce);
         }
     }
     catch (exception& e)
@@ -1242,6 +1263,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
         break;
     }
     case network::PROTO_CMD_GETBLOCKS:
+    case network::PROTO_CMD_GETHEADERS:
     {
         try
         {
@@ -1250,6 +1272,7 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
 
             if (eventMsgRsp.data.nRspResult == MSGRSP_RESULT_GETBLOCKS_EMPTY)
             {
+                sched.ClearLastHeader(nNonce);
                 uint256 hashInvBlock;
                 if (sched.GetLocatorInvBlockHash(nNonce, hashInvBlock) > 0)
                 {
@@ -1289,6 +1312,352 @@ bool CNetChannel::HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp)
     return true;
 }
 
+bool CNetChannel::HandleEvent(network::CEventPeerGetHeaders& eventGetHeaders)
+{
+    uint64 nNonce = eventGetHeaders.nNonce;
+    uint256& hashFork = eventGetHeaders.hashFork;
+    vector<uint256> vBlockHash;
+
+    StdTrace("NetChannel", "CEventPeerGetHeaders: peer: %s, fork: %s",
+             GetPeerAddressInfo(nNonce).c_str(), hashFork.GetHex().c_str());
+
+    if (eventGetHeaders.data.vBlockHash.empty())
+    {
+        StdError("NetChannel", "CEventPeerGetHeaders: vBlockHash is empty");
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "CEventPeerGetHeaders vBlockHash is empty");
+        return true;
+    }
+
+    network::CEventPeerMsgRsp eventMsgRsp(nNonce, hashFork);
+    eventMsgRsp.data.nReqMsgType = network::PROTO_CMD_GETHEADERS;
+    eventMsgRsp.data.nReqMsgSubType = MSGRSP_SUBTYPE_NON;
+    eventMsgRsp.data.nRspResult = MSGRSP_RESULT_GETBLOCKS_EQUAL;
+    if (!pBlockChain->GetBlockInv(hashFork, eventGetHeaders.data, vBlockHash, MAX_GETHEADERS_COUNT))
+    {
+        StdError("NetChannel", "CEventPeerGetHeaders: GetBlockInv fail");
+        pPeerNet->DispatchEvent(&eventMsgRsp);
+        return true;
+    }
+    if (vBlockHash.empty())
+    {
+        eventMsgRsp.data.nRspResult = MSGRSP_RESULT_GETBLOCKS_EMPTY;
+
+        CBlockStatus status;
+        if (pBlockChain->GetLastBlockStatus(hashFork, status))
+        {
+            for (const uint256& hash : eventGetHeaders.data.vBlockHash)
+            {
+                if (hash == status.hashBlock)
+                {
+                    eventMsgRsp.data.nRspResult = MSGRSP_RESULT_GETBLOCKS_EQUAL;
+                    break;
+                }
+            }
+        }
+        pPeerNet->DispatchEvent(&eventMsgRsp);
+        return true;
+    }
+
+    // Headers are blocks without transactions, the hash commits to them by the merkle root.
+    // A header missing from the cache is read from its record with the txs stepped over.
+    // Reads are bounded so one request costs about one getdata.
+    network::CEventPeerHeaders eventHeaders(nNonce, hashFork);
+    size_t nPayloadSize = 0;
+    size_t nReadSize = 0;
+    for (const uint256& hash : vBlockHash)
+    {
+        CBlock header;
+        if (!cacheHeader.Retrieve(hash, header))
+        {
+            if (nReadSize >= MAX_GETHEADERS_READ_SIZE)
+            {
+                break;
+            }
+            if (!pBlockChain->GetBlockHeader(hash, header))
+            {
+                StdError("NetChannel", "CEventPeerGetHeaders: GetBlockHeader fail, block: %s", hash.GetHex().c_str());
+                break;
+            }
+            nReadSize += GetSerializeSize(header);
+            cacheHeader.AddNew(hash, header);
+        }
+        nPayloadSize += GetSerializeSize(header);
+        if (nPayloadSize > MESSAGE_PAYLOAD_MAX_SIZE / 2)
+        {
+            break;
+        }
+        eventHeaders.data.push_back(header);
+    }
+    if (eventHeaders.data.empty())
+    {
+        pPeerNet->DispatchEvent(&eventMsgRsp);
+    }
+    else
+    {
+        pPeerNet->DispatchEvent(&eventHeaders);
+    }
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerHeaders& eventHeaders)
+{
+    uint64 nNonce = eventHeaders.nNonce;
+    uint256& hashFork = eventHeaders.hashFork;
+    vector<CBlock>& vHeader = eventHeaders.data;
+    try
+    {
+        if (vHeader.size() > MAX_GETHEADERS_COUNT)
+        {
+            throw runtime_error(string("Headers count overflow, size: ") + to_string(vHeader.size()));
+        }
+
+        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        CSchedule& sched = GetSchedule(hashFork);
+
+        // The batch must be one chain connected to a known block or header, bad
+        // branches are rejected here before any body is requested
+        uint256 hashPrev;
+        int64 nPrevTime = 0;
+        size_t nExistCount = 0;
+        size_t nAddCount = 0;
+        for (size_t i = 0; i < vHeader.size(); i++)
+        {
+            const CBlock& header = vHeader[i];
+            uint256 hash = header.GetHash();
+            if (i == 0)
+            {
+                const CBlock* pPrev = sched.GetHeader(header.hashPrev);
+                uint256 hashForkPrev;
+                int nHeightPrev;
+                CBlockStatus status;
+                if (pPrev != nullptr)
+                {
+                    nPrevTime = pPrev->GetBlockTime();
+                }
+                else if (pBlockChain->GetBlockLocation(header.hashPrev, hashForkPrev, nHeightPrev) && hashForkPrev == hashFork
+                         && pBlockChain->GetBlockStatus(header.hashPrev, status))
+                {
+                    nPrevTime = status.nBlockTime;
+                }
+                else
+                {
+                    StdLog("NetChannel", "CEventPeerHeaders: headers not connected, peer: %s, prev: %s",
+                           GetPeerAddressInfo(nNonce).c_str(), header.hashPrev.GetHex().c_str());
+                    sched.ClearLastHeader(nNonce);
+                    return true;
+                }
+            }
+            else if (header.hashPrev != hashPrev)
+            {
+                throw runtime_error(string("headers are not continuous, block: ") + hash.GetHex());
+            }
+
+            uint256 hashLocationFork;
+            int nLocationHeight;
+            uint256 hashLocationNext;
+            if (pBlockChain->GetBlockLocation(hash, hashLocationFork, nLocationHeight, hashLocationNext))
+            {
+                sched.SetLocatorInvBlockHash(nNonce, nLocationHeight, hash, hashLocationNext);
+                nExistCount++;
+            }
+            else
+            {
+                if (header.GetBlockTime() < nPrevTime
+                    && !(header.IsVacant() && pCoreProtocol->IsRefVacantHeight(header.GetBlockHeight())))
+                {
+                    throw runtime_error(string("header timestamp out of range, block: ") + hash.GetHex());
+                }
+                Errno err = pCoreProtocol->ValidateBlockHeader(header);
+                if (err != OK)
+                {
+                    throw runtime_error(string("invalid header: ") + ErrorString(err) + ", block: " + hash.GetHex());
+                }
+                if (header.IsPrimary())
+                {
+                    // the delegate proof can be checked while the enroll block is stored
+                    uint256 hashAncestor = header.hashPrev;
+                    for (int n = 0; n <= CONSENSUS_DISTRIBUTE_INTERVAL && !pBlockChain->Exists(hashAncestor); n++)
+                    {
+                        const CBlock* pAncestor = sched.GetHeader(hashAncestor);
+                        if (pAncestor == nullptr)
+                        {
+                            break;
+                        }
+                        hashAncestor = pAncestor->hashPrev;
+                    }
+                    err = pBlockChain->VerifyBlockHeaderProof(header, hashAncestor);
+                    if (err != OK)
+                    {
+                        throw runtime_error(string("invalid header proof: ") + ErrorString(err) + ", block: " + hash.GetHex());
+                    }
+                }
+                if (Config()->nMagicNum == MAINNET_MAGICNUM && !header.IsExtended()
+                    && !pBlockChain->VerifyCheckPoint(hashFork, (int)header.GetBlockHeight(), hash))
+                {
+                    throw runtime_error(string("header does not match checkpoint hash, block: ") + hash.GetHex());
+                }
+                if (sched.GetPeerHeaderCount(nNonce) >= CSchedule::MAX_PEER_HEADER_COUNT)
+                {
+                    break;
+                }
+                sched.AddNewHeader(nNonce, hash, header);
+                nAddCount++;
+            }
+            hashPrev = hash;
+            nPrevTime = header.GetBlockTime();
+        }
+        StdTrace("NetChannel", "CEventPeerHeaders: peer: %s, recv headers, exist: %ld, add: %ld, cached: %ld",
+                 GetPeerAddressInfo(nNonce).c_str(), nExistCount, nAddCount, sched.GetHeaderCount());
+
+        // Keep the headers ahead of the bodies
+        if (!vHeader.empty())
+        {
+            sched.SetNextGetBlocksTime(nNonce, 0);
+            DispatchGetBlocksEvent(nNonce, hashFork);
+        }
+        SchedulePeerInv(nNonce, hashFork, sched);
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventHeaders: ") + e.what());
+    }
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerCmpctBlock& eventCmpctBlock)
+{
+    uint64 nNonce = eventCmpctBlock.nNonce;
+    uint256& hashFork = eventCmpctBlock.hashFork;
+    CBlock& block = eventCmpctBlock.data.header;
+    uint256 hash = block.GetHash();
+    try
+    {
+        if (!block.vtx.empty())
+        {
+            throw runtime_error("compact block with txs");
+        }
+        // no block can hold more txs than empty ones fit in MAX_BLOCK_SIZE
+        static const size_t nMaxBlockTxCount = MAX_BLOCK_SIZE / xengine::GetSerializeSize(CTransaction());
+        if (eventCmpctBlock.data.vShortTxId.size() > nMaxBlockTxCount)
+        {
+            throw runtime_error("compact block txs count overflow");
+        }
+
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            if (!GetSchedule(hashFork).IsAssignedBlock(nNonce, hash))
+            {
+                StdLog("NetChannel", "CEventPeerCmpctBlock: block is not requested, peer: %s, block: %s",
+                       GetPeerAddressInfo(nNonce).c_str(), hash.GetHex().c_str());
+                return true;
+            }
+        }
+
+        // match the pool without holding the scheduler, the assignment is checked again below
+        vector<uint32> vMissing;
+        pTxPool->FetchCompactBlockTx(hashFork, eventCmpctBlock.data, vMissing);
+        StdTrace("NetChannel", "CEventPeerCmpctBlock: peer: %s, height: %d, block: %s, txs: %lu, missing: %lu",
+                 GetPeerAddressInfo(nNonce).c_str(), CBlock::GetBlockHeightByHash(hash), hash.GetHex().c_str(),
+                 block.vtx.size(), vMissing.size());
+        if (!vMissing.empty())
+        {
+            boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+            CSchedule& sched = GetSchedule(hashFork);
+            if (!sched.IsAssignedBlock(nNonce, hash))
+            {
+                return true;
+            }
+            sched.AddPartialBlock(nNonce, hash, block, vMissing);
+
+            network::CEventPeerGetBlockTxn eventGetBlockTxn(nNonce, hashFork);
+            eventGetBlockTxn.data.hashBlock = hash;
+            eventGetBlockTxn.data.vIndex = vMissing;
+            pPeerNet->DispatchEvent(&eventGetBlockTxn);
+            return true;
+        }
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventCmpctBlock: ") + e.what());
+        return true;
+    }
+    AcceptCompactBlock(nNonce, hashFork, block);
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    uint64 nNonce = eventGetBlockTxn.nNonce;
+    uint256& hashFork = eventGetBlockTxn.hashFork;
+    const uint256& hashBlock = eventGetBlockTxn.data.hashBlock;
+    network::CEventPeerBlockTxn eventBlockTxn(nNonce, hashFork);
+    try
+    {
+        CBlock block;
+        if (!GetRelayBlock(hashFork, hashBlock, block))
+        {
+            StdError("NetChannel", "CEventPeerGetBlockTxn: Get block fail, block hash: %s", hashBlock.GetHex().c_str());
+            network::CEventPeerGetFail eventGetFail(nNonce, hashFork);
+            eventGetFail.data.push_back(network::CInv(network::CInv::MSG_CMPCT_BLOCK, hashBlock));
+            pPeerNet->DispatchEvent(&eventGetFail);
+            return true;
+        }
+        eventBlockTxn.data.hashBlock = hashBlock;
+        for (const uint32 nIndex : eventGetBlockTxn.data.vIndex)
+        {
+            if (nIndex >= block.vtx.size())
+            {
+                throw runtime_error("tx index out of range");
+            }
+            eventBlockTxn.data.vtx.push_back(block.vtx[nIndex]);
+        }
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventGetBlockTxn: ") + e.what());
+        return true;
+    }
+    pPeerNet->DispatchEvent(&eventBlockTxn);
+    StdTrace("NetChannel", "CEventPeerGetBlockTxn: send block txs, peer: %s, block: %s, txs: %lu",
+             GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str(), eventBlockTxn.data.vtx.size());
+    return true;
+}
+
+bool CNetChannel::HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn)
+{
+    uint64 nNonce = eventBlockTxn.nNonce;
+    uint256& hashFork = eventBlockTxn.hashFork;
+    const uint256& hashBlock = eventBlockTxn.data.hashBlock;
+    CBlock block;
+    try
+    {
+        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        CSchedule& sched = GetSchedule(hashFork);
+        vector<uint32> vMissing;
+        if (!sched.TakePartialBlock(nNonce, hashBlock, block, vMissing))
+        {
+            StdLog("NetChannel", "CEventPeerBlockTxn: block txs are not requested, peer: %s, block: %s",
+                   GetPeerAddressInfo(nNonce).c_str(), hashBlock.GetHex().c_str());
+            return true;
+        }
+        if (eventBlockTxn.data.vtx.size() != vMissing.size())
+        {
+            throw runtime_error("block txs count error");
+        }
+        for (size_t i = 0; i < vMissing.size(); i++)
+        {
+            block.vtx[vMissing[i]] = eventBlockTxn.data.vtx[i];
+        }
+    }
+    catch (exception& e)
+    {
+        DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, string("eventBlockTxn: ") + e.what());
+        return true;
+    }
+    AcceptCompactBlock(nNonce, hashFork, block);
+    return true;
+}
+
 CSchedule& CNetChannel::GetSchedule(const uint256& hashFork)
 {
     map<uint256, CSchedule>::iterator it = mapSched.find(hashFork);
@@ -1313,6 +1682,12 @@ void CNetChannel::DispatchGetBlocksEvent(uint64 nNonce, const uint256& hashFork)
     try
     {
         CSchedule& sched = GetSchedule(hashFork);
+        bool fHeaders = IsPeerHeadersFirst(nNonce);
+        if (fHeaders && sched.GetPeerHeaderCount(nNonce) >= CSchedule::MAX_PEER_HEADER_COUNT)
+        {
+            // Wait for the bodies of the headers cached from this peer
+            return;
+        }
         if (sched.CheckAddInvIdleLocation(nNonce, network::CInv::MSG_BLOCK))
         {
             uint256 hashDepth;
@@ -1322,8 +1697,13 @@ void CNetChannel::DispatchGetBlocksEvent(uint64 nNonce, const uint256& hashFork)
             int nLocatorInvHeight;
             nLocatorInvHeight = sched.GetLocatorInvBlockHash(nNonce, hashInvBlock);
 
+            uint256 hashLastHeader;
             network::CEventPeerGetBlocks eventGetBlocks(nNonce, hashFork);
-            if (nLocatorInvHeight > 0)
+            if (fHeaders && sched.GetLastHeader(nNonce, hashLastHeader))
+            {
+                eventGetBlocks.data.vBlockHash.push_back(hashLastHeader);
+            }
+            else if (nLocatorInvHeight > 0)
             {
                 eventGetBlocks.data.vBlockHash.push_back(hashInvBlock);
                 sched.SetLocatorDepthHash(nNonce, uint256());
@@ -1337,9 +1717,19 @@ void CNetChannel::DispatchGetBlocksEvent(uint64 nNonce, const uint256& hashFork)
             }
             if (!eventGetBlocks.data.vBlockHash.empty())
             {
-                StdLog("NetChannel", "DispatchGetBlocksEvent: Peer: %s, nLocatorInvHeight: %d, hashInvBlock: %s, hashFork: %s.",
-                       GetPeerAddressInfo(nNonce).c_str(), nLocatorInvHeight, hashInvBlock.GetHex().c_str(), hashFork.GetHex().c_str());
-                pPeerNet->DispatchEvent(&eventGetBlocks);
+                StdLog("NetChannel", "DispatchGetBlocksEvent: Peer: %s, nLocatorInvHeight: %d, hashInvBlock: %s, hashFork: %s, headers: %s.",
+                       GetPeerAddressInfo(nNonce).c_str(), nLocatorInvHeight, hashInvBlock.GetHex().c_str(), hashFork.GetHex().c_str(),
+                       (fHeaders ? "true" : "false"));
+                if (fHeaders)
+                {
+                    network::CEventPeerGetHeaders eventGetHeaders(nNonce, hashFork);
+                    eventGetHeaders.data = eventGetBlocks.data;
+                    pPeerNet->DispatchEvent(&eventGetHeaders);
+                }
+                else
+                {
+                    pPeerNet->DispatchEvent(&eventGetBlocks);
+                }
                 sched.SetNextGetBlocksTime(nNonce, GET_BLOCKS_INTERVAL_DEF_TIME);
             }
         }
@@ -1375,10 +1765,14 @@ void CNetChannel::DispatchMisbehaveEvent(uint64 nNonce, CEndpointManager::CloseR
 
 void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSchedule& sched)
 {
+    if (sched.GetHeaderCount() > 0)
+    {
+        AddHeaderInv(nNonce, hashFork, sched);
+    }
     network::CEventPeerGetData eventGetData(nNonce, hashFork);
     bool fMissingPrev = false;
     bool fEmpty = true;
-    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, 1, fMissingPrev, fEmpty))
+    if (sched.ScheduleBlockInv(nNonce, eventGetData.data, CInvPeer::MAX_BLOCK_WINDOW, fMissingPrev, fEmpty))
     {
         if (fMissingPrev)
         {
@@ -1428,6 +1822,22 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     {
         DispatchMisbehaveEvent(nNonce, CEndpointManager::DDOS_ATTACK, "SchedulePeerInv2: ScheduleBlockInv fail");
     }
+    if (!eventGetData.data.empty() && eventGetData.data[0].nType == network::CInv::MSG_BLOCK && IsPeerCompactBlock(nNonce))
+    {
+        // txs of a block on top of the chain are expected in the pool already
+        CBlockStatus status;
+        if (pBlockChain->GetLastBlockStatus(hashFork, status))
+        {
+            for (network::CInv& inv : eventGetData.data)
+            {
+                int nHeight = CBlock::GetBlockHeightByHash(inv.nHash);
+                if (nHeight == status.nBlockHeight || nHeight == status.nBlockHeight + 1)
+                {
+                    inv.nType = network::CInv::MSG_CMPCT_BLOCK;
+                }
+            }
+        }
+    }
     if (!eventGetData.data.empty())
     {
         pPeerNet->DispatchEvent(&eventGetData);
@@ -1451,6 +1861,75 @@ void CNetChannel::SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSched
     }
 }
 
+void CNetChannel::AddHeaderInv(uint64 nNonce, const uint256& hashFork, CSchedule& sched)
+{
+    CBlockStatus status;
+    if (!pBlockChain->GetLastBlockStatus(hashFork, status))
+    {
+        return;
+    }
+    sched.PruneHeader(status.nBlockHeight);
+
+    // Bodies are requested against the validated headers in the same height range as block invs
+    vector<network::CInv> vInv;
+    sched.GetHeaderInv(nNonce, status.nBlockHeight + CSchedule::MAX_PEER_BLOCK_INV_COUNT / 2, vInv);
+    for (const network::CInv& inv : vInv)
+    {
+        if (!pBlockChain->Exists(inv.nHash) && !sched.AddNewInv(inv, nNonce))
+        {
+            break;
+        }
+    }
+}
+
+bool CNetChannel::IsPeerHeadersFirst(uint64 nNonce)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+    map<uint64, CNetChannelPeer>::const_iterator it = mapPeer.find(nNonce);
+    return (it != mapPeer.end() && it->second.IsHeadersFirst());
+}
+
+bool CNetChannel::IsPeerCompactBlock(uint64 nNonce)
+{
+    boost::shared_lock<boost::shared_mutex> rlock(rwNetPeer);
+    map<uint64, CNetChannelPeer>::const_iterator it = mapPeer.find(nNonce);
+    return (it != mapPeer.end() && it->second.IsCompactBlock());
+}
+
+bool CNetChannel::GetRelayBlock(const uint256& hashFork, const uint256& hashBlock, CBlock& block)
+{
+    if (hashFork == pCoreProtocol->GetGenesisBlockHash())
+    {
+        boost::recursive_mutex::scoped_lock scoped_lock(mtxSched);
+        CSchedule& sched = GetSchedule(hashFork);
+        if (sched.GetCachePowBlock(hashBlock, block))
+        {
+            return true;
+        }
+    }
+    return pBlockChain->GetBlock(hashBlock, block);
+}
+
+void CNetChannel::AcceptCompactBlock(uint64 nNonce, const uint256& hashFork, CBlock& block)
+{
+    block.MemoizeTxHash();
+    if (block.CalcMerkleTreeRoot() != block.hashMerkle)
+    {
+        // an unresolved short id collision, fetch the full block from the same peer
+        uint256 hash = block.GetHash();
+        StdLog("NetChannel", "AcceptCompactBlock: merkle root mismatch, request full block, peer: %s, block: %s",
+               GetPeerAddressInfo(nNonce).c_str(), hash.GetHex().c_str());
+        network::CEventPeerGetData eventGetData(nNonce, hashFork);
+        eventGetData.data.push_back(network::CInv(network::CInv::MSG_BLOCK, hash));
+        pPeerNet->DispatchEvent(&eventGetData);
+        return;
+    }
+
+    network::CEventPeerBlock eventBlock(nNonce, hashFork);
+    swap(eventBlock.data, block);
+    HandleEvent(eventBlock);
+}
+
 bool CNetChannel::GetMissingPrevTx(const CTransaction& tx, set<uint256>& setMissingPrevTx)
 {
     setMissingPrevTx.clear();
@@ -176,6 +176,14 @@ public:
     {
         return (!!mapSubscribedFork.count(hashFork));
     }
+    bool IsHeadersFirst() const
+    {
+        return (!!(nService & network::NODE_HEADERS));
+    }
+    bool IsCompactBlock() const
+    {
+        return (!!(nService & network::NODE_COMPACTBLOCK));
+    }
     void ResetTxInvSynStatus(const uint256& hashFork, bool fIsComplete)
     {
         std::map<uint256, CNetChannelPeerFork>::iterator it = mapSubscribedFork.find(hashFork);
@@ -259,6 +267,9 @@ protected:
     enum
     {
         MAX_GETBLOCKS_COUNT = 128,
+        MAX_GETHEADERS_COUNT = 1024,
+        MAX_GETHEADERS_READ_SIZE = MESSAGE_PAYLOAD_MAX_SIZE,
+        MAX_HEADER_CACHE_COUNT = 1024 * 16,
         GET_BLOCKS_INTERVAL_DEF_TIME = 120,
         GET_BLOCKS_INTERVAL_EQUAL_TIME = 600,
         MAX_TXINV_INTERVAL_TIME = 7200
@@ -297,6 +308,11 @@ protected:
     bool HandleEvent(network::CEventPeerBlock& eventBlock) override;
     bool HandleEvent(network::CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(network::CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(network::CEventPeerGetHeaders& eventGetHeaders) override;
+    bool HandleEvent(network::CEventPeerHeaders& eventHeaders) override;
+    bool HandleEvent(network::CEventPeerCmpctBlock& eventCmpctBlock) override;
+    bool HandleEvent(network::CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(network::CEventPeerBlockTxn& eventBlockTxn) override;
 
     CSchedule& GetSchedule(const uint256& hashFork);
     void NotifyPeerUpdate(uint64 nNonce, bool fActive, const network::CAddress& addrPeer);
@@ -304,6 +320,11 @@ protected:
     void DispatchAwardEvent(uint64 nNonce, xengine::CEndpointManager::Bonus bonus);
     void DispatchMisbehaveEvent(uint64 nNonce, xengine::CEndpointManager::CloseReason reason, const std::string& strCaller = "");
     void SchedulePeerInv(uint64 nNonce, const uint256& hashFork, CSchedule& sched);
+    void AddHeaderInv(uint64 nNonce, const uint256& hashFork, CSchedule& sched);
+    bool IsPeerHeadersFirst(uint64 nNonce);
+    bool IsPeerCompactBlock(uint64 nNonce);
+    bool GetRelayBlock(const uint256& hashFork, const uint256& hashBlock, CBlock& block);
+    void AcceptCompactBlock(uint64 nNonce, const uint256& hashFork, CBlock& block);
     bool GetMissingPrevTx(const CTransaction& tx, std::set<uint256>& setMissingPrevTx);
     bool CheckPrevTx(const CTransaction& tx, uint64 nNonce, const uint256& hashFork, CSchedule& sched, const std::set<uint64>& setSchedPeer);
     void AddNewBlock(const uint256& hashFork, const uint256& hash, CSchedule& sched,
@@ -346,6 +367,8 @@ protected:
     std::map<uint64, CNetChannelPeer> mapPeer;
     std::map<uint256, std::set<uint64>> mapUnsync;
 
+    xengine::CCache<uint256, CBlock> cacheHeader;
+
     mutable boost::mutex mtxPushTx;
     uint32 nTimerPushTx;
     uint32 nTimerForkUpdate;
@@ -36,7 +36,7 @@ bool CNetwork::HandleInitialize()
         return false;
     }
 
-    Configure(NetworkConfig()->nMagicNum, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED,
+    Configure(NetworkConfig()->nMagicNum, PROTO_VERSION, network::NODE_NETWORK | network::NODE_DELEGATED | network::NODE_HEADERS | network::NODE_COMPACTBLOCK,
               FormatSubVersion(), !NetworkConfig()->vConnectTo.empty(), pCoreProtocol->GetGenesisBlockHash());
 
     CPeerNetConfig config;
@@ -96,6 +96,7 @@ bool CNetwork::HandleInitialize()
     }
 
     ConfigNetwork(config);
+    SetIoThreadCount(NetworkConfig()->nNetIOThreads);
 
     return network::CBbPeerNet::HandleInitialize();
 }
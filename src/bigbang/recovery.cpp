@@ -5,57 +5,191 @@
 #include "recovery.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
 
 #include "block.h"
 #include "core.h"
 #include "purger.h"
 #include "timeseries.h"
 
+using namespace std;
 using namespace boost::filesystem;
 
 namespace bigbang
 {
 
-class CRecoveryWalker : public storage::CTSWalker<CBlockEx>
+static const std::size_t RECOVERY_PIPELINE_DEPTH = 256;
+
+// Recovery runs in three stages: the reader walks the block files, a group of
+// workers runs the context free checks of ValidateBlock and the proof of work
+// hash ahead, and the caller connects the blocks in file order.
+class CRecoveryPipeline
 {
+    class CSlot
+    {
+    public:
+        CBlockEx block;
+        uint32 nFile;
+        uint32 nOffset;
+        bool fValidated;
+    };
+
 public:
-    CRecoveryWalker(IDispatcher* pDispatcherIn, const size_t nSizeIn)
-      : pDispatcher(pDispatcherIn), nSize(nSizeIn), nNextSize(nSizeIn / 100), nWalkedFileSize(0) {}
-    bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
+    CRecoveryPipeline(ICoreProtocol* pCoreProtocolIn, const size_t nWorkerIn, const size_t nCapacityIn)
+      : pCoreProtocol(pCoreProtocolIn), nWorker(nWorkerIn), nCapacity(nCapacityIn), nClaimed(0), fFinished(false), fAborted(false) {}
+    ~CRecoveryPipeline()
     {
-        if (!t.IsGenesis())
+        Stop();
+    }
+    void Start()
+    {
+        for (size_t i = 0; i < nWorker; i++)
         {
-            Errno err = pDispatcher->AddNewBlock(t);
-            if (err == OK)
+            thrWorker.create_thread(boost::bind(&CRecoveryPipeline::Validate, this));
+        }
+    }
+    void Stop()
+    {
+        Abort();
+        thrWorker.join_all();
+    }
+    // reader stage, blocks while the pipeline is full
+    bool Push(const CBlockEx& block, uint32 nFile, uint32 nOffset)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPipe);
+        while (dqSlot.size() >= nCapacity && !fAborted)
+        {
+            condRead.wait(lock);
+        }
+        if (fAborted)
+        {
+            return false;
+        }
+        dqSlot.push_back(CSlot());
+        CSlot& slot = dqSlot.back();
+        slot.block = block;
+        slot.nFile = nFile;
+        slot.nOffset = nOffset;
+        slot.fValidated = false;
+        condValidate.notify_one();
+        return true;
+    }
+    void Finish()
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPipe);
+        fFinished = true;
+        condValidate.notify_all();
+        condConnect.notify_all();
+    }
+    void Abort()
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPipe);
+        fAborted = true;
+        condRead.notify_all();
+        condValidate.notify_all();
+        condConnect.notify_all();
+    }
+    // connect stage, returns blocks in file order once they are validated
+    bool Pop(CBlockEx& block, uint32& nFile, uint32& nOffset)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPipe);
+        while (!fAborted && (dqSlot.empty() ? !fFinished : !dqSlot.front().fValidated))
+        {
+            condConnect.wait(lock);
+        }
+        if (fAborted || dqSlot.empty())
+        {
+            return false;
+        }
+        CSlot& slot = dqSlot.front();
+        block = std::move(slot.block);
+        nFile = slot.nFile;
+        nOffset = slot.nOffset;
+        dqSlot.pop_front();
+        --nClaimed;
+        condRead.notify_one();
+        return true;
+    }
+
+protected:
+    void Validate()
+    {
+        boost::unique_lock<boost::mutex> lock(mtxPipe);
+        for (;;)
+        {
+            while (!fAborted && nClaimed == dqSlot.size() && !fFinished)
             {
-                xengine::StdTrace("Recovery", "Recovery block [%s]", t.GetHash().ToString().c_str());
+                condValidate.wait(lock);
             }
-            else if (err != ERR_ALREADY_HAVE)
+            if (fAborted || nClaimed == dqSlot.size())
             {
-                printf("...... block: %s, file: %u, offset: %u\n", t.GetHash().ToString().c_str(), nFile, nOffset);
-                xengine::StdError("Recovery", "Recovery block [%s] error: %s", t.GetHash().ToString().c_str(), ErrorString(err));
-                return false;
+                break;
             }
+            // deque references stay valid across push_back and pop_front of other slots
+            CSlot& slot = dqSlot[nClaimed++];
+            lock.unlock();
+
+            slot.block.MemoizeTxHash();
+            pCoreProtocol->PreValidateBlock(slot.block);
+
+            lock.lock();
+            slot.fValidated = true;
+            condConnect.notify_one();
         }
+    }
 
-        if (nWalkedFileSize + nOffset > nNextSize)
+protected:
+    ICoreProtocol* pCoreProtocol;
+    const size_t nWorker;
+    const size_t nCapacity;
+    boost::mutex mtxPipe;
+    boost::condition_variable condRead;
+    boost::condition_variable condValidate;
+    boost::condition_variable condConnect;
+    std::deque<CSlot> dqSlot;
+    size_t nClaimed;
+    bool fFinished;
+    bool fAborted;
+    boost::thread_group thrWorker;
+};
+
+class CRecoveryWalker : public storage::CTSWalker<CBlockEx>
+{
+public:
+    CRecoveryWalker(CRecoveryPipeline& pipelineIn)
+      : pipeline(pipelineIn) {}
+    bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
+    {
+        return pipeline.Push(t, nFile, nOffset);
+    }
+
+protected:
+    CRecoveryPipeline& pipeline;
+};
+
+// the chain links of the blocks up to the last checkpoint
+class CRecoveryLinkWalker : public storage::CTSWalker<CBlockEx>
+{
+public:
+    CRecoveryLinkWalker(int nMaxHeightIn)
+      : nMaxHeight(nMaxHeightIn) {}
+    bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
+    {
+        if ((int)t.GetBlockHeight() <= nMaxHeight)
         {
-            xengine::StdLog("CRecovery", "....................... Recovered %d%% ..................", nNextSize / (nSize / 100));
-            nNextSize += (nSize / 100);
+            mapPrev[t.GetHash()] = t.hashPrev;
         }
-
         return true;
     }
 
-protected:
-    IDispatcher* pDispatcher;
-    const size_t nSize;
-    size_t nNextSize;
-    size_t nWalkedFileSize;
+public:
+    int nMaxHeight;
+    map<uint256, uint256> mapPrev;
 };
 
 CRecovery::CRecovery()
-  : pDispatcher(nullptr)
+  : pCoreProtocol(nullptr), pBlockChain(nullptr), pDispatcher(nullptr)
 {
 }
 
@@ -65,6 +199,18 @@ CRecovery::~CRecovery()
 
 bool CRecovery::HandleInitialize()
 {
+    if (!GetObject("coreprotocol", pCoreProtocol))
+    {
+        Error("Failed to request coreprotocol");
+        return false;
+    }
+
+    if (!GetObject("blockchain", pBlockChain))
+    {
+        Error("Failed to request blockchain");
+        return false;
+    }
+
     if (!GetObject("dispatcher", pDispatcher))
     {
         Error("Failed to request dispatcher");
@@ -91,6 +237,8 @@ bool CRecovery::HandleInitialize()
 
 void CRecovery::HandleDeinitialize()
 {
+    pCoreProtocol = nullptr;
+    pBlockChain = nullptr;
     pDispatcher = nullptr;
 }
 
@@ -114,11 +262,18 @@ bool CRecovery::HandleInvoke()
             return false;
         }
 
-        size_t nSize = tsBlock.GetSize();
-        CRecoveryWalker walker(pDispatcher, nSize);
-        uint32 nLastFile;
-        uint32 nLastPos;
-        if (!tsBlock.WalkThrough(walker, nLastFile, nLastPos, false))
+        // with trusted replay the chain is anchored by the checkpoints instead of signatures
+        map<int, uint256> mapCheckPoint;
+        if (StorageConfig()->fRecoveryTrusted)
+        {
+            for (const IBlockChain::CCheckPoint& point : pBlockChain->CheckPoints(pCoreProtocol->GetGenesisBlockHash()))
+            {
+                mapCheckPoint[point.nHeight] = point.nBlockHash;
+            }
+            Log("Recovery trusted below checkpoint height: %d", (mapCheckPoint.empty() ? -1 : mapCheckPoint.rbegin()->first));
+        }
+
+        if (!Replay(tsBlock, mapCheckPoint))
         {
             Error("Recovery walkthrough fail");
             return false;
@@ -130,4 +285,140 @@ bool CRecovery::HandleInvoke()
     return true;
 }
 
+bool CRecovery::Replay(storage::CTimeSeriesCached& tsBlock, const map<int, uint256>& mapCheckPoint)
+{
+    set<uint256> setTrusted;
+    if (!GetTrustedBlock(tsBlock, mapCheckPoint, setTrusted))
+    {
+        xengine::StdError("Recovery", "Recovery get trusted blocks fail");
+        return false;
+    }
+    int nTrustedHeight = (mapCheckPoint.empty() ? -1 : mapCheckPoint.rbegin()->first);
+    xengine::StdLog("CRecovery", "Recovery trusted blocks: %lu", setTrusted.size());
+    pCoreProtocol->SetTrustedBlock(setTrusted);
+
+    size_t nSize = tsBlock.GetSize();
+    size_t nNextSize = nSize / 100;
+    size_t nWalkedFileSize = 0;
+    uint32 nWalkedFile = 1;
+
+    size_t nWorker = max(boost::thread::hardware_concurrency(), 2u) - 1;
+    CRecoveryPipeline pipeline(pCoreProtocol, nWorker, RECOVERY_PIPELINE_DEPTH);
+    pipeline.Start();
+
+    bool fReadOK = false;
+    boost::thread thrRead([&]() {
+        try
+        {
+            CRecoveryWalker walker(pipeline);
+            uint32 nLastFile;
+            uint32 nLastPos;
+            fReadOK = tsBlock.WalkThrough(walker, nLastFile, nLastPos, false);
+        }
+        catch (exception& e)
+        {
+            xengine::StdError("Recovery", "Recovery read error: %s", e.what());
+        }
+        pipeline.Finish();
+    });
+
+    bool fConnectOK = true;
+    CBlockEx block;
+    uint32 nFile;
+    uint32 nOffset;
+    while (pipeline.Pop(block, nFile, nOffset))
+    {
+        if (!block.IsGenesis())
+        {
+            uint256 hash = block.GetHash();
+            if (block.IsPrimary() && (int)block.GetBlockHeight() <= nTrustedHeight)
+            {
+                auto it = mapCheckPoint.find(block.GetBlockHeight());
+                if (it != mapCheckPoint.end() && it->second != hash)
+                {
+                    xengine::StdError("Recovery", "Recovery block [%s] mismatch checkpoint", hash.ToString().c_str());
+                    fConnectOK = false;
+                    break;
+                }
+            }
+            Errno err = pDispatcher->AddNewBlock(block);
+            if (err == OK)
+            {
+                xengine::StdTrace("Recovery", "Recovery block [%s]", hash.ToString().c_str());
+            }
+            else if (err != ERR_ALREADY_HAVE)
+            {
+                xengine::StdError("Recovery", "Recovery block [%s] error: %s, file: %u, offset: %u",
+                                  hash.ToString().c_str(), ErrorString(err), nFile, nOffset);
+                fConnectOK = false;
+                break;
+            }
+        }
+
+        while (nWalkedFile < nFile)
+        {
+            nWalkedFileSize += tsBlock.GetSize(nWalkedFile++);
+        }
+        if (nWalkedFileSize + nOffset > nNextSize)
+        {
+            xengine::StdLog("CRecovery", "....................... Recovered %d%% ..................", nNextSize / (nSize / 100));
+            nNextSize += (nSize / 100);
+        }
+    }
+    pipeline.Stop();
+    thrRead.join();
+    set<uint256> setReset;
+    pCoreProtocol->SetTrustedBlock(setReset);
+
+    return (fConnectOK && fReadOK);
+}
+
+bool CRecovery::GetTrustedBlock(storage::CTimeSeriesCached& tsBlock, const map<int, uint256>& mapCheckPoint, set<uint256>& setBlock)
+{
+    // blocks are only trusted when they are known to lead to a checkpoint, so the
+    // links are read in a pass of their own before anything is replayed
+    setBlock.clear();
+    if (mapCheckPoint.empty())
+    {
+        return true;
+    }
+    CRecoveryLinkWalker walker(mapCheckPoint.rbegin()->first);
+    uint32 nLastFile;
+    uint32 nLastPos;
+    if (!tsBlock.WalkThrough(walker, nLastFile, nLastPos, false))
+    {
+        return false;
+    }
+
+    auto it = mapCheckPoint.rbegin();
+    while (it != mapCheckPoint.rend() && !walker.mapPrev.count(it->second))
+    {
+        ++it;
+    }
+    if (it == mapCheckPoint.rend())
+    {
+        return true;
+    }
+    for (uint256 hash = it->second; hash != 0;)
+    {
+        auto mt = walker.mapPrev.find(hash);
+        if (mt == walker.mapPrev.end())
+        {
+            xengine::StdError("Recovery", "Recovery block [%s] of the checkpoint chain is missing", hash.ToString().c_str());
+            setBlock.clear();
+            return false;
+        }
+        auto ct = mapCheckPoint.find(CBlock::GetBlockHeightByHash(hash));
+        if (ct != mapCheckPoint.end() && ct->second != hash)
+        {
+            xengine::StdError("Recovery", "Recovery block [%s] mismatch checkpoint", hash.ToString().c_str());
+            setBlock.clear();
+            return false;
+        }
+        setBlock.insert(hash);
+        hash = mt->second;
+    }
+    return true;
+}
+
 } // namespace bigbang
@@ -20,8 +20,15 @@ protected:
     bool HandleInitialize() override;
     void HandleDeinitialize() override;
     bool HandleInvoke() override;
+    // replay the block files, blocks of the chain down from the highest checkpoint
+    // in the files are trusted, primary blocks must match the checkpoints on their heights
+    bool Replay(storage::CTimeSeriesCached& tsBlock, const std::map<int, uint256>& mapCheckPoint);
+    bool GetTrustedBlock(storage::CTimeSeriesCached& tsBlock, const std::map<int, uint256>& mapCheckPoint,
+                         std::set<uint256>& setBlock);
 
 protected:
+    ICoreProtocol* pCoreProtocol;
+    IBlockChain* pBlockChain;
     IDispatcher* pDispatcher;
 };
 
@@ -7,6 +7,7 @@
 #include "json/json_spirit_reader_template.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/format.hpp>
@@ -158,6 +159,14 @@ static CUnspentData UnspentToJSON(const CTxUnspent& unspent)
     return data;
 }
 
+//remove all sensible information such as private key
+// or passphrass from log content
+static string MaskSecret(const string& data)
+{
+    boost::regex ptnSec(R"raw(("privkey"|"passphrase"|"oldpassphrase"|"signsecret"|"privkeyaddress")(\s*:\s*)(".*?"))raw", boost::regex::perl);
+    return boost::regex_replace(data, ptnSec, string(R"raw($1$2"***")raw"));
+}
+
 namespace bigbang
 {
 
@@ -216,6 +225,8 @@ CRPCMod::CRPCMod()
         ("getvotes", &CRPCMod::RPCGetVotes)
         //
         ("listdelegate", &CRPCMod::RPCListDelegate)
+        //
+        ("getblockcache", &CRPCMod::RPCGetBlockCache)
         /* Wallet */
         ("listkey", &CRPCMod::RPCListKey)
         //
@@ -251,6 +262,8 @@ CRPCMod::CRPCMod()
         //
         ("listtransaction", &CRPCMod::RPCListTransaction)
         //
+        ("listtransactionpage", &CRPCMod::RPCListTransactionPage)
+        //
         ("sendfrom", &CRPCMod::RPCSendFrom)
         //
         ("createtransaction", &CRPCMod::RPCCreateTransaction)
@@ -306,6 +319,34 @@ CRPCMod::CRPCMod()
         ("querystat", &CRPCMod::RPCQueryStat);
     mapRPCFunc = temp_map;
     fWriteRPCLog = true;
+
+    std::set<std::string> setParallel = boost::assign::list_of
+        /* System */
+        ("help")("version")
+        /* Network */
+        ("getpeercount")("listpeer")
+        /* Blockchain & TxPool */
+        ("getforkcount")("listfork")("getgenealogy")("getblocklocation")("getblockcount")("getblockhash")
+        ("getblock")("getblockdetail")("gettxpool")("gettransaction")("getforkheight")("getvotes")
+        ("listdelegate")("getblockcache")
+        /* Wallet */
+        ("listkey")("exportkey")("exporttemplate")("validateaddress")("getbalance")("listtransaction")
+        ("listtransactionpage")("listaddress")
+        /* Util */
+        ("verifymessage")("makekeypair")("getpubkey")("getpubkeyaddress")("gettemplateaddress")
+        ("maketemplate")("decodetransaction")("gettxfee")("makesha256")("aesencrypt")("aesdecrypt")
+        ("listunspent")("listunspentold")("getdefirelation")
+        /* tool */
+        ("querystat");
+    std::set<std::string> setScan = boost::assign::list_of("getblockdetail")("gettxpool")("listtransaction")("listtransactionpage")("listunspent")("listunspentold");
+    for (const auto& vd : mapRPCFunc)
+    {
+        mapRPCMethodCtrl[vd.first] = CRPCMethodCtrl(setParallel.count(vd.first) != 0, setScan.count(vd.first) != 0);
+    }
+    nWorker = 1;
+    nQueueTimeout = 0;
+    fSerialRunning = false;
+    fExit = true;
 }
 
 CRPCMod::~CRPCMod()
@@ -344,6 +385,18 @@ bool CRPCMod::HandleInitialize()
     }
     fWriteRPCLog = RPCServerConfig()->fRPCLogEnable;
 
+    nWorker = std::max(RPCServerConfig()->nRPCThreads, 1u);
+    size_t nScanLimit = RPCServerConfig()->nRPCScanThreads;
+    if (nScanLimit == 0)
+    {
+        nScanLimit = (nWorker + 1) / 2;
+    }
+    for (auto& vd : mapRPCMethodCtrl)
+    {
+        vd.second.nLimit = (vd.second.fScan ? nScanLimit : 0);
+    }
+    nQueueTimeout = RPCServerConfig()->nRPCQueueTimeout * 1000LL;
+
     return true;
 }
 
@@ -356,17 +409,45 @@ void CRPCMod::HandleDeinitialize()
     pForkManager = nullptr;
 }
 
-bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
+bool CRPCMod::HandleInvoke()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxJob);
+        listJob.clear();
+        fSerialRunning = false;
+        fExit = false;
+    }
+    for (size_t i = 0; i < nWorker; i++)
+    {
+        thrWorker.create_thread(boost::bind(&CRPCMod::WorkerThreadFunc, this));
+    }
+    return IIOModule::HandleInvoke();
+}
+
+void CRPCMod::HandleHalt()
 {
-    auto lmdMask = [](const string& data) -> string {
-        //remove all sensible information such as private key
-        // or passphrass from log content
+    IIOModule::HandleHalt();
 
-        //log for debug mode
-        boost::regex ptnSec(R"raw(("privkey"|"passphrase"|"oldpassphrase"|"signsecret"|"privkeyaddress")(\s*:\s*)(".*?"))raw", boost::regex::perl);
-        return boost::regex_replace(data, ptnSec, string(R"raw($1$2"***")raw"));
-    };
+    {
+        boost::unique_lock<boost::mutex> lock(mtxJob);
+        fExit = true;
+    }
+    condJob.notify_all();
+    thrWorker.join_all();
+
+    boost::unique_lock<boost::mutex> lock(mtxJob);
+    for (const CRPCJobPtr& spJob : listJob)
+    {
+        for (const string& strMethod : spJob->setMethod)
+        {
+            mapRPCMethodCtrl[strMethod].nQueued--;
+        }
+    }
+    listJob.clear();
+}
 
+bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
+{
     uint64 nNonce = eventHttpReq.nNonce;
 
     string strResult;
@@ -384,16 +465,140 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
             }
         }
 
-        bool fArray;
-        CRPCReqVec vecReq = DeserializeCRPCReq(eventHttpReq.data.strContent, fArray);
+        CRPCJobPtr spJob(new CRPCJob);
+        spJob->nNonce = nNonce;
+        spJob->vecReq = DeserializeCRPCReq(eventHttpReq.data.strContent, spJob->fArray);
+        spJob->fSerial = false;
+        for (auto& spReq : spJob->vecReq)
+        {
+            map<string, CRPCMethodCtrl>::iterator it = mapRPCMethodCtrl.find(spReq->strMethod);
+            if (it != mapRPCMethodCtrl.end())
+            {
+                spJob->setMethod.insert(spReq->strMethod);
+                spJob->fSerial |= !(*it).second.fParallel;
+            }
+        }
+        EnqueueJob(spJob);
+        return true;
+    }
+    catch (CRPCException& e)
+    {
+        auto spError = MakeCRPCErrorPtr(e);
+        CRPCResp resp(e.valData, spError);
+        strResult = resp.Serialize();
+    }
+    catch (exception& e)
+    {
+        cout << "error: " << e.what() << endl;
+        auto spError = MakeCRPCErrorPtr(RPC_MISC_ERROR, e.what());
+        CRPCResp resp(Value(), spError);
+        strResult = resp.Serialize();
+    }
+
+    if (fWriteRPCLog)
+    {
+        Debug("response : %s ", MaskSecret(strResult).c_str());
+    }
+    JsonReply(nNonce, strResult);
+
+    return true;
+}
+
+bool CRPCMod::HandleEvent(CEventHttpBroken& eventHttpBroken)
+{
+    // calls not started yet have nobody to answer
+    boost::unique_lock<boost::mutex> lock(mtxJob);
+    for (list<CRPCJobPtr>::iterator it = listJob.begin(); it != listJob.end();)
+    {
+        if ((*it)->nNonce == eventHttpBroken.nNonce)
+        {
+            for (const string& strMethod : (*it)->setMethod)
+            {
+                mapRPCMethodCtrl[strMethod].nQueued--;
+            }
+            listJob.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void CRPCMod::EnqueueJob(CRPCJobPtr spJob)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtxJob);
+        spJob->nQueueTime = GetTimeMillis();
+        for (const string& strMethod : spJob->setMethod)
+        {
+            CRPCMethodCtrl& ctrl = mapRPCMethodCtrl[strMethod];
+            if (++ctrl.nQueued > ctrl.nPeakQueued)
+            {
+                ctrl.nPeakQueued = ctrl.nQueued;
+            }
+        }
+        listJob.push_back(spJob);
+    }
+    condJob.notify_one();
+}
+
+list<CRPCMod::CRPCJobPtr>::iterator CRPCMod::FetchJob(bool& fTimeout)
+{
+    // jobs are queued in time order, so expired ones are always in front
+    int64 nNow = GetTimeMillis();
+    for (list<CRPCJobPtr>::iterator it = listJob.begin(); it != listJob.end(); ++it)
+    {
+        const CRPCJob& job = *(*it);
+        if (nQueueTimeout > 0 && nNow - job.nQueueTime > nQueueTimeout)
+        {
+            fTimeout = true;
+            return it;
+        }
+        if (job.fSerial && fSerialRunning)
+        {
+            continue;
+        }
+        bool fLimited = false;
+        for (const string& strMethod : job.setMethod)
+        {
+            const CRPCMethodCtrl& ctrl = mapRPCMethodCtrl[strMethod];
+            if (ctrl.nLimit != 0 && ctrl.nRunning >= ctrl.nLimit)
+            {
+                fLimited = true;
+                break;
+            }
+        }
+        if (!fLimited)
+        {
+            fTimeout = false;
+            return it;
+        }
+    }
+    return listJob.end();
+}
+
+string CRPCMod::ExecuteJob(CRPCJob& job, bool fTimeout)
+{
+    string strResult;
+    try
+    {
         CRPCRespVec vecResp;
-        for (auto& spReq : vecReq)
+        for (auto& spReq : job.vecReq)
         {
             CRPCErrorPtr spError;
             CRPCResultPtr spResult;
+            int64 nStart = GetTimeMillis();
+            bool fCalled = false;
             try
             {
-                map<string, RPCFunc>::iterator it = mapRPCFunc.find(spReq->strMethod);
+                if (fTimeout)
+                {
+                    throw CRPCException(RPC_REQUEST_TIMEOUT, "Request timeout");
+                }
+
+                map<string, RPCFunc>::const_iterator it = mapRPCFunc.find(spReq->strMethod);
                 if (it == mapRPCFunc.end())
                 {
                     throw CRPCException(RPC_METHOD_NOT_FOUND, "Method not found");
@@ -401,9 +606,10 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
 
                 if (fWriteRPCLog)
                 {
-                    Debug("request : %s ", lmdMask(spReq->Serialize()).c_str());
+                    Debug("request : %s ", MaskSecret(spReq->Serialize()).c_str());
                 }
 
+                fCalled = true;
                 spResult = (this->*(*it).second)(spReq->spParam);
             }
             catch (CRPCException& e)
@@ -414,6 +620,10 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
             {
                 spError = CRPCErrorPtr(new CRPCError(RPC_MISC_ERROR, e.what()));
             }
+            if (fCalled)
+            {
+                job.vCallTime.push_back(make_pair(spReq->strMethod, GetTimeMillis() - nStart));
+            }
 
             if (spError)
             {
@@ -429,7 +639,7 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
             }
         }
 
-        if (fArray)
+        if (job.fArray)
         {
             strResult = SerializeCRPCResp(vecResp);
         }
@@ -455,25 +665,81 @@ bool CRPCMod::HandleEvent(CEventHttpReq& eventHttpReq)
         CRPCResp resp(Value(), spError);
         strResult = resp.Serialize();
     }
+    return strResult;
+}
 
-    if (fWriteRPCLog)
-    {
-        Debug("response : %s ", lmdMask(strResult).c_str());
-    }
+void CRPCMod::WorkerThreadFunc()
+{
+    SetThreadName("rpcmod-worker");
 
-    // no result means no return
-    if (!strResult.empty())
+    boost::unique_lock<boost::mutex> lock(mtxJob);
+    while (!fExit)
     {
-        JsonReply(nNonce, strResult);
-    }
+        bool fTimeout = false;
+        list<CRPCJobPtr>::iterator it = FetchJob(fTimeout);
+        if (it == listJob.end())
+        {
+            // wake up now and then to expire jobs blocked behind long calls
+            condJob.timed_wait(lock, boost::posix_time::seconds(1));
+            continue;
+        }
 
-    return true;
-}
+        CRPCJobPtr spJob = *it;
+        listJob.erase(it);
+        for (const string& strMethod : spJob->setMethod)
+        {
+            CRPCMethodCtrl& ctrl = mapRPCMethodCtrl[strMethod];
+            ctrl.nQueued--;
+            if (fTimeout)
+            {
+                ctrl.nTimeouts++;
+            }
+            else
+            {
+                ctrl.nRunning++;
+            }
+        }
+        if (!fTimeout && spJob->fSerial)
+        {
+            fSerialRunning = true;
+        }
+        lock.unlock();
 
-bool CRPCMod::HandleEvent(CEventHttpBroken& eventHttpBroken)
-{
-    (void)eventHttpBroken;
-    return true;
+        string strResult = ExecuteJob(*spJob, fTimeout);
+        if (fWriteRPCLog)
+        {
+            Debug("response : %s ", MaskSecret(strResult).c_str());
+        }
+        // no result means no return
+        if (!strResult.empty())
+        {
+            JsonReply(spJob->nNonce, strResult);
+        }
+
+        lock.lock();
+        if (!fTimeout)
+        {
+            for (const string& strMethod : spJob->setMethod)
+            {
+                mapRPCMethodCtrl[strMethod].nRunning--;
+            }
+            for (const auto& call : spJob->vCallTime)
+            {
+                CRPCMethodCtrl& ctrl = mapRPCMethodCtrl[call.first];
+                ctrl.nCalls++;
+                ctrl.nTotalTime += call.second;
+                if (call.second > ctrl.nMaxTime)
+                {
+                    ctrl.nMaxTime = call.second;
+                }
+            }
+            if (spJob->fSerial)
+            {
+                fSerialRunning = false;
+            }
+            condJob.notify_all();
+        }
+    }
 }
 
 void CRPCMod::JsonReply(uint64 nNonce, const std::string& result)
@@ -626,6 +892,28 @@ CRPCResultPtr CRPCMod::RPCListPeer(CRPCParamPtr param)
                     peer.strServices = peer.strServices + ",NODE_DELEGATED";
                 }
             }
+            if (info.nService & network::NODE_HEADERS)
+            {
+                if (peer.strServices.empty())
+                {
+                    peer.strServices = "NODE_HEADERS";
+                }
+                else
+                {
+                    peer.strServices = peer.strServices + ",NODE_HEADERS";
+                }
+            }
+            if (info.nService & network::NODE_COMPACTBLOCK)
+            {
+                if (peer.strServices.empty())
+                {
+                    peer.strServices = "NODE_COMPACTBLOCK";
+                }
+                else
+                {
+                    peer.strServices = peer.strServices + ",NODE_COMPACTBLOCK";
+                }
+            }
             if (peer.strServices.empty())
             {
                 peer.strServices = string("OTHER:") + to_string(info.nService);
@@ -1112,6 +1400,21 @@ CRPCResultPtr CRPCMod::RPCListDelegate(CRPCParamPtr param)
     return spResult;
 }
 
+CRPCResultPtr CRPCMod::RPCGetBlockCache(CRPCParamPtr param)
+{
+    xengine::CCacheStat stat;
+    pService->GetBlockCacheStat(stat);
+
+    auto spResult = MakeCGetBlockCacheResultPtr();
+    spResult->nCapacity = stat.nCapacity;
+    spResult->nSize = stat.nSize;
+    spResult->nCount = stat.nCount;
+    spResult->nHit = stat.nHit;
+    spResult->nMiss = stat.nMiss;
+    spResult->nEviction = stat.nEviction;
+    return spResult;
+}
+
 /* Wallet */
 CRPCResultPtr CRPCMod::RPCListKey(CRPCParamPtr param)
 {
@@ -1809,6 +2112,73 @@ CRPCResultPtr CRPCMod::RPCListTransaction(CRPCParamPtr param)
     return spResult;
 }
 
+CRPCResultPtr CRPCMod::RPCListTransactionPage(CRPCParamPtr param)
+{
+    if (!BasicConfig()->fAddrTxIndex)
+    {
+        throw CRPCException(RPC_INVALID_REQUEST, "If you need this function, please set config 'addrtxindex=true' and restart");
+    }
+
+    auto spParam = CastParamPtr<CListTransactionPageParam>(param);
+
+    uint256 fork;
+    if (!GetForkHashOfDef(spParam->strFork, fork))
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid fork");
+    }
+
+    CAddress address(spParam->strAddress);
+    if (address.IsNull())
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Invalid address");
+    }
+
+    int nCount = GetUint(spParam->nCount, 10);
+    if (nCount <= 0)
+    {
+        throw CRPCException(RPC_INVALID_PARAMETER, "Negative, zero or out of range count");
+    }
+    bool fReverse = spParam->fReverse.IsValid() ? bool(spParam->fReverse) : false;
+
+    // the cursor is the (height << 32 | txseq) of the last tx of the previous page in hex
+    int64 nHeightSeqCursor = -1;
+    if (spParam->strCursor.IsValid() && !string(spParam->strCursor).empty())
+    {
+        string strCursor = spParam->strCursor;
+        if (strCursor.size() != 16 || strCursor.find_first_not_of("0123456789abcdefABCDEF") != string::npos
+            || (nHeightSeqCursor = (int64)stoull(strCursor, nullptr, 16)) < 0)
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+    }
+
+    vector<CTxInfo> vTx;
+    int64 nHeightSeqNext = -1;
+    int64 nTxCount = 0;
+    if (!pService->ListTransactionPage(fork, address, nHeightSeqCursor, fReverse, nCount, vTx, nHeightSeqNext, nTxCount))
+    {
+        throw CRPCException(RPC_WALLET_ERROR, "Failed to list transactions");
+    }
+
+    auto spResult = MakeCListTransactionPageResultPtr();
+    spResult->nTotal = nTxCount;
+    for (const CTxInfo& tx : vTx)
+    {
+        bool fSendFrom = false;
+        if ((tx.destFrom.IsPubKey() && pService->HaveKey(tx.destFrom.GetPubKey()))
+            || (tx.destFrom.IsTemplate() && pService->HaveTemplate(tx.destFrom.GetTemplateId())))
+        {
+            fSendFrom = true;
+        }
+        spResult->vecTransactions.push_back(TxInfoToJSON(tx, fSendFrom));
+    }
+    if (nHeightSeqNext >= 0)
+    {
+        spResult->strCursor = (boost::format("%016x") % nHeightSeqNext).str();
+    }
+    return spResult;
+}
+
 CRPCResultPtr CRPCMod::RPCSendFrom(CRPCParamPtr param)
 {
     //sendfrom <"from"> <"to"> <$amount$> ($txfee$) (-f="fork") (-d="data")
@@ -3462,12 +3832,31 @@ CRPCResultPtr CRPCMod::RPCListUnspentOld(CRPCParamPtr param)
         throw CRPCException(RPC_INVALID_ADDRESS_OR_KEY, "Available address as argument should be provided.");
     }
 
+    CTxOutPoint outBegin;
+    if (spParam->strCursor.IsValid() && !string(spParam->strCursor).empty())
+    {
+        if (vAddr.size() != 1)
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Cursor is only supported for single address");
+        }
+        string strCursor = spParam->strCursor;
+        size_t nPos = strCursor.find(':');
+        string strOut = (nPos == string::npos) ? string() : strCursor.substr(nPos + 1);
+        if (strOut.empty() || strOut.size() > 3 || strOut.find_first_not_of("0123456789") != string::npos
+            || stoi(strOut) > 0xFF || outBegin.hash.SetHex(strCursor.substr(0, nPos)) != nPos)
+        {
+            throw CRPCException(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        outBegin.n = stoi(strOut);
+    }
+
     std::map<CDestination, std::vector<CTxUnspent>> mapDest;
     for (const auto& i : vAddr)
     {
         mapDest.emplace(std::make_pair(static_cast<CDestination>(i), std::vector<CTxUnspent>()));
     }
 
+    CTxOutPoint outNext;
     if (vAddr.size() > 1)
     {
         if (!pService->ListForkUnspentBatch(fork, spParam->nMax, mapDest))
@@ -3477,8 +3866,8 @@ CRPCResultPtr CRPCMod::RPCListUnspentOld(CRPCParamPtr param)
     }
     else if (1 == vAddr.size())
     {
-        if (!pService->ListForkUnspent(fork, static_cast<CDestination&>(vAddr[0]),
-                                       spParam->nMax, mapDest[static_cast<CDestination>(vAddr[0])]))
+        if (!pService->ListForkUnspent(fork, static_cast<CDestination&>(vAddr[0]), outBegin,
+                                       spParam->nMax, mapDest[static_cast<CDestination>(vAddr[0])], outNext))
         {
             throw CRPCException(RPC_INVALID_ADDRESS_OR_KEY, "Acquiring unspent list failed.");
         }
@@ -3502,6 +3891,10 @@ CRPCResultPtr CRPCMod::RPCListUnspentOld(CRPCParamPtr param)
         }
 
         a.dSum = dSum;
+        if (!outNext.IsNull())
+        {
+            a.strCursor = outNext.hash.GetHex() + ":" + to_string(outNext.n);
+        }
 
         spResult->vecAddresses.push_back(a);
 
@@ -3603,7 +3996,8 @@ CRPCResultPtr CRPCMod::RPCQueryStat(rpc::CRPCParamPtr param)
     {
         TYPE_NON,
         TYPE_MAKER,
-        TYPE_P2PSYN
+        TYPE_P2PSYN,
+        TYPE_RPC
     } eType
         = TYPE_NON;
     uint32 nDefQueryCount = 20;
@@ -3625,6 +4019,10 @@ CRPCResultPtr CRPCMod::RPCQueryStat(rpc::CRPCParamPtr param)
     {
         eType = TYPE_P2PSYN;
     }
+    else if (spParam->strType == "rpc")
+    {
+        eType = TYPE_RPC;
+    }
     else
     {
         throw CRPCException(RPC_INVALID_PARAMETER, "Invalid type");
@@ -3845,6 +4243,45 @@ CRPCResultPtr CRPCMod::RPCQueryStat(rpc::CRPCParamPtr param)
         }
         return MakeCQueryStatResultPtr(strResult);
     }
+    case TYPE_RPC:
+    {
+        vector<vector<string>> vRow;
+        vRow.push_back(vector<string>{ "method", "calls", "running", "queued", "peakqueued", "timeouts", "avgms", "maxms" });
+        {
+            boost::unique_lock<boost::mutex> lock(mtxJob);
+            for (const auto& vd : mapRPCMethodCtrl)
+            {
+                const CRPCMethodCtrl& ctrl = vd.second;
+                if (ctrl.nCalls == 0 && ctrl.nRunning == 0 && ctrl.nPeakQueued == 0 && ctrl.nTimeouts == 0)
+                {
+                    continue;
+                }
+                vRow.push_back(vector<string>{ vd.first, to_string(ctrl.nCalls), to_string(ctrl.nRunning),
+                                               to_string(ctrl.nQueued), to_string(ctrl.nPeakQueued), to_string(ctrl.nTimeouts),
+                                               to_string(ctrl.nCalls ? ctrl.nTotalTime / (int64)ctrl.nCalls : 0), to_string(ctrl.nMaxTime) });
+            }
+        }
+
+        vector<int> vWidth(vRow[0].size(), 0);
+        for (const vector<string>& vCol : vRow)
+        {
+            for (size_t i = 0; i < vCol.size(); i++)
+            {
+                vWidth[i] = std::max(vWidth[i], (int)vCol[i].size() + 2); //+ two spaces
+            }
+        }
+
+        string strResult;
+        for (const vector<string>& vCol : vRow)
+        {
+            for (size_t i = 0; i < vCol.size(); i++)
+            {
+                strResult += GetWidthString(vCol[i], vWidth[i]);
+            }
+            strResult += string("\r\n");
+        }
+        return MakeCQueryStatResultPtr(strResult);
+    }
     default:
         break;
     }
@@ -7,6 +7,9 @@
 
 #include "json/json_spirit.h"
 #include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <list>
+#include <set>
 
 #include "base.h"
 #include "rpc/rpc.h"
@@ -24,9 +27,48 @@ public:
     bool HandleEvent(xengine::CEventHttpReq& eventHttpReq) override;
     bool HandleEvent(xengine::CEventHttpBroken& eventHttpBroken) override;
 
+protected:
+    // Read-only methods run in parallel, the others one at a time. Scans are
+    // limited so they can not take every worker.
+    class CRPCMethodCtrl
+    {
+    public:
+        CRPCMethodCtrl(bool fParallelIn = false, bool fScanIn = false)
+          : fParallel(fParallelIn), fScan(fScanIn), nLimit(0), nRunning(0), nQueued(0), nPeakQueued(0),
+            nCalls(0), nTimeouts(0), nTotalTime(0), nMaxTime(0) {}
+
+    public:
+        bool fParallel;
+        bool fScan;
+        std::size_t nLimit;
+        std::size_t nRunning;
+        std::size_t nQueued;
+        std::size_t nPeakQueued;
+        uint64 nCalls;
+        uint64 nTimeouts;
+        int64 nTotalTime;
+        int64 nMaxTime;
+    };
+
+    // One http request, the calls of a batch run in order on one worker
+    class CRPCJob
+    {
+    public:
+        uint64 nNonce;
+        rpc::CRPCReqVec vecReq;
+        bool fArray;
+        bool fSerial;
+        int64 nQueueTime;
+        std::set<std::string> setMethod;
+        std::vector<std::pair<std::string, int64>> vCallTime;
+    };
+    typedef std::shared_ptr<CRPCJob> CRPCJobPtr;
+
 protected:
     bool HandleInitialize() override;
     void HandleDeinitialize() override;
+    bool HandleInvoke() override;
+    void HandleHalt() override;
     const CBasicConfig* BasicConfig()
     {
         return dynamic_cast<const CBasicConfig*>(xengine::IBase::Config());
@@ -41,6 +83,10 @@ protected:
     }
 
     void JsonReply(uint64 nNonce, const std::string& result);
+    void EnqueueJob(CRPCJobPtr spJob);
+    std::list<CRPCJobPtr>::iterator FetchJob(bool& fTimeout);
+    std::string ExecuteJob(CRPCJob& job, bool fTimeout);
+    void WorkerThreadFunc();
 
     int GetInt(const rpc::CRPCInt64& i, int valDefault)
     {
@@ -101,6 +147,7 @@ private:
     rpc::CRPCResultPtr RPCGetForkHeight(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCGetVotes(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCListDelegate(rpc::CRPCParamPtr param);
+    rpc::CRPCResultPtr RPCGetBlockCache(rpc::CRPCParamPtr param);
     /* Wallet */
     rpc::CRPCResultPtr RPCListKey(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCGetNewKey(rpc::CRPCParamPtr param);
@@ -119,6 +166,7 @@ private:
     rpc::CRPCResultPtr RPCValidateAddress(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCGetBalance(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCListTransaction(rpc::CRPCParamPtr param);
+    rpc::CRPCResultPtr RPCListTransactionPage(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSendFrom(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCCreateTransaction(rpc::CRPCParamPtr param);
     rpc::CRPCResultPtr RPCSignTransaction(rpc::CRPCParamPtr param);
@@ -159,6 +207,16 @@ protected:
 private:
     std::map<std::string, RPCFunc> mapRPCFunc;
     bool fWriteRPCLog;
+
+    std::map<std::string, CRPCMethodCtrl> mapRPCMethodCtrl;
+    std::size_t nWorker;
+    int64 nQueueTimeout;
+    boost::mutex mtxJob;
+    boost::condition_variable condJob;
+    std::list<CRPCJobPtr> listJob;
+    bool fSerialRunning;
+    bool fExit;
+    boost::thread_group thrWorker;
 };
 
 } // namespace bigbang
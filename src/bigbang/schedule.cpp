@@ -75,6 +75,139 @@ void COrphan::RemoveBranch(const uint256& root, std::vector<uint256>& vBranch)
     }
 }
 
+///////////////////////////////
+// CHeaderChain
+
+size_t CHeaderChain::GetSize() const
+{
+    return mapHeader.size();
+}
+
+size_t CHeaderChain::GetPeerCount(uint64 nPeerNonce) const
+{
+    map<uint64, size_t>::const_iterator it = mapPeerCount.find(nPeerNonce);
+    return (it != mapPeerCount.end() ? (*it).second : 0);
+}
+
+const CBlock* CHeaderChain::Get(const uint256& hash) const
+{
+    map<uint256, CHeaderState>::const_iterator it = mapHeader.find(hash);
+    if (it != mapHeader.end())
+    {
+        return &(*it).second.header;
+    }
+    return nullptr;
+}
+
+void CHeaderChain::AddNew(const uint256& hash, const CBlock& header, uint64 nPeerNonce)
+{
+    map<uint256, CHeaderState>::iterator it = mapHeader.find(hash);
+    if (it == mapHeader.end())
+    {
+        it = mapHeader.insert(make_pair(hash, CHeaderState())).first;
+        (*it).second.header = header;
+        mapHeight[CBlock::GetBlockHeightByHash(hash)].insert(hash);
+    }
+    if ((*it).second.setKnownPeer.insert(nPeerNonce).second)
+    {
+        mapPeerCount[nPeerNonce]++;
+    }
+}
+
+void CHeaderChain::GetKnown(uint64 nPeerNonce, int nMaxHeight, vector<uint256>& vHash) const
+{
+    for (map<int, set<uint256>>::const_iterator it = mapHeight.begin(); it != mapHeight.end() && (*it).first <= nMaxHeight; ++it)
+    {
+        for (const uint256& hash : (*it).second)
+        {
+            map<uint256, CHeaderState>::const_iterator mt = mapHeader.find(hash);
+            if (mt != mapHeader.end() && (*mt).second.setKnownPeer.count(nPeerNonce))
+            {
+                vHash.push_back(hash);
+            }
+        }
+    }
+}
+
+void CHeaderChain::RemoveBranch(const uint256& root)
+{
+    set<uint256> setBranch;
+    setBranch.insert(root);
+    for (map<int, set<uint256>>::iterator it = mapHeight.lower_bound(CBlock::GetBlockHeightByHash(root)); it != mapHeight.end(); ++it)
+    {
+        for (const uint256& hash : (*it).second)
+        {
+            map<uint256, CHeaderState>::iterator mt = mapHeader.find(hash);
+            if (mt != mapHeader.end() && setBranch.count((*mt).second.header.hashPrev))
+            {
+                setBranch.insert(hash);
+            }
+        }
+    }
+    for (const uint256& hash : setBranch)
+    {
+        Remove(hash);
+    }
+}
+
+void CHeaderChain::RemovePeer(uint64 nPeerNonce)
+{
+    vector<uint256> vRemove;
+    for (auto& vd : mapHeader)
+    {
+        vd.second.setKnownPeer.erase(nPeerNonce);
+        if (vd.second.setKnownPeer.empty())
+        {
+            vRemove.push_back(vd.first);
+        }
+    }
+    mapPeerCount.erase(nPeerNonce);
+    for (const uint256& hash : vRemove)
+    {
+        Remove(hash);
+    }
+}
+
+void CHeaderChain::Prune(int nHeight)
+{
+    while (!mapHeight.empty() && mapHeight.begin()->first <= nHeight)
+    {
+        if (mapHeight.begin()->second.empty())
+        {
+            mapHeight.erase(mapHeight.begin());
+            continue;
+        }
+        // Remove drops the height entry with its last header
+        Remove(*mapHeight.begin()->second.begin());
+    }
+}
+
+void CHeaderChain::Remove(const uint256& hash)
+{
+    map<uint256, CHeaderState>::iterator mt = mapHeader.find(hash);
+    if (mt != mapHeader.end())
+    {
+        for (uint64 nPeerNonce : (*mt).second.setKnownPeer)
+        {
+            map<uint64, size_t>::iterator pt = mapPeerCount.find(nPeerNonce);
+            if (pt != mapPeerCount.end() && --(*pt).second == 0)
+            {
+                mapPeerCount.erase(pt);
+            }
+        }
+        mapHeader.erase(mt);
+    }
+    map<int, set<uint256>>::iterator it = mapHeight.find(CBlock::GetBlockHeightByHash(hash));
+    if (it != mapHeight.end())
+    {
+        (*it).second.erase(hash);
+        if ((*it).second.empty())
+        {
+            mapHeight.erase(it);
+        }
+    }
+}
+
 ///////////////////////////////
 // CSchedule
 
@@ -135,6 +268,18 @@ void CSchedule::RemovePeer(uint64 nPeerNonce, set<uint64>& setSchedPeer)
         }
         mapPeer.erase(it);
     }
+    headerChain.RemovePeer(nPeerNonce);
+    for (auto mt = mapPartialBlock.begin(); mt != mapPartialBlock.end();)
+    {
+        if (mt->second.nPeerNonce == nPeerNonce)
+        {
+            mapPartialBlock.erase(mt++);
+        }
+        else
+        {
+            ++mt;
+        }
+    }
 }
 
 bool CSchedule::CheckAddInvIdleLocation(uint64 nPeerNonce, uint32 nInvType)
@@ -190,6 +335,7 @@ void CSchedule::RemoveInvState(const network::CInv& inv)
     {
         RemoveHeightBlock(CBlock::GetBlockHeightByHash(inv.nHash), inv.nHash);
         RemoveRefBlock(inv.nHash);
+        mapPartialBlock.erase(inv.nHash);
     }
     mapState.erase(inv);
 }
@@ -206,7 +352,9 @@ bool CSchedule::ReceiveBlock(uint64 nPeerNonce, const uint256& hash, const CBloc
             state.nRecvObjTime = GetTime();
             state.nClearObjTime = GetTime() + MAX_OBJ_WAIT_TIME;
             setSchedPeer.insert(state.setKnownPeer.begin(), state.setKnownPeer.end());
-            mapPeer[nPeerNonce].Completed((*it).first);
+            CInvPeer& peer = mapPeer[nPeerNonce];
+            peer.Completed((*it).first);
+            peer.ReceiveWindowBlock();
             if (block.IsPrimary() && block.IsProofOfWork())
             {
                 mapHeightBlock[block.GetBlockHeight()].push_back(make_pair(hash, CACHE_POW_BLOCK_TYPE_REMOTE));
@@ -296,6 +444,7 @@ void CSchedule::InvalidateBlock(const uint256& hash, set<uint64>& setMisbehavePe
         RemoveInv(network::CInv(network::CInv::MSG_BLOCK, hashInvalid), setMisbehavePeer);
     }
     RemoveInv(network::CInv(network::CInv::MSG_BLOCK, hash), setMisbehavePeer);
+    headerChain.RemoveBranch(hash);
 }
 
 void CSchedule::InvalidateTx(const uint256& txid, set<uint64>& setMisbehavePeer)
@@ -319,10 +468,12 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
     {
         CInvPeer& peer = (*it).second;
         fEmpty = peer.Empty(network::CInv::MSG_BLOCK);
-        if (!peer.IsAssigned())
+        size_t nAssigned = peer.GetAssigned(network::CInv::MSG_BLOCK).size();
+        size_t nWindow = min(nMaxCount, peer.GetBlockWindow());
+        if (peer.GetAssigned(network::CInv::MSG_TX).empty() && nAssigned < nWindow)
         {
             bool fReceivedAll;
-            if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, nMaxCount, fReceivedAll))
+            if (!ScheduleKnownInv(nPeerNonce, peer, network::CInv::MSG_BLOCK, vInv, nWindow - nAssigned, fReceivedAll))
             {
                 if (fReceivedAll && peer.CheckNextGetBlocksTime() && CheckAddInvIdleLocation(nPeerNonce, network::CInv::MSG_BLOCK))
                 {
@@ -336,6 +487,10 @@ bool CSchedule::ScheduleBlockInv(uint64 nPeerNonce, vector<network::CInv>& vInv,
                 {
                     fMissingPrev = true;
                 }
+                if ((nAssigned == 0 || !peer.IsBlockWindowStarted()) && !vInv.empty())
+                {
+                    peer.StartBlockWindow();
+                }
             }
         }
     }
@@ -393,11 +548,24 @@ bool CSchedule::CancelAssignedInv(uint64 nPeerNonce, const network::CInv& inv)
         else
         {
             (*mt).second.RemoveInv(inv);
+            if (inv.nType == network::CInv::MSG_BLOCK)
+            {
+                mapPartialBlock.erase(inv.nHash);
+            }
         }
     }
     return true;
 }
 
+void CSchedule::FailBlockWindow(uint64 nPeerNonce)
+{
+    map<uint64, CInvPeer>::iterator it = mapPeer.find(nPeerNonce);
+    if (it != mapPeer.end())
+    {
+        it->second.FailWindowBlock();
+    }
+}
+
 bool CSchedule::GetLocatorDepthHash(uint64 nPeerNonce, uint256& hashDepth)
 {
     map<uint64, CInvPeer>::iterator it = mapPeer.find(nPeerNonce);
@@ -749,6 +917,104 @@ void CSchedule::SetPowBlockVerifyState(const uint256& hash, bool fVerifyPowBlock
     }
 }
 
+size_t CSchedule::GetHeaderCount() const
+{
+    return headerChain.GetSize();
+}
+
+size_t CSchedule::GetPeerHeaderCount(uint64 nPeerNonce) const
+{
+    return headerChain.GetPeerCount(nPeerNonce);
+}
+
+void CSchedule::RemovePeerHeader(uint64 nPeerNonce)
+{
+    headerChain.RemovePeer(nPeerNonce);
+    ClearLastHeader(nPeerNonce);
+}
+
+const CBlock* CSchedule::GetHeader(const uint256& hash) const
+{
+    return headerChain.Get(hash);
+}
+
+void CSchedule::AddNewHeader(uint64 nPeerNonce, const uint256& hash, const CBlock& header)
+{
+    headerChain.AddNew(hash, header, nPeerNonce);
+    mapPeer[nPeerNonce].hashLastHeader = hash;
+}
+
+bool CSchedule::GetLastHeader(uint64 nPeerNonce, uint256& hashLast)
+{
+    map<uint64, CInvPeer>::iterator it = mapPeer.find(nPeerNonce);
+    if (it != mapPeer.end() && headerChain.Get((*it).second.hashLastHeader) != nullptr)
+    {
+        hashLast = (*it).second.hashLastHeader;
+        return true;
+    }
+    return false;
+}
+
+void CSchedule::ClearLastHeader(uint64 nPeerNonce)
+{
+    map<uint64, CInvPeer>::iterator it = mapPeer.find(nPeerNonce);
+    if (it != mapPeer.end())
+    {
+        (*it).second.hashLastHeader = 0;
+    }
+}
+
+void CSchedule::GetHeaderInv(uint64 nPeerNonce, int nMaxHeight, vector<network::CInv>& vInv)
+{
+    map<uint64, CInvPeer>::iterator it = mapPeer.find(nPeerNonce);
+    if (it == mapPeer.end())
+    {
+        return;
+    }
+    vector<uint256> vHash;
+    headerChain.GetKnown(nPeerNonce, nMaxHeight, vHash);
+    for (const uint256& hash : vHash)
+    {
+        network::CInv inv(network::CInv::MSG_BLOCK, hash);
+        if (!(*it).second.KnownInvExists(inv))
+        {
+            vInv.push_back(inv);
+        }
+    }
+}
+
+void CSchedule::PruneHeader(int nHeight)
+{
+    headerChain.Prune(nHeight);
+}
+
+bool CSchedule::IsAssignedBlock(uint64 nPeerNonce, const uint256& hash)
+{
+    map<network::CInv, CInvState>::iterator it = mapState.find(network::CInv(network::CInv::MSG_BLOCK, hash));
+    return (it != mapState.end() && (*it).second.nAssigned == nPeerNonce && !(*it).second.IsReceived());
+}
+
+void CSchedule::AddPartialBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, const vector<uint32>& vMissing)
+{
+    CPartialBlock& partial = mapPartialBlock[hash];
+    partial.nPeerNonce = nPeerNonce;
+    partial.block = block;
+    partial.vMissing = vMissing;
+}
+
+bool CSchedule::TakePartialBlock(uint64 nPeerNonce, const uint256& hash, CBlock& block, vector<uint32>& vMissing)
+{
+    map<uint256, CPartialBlock>::iterator it = mapPartialBlock.find(hash);
+    if (it == mapPartialBlock.end() || (*it).second.nPeerNonce != nPeerNonce)
+    {
+        return false;
+    }
+    block = (*it).second.block;
+    vMissing.swap((*it).second.vMissing);
+    mapPartialBlock.erase(it);
+    return true;
+}
+
 void CSchedule::RemoveOrphan(const network::CInv& inv)
 {
     if (inv.nType == network::CInv::MSG_TX)
@@ -32,9 +32,18 @@ class CInvPeer
         std::map<uint32, std::set<uint256>> mapRepeat;
     };
 
+public:
+    enum
+    {
+        MIN_BLOCK_WINDOW = 1,
+        INIT_BLOCK_WINDOW = 4,
+        MAX_BLOCK_WINDOW = 32,
+        BLOCK_WINDOW_TARGET_TIME = 4000
+    };
+
 public:
     CInvPeer()
-      : nInvHeight(0)
+      : nInvHeight(0), nBlockWindow(INIT_BLOCK_WINDOW), nBlockWindowRecv(0), nBlockWindowTime(0)
     {
     }
     ~CInvPeer()
@@ -162,6 +171,52 @@ public:
     {
         return (GetTime() >= invKnown[network::CInv::MSG_BLOCK - network::CInv::MSG_TX].nNextGetBlocksTime);
     }
+    std::size_t GetBlockWindow() const
+    {
+        return nBlockWindow;
+    }
+    bool IsBlockWindowStarted() const
+    {
+        return (nBlockWindowTime != 0);
+    }
+    void StartBlockWindow()
+    {
+        nBlockWindowRecv = 0;
+        nBlockWindowTime = GetTimeMillis();
+    }
+    // Adapt the number of blocks in flight to the time the peer takes to deliver a full window
+    void ReceiveWindowBlock()
+    {
+        if (nBlockWindowTime == 0 || ++nBlockWindowRecv < nBlockWindow)
+        {
+            return;
+        }
+        int64 nElapse = GetTimeMillis() - nBlockWindowTime;
+        if (nElapse <= BLOCK_WINDOW_TARGET_TIME / 2)
+        {
+            nBlockWindow *= 2;
+        }
+        else if (nElapse <= BLOCK_WINDOW_TARGET_TIME)
+        {
+            nBlockWindow++;
+        }
+        else if (nElapse > BLOCK_WINDOW_TARGET_TIME * 4)
+        {
+            nBlockWindow /= 2;
+        }
+        else if (nElapse > BLOCK_WINDOW_TARGET_TIME * 2)
+        {
+            nBlockWindow--;
+        }
+        nBlockWindow = std::max(std::min(nBlockWindow, (std::size_t)MAX_BLOCK_WINDOW), (std::size_t)MIN_BLOCK_WINDOW);
+        StartBlockWindow();
+    }
+    // Called once per failed request, the timing restarts with the next top-up
+    void FailWindowBlock()
+    {
+        nBlockWindow = std::max(nBlockWindow / 2, (std::size_t)MIN_BLOCK_WINDOW);
+        nBlockWindowTime = 0;
+    }
     int64 AddRepeatBlock(const uint256& hash)
     {
         if (KnownInvExists(network::CInv(network::CInv::MSG_BLOCK, hash)))
@@ -178,6 +233,10 @@ public:
     uint256 hashGetBlockLocatorDepth;
     int nInvHeight;
     uint256 hashInvBlock;
+    uint256 hashLastHeader;
+    std::size_t nBlockWindow;
+    std::size_t nBlockWindowRecv;
+    int64 nBlockWindowTime;
 };
 
 class COrphan
@@ -194,6 +253,35 @@ protected:
     std::multimap<uint256, uint256> mapOrphanByPrev;
 };
 
+// Validated headers waiting for their bodies, ahead of the block invs
+class CHeaderChain
+{
+    class CHeaderState
+    {
+    public:
+        CBlock header;
+        std::set<uint64> setKnownPeer;
+    };
+
+public:
+    std::size_t GetSize() const;
+    std::size_t GetPeerCount(uint64 nPeerNonce) const;
+    const CBlock* Get(const uint256& hash) const;
+    void AddNew(const uint256& hash, const CBlock& header, uint64 nPeerNonce);
+    void GetKnown(uint64 nPeerNonce, int nMaxHeight, std::vector<uint256>& vHash) const;
+    void RemoveBranch(const uint256& root);
+    void RemovePeer(uint64 nPeerNonce);
+    void Prune(int nHeight);
+
+protected:
+    void Remove(const uint256& hash);
+
+protected:
+    std::map<uint256, CHeaderState> mapHeader;
+    std::map<int, std::set<uint256>> mapHeight;
+    std::map<uint64, std::size_t> mapPeerCount;
+};
+
 class CSchedule
 {
     typedef boost::variant<CNil, CBlock, CTransaction> CInvObject;
@@ -220,6 +308,14 @@ class CSchedule
         bool fVerifyPowBlock;
         uint256 hashRefBlock;
     };
+    // Compact block waiting for the txs missing from the pool
+    class CPartialBlock
+    {
+    public:
+        uint64 nPeerNonce;
+        CBlock block;
+        std::vector<uint32> vMissing;
+    };
 
 public:
     enum
@@ -235,7 +331,8 @@ public:
         MAX_SUB_BLOCK_DELAYED_TIME = 120,
         MAX_CERTTX_DELAYED_TIME = 180,
         MAX_SUBMIT_POW_TIMEOUT = 10,
-        MAX_MINTTX_DELAYED_TIME = 180
+        MAX_MINTTX_DELAYED_TIME = 180,
+        MAX_PEER_HEADER_COUNT = 1024 * 4
     };
 
     enum
@@ -266,6 +363,7 @@ public:
     bool ScheduleBlockInv(uint64 nPeerNonce, std::vector<network::CInv>& vInv, std::size_t nMaxCount, bool& fMissingPrev, bool& fEmpty);
     bool ScheduleTxInv(uint64 nPeerNonce, std::vector<network::CInv>& vInv, std::size_t nMaxCount, bool& fReceivedAll);
     bool CancelAssignedInv(uint64 nPeerNonce, const network::CInv& inv);
+    void FailBlockWindow(uint64 nPeerNonce);
     bool GetLocatorDepthHash(uint64 nPeerNonce, uint256& hashDepth);
     void SetLocatorDepthHash(uint64 nPeerNonce, const uint256& hashDepth);
     int GetLocatorInvBlockHash(uint64 nPeerNonce, uint256& hashBlock);
@@ -288,6 +386,18 @@ public:
     void RemoveHeightBlock(int nHeight, const uint256& hash);
     bool GetPowBlockState(const uint256& hash, bool& fVerifyPowBlockOut);
     void SetPowBlockVerifyState(const uint256& hash, bool fVerifyPowBlockIn);
+    std::size_t GetHeaderCount() const;
+    std::size_t GetPeerHeaderCount(uint64 nPeerNonce) const;
+    void RemovePeerHeader(uint64 nPeerNonce);
+    const CBlock* GetHeader(const uint256& hash) const;
+    void AddNewHeader(uint64 nPeerNonce, const uint256& hash, const CBlock& header);
+    bool GetLastHeader(uint64 nPeerNonce, uint256& hashLast);
+    void ClearLastHeader(uint64 nPeerNonce);
+    void GetHeaderInv(uint64 nPeerNonce, int nMaxHeight, std::vector<network::CInv>& vInv);
+    void PruneHeader(int nHeight);
+    bool IsAssignedBlock(uint64 nPeerNonce, const uint256& hash);
+    void AddPartialBlock(uint64 nPeerNonce, const uint256& hash, const CBlock& block, const std::vector<uint32>& vMissing);
+    bool TakePartialBlock(uint64 nPeerNonce, const uint256& hash, CBlock& block, std::vector<uint32>& vMissing);
 
 protected:
     void RemoveOrphan(const network::CInv& inv);
@@ -297,12 +407,14 @@ protected:
 protected:
     COrphan orphanBlock;
     COrphan orphanTx;
+    CHeaderChain headerChain;
     std::map<uint64, CInvPeer> mapPeer;
     std::map<network::CInv, CInvState> mapState;
     std::set<network::CInv> setMissPrevTxInv;
     std::map<uint256, std::map<uint256, uint256>> mapRefBlock;
     std::map<int, std::vector<std::pair<uint256, int>>> mapHeightBlock;
     std::map<int, CBlock> mapKcPowBlock;
+    std::map<uint256, CPartialBlock> mapPartialBlock;
 };
 
 } // namespace bigbang
@@ -468,6 +468,24 @@ bool CService::ListForkUnspent(const uint256& hashFork, const CDestination& dest
     return false;
 }
 
+bool CService::ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent, CTxOutPoint& outNext)
+{
+    std::vector<CTxUnspent> vUnspentOnChain;
+    if (!pBlockChain->ListForkUnspent(hashFork, dest, outBegin, nMax, vUnspentOnChain))
+    {
+        return false;
+    }
+
+    // The cursor follows the chain index only, a full page means more may follow,
+    // so pool outputs are only appended to the last page
+    outNext.SetNull();
+    if (nMax != 0 && vUnspentOnChain.size() >= nMax)
+    {
+        outNext = vUnspentOnChain.back();
+    }
+    return pTxPool->ListForkUnspent(hashFork, dest, nMax, vUnspentOnChain, vUnspent, outNext.IsNull());
+}
+
 bool CService::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent)
 {
     std::map<CDestination, std::vector<CTxUnspent>> mapUnspentOnChain(mapUnspent);
@@ -580,6 +598,11 @@ bool CService::ListDelegate(uint32 nCount, std::multimap<int64, CDestination>& m
     return pBlockChain->ListDelegate(nCount, mapVotes);
 }
 
+void CService::GetBlockCacheStat(xengine::CCacheStat& stat)
+{
+    pBlockChain->GetBlockCacheStat(stat);
+}
+
 bool CService::HaveKey(const crypto::CPubKey& pubkey, const int32 nVersion)
 {
     return pWallet->Have(pubkey, nVersion);
@@ -895,6 +918,13 @@ bool CService::ListTransaction(const uint256& hashFork, const CDestination& dest
     return true;
 }
 
+bool CService::ListTransactionPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                   vector<CTxInfo>& vTx, int64& nHeightSeqNext, int64& nTxCount)
+{
+    return (pBlockChain->ListAddressTxPage(hashFork, dest, nHeightSeqCursor, fReverse, nCount, vTx, nHeightSeqNext)
+            && pBlockChain->GetAddressTxCount(hashFork, dest, nTxCount));
+}
+
 boost::optional<std::string> CService::CreateTransactionByUnspent(const uint256& hashFork, const CDestination& destFrom,
                                                                   const CDestination& destSendTo, const uint16 nType, const int64 nAmount, const int64 nTxFee, const int nLockHeight,
                                                                   const vector<unsigned char>& vchData, CTransaction& txNew)
@@ -50,10 +50,12 @@ public:
     Errno SendTransaction(CTransaction& tx) override;
     bool RemovePendingTx(const uint256& txid) override;
     bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent) override;
+    bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent, CTxOutPoint& outNext) override;
     bool ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent) override;
     Errno ListForkAddressUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, int64 nAmount, std::vector<CTxUnspent>& vUnspent, std::string& strErr) override;
     bool GetVotes(const CDestination& destDelegate, int64& nVotes, string& strFailCause) override;
     bool ListDelegate(uint32 nCount, std::multimap<int64, CDestination>& mapVotes) override;
+    void GetBlockCacheStat(xengine::CCacheStat& stat) override;
     /* Wallet */
     bool HaveKey(const crypto::CPubKey& pubkey, const int32 nVersion = -1) override;
     void GetPubKeys(std::set<crypto::CPubKey>& setPubKey) override;
@@ -77,6 +79,8 @@ public:
     bool GetDeFiRelation(const uint256& hashFork, const CDestination& destIn, CDestination& parent) override;
     bool GetBalanceByUnspent(const CDestination& dest, const uint256& hashFork, CWalletBalance& balance) override;
     bool ListTransaction(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx) override;
+    bool ListTransactionPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                             std::vector<CTxInfo>& vTx, int64& nHeightSeqNext, int64& nTxCount) override;
     boost::optional<std::string> CreateTransactionByUnspent(const uint256& hashFork, const CDestination& destFrom,
                                                             const CDestination& destSendTo, const uint16 nType, const int64 nAmount, const int64 nTxFee, const int nLockHeight,
                                                             const std::vector<unsigned char>& vchData, CTransaction& txNew) override;
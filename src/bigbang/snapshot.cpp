@@ -0,0 +1,498 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot.h"
+
+#include "block.h"
+#include "blockindexdb.h"
+#include "crypto.h"
+#include "forkdb.h"
+
+#define BLOCKFILE_PREFIX "block"
+
+using namespace std;
+using namespace xengine;
+using namespace boost::filesystem;
+using namespace bigbang::storage;
+
+namespace bigbang
+{
+
+// chain state kept in the snapshot, wallet, txpool and logs stay local
+static const char* SNAPSHOT_DIRS[] = {
+    "block", "blockindex", "fork", "delegate", "unspent", "address",
+    "addressunspent", "addresstxindex", "txindex", "forkdb"
+};
+
+static string GetBlockFileName(uint32 nFile)
+{
+    char szName[32];
+    snprintf(szName, sizeof(szName), BLOCKFILE_PREFIX "_%06u.dat", nFile);
+    return string(szName);
+}
+
+static bool GetBlockFileNo(const string& strName, uint32& nFile)
+{
+    return (sscanf(strName.c_str(), BLOCKFILE_PREFIX "_%6u.dat", &nFile) == 1 && nFile > 0
+            && strName == GetBlockFileName(nFile));
+}
+
+//////////////////////////////
+// CSnapshotFileWalker
+
+// the highest block of each block file
+class CSnapshotFileWalker : public CBlockDBWalker
+{
+public:
+    bool Walk(CBlockOutline& outline) override
+    {
+        auto it = mapFileHeight.insert(make_pair(outline.nFile, outline.nHeight)).first;
+        it->second = max(it->second, (int)outline.nHeight);
+        return true;
+    }
+
+public:
+    map<uint32, int> mapFileHeight;
+};
+
+//////////////////////////////
+// CSnapshotLinkWalker
+
+// the chain links of the shipped block index
+class CSnapshotLinkWalker : public CBlockDBWalker
+{
+public:
+    bool Walk(CBlockOutline& outline) override
+    {
+        mapPrev[outline.hashBlock] = make_pair(outline.hashPrev, outline.nFile);
+        return true;
+    }
+
+public:
+    map<uint256, pair<uint256, uint32>> mapPrev;
+};
+
+//////////////////////////////
+// CSnapshot
+
+CSnapshot::CSnapshot(const path& pathDataIn, const uint256& hashGenesisIn)
+  : pathData(pathDataIn), hashGenesis(hashGenesisIn)
+{
+}
+
+bool CSnapshot::Export(const path& pathFile, int nBlockDepth, CHeader& header)
+{
+    header = CHeader();
+    header.hashGenesis = hashGenesis;
+    if (!GetLastBlock(pathData, header.hashLastBlock, header.nHeight))
+    {
+        StdError("CSnapshot", "Export: get last block fail");
+        return false;
+    }
+    header.nFirstBlockFile = GetFirstBlockFile(pathData, header.nHeight, nBlockDepth);
+    if (header.nFirstBlockFile == 0)
+    {
+        StdError("CSnapshot", "Export: walk block index fail");
+        return false;
+    }
+
+    vector<path> vFile;
+    ListFile(header.nFirstBlockFile, vFile);
+
+    FILE* fp = fopen(pathFile.string().c_str(), "wb");
+    if (fp == nullptr)
+    {
+        StdError("CSnapshot", "Export: open %s fail", pathFile.string().c_str());
+        return false;
+    }
+
+    uint256 hashContent;
+    CBufStream ss;
+    ss << header;
+    bool fRet = WriteRaw(fp, ss, hashContent);
+    for (size_t i = 0; fRet && i < vFile.size(); i++)
+    {
+        fRet = WriteFile(fp, pathData / vFile[i], vFile[i].generic_string(), hashContent);
+    }
+    if (fRet)
+    {
+        // an empty name ends the records, the content hash follows
+        CBufStream ssEnd;
+        ssEnd << uint32(0);
+        fRet = (WriteRaw(fp, ssEnd, hashContent)
+                && fwrite(hashContent.begin(), hashContent.size(), 1, fp) == 1
+                && fflush(fp) == 0);
+    }
+    fclose(fp);
+
+    if (!fRet)
+    {
+        StdError("CSnapshot", "Export: write %s fail", pathFile.string().c_str());
+        remove(pathFile);
+        return false;
+    }
+    StdLog("CSnapshot", "Export: height: %d, last block: %s, first block file: %u, files: %lu, content hash: %s",
+           header.nHeight, header.hashLastBlock.GetHex().c_str(), header.nFirstBlockFile, vFile.size(), hashContent.GetHex().c_str());
+    return true;
+}
+
+bool CSnapshot::Import(const path& pathFile, const map<int, uint256>& mapCheckPoint, CHeader& header)
+{
+    if (exists(pathData / "blockindex"))
+    {
+        StdError("CSnapshot", "Import: data directory already holds a chain");
+        return false;
+    }
+
+    FILE* fp = fopen(pathFile.string().c_str(), "rb");
+    if (fp == nullptr)
+    {
+        StdError("CSnapshot", "Import: open %s fail", pathFile.string().c_str());
+        return false;
+    }
+
+    path pathTemp = pathData / "snapshot.import";
+    uint256 hashContent;
+    bool fRet = false;
+    try
+    {
+        remove_all(pathTemp);
+        create_directories(pathTemp);
+
+        vector<unsigned char> vHeader(4 + 4 + 32 + 32 + 4 + 4);
+        if (fread(&vHeader[0], vHeader.size(), 1, fp) != 1)
+        {
+            throw runtime_error("read header fail");
+        }
+        hashContent = crypto::CryptoHash(hashContent, crypto::CryptoHash(&vHeader[0], vHeader.size()));
+        CBufStream ss;
+        ss.Write((const char*)&vHeader[0], vHeader.size());
+        ss >> header;
+        if (header.nMagic != SNAPSHOT_MAGIC || header.nVersion != SNAPSHOT_VERSION || header.hashGenesis != hashGenesis)
+        {
+            throw runtime_error("snapshot is not for this network or version");
+        }
+
+        // blocks past the last checkpoint would be taken without signature or work checks
+        auto it = mapCheckPoint.find(header.nHeight);
+        if (it == mapCheckPoint.end() || it->second != header.hashLastBlock)
+        {
+            throw runtime_error("last block " + header.hashLastBlock.GetHex() + " at height "
+                                + to_string(header.nHeight) + " is not a checkpoint");
+        }
+
+        bool fEnd = false;
+        while (!fEnd)
+        {
+            if (!ReadFile(fp, pathTemp, hashContent, fEnd))
+            {
+                throw runtime_error("read record fail");
+            }
+        }
+
+        uint256 hashTrailer;
+        if (fread(hashTrailer.begin(), hashTrailer.size(), 1, fp) != 1 || hashTrailer != hashContent)
+        {
+            throw runtime_error("content hash mismatch");
+        }
+
+        if (!VerifyCheckPoint(pathTemp, header, mapCheckPoint))
+        {
+            throw runtime_error("checkpoint verify fail");
+        }
+
+        // move nothing unless every target is free, a half moved chain can not be reopened
+        vector<path> vEntry;
+        for (directory_iterator it(pathTemp); it != directory_iterator(); ++it)
+        {
+            if (exists(pathData / it->path().filename()))
+            {
+                throw runtime_error(string("target already exists: ") + (pathData / it->path().filename()).string());
+            }
+            vEntry.push_back(it->path());
+        }
+        for (const path& pathEntry : vEntry)
+        {
+            rename(pathEntry, pathData / pathEntry.filename());
+        }
+        remove_all(pathTemp);
+        fRet = true;
+    }
+    catch (exception& e)
+    {
+        StdError("CSnapshot", "Import: %s", e.what());
+    }
+    fclose(fp);
+
+    if (!fRet)
+    {
+        boost::system::error_code ec;
+        remove_all(pathTemp, ec);
+        return false;
+    }
+    StdLog("CSnapshot", "Import: height: %d, last block: %s, first block file: %u, content hash: %s",
+           header.nHeight, header.hashLastBlock.GetHex().c_str(), header.nFirstBlockFile, hashContent.GetHex().c_str());
+    return true;
+}
+
+bool CSnapshot::GetLastBlock(const path& pathDB, uint256& hashLastBlock, int& nHeight)
+{
+    if (!is_directory(pathDB / "fork"))
+    {
+        return false;
+    }
+    CForkDB dbFork;
+    if (!dbFork.Initialize(pathDB, hashGenesis))
+    {
+        return false;
+    }
+    bool fRet = dbFork.RetrieveFork(hashGenesis, hashLastBlock);
+    dbFork.Deinitialize();
+    nHeight = CBlock::GetBlockHeightByHash(hashLastBlock);
+    return (fRet && hashLastBlock != 0);
+}
+
+bool CSnapshot::VerifyCheckPoint(const path& pathDB, const CHeader& header, const map<int, uint256>& mapCheckPoint)
+{
+    uint256 hashLastBlock;
+    int nHeight = 0;
+    if (!GetLastBlock(pathDB, hashLastBlock, nHeight) || hashLastBlock != header.hashLastBlock || nHeight != header.nHeight)
+    {
+        StdError("CSnapshot", "VerifyCheckPoint: last block does not match the header");
+        return false;
+    }
+
+    // the databases are taken as shipped under the content hash, only the
+    // block index is walked to see the primary chain pass every checkpoint
+    CSnapshotLinkWalker walker;
+    {
+        CBlockIndexDB dbBlockIndex;
+        if (!dbBlockIndex.Initialize(pathDB))
+        {
+            return false;
+        }
+        bool fRet = dbBlockIndex.WalkThroughBlock(walker);
+        dbBlockIndex.Deinitialize();
+        if (!fRet)
+        {
+            StdError("CSnapshot", "VerifyCheckPoint: walk block index fail");
+            return false;
+        }
+    }
+
+    auto lt = walker.mapPrev.find(hashLastBlock);
+    if (lt == walker.mapPrev.end() || lt->second.second < header.nFirstBlockFile
+        || !exists(pathDB / "block" / GetBlockFileName(lt->second.second)))
+    {
+        StdError("CSnapshot", "VerifyCheckPoint: last block %s is not in the block files", hashLastBlock.GetHex().c_str());
+        return false;
+    }
+
+    uint256 hash = hashLastBlock;
+    for (;;)
+    {
+        auto mt = walker.mapPrev.find(hash);
+        if (mt == walker.mapPrev.end())
+        {
+            StdError("CSnapshot", "VerifyCheckPoint: block %s is missing", hash.GetHex().c_str());
+            return false;
+        }
+        auto ct = mapCheckPoint.find(CBlock::GetBlockHeightByHash(hash));
+        if (ct != mapCheckPoint.end() && ct->second != hash)
+        {
+            StdError("CSnapshot", "VerifyCheckPoint: checkpoint %d mismatch, block: %s, checkpoint: %s",
+                     ct->first, hash.GetHex().c_str(), ct->second.GetHex().c_str());
+            return false;
+        }
+        if (mt->second.first == 0)
+        {
+            if (hash != hashGenesis)
+            {
+                StdError("CSnapshot", "VerifyCheckPoint: block %s is not linked to genesis", hash.GetHex().c_str());
+                return false;
+            }
+            return true;
+        }
+        // heights are part of the hashes, a forged index can not loop
+        if (CBlock::GetBlockHeightByHash(mt->second.first) >= CBlock::GetBlockHeightByHash(hash))
+        {
+            StdError("CSnapshot", "VerifyCheckPoint: block %s is not above its previous block", hash.GetHex().c_str());
+            return false;
+        }
+        hash = mt->second.first;
+    }
+}
+
+uint32 CSnapshot::GetFirstBlockFile(const path& pathDB, int nHeight, int nBlockDepth)
+{
+    CSnapshotFileWalker walker;
+    {
+        CBlockIndexDB dbBlockIndex;
+        if (!dbBlockIndex.Initialize(pathDB))
+        {
+            return 0;
+        }
+        bool fRet = dbBlockIndex.WalkThroughBlock(walker);
+        dbBlockIndex.Deinitialize();
+        if (!fRet || walker.mapFileHeight.empty())
+        {
+            return 0;
+        }
+    }
+    if (nBlockDepth <= 0)
+    {
+        return walker.mapFileHeight.begin()->first;
+    }
+    // the first file holding a block of the window, every later file goes along
+    for (const auto& vd : walker.mapFileHeight)
+    {
+        if (vd.second > nHeight - nBlockDepth)
+        {
+            return vd.first;
+        }
+    }
+    return walker.mapFileHeight.rbegin()->first;
+}
+
+void CSnapshot::ListFile(uint32 nFirstBlockFile, vector<path>& vFile)
+{
+    for (const char* pszDir : SNAPSHOT_DIRS)
+    {
+        if (!is_directory(pathData / pszDir))
+        {
+            continue;
+        }
+        for (recursive_directory_iterator it(pathData / pszDir); it != recursive_directory_iterator(); ++it)
+        {
+            // leveldb lock and info logs are local to a process
+            string strName = it->path().filename().string();
+            if (!is_regular_file(it->path()) || strName == "LOCK" || strName.compare(0, 3, "LOG") == 0)
+            {
+                continue;
+            }
+            uint32 nFile = 0;
+            if (string(pszDir) == "block" && GetBlockFileNo(strName, nFile) && nFile < nFirstBlockFile)
+            {
+                continue;
+            }
+            vFile.push_back(relative(it->path(), pathData));
+        }
+    }
+}
+
+bool CSnapshot::WriteFile(FILE* fp, const path& pathFile, const string& strName, uint256& hashContent)
+{
+    FILE* fpIn = fopen(pathFile.string().c_str(), "rb");
+    if (fpIn == nullptr)
+    {
+        return false;
+    }
+    fseek(fpIn, 0, SEEK_END);
+    uint64 nSize = ftell(fpIn);
+    fseek(fpIn, 0, SEEK_SET);
+
+    CBufStream ss;
+    ss << uint32(strName.size());
+    ss.Write(strName.data(), strName.size());
+    ss << nSize;
+    bool fRet = WriteRaw(fp, ss, hashContent);
+
+    vector<char> vBuf(SNAPSHOT_CHUNK_SIZE);
+    while (fRet && nSize > 0)
+    {
+        size_t nRead = min((uint64)vBuf.size(), nSize);
+        if (fread(&vBuf[0], nRead, 1, fpIn) != 1)
+        {
+            fRet = false;
+            break;
+        }
+        CBufStream ssChunk;
+        ssChunk.Write(&vBuf[0], nRead);
+        fRet = WriteRaw(fp, ssChunk, hashContent);
+        nSize -= nRead;
+    }
+    fclose(fpIn);
+    return fRet;
+}
+
+bool CSnapshot::ReadFile(FILE* fp, const path& pathTemp, uint256& hashContent, bool& fEnd)
+{
+    uint32 nNameSize = 0;
+    if (fread(&nNameSize, sizeof(nNameSize), 1, fp) != 1)
+    {
+        return false;
+    }
+    if (nNameSize == 0)
+    {
+        hashContent = crypto::CryptoHash(hashContent, crypto::CryptoHash(&nNameSize, sizeof(nNameSize)));
+        fEnd = true;
+        return true;
+    }
+    if (nNameSize > 1024)
+    {
+        return false;
+    }
+
+    string strName(nNameSize, '\0');
+    uint64 nSize = 0;
+    if (fread(&strName[0], nNameSize, 1, fp) != 1 || fread(&nSize, sizeof(nSize), 1, fp) != 1)
+    {
+        return false;
+    }
+    // hashed as one span, the same way the record head is written
+    CBufStream ss;
+    ss << nNameSize;
+    ss.Write(strName.data(), strName.size());
+    ss << nSize;
+    hashContent = crypto::CryptoHash(hashContent, crypto::CryptoHash(ss.GetData(), ss.GetSize()));
+
+    // records may only name files below the listed directories
+    path pathName(strName);
+    bool fValid = (!pathName.is_absolute() && !pathName.empty());
+    for (const path& part : pathName)
+    {
+        fValid = (fValid && part != ".." && part != ".");
+    }
+    if (!fValid || find(begin(SNAPSHOT_DIRS), end(SNAPSHOT_DIRS), pathName.begin()->string()) == end(SNAPSHOT_DIRS))
+    {
+        StdError("CSnapshot", "ReadFile: invalid name: %s", strName.c_str());
+        return false;
+    }
+
+    path pathFile = pathTemp / pathName;
+    create_directories(pathFile.parent_path());
+    FILE* fpOut = fopen(pathFile.string().c_str(), "wb");
+    if (fpOut == nullptr)
+    {
+        return false;
+    }
+
+    vector<char> vBuf(SNAPSHOT_CHUNK_SIZE);
+    bool fRet = true;
+    while (nSize > 0)
+    {
+        size_t nRead = min((uint64)vBuf.size(), nSize);
+        if (fread(&vBuf[0], nRead, 1, fp) != 1 || fwrite(&vBuf[0], nRead, 1, fpOut) != 1)
+        {
+            fRet = false;
+            break;
+        }
+        hashContent = crypto::CryptoHash(hashContent, crypto::CryptoHash(&vBuf[0], nRead));
+        nSize -= nRead;
+    }
+    fclose(fpOut);
+    return fRet;
+}
+
+bool CSnapshot::WriteRaw(FILE* fp, CBufStream& ss, uint256& hashContent)
+{
+    if (ss.GetSize() == 0)
+    {
+        return true;
+    }
+    hashContent = crypto::CryptoHash(hashContent, crypto::CryptoHash(ss.GetData(), ss.GetSize()));
+    return (fwrite(ss.GetData(), ss.GetSize(), 1, fp) == 1);
+}
+
+} // namespace bigbang
@@ -0,0 +1,87 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BIGBANG_SNAPSHOT_H
+#define BIGBANG_SNAPSHOT_H
+
+#include <boost/filesystem.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "uint256.h"
+#include "xengine.h"
+
+namespace bigbang
+{
+
+// Chain state snapshot of a stopped node: block index, fork contexts,
+// delegate votes, unspent and address databases and the block files that
+// hold the most recent blocks, older block bodies are left out.
+// The file is a header, one record per file and a running content hash.
+// The header is hashed first, so the content hash is bound to the
+// checkpoint height and hash the snapshot ends at.
+class CSnapshot
+{
+public:
+    enum
+    {
+        SNAPSHOT_MAGIC = 0x5042424e,
+        SNAPSHOT_VERSION = 2,
+        SNAPSHOT_CHUNK_SIZE = 0x100000
+    };
+
+    class CHeader
+    {
+        friend class xengine::CStream;
+
+    public:
+        uint32 nMagic;
+        uint32 nVersion;
+        uint256 hashGenesis;
+        uint256 hashLastBlock;
+        int nHeight;
+        uint32 nFirstBlockFile;
+
+    public:
+        CHeader()
+          : nMagic(SNAPSHOT_MAGIC), nVersion(SNAPSHOT_VERSION), nHeight(0), nFirstBlockFile(1) {}
+
+    protected:
+        template <typename O>
+        void Serialize(xengine::CStream& s, O& opt)
+        {
+            s.Serialize(nMagic, opt);
+            s.Serialize(nVersion, opt);
+            s.Serialize(hashGenesis, opt);
+            s.Serialize(hashLastBlock, opt);
+            s.Serialize(nHeight, opt);
+            s.Serialize(nFirstBlockFile, opt);
+        }
+    };
+
+public:
+    CSnapshot(const boost::filesystem::path& pathDataIn, const uint256& hashGenesisIn);
+    // block files holding the last nBlockDepth blocks are exported, 0 exports all of them
+    bool Export(const boost::filesystem::path& pathFile, int nBlockDepth, CHeader& header);
+    bool Import(const boost::filesystem::path& pathFile, const std::map<int, uint256>& mapCheckPoint, CHeader& header);
+
+protected:
+    bool GetLastBlock(const boost::filesystem::path& pathDB, uint256& hashLastBlock, int& nHeight);
+    bool VerifyCheckPoint(const boost::filesystem::path& pathDB, const CHeader& header,
+                          const std::map<int, uint256>& mapCheckPoint);
+    uint32 GetFirstBlockFile(const boost::filesystem::path& pathDB, int nHeight, int nBlockDepth);
+    void ListFile(uint32 nFirstBlockFile, std::vector<boost::filesystem::path>& vFile);
+    bool WriteFile(FILE* fp, const boost::filesystem::path& pathFile, const std::string& strName, uint256& hashContent);
+    bool ReadFile(FILE* fp, const boost::filesystem::path& pathTemp, uint256& hashContent, bool& fEnd);
+    bool WriteRaw(FILE* fp, xengine::CBufStream& ss, uint256& hashContent);
+
+protected:
+    boost::filesystem::path pathData;
+    uint256 hashGenesis;
+};
+
+} // namespace bigbang
+
+#endif //BIGBANG_SNAPSHOT_H
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <boost/range/adaptor/reversed.hpp>
 #include <deque>
+#include <limits>
 
 using namespace std;
 using namespace xengine;
@@ -60,12 +61,50 @@ void CTxPoolView::RemoveSpent(const CTxOutPoint& out)
     {
         if (!it->second.destTo.IsNull())
         {
-            mapAddressUnspent[it->second.destTo].RemoveTxUnspent(out);
+            auto mi = mapAddressUnspent.find(it->second.destTo);
+            if (mi != mapAddressUnspent.end())
+            {
+                mi->second.RemoveTxUnspent(out);
+                if (mi->second.IsEmpty())
+                {
+                    mapAddressUnspent.erase(mi);
+                }
+            }
         }
         mapSpent.erase(it);
     }
 }
 
+void CTxPoolView::Compact()
+{
+    if (!ptrArena->IsSparse())
+    {
+        return;
+    }
+
+    // move the live nodes to a new arena, the old one is destroyed after the
+    // swapped out containers that still point to it
+    unique_ptr<xengine::CNodeArena> ptrOldArena(new xengine::CNodeArena);
+    ptrArena.swap(ptrOldArena);
+    {
+        CPooledTxLinkSet setNew(CPooledTxLinkSet::ctor_args_list(), xengine::CPooledAllocator<CPooledTxLink>(ptrArena.get()));
+        const CPooledTxLinkSetBySequenceNumber& idxSeq = setTxLinkIndex.get<1>();
+        for (const CPooledTxLink& link : idxSeq)
+        {
+            setNew.insert(link);
+        }
+        setNew.swap(setTxLinkIndex);
+    }
+    for (auto& kv : mapAddressUnspent)
+    {
+        CAddrUnspent::MapTxUnspent mapNew(kv.second.mapTxUnspent.begin(), kv.second.mapTxUnspent.end(), std::less<CTxOutPoint>(),
+                                          CAddrUnspent::MapTxUnspent::allocator_type(ptrArena.get()));
+        mapNew.swap(kv.second.mapTxUnspent);
+    }
+    StdTrace("CTxPoolView", "Compact: arena chunks %lu -> %lu, live nodes: %lu",
+             ptrOldArena->GetChunkCount(), ptrArena->GetChunkCount(), ptrArena->GetLiveCount());
+}
+
 bool CTxPoolView::AddTxIndex(const uint256& txid, CPooledTx& tx)
 {
     CPooledTxLinkSetByTxHash& idxTx = setTxLinkIndex.get<0>();
@@ -217,6 +256,7 @@ bool CTxPoolView::AddNew(const uint256& txid, CPooledTx& tx)
         return false;
     }
 
+    AppendBlockTemplate(txid, tx);
     return true;
 }
 
@@ -253,6 +293,7 @@ void CTxPoolView::InvalidateSpent(const CTxOutPoint& out, CTxPoolView& viewInvol
                 RemoveSpent(out1);
             }
             viewInvolvedTx.AddNew(txidNextTx, *pNextTx);
+            InvalidateBlockTemplate(txidNextTx);
             setTxLinkIndex.erase(txidNextTx);
         }
         else
@@ -441,19 +482,18 @@ bool CTxPoolView::AddArrangeBlockTx(vector<CTransaction>& vtx, int64& nTotalTxFe
 
 bool CTxPoolView::AddAddressUnspent(const uint256& txid, const CPooledTx& tx)
 {
-    CAddrUnspent& addrDestIn = mapAddressUnspent[tx.destIn];
-    CAddrUnspent& addrSendTo = mapAddressUnspent[tx.sendTo];
-
-    for (std::size_t i = 0; i < tx.vInput.size(); i++)
-    {
-        addrDestIn.SetTxSpent(tx.vInput[i].prevout);
-    }
-
+    // entries of the open hash map move on insertion, look up each destination in turn
     CTxOut output;
     output = tx.GetOutput(0);
     if (!output.IsNull())
     {
-        addrSendTo.SetTxUnspent(CTxOutPoint(txid, 0), CUnspentOut(output, tx.nType, -1));
+        GetAddrUnspent(tx.sendTo).SetTxUnspent(CTxOutPoint(txid, 0), CUnspentOut(output, tx.nType, -1));
+    }
+
+    CAddrUnspent& addrDestIn = GetAddrUnspent(tx.destIn);
+    for (std::size_t i = 0; i < tx.vInput.size(); i++)
+    {
+        addrDestIn.SetTxSpent(tx.vInput[i].prevout);
     }
 
     output = tx.GetOutput(1);
@@ -522,6 +562,147 @@ void CTxPoolView::GetBlockTxList(vector<CTransaction>& vtx, int64& nTotalTxFee,
     }
 }
 
+void CTxPoolView::SetBlockTemplate(const uint256& hashPrev, const int nHeight, const bool fDposHeight, const size_t nMaxSize, const vector<CTransaction>& vtx)
+{
+    blockTemplate.SetNull();
+    for (const CTransaction& tx : vtx)
+    {
+        const uint256 txid = tx.GetHash();
+        const CPooledTx* ptx = Get(txid);
+        if (ptx == nullptr)
+        {
+            StdError("CTxPoolView", "SetBlockTemplate: find tx fail, txid: %s", txid.GetHex().c_str());
+            blockTemplate.SetNull();
+            return;
+        }
+        blockTemplate.vTx.push_back(ptx);
+        blockTemplate.setTx.insert(txid);
+        blockTemplate.nTotalSize += ptx->nSerializeSize;
+        blockTemplate.nTotalTxFee += ptx->nTxFee;
+    }
+    blockTemplate.hashPrev = hashPrev;
+    blockTemplate.nHeight = nHeight;
+    blockTemplate.fDposHeight = fDposHeight;
+    blockTemplate.nMaxSize = nMaxSize;
+
+    // GetBlockTxList stops at the first tx that does not fit, which leaves less than MAX_TX_SIZE
+    blockTemplate.fFull = (blockTemplate.nTotalSize + MAX_TX_SIZE > nMaxSize);
+
+    // cert txs left out were refused by the vote count
+    const CPooledTxLinkSetByTxType& idxTxLinkType = setTxLinkIndex.get<2>();
+    const auto iterBegin = idxTxLinkType.lower_bound((uint16)(CTransaction::TX_CERT));
+    const auto iterEnd = idxTxLinkType.upper_bound((uint16)(CTransaction::TX_CERT));
+    for (auto iter = iterBegin; iter != iterEnd; ++iter)
+    {
+        if (!blockTemplate.setTx.count(iter->hashTX))
+        {
+            blockTemplate.fCertSkipped = true;
+            break;
+        }
+    }
+}
+
+bool CTxPoolView::GetBlockTemplate(const uint256& hashPrev, const int nHeight, const int64 nBlockTime, const size_t nMaxSize,
+                                   vector<CTransaction>& vtx, int64& nTotalTxFee) const
+{
+    if (!HasBlockTemplate(hashPrev, nHeight) || nMaxSize > blockTemplate.nMaxSize)
+    {
+        return false;
+    }
+
+    vector<const CPooledTx*> vTemplateTx;
+    vTemplateTx.reserve(blockTemplate.vTx.size());
+    set<uint256> setUnTx;
+    size_t nTotalSize = 0;
+    bool fStop = false;
+    for (const CPooledTx* ptx : blockTemplate.vTx)
+    {
+        bool fMissPrev = (ptx->GetTxTime() > nBlockTime);
+        for (size_t i = 0; i < ptx->vInput.size() && !fMissPrev && !setUnTx.empty(); i++)
+        {
+            fMissPrev = (setUnTx.count(ptx->vInput[i].prevout.hash) != 0);
+        }
+        if (fMissPrev)
+        {
+            // a skipped cert hands its vote slot to a cert the template refused
+            if (ptx->nType == CTransaction::TX_CERT && blockTemplate.fCertSkipped)
+            {
+                return false;
+            }
+            setUnTx.insert(ptx->GetHash());
+            continue;
+        }
+        if (nTotalSize + ptx->nSerializeSize > nMaxSize)
+        {
+            fStop = true;
+            break;
+        }
+        vTemplateTx.push_back(ptx);
+        nTotalSize += ptx->nSerializeSize;
+    }
+    if (!fStop && !setUnTx.empty() && blockTemplate.fFull)
+    {
+        // freed space could hold txs beyond the template
+        return false;
+    }
+
+    vtx.reserve(vtx.size() + vTemplateTx.size());
+    for (const CPooledTx* ptx : vTemplateTx)
+    {
+        vtx.push_back(*static_cast<const CTransaction*>(ptx));
+        nTotalTxFee += ptx->nTxFee;
+    }
+    return true;
+}
+
+void CTxPoolView::AppendBlockTemplate(const uint256& txid, const CPooledTx& tx)
+{
+    if (blockTemplate.IsNull() || blockTemplate.fFull)
+    {
+        return;
+    }
+
+    // only a plain tx taking the last sequence number lands at the end of GetBlockTxList
+    bool fPlain = ((tx.nSequenceNumber & 0xFFFFFFL) == 0
+                   && (tx.nType == CTransaction::TX_TOKEN || tx.nType == CTransaction::TX_DEFI_RELATION));
+    CTemplateId tid;
+    if (fPlain && tx.destIn.GetTemplateId(tid))
+    {
+        fPlain = (tid.GetType() != TEMPLATE_DEXMATCH && tid.GetType() != TEMPLATE_FORK);
+    }
+    if (fPlain && tx.sendTo.GetTemplateId(tid))
+    {
+        fPlain = (tid.GetType() != TEMPLATE_FORK);
+    }
+    if (!fPlain)
+    {
+        blockTemplate.SetNull();
+        return;
+    }
+
+    for (const CTxIn& txin : tx.vInput)
+    {
+        if (Exists(txin.prevout.hash) && !blockTemplate.setTx.count(txin.prevout.hash))
+        {
+            return;
+        }
+    }
+    if (blockTemplate.fDposHeight && tx.nTxFee < CalcMinTxFee(tx.vchData.size(), NEW_MIN_TX_FEE))
+    {
+        return;
+    }
+    if (blockTemplate.nTotalSize + tx.nSerializeSize > blockTemplate.nMaxSize)
+    {
+        blockTemplate.fFull = true;
+        return;
+    }
+
+    blockTemplate.vTx.push_back(&tx);
+    blockTemplate.setTx.insert(txid);
+    blockTemplate.nTotalSize += tx.nSerializeSize;
+    blockTemplate.nTotalTxFee += tx.nTxFee;
+}
+
 bool CTxPoolView::GetAddressUnspent(const CDestination& dest, const uint256& hashChainLastBlock, map<CTxOutPoint, CUnspentOut>& mapUnspent)
 {
     if (hashChainLastBlock != hashLastBlock)
@@ -530,7 +711,7 @@ bool CTxPoolView::GetAddressUnspent(const CDestination& dest, const uint256& has
                  hashChainLastBlock.GetHex().c_str(), hashLastBlock.GetHex().c_str());
         return false;
     }
-    map<CDestination, CAddrUnspent>::const_iterator it = mapAddressUnspent.find(dest);
+    MapAddressUnspent::const_iterator it = mapAddressUnspent.find(dest);
     if (it != mapAddressUnspent.end())
     {
         for (const auto& vd : it->second.mapTxUnspent)
@@ -916,14 +1097,14 @@ bool CTxPool::ListTxOfSeq(const uint256& hashFork, const CDestination& dest, std
     return true;
 }
 
-bool CTxPool::ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent)
+bool CTxPool::ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent, bool fPoolUnspent)
 {
     boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
     map<uint256, CTxPoolView>::const_iterator it = mapPoolView.find(hashFork);
     if (it != mapPoolView.end())
     {
         const CTxPoolView& txPoolView = it->second;
-        ListUnspent(txPoolView, dest, nMax, vUnspentOnChain, vUnspent);
+        ListUnspent(txPoolView, dest, nMax, vUnspentOnChain, vUnspent, fPoolUnspent);
         return true;
     }
 
@@ -950,7 +1131,7 @@ bool CTxPool::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, const s
     return false;
 }
 
-void CTxPool::ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent)
+void CTxPool::ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent, bool fPoolUnspent)
 {
     uint32 nCount = 0;
     std::set<CTxUnspent> setTxUnspent;
@@ -972,6 +1153,11 @@ void CTxPool::ListUnspent(const CTxPoolView& txPoolView, const CDestination& des
         }
     }
 
+    if (!fPoolUnspent)
+    {
+        return;
+    }
+
     std::vector<CTxUnspent> vTxPoolUnspent;
     txPoolView.ListUnspent(dest, setTxUnspent, (nMax != 0) ? (nMax - nCount) : nMax, vTxPoolUnspent);
     vUnspent.insert(vUnspent.end(), vTxPoolUnspent.begin(), vTxPoolUnspent.end());
@@ -1006,55 +1192,80 @@ bool CTxPool::FilterTx(const uint256& hashFork, CTxFilter& filter)
 bool CTxPool::FetchArrangeBlockTx(const uint256& hashFork, const uint256& hashPrev, int nNewBlockHeight, int64 nBlockTime,
                                   size_t nMaxSize, vector<CTransaction>& vtx, int64& nTotalTxFee)
 {
-    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
-
-    // if (hashFork == uint256("00000001aeababf13e5fb76897130a0c659ce9fefdf49db65b0c72569abfa16c"))
-    // {
-    //     return true;
-    // }
-
-    const CTxPoolView& viewTx = mapPoolView[hashFork];
-    if (hashPrev == viewTx.hashLastBlock)
     {
-        vector<pair<uint256, vector<CTxIn>>> vTxRemove;
-        CacheArrangeBlockTx(hashFork, nBlockTime, hashPrev, nMaxSize, vtx, nTotalTxFee, nNewBlockHeight, vTxRemove);
-        StdDebug("CTxPool", "Fetch arrange block tx: hashPrev is last block, target height: %d, new vtx size: %ld, view tx count: %ld",
-                 nNewBlockHeight, vtx.size(), viewTx.Count());
-    }
-    else if (nNewBlockHeight == CBlock::GetBlockHeightByHash(hashPrev) + 1)
-    {
-        auto it = mapTxCache.find(hashFork);
-        if (it == mapTxCache.end())
-        {
-            StdError("CTxPool", "Fetch arrange block tx: find hashFork failed");
-            return false;
-        }
+        boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
 
-        std::vector<CTransaction> vCacheTx;
-        if (!it->second.Retrieve(hashPrev, vCacheTx))
+        map<uint256, CTxPoolView>::const_iterator mi = mapPoolView.find(hashFork);
+        if (mi != mapPoolView.end() && hashPrev == mi->second.hashLastBlock)
         {
-            StdError("CTxPool", "Fetch arrange block tx: find hashPrev in cache failed");
-            return false;
+            if (mi->second.GetBlockTemplate(hashPrev, nNewBlockHeight, nBlockTime, nMaxSize, vtx, nTotalTxFee))
+            {
+                StdDebug("CTxPool", "Fetch arrange block tx: template of last block, target height: %d, new vtx size: %ld, view tx count: %ld",
+                         nNewBlockHeight, vtx.size(), mi->second.Count());
+                return true;
+            }
         }
-
-        size_t currentSize = 0;
-        for (const auto& tx : vCacheTx)
+        else
         {
-            size_t nSerializeSize = xengine::GetSerializeSize(tx);
-            currentSize += nSerializeSize;
-            if (currentSize > nMaxSize)
+            if (nNewBlockHeight == CBlock::GetBlockHeightByHash(hashPrev) + 1)
             {
-                break;
-            }
+                auto it = mapTxCache.find(hashFork);
+                if (it == mapTxCache.end())
+                {
+                    StdError("CTxPool", "Fetch arrange block tx: find hashFork failed");
+                    return false;
+                }
 
-            nTotalTxFee += tx.nTxFee;
-            vtx.push_back(tx);
+                std::vector<CTransaction> vCacheTx;
+                if (!it->second.Retrieve(hashPrev, vCacheTx))
+                {
+                    StdError("CTxPool", "Fetch arrange block tx: find hashPrev in cache failed");
+                    return false;
+                }
+
+                size_t currentSize = 0;
+                for (const auto& tx : vCacheTx)
+                {
+                    size_t nSerializeSize = xengine::GetSerializeSize(tx);
+                    currentSize += nSerializeSize;
+                    if (currentSize > nMaxSize)
+                    {
+                        break;
+                    }
+
+                    nTotalTxFee += tx.nTxFee;
+                    vtx.push_back(tx);
+                }
+            }
+            return true;
         }
     }
+
+    boost::unique_lock<boost::shared_mutex> wlock(rwAccess);
+
+    CTxPoolView& viewTx = mapPoolView[hashFork];
+    if (hashPrev != viewTx.hashLastBlock)
+    {
+        StdLog("CTxPool", "Fetch arrange block tx: last block changed, target height: %d", nNewBlockHeight);
+        return true;
+    }
+
+    vector<pair<uint256, vector<CTxIn>>> vTxRemove;
+    if (!viewTx.HasBlockTemplate(hashPrev, nNewBlockHeight))
+    {
+        ArrangeBlockTemplate(hashFork, hashPrev, nNewBlockHeight, vTxRemove);
+    }
+    if (!viewTx.GetBlockTemplate(hashPrev, nNewBlockHeight, nBlockTime, nMaxSize, vtx, nTotalTxFee))
+    {
+        vTxRemove.clear();
+        CacheArrangeBlockTx(hashFork, nBlockTime, hashPrev, nMaxSize, vtx, nTotalTxFee, nNewBlockHeight, vTxRemove);
+    }
+    StdDebug("CTxPool", "Fetch arrange block tx: hashPrev is last block, target height: %d, new vtx size: %ld, view tx count: %ld",
+             nNewBlockHeight, vtx.size(), viewTx.Count());
     return true;
 }
 
-void CTxPool::CacheArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashLastBlock, size_t nMaxSize,
+bool CTxPool::CacheArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashLastBlock, size_t nMaxSize,
                                   vector<CTransaction>& vtx, int64& nTotalTxFee, int nHeight, vector<pair<uint256, vector<CTxIn>>>& vTxRemove)
 {
     map<CDestination, int> mapVoteCert;
@@ -1065,26 +1276,117 @@ void CTxPool::CacheArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, con
         if (!pBlockChain->GetDelegateCertTxCount(hashLastBlock, mapVoteCert))
         {
             StdError("CTxPool", "Cache arrange block tx: GetDelegateCertTxCount fail");
-            return;
+            return false;
         }
 
         if (!pBlockChain->GetBlockDelegateVote(hashLastBlock, mapVote))
         {
             StdError("CTxPool", "Cache arrange block tx: GetBlockDelegateVote fail");
-            return;
+            return false;
         }
 
         nMinEnrollAmount = pBlockChain->GetDelegateMinEnrollAmount(hashLastBlock);
         if (nMinEnrollAmount < 0)
         {
             StdError("CTxPool", "Cache arrange block tx: GetDelegateMinEnrollAmount fail");
-            return;
+            return false;
         }
     }
 
     mapPoolView[hashFork].GetBlockTxList(vtx, nTotalTxFee, nBlockTime, nMaxSize, hashFork, nHeight, mapVoteCert,
                                          mapVote, nMinEnrollAmount, pCoreProtocol->IsDposHeight(nHeight), vTxRemove,
                                          pCoreProtocol, hashLastBlock);
+    return true;
+}
+
+void CTxPool::ArrangeBlockTemplate(const uint256& hashFork, const uint256& hashLastBlock, int nHeight, vector<pair<uint256, vector<CTxIn>>>& vTxRemove)
+{
+    // arrange without the time limit, fetch filters by block time
+    vector<CTransaction> vtx;
+    int64 nTotalTxFee = 0;
+    CTxPoolView& txView = mapPoolView[hashFork];
+    if (!CacheArrangeBlockTx(hashFork, std::numeric_limits<int64>::max(), hashLastBlock, MAX_BLOCK_SIZE, vtx, nTotalTxFee, nHeight, vTxRemove))
+    {
+        txView.blockTemplate.SetNull();
+        return;
+    }
+    txView.SetBlockTemplate(hashLastBlock, nHeight, pCoreProtocol->IsDposHeight(nHeight), MAX_BLOCK_SIZE, vtx);
+}
+
+void CTxPool::CacheBlockTemplate(const uint256& hashFork, const uint256& hashLastBlock, int64 nLastBlockTime, int nHeight,
+                                 vector<pair<uint256, vector<CTxIn>>>& vTxRemove)
+{
+    if (mapTxCache.find(hashFork) == mapTxCache.end())
+    {
+        mapTxCache.insert(std::make_pair(hashFork, CTxCache(CACHE_HEIGHT_INTERVAL)));
+    }
+
+    ArrangeBlockTemplate(hashFork, hashLastBlock, nHeight, vTxRemove);
+
+    vector<CTransaction> vtx;
+    int64 nTotalFee = 0;
+    if (!mapPoolView[hashFork].GetBlockTemplate(hashLastBlock, nHeight, nLastBlockTime, MAX_BLOCK_SIZE, vtx, nTotalFee))
+    {
+        vector<pair<uint256, vector<CTxIn>>> vArrangeTxRemove;
+        vtx.clear();
+        nTotalFee = 0;
+        CacheArrangeBlockTx(hashFork, nLastBlockTime, hashLastBlock, MAX_BLOCK_SIZE, vtx, nTotalFee, nHeight, vArrangeTxRemove);
+    }
+    mapTxCache[hashFork].AddNew(hashLastBlock, vtx);
+}
+
+void CTxPool::FetchCompactBlockTx(const uint256& hashFork, CCompactBlock& cmpct, vector<uint32>& vMissing)
+{
+    CBlock& block = cmpct.header;
+    const vector<uint64>& vShortTxId = cmpct.vShortTxId;
+    block.vtx.resize(vShortTxId.size());
+
+    // a short id shared by two txs of the block or of the pool can not be resolved here
+    map<uint64, uint32> mapIndex;
+    vector<bool> vFound(vShortTxId.size(), false);
+    vector<bool> vCollided(vShortTxId.size(), false);
+    for (uint32 i = 0; i < vShortTxId.size(); i++)
+    {
+        auto ret = mapIndex.insert(make_pair(vShortTxId[i], i));
+        if (!ret.second)
+        {
+            vCollided[i] = vCollided[ret.first->second] = true;
+        }
+    }
+
+    boost::shared_lock<boost::shared_mutex> rlock(rwAccess);
+    map<uint256, CTxPoolView>::const_iterator itView = mapPoolView.find(hashFork);
+    if (!mapIndex.empty() && itView != mapPoolView.end())
+    {
+        const uint256 hashSalt = cmpct.GetShortTxIdSalt();
+        const CPooledTxLinkSetBySequenceNumber& idxTx = (*itView).second.setTxLinkIndex.get<1>();
+        for (CPooledTxLinkSetBySequenceNumber::const_iterator mi = idxTx.begin(); mi != idxTx.end(); ++mi)
+        {
+            map<uint64, uint32>::iterator it = mapIndex.find(CCompactBlock::GetShortTxId(hashSalt, (*mi).hashTX));
+            if (it == mapIndex.end() || vCollided[it->second])
+            {
+                continue;
+            }
+            if (vFound[it->second])
+            {
+                vCollided[it->second] = true;
+            }
+            else
+            {
+                block.vtx[it->second] = *(*mi).ptx;
+                vFound[it->second] = true;
+            }
+        }
+    }
+
+    for (uint32 i = 0; i < vShortTxId.size(); i++)
+    {
+        if (!vFound[i] || vCollided[i])
+        {
+            block.vtx[i].SetNull();
+            vMissing.push_back(i);
+        }
+    }
 }
 
 bool CTxPool::FetchInputs(const uint256& hashFork, const CTransaction& tx, vector<CTxOut>& vUnspent)
@@ -1261,18 +1563,8 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
         }
     }
 
-    if (mapTxCache.find(update.hashFork) == mapTxCache.end())
-    {
-        mapTxCache.insert(std::make_pair(update.hashFork, CTxCache(CACHE_HEIGHT_INTERVAL)));
-    }
-
-    vector<CTransaction> vtx;
     vector<pair<uint256, vector<CTxIn>>> vArrangeTxRemove;
-    int64 nTotalFee = 0;
-    CacheArrangeBlockTx(update.hashFork, update.nLastBlockTime, update.hashLastBlock,
-                        MAX_BLOCK_SIZE, vtx, nTotalFee, update.nLastBlockHeight + 1, vArrangeTxRemove);
-
-    mapTxCache[update.hashFork].AddNew(update.hashLastBlock, vtx);
+    CacheBlockTemplate(update.hashFork, update.hashLastBlock, update.nLastBlockTime, update.nLastBlockHeight + 1, vArrangeTxRemove);
     mapPoolView[update.hashFork].SetLastBlock(update.hashLastBlock, update.nLastBlockTime);
 
     for (const auto& vd : vArrangeTxRemove)
@@ -1303,6 +1595,9 @@ bool CTxPool::SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChang
         }
     }
     change.vTxRemove.insert(change.vTxRemove.end(), vTxRemove.rbegin(), vTxRemove.rend());
+
+    // give back the arena chunks of txs that left with the blocks
+    txView.Compact();
     return true;
 }
 
@@ -1385,7 +1680,6 @@ bool CTxPool::LoadData()
     for (const auto& kv : mapForkStatus)
     {
         const uint256& hashFork = kv.first;
-        mapTxCache.insert(make_pair(hashFork, CTxCache(CACHE_HEIGHT_INTERVAL)));
 
         CBlockStatus status;
         if (!pBlockChain->GetLastBlockStatus(hashFork, status))
@@ -1393,11 +1687,8 @@ bool CTxPool::LoadData()
             return false;
         }
 
-        std::vector<CTransaction> vtx;
         vector<pair<uint256, vector<CTxIn>>> vTxRemove;
-        int64 nTotalFee = 0;
-        CacheArrangeBlockTx(hashFork, status.nBlockTime, status.hashBlock, MAX_BLOCK_SIZE, vtx, nTotalFee, status.nBlockHeight + 1, vTxRemove);
-        mapTxCache[hashFork].AddNew(status.hashBlock, vtx);
+        CacheBlockTemplate(hashFork, status.hashBlock, status.nBlockTime, status.nBlockHeight + 1, vTxRemove);
 
         mapPoolView[hashFork].SetLastBlock(status.hashBlock, status.nBlockTime);
     }
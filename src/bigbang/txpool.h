@@ -5,6 +5,8 @@
 #ifndef BIGBANG_TXPOOL_H
 #define BIGBANG_TXPOOL_H
 
+#include <boost/multi_index/hashed_index.hpp>
+
 #include "base.h"
 #include "defi.h"
 #include "txpooldata.h"
@@ -34,11 +36,13 @@ public:
       : CAssembledTx(tx), nSequenceNumber(nSequenceNumberIn), nNextSequenceNumber(0)
     {
         nSerializeSize = xengine::GetSerializeSize(static_cast<const CTransaction&>(tx));
+        MemoizeHash();
     }
     CPooledTx(const CTransaction& tx, int nBlockHeightIn, uint64 nSequenceNumberIn, const CDestination& destInIn = CDestination(), int64 nValueInIn = 0)
       : CAssembledTx(tx, nBlockHeightIn, destInIn, nValueInIn), nSequenceNumber(nSequenceNumberIn), nNextSequenceNumber(0)
     {
         nSerializeSize = xengine::GetSerializeSize(tx);
+        MemoizeHash();
     }
     void SetNull() override
     {
@@ -88,11 +92,38 @@ struct tx_score
 {
 };
 
+class CTxIdHash
+{
+public:
+    std::size_t operator()(const uint256& txid) const
+    {
+        return (txid.Get64(0) ^ txid.Get64(1) ^ txid.Get64(2) ^ txid.Get64(3));
+    }
+};
+
+class CTxOutPointHash
+{
+public:
+    std::size_t operator()(const CTxOutPoint& out) const
+    {
+        return (CTxIdHash()(out.hash) + out.n);
+    }
+};
+
+class CDestinationHash
+{
+public:
+    std::size_t operator()(const CDestination& dest) const
+    {
+        return (CTxIdHash()(dest.data) + dest.prefix);
+    }
+};
+
 typedef boost::multi_index_container<
     CPooledTxLink,
     boost::multi_index::indexed_by<
-        // sorted by Tx ID
-        boost::multi_index::ordered_unique<boost::multi_index::member<CPooledTxLink, uint256, &CPooledTxLink::hashTX>>,
+        // hashed by Tx ID
+        boost::multi_index::hashed_unique<boost::multi_index::member<CPooledTxLink, uint256, &CPooledTxLink::hashTX>, CTxIdHash>,
         // sorted by entry sequence
         boost::multi_index::ordered_non_unique<boost::multi_index::member<CPooledTxLink, uint64, &CPooledTxLink::nSequenceNumber>>,
         // sorted by Tx Type
@@ -101,7 +132,8 @@ typedef boost::multi_index_container<
         boost::multi_index::ordered_non_unique<
             boost::multi_index::tag<tx_score>,
             boost::multi_index::identity<CPooledTxLink>,
-            ComparePooledTxLinkByTxScore>>>
+            ComparePooledTxLinkByTxScore>>,
+    xengine::CPooledAllocator<CPooledTxLink>>
 
     CPooledTxLinkSet;
 typedef CPooledTxLinkSet::nth_index<0>::type CPooledTxLinkSetByTxHash;
@@ -112,15 +144,54 @@ typedef CPooledTxLinkSet::nth_index<3>::type CPooledTxLinkSetByTxScore;
 typedef boost::multi_index_container<
     CPooledTxLink,
     boost::multi_index::indexed_by<
-        // sorted by Tx ID
-        boost::multi_index::ordered_unique<boost::multi_index::member<CPooledTxLink, uint256, &CPooledTxLink::hashTX>>,
+        // hashed by Tx ID
+        boost::multi_index::hashed_unique<boost::multi_index::member<CPooledTxLink, uint256, &CPooledTxLink::hashTX>, CTxIdHash>,
         // sorted by entry sequence
-        boost::multi_index::ordered_non_unique<boost::multi_index::member<CPooledTxLink, uint64, &CPooledTxLink::nSequenceNumber>>>>
+        boost::multi_index::ordered_non_unique<boost::multi_index::member<CPooledTxLink, uint64, &CPooledTxLink::nSequenceNumber>>>,
+    xengine::CPooledAllocator<CPooledTxLink>>
 
     CPooledCertTxLinkSet;
 typedef CPooledCertTxLinkSet::nth_index<0>::type CPooledCertTxLinkSetByTxHash;
 typedef CPooledCertTxLinkSet::nth_index<1>::type CPooledCertTxLinkSetBySequenceNumber;
 
+class CBlockTxTemplate
+{
+public:
+    CBlockTxTemplate()
+    {
+        SetNull();
+    }
+    void SetNull()
+    {
+        hashPrev = 0;
+        nHeight = -1;
+        fDposHeight = false;
+        nMaxSize = 0;
+        nTotalSize = 0;
+        nTotalTxFee = 0;
+        fFull = false;
+        fCertSkipped = false;
+        vTx.clear();
+        setTx.clear();
+    }
+    bool IsNull() const
+    {
+        return (nHeight < 0);
+    }
+
+public:
+    uint256 hashPrev;
+    int nHeight;
+    bool fDposHeight;
+    std::size_t nMaxSize;
+    std::size_t nTotalSize;
+    int64 nTotalTxFee;
+    bool fFull;
+    bool fCertSkipped;
+    std::vector<const CPooledTx*> vTx;
+    std::set<uint256> setTx;
+};
+
 class CTxPoolView
 {
 public:
@@ -153,12 +224,17 @@ public:
     class CAddrUnspent
     {
     public:
-        std::map<CTxOutPoint, CUnspentOut> mapTxUnspent;
+        typedef std::map<CTxOutPoint, CUnspentOut, std::less<CTxOutPoint>, xengine::CPooledAllocator<std::pair<const CTxOutPoint, CUnspentOut>>> MapTxUnspent;
+        MapTxUnspent mapTxUnspent;
 
     public:
         CAddrUnspent()
         {
         }
+        CAddrUnspent(xengine::CNodeArena* pArena)
+          : mapTxUnspent(std::less<CTxOutPoint>(), MapTxUnspent::allocator_type(pArena))
+        {
+        }
         void SetTxUnspent(const CTxOutPoint& out, const CUnspentOut& unspent)
         {
             mapTxUnspent[out] = unspent;
@@ -175,12 +251,23 @@ public:
                 mapTxUnspent.erase(it);
             }
         }
+        bool IsEmpty() const
+        {
+            return mapTxUnspent.empty();
+        }
     };
+    typedef xengine::COpenHashMap<CTxOutPoint, CSpent, CTxOutPointHash> MapSpent;
+    typedef xengine::COpenHashMap<CDestination, CAddrUnspent, CDestinationHash> MapAddressUnspent;
 
 public:
     CTxPoolView()
+      : ptrArena(new xengine::CNodeArena),
+        setTxLinkIndex(CPooledTxLinkSet::ctor_args_list(), xengine::CPooledAllocator<CPooledTxLink>(ptrArena.get()))
     {
     }
+    // the view owns the arena its containers allocate from
+    CTxPoolView(const CTxPoolView&) = delete;
+    CTxPoolView& operator=(const CTxPoolView&) = delete;
     std::size_t Count() const
     {
         return setTxLinkIndex.size();
@@ -211,7 +298,7 @@ public:
     }
     bool IsSpent(const CTxOutPoint& out) const
     {
-        std::map<CTxOutPoint, CSpent>::const_iterator it = mapSpent.find(out);
+        MapSpent::const_iterator it = mapSpent.find(out);
         if (it != mapSpent.end())
         {
             return (*it).second.IsSpent();
@@ -220,7 +307,7 @@ public:
     }
     bool GetUnspent(const CTxOutPoint& out, CTxOut& unspent) const
     {
-        std::map<CTxOutPoint, CSpent>::const_iterator it = mapSpent.find(out);
+        MapSpent::const_iterator it = mapSpent.find(out);
         if (it != mapSpent.end() && !(*it).second.IsSpent())
         {
             unspent = static_cast<CTxOut>((*it).second);
@@ -230,7 +317,7 @@ public:
     }
     bool GetSpent(const CTxOutPoint& out, uint256& txidNextTxRet) const
     {
-        std::map<CTxOutPoint, CSpent>::const_iterator it = mapSpent.find(out);
+        MapSpent::const_iterator it = mapSpent.find(out);
         if (it != mapSpent.end())
         {
             txidNextTxRet = (*it).second.txidNextTx;
@@ -247,7 +334,7 @@ public:
             mapSpent[out].SetUnspent(unspent);
             if (!unspent.destTo.IsNull())
             {
-                mapAddressUnspent[unspent.destTo].SetTxUnspent(out, CUnspentOut(unspent, pTx->nType, -1));
+                GetAddrUnspent(unspent.destTo).SetTxUnspent(out, CUnspentOut(unspent, pTx->nType, -1));
             }
         }
         else
@@ -260,7 +347,7 @@ public:
         mapSpent[out].SetSpent(destIn, txidNextTxIn);
         if (!destIn.IsNull())
         {
-            mapAddressUnspent[destIn].SetTxSpent(out);
+            GetAddrUnspent(destIn).SetTxSpent(out);
         }
     }
     void RemoveSpent(const CTxOutPoint& out);
@@ -277,6 +364,7 @@ public:
             }
             xengine::StdTrace("CTxPoolView", "Remove: setTxLinkIndex erase, txid: %s, seq: %ld",
                               txid.GetHex().c_str(), pTx->nSequenceNumber);
+            InvalidateBlockTemplate(txid);
             setTxLinkIndex.erase(txid);
         }
     }
@@ -285,7 +373,10 @@ public:
         setTxLinkIndex.clear();
         mapSpent.clear();
         mapAddressUnspent.clear();
+        blockTemplate.SetNull();
+        Compact();
     }
+    void Compact();
     void SetLastBlock(const uint256& hash, int64 nTime)
     {
         hashLastBlock = hash;
@@ -293,17 +384,21 @@ public:
     }
     void ListUnspent(const CDestination& dest, const std::set<CTxUnspent>& setTxUnspent, uint32 nMax, std::vector<CTxUnspent>& vTxUnspent) const
     {
+        MapAddressUnspent::const_iterator it = mapAddressUnspent.find(dest);
+        if (it == mapAddressUnspent.end())
+        {
+            return;
+        }
         uint32 nCount = 0;
-        for (const auto& kv : mapSpent)
+        for (const auto& kv : it->second.mapTxUnspent)
         {
             const CTxOutPoint& outpoint = kv.first;
-            const CSpent& spent = kv.second;
             CTxOut out;
             if (nMax != 0 && nCount >= nMax)
             {
                 break;
             }
-            if (!spent.IsSpent() && GetUnspent(outpoint, out) && out.destTo == dest)
+            if (!kv.second.IsNull() && GetUnspent(outpoint, out) && out.destTo == dest)
             {
                 CTxUnspent txUnSpent(outpoint, out);
                 if (setTxUnspent.count(txUnSpent) == 0)
@@ -319,6 +414,21 @@ public:
     void GetBlockTxList(std::vector<CTransaction>& vtx, int64& nTotalTxFee, const int64 nBlockTime, const std::size_t nMaxSize, const uint256& hashFork, const int nHeight,
                         std::map<CDestination, int>& mapVoteCert, const std::map<CDestination, int64>& mapVote, const int64 nMinEnrollAmount, const bool fIsDposHeight,
                         std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove, ICoreProtocol* pCorePro, const uint256& hashLastBlock);
+    void SetBlockTemplate(const uint256& hashPrev, const int nHeight, const bool fDposHeight, const std::size_t nMaxSize, const std::vector<CTransaction>& vtx);
+    bool HasBlockTemplate(const uint256& hashPrev, const int nHeight) const
+    {
+        return (!blockTemplate.IsNull() && blockTemplate.hashPrev == hashPrev && blockTemplate.nHeight == nHeight);
+    }
+    bool GetBlockTemplate(const uint256& hashPrev, const int nHeight, const int64 nBlockTime, const std::size_t nMaxSize,
+                          std::vector<CTransaction>& vtx, int64& nTotalTxFee) const;
+    void InvalidateBlockTemplate(const uint256& txid)
+    {
+        // a full template may admit other txs once one leaves
+        if (!blockTemplate.IsNull() && (blockTemplate.fFull || blockTemplate.setTx.count(txid)))
+        {
+            blockTemplate.SetNull();
+        }
+    }
 
 private:
     void GetAllPrevTxLink(const CPooledTxLink& link, std::vector<CPooledTxLink>& prevLinks, CPooledCertTxLinkSet& setCertTxLink);
@@ -328,16 +438,28 @@ private:
                            std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove, ICoreProtocol* pCorePro, const uint256& hashLastBlock);
 
     bool AddAddressUnspent(const uint256& txid, const CPooledTx& tx);
+    CAddrUnspent& GetAddrUnspent(const CDestination& dest)
+    {
+        MapAddressUnspent::iterator it = mapAddressUnspent.find(dest);
+        if (it == mapAddressUnspent.end())
+        {
+            it = mapAddressUnspent.insert(std::make_pair(dest, CAddrUnspent(ptrArena.get()))).first;
+        }
+        return (*it).second;
+    }
+    void AppendBlockTemplate(const uint256& txid, const CPooledTx& tx);
 
 public:
+    std::unique_ptr<xengine::CNodeArena> ptrArena;
     CPooledTxLinkSet setTxLinkIndex;
-    std::map<CTxOutPoint, CSpent> mapSpent;
-    std::map<CDestination, CAddrUnspent> mapAddressUnspent;
+    MapSpent mapSpent;
+    MapAddressUnspent mapAddressUnspent;
     uint256 hashLastBlock;
     int64 nLastBlockTime;
     CProfile profile;
     xengine::CForest<CDestination, uint256> relation;
     uint256 mintHeightTxid;
+    CBlockTxTemplate blockTemplate;
 };
 
 class CTxCache
@@ -446,12 +568,13 @@ public:
     void ListTx(const uint256& hashFork, std::vector<uint256>& vTxPool) override;
     bool ListTx(const uint256& hashFork, const CDestination& dest, std::vector<CTxInfo>& vTxPool, const int64 nGetOffset = 0, const int64 nGetCount = 0) override;
     bool ListTxOfSeq(const uint256& hashFork, const CDestination& dest, std::vector<CTxInfo>& vTxPool, const uint64 nPrevTxSeq, const int64 nGetCount = 0) override;
-    bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent) override;
+    bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent, bool fPoolUnspent = true) override;
     bool ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, const std::map<CDestination, std::vector<CTxUnspent>>& mapUnspentOnChain, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent) override;
     bool FilterTx(const uint256& hashFork, CTxFilter& filter) override;
     bool FetchArrangeBlockTx(const uint256& hashFork, const uint256& hashPrev, int nNewBlockHeight, int64 nBlockTime,
                              std::size_t nMaxSize, std::vector<CTransaction>& vtx, int64& nTotalTxFee) override;
     bool FetchInputs(const uint256& hashFork, const CTransaction& tx, std::vector<CTxOut>& vUnspent) override;
+    void FetchCompactBlockTx(const uint256& hashFork, CCompactBlock& cmpct, std::vector<uint32>& vMissing) override;
     bool SynchronizeBlockChain(const CBlockChainUpdate& update, CTxSetChange& change) override;
     void AddDestDelegate(const CDestination& destDeleage) override;
     bool FetchAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent) override;
@@ -473,10 +596,13 @@ protected:
         }
         return ((++nLastSequenceNumber) << 24);
     }
-    void CacheArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashBlock, std::size_t nMaxSize,
+    bool CacheArrangeBlockTx(const uint256& hashFork, int64 nBlockTime, const uint256& hashBlock, std::size_t nMaxSize,
                              std::vector<CTransaction>& vtx, int64& nTotalTxFee, int nHeight, std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove);
+    void ArrangeBlockTemplate(const uint256& hashFork, const uint256& hashLastBlock, int nHeight, std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove);
+    void CacheBlockTemplate(const uint256& hashFork, const uint256& hashLastBlock, int64 nLastBlockTime, int nHeight,
+                            std::vector<std::pair<uint256, std::vector<CTxIn>>>& vTxRemove);
 
-    void ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent);
+    void ListUnspent(const CTxPoolView& txPoolView, const CDestination& dest, uint32 nMax, const std::vector<CTxUnspent>& vUnspentOnChain, std::vector<CTxUnspent>& vUnspent, bool fPoolUnspent = true);
 
 protected:
     storage::CTxPoolData datTxPool;
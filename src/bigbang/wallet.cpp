@@ -4,6 +4,8 @@
 
 #include "wallet.h"
 
+#include <cassert>
+
 #include "address.h"
 #include "defs.h"
 #include "param.h"
@@ -476,6 +478,8 @@ void CWallet::GetDestinations(set<CDestination>& setDest)
 
 bool CWallet::SignTransaction(const CDestination& destIn, CTransaction& tx, const vector<uint8>& vchDestInData, const vector<uint8>& vchSendToData, const vector<uint8>& vchSignExtraData, const uint256& hashFork, const int32 nForkHeight, bool& fCompleted)
 {
+    // the kept hashes of a memoized tx would go stale once it is signed
+    assert(!tx.IsMemoizeHash());
     vector<uint8> vchSig;
     CTemplateId tid;
     if (destIn.GetTemplateId(tid) && tid.GetType() == TEMPLATE_PAYMENT)
@@ -165,6 +165,23 @@ public:
         std::vector<uint256> vMerkleTree;
         return BuildMerkleTree(vMerkleTree);
     }
+    void MemoizeTxHash(bool fEnable = true) const
+    {
+        txMint.MemoizeHash(fEnable);
+        for (const CTransaction& tx : vtx)
+        {
+            tx.MemoizeHash(fEnable);
+        }
+    }
+    uint64 GetTxHashSavedCount() const
+    {
+        uint64 nSaved = txMint.GetHashSavedCount();
+        for (const CTransaction& tx : vtx)
+        {
+            nSaved += tx.GetHashSavedCount();
+        }
+        return nSaved;
+    }
     static uint32 GetBlockHeightByHash(const uint256& hash)
     {
         return hash.Get32(7);
@@ -183,6 +200,11 @@ protected:
         s.Serialize(txMint, opt);
         s.Serialize(vtx, opt);
         s.Serialize(vchSig, opt);
+        if (boost::is_same<O, xengine::LoadType>::value)
+        {
+            // txs of a loaded block are immutable, keep their hashes once they are computed
+            MemoizeTxHash();
+        }
     }
 };
 
@@ -209,6 +231,60 @@ protected:
     }
 };
 
+// A block loaded from its record without txs, they are stepped over by their
+// lengths. The signature follows them, so it is read as well. It is saved as a
+// block without txs.
+class CBlockHeaderRecord : public CBlock
+{
+    friend class xengine::CStream;
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        CBlock::Serialize(s, opt);
+    }
+    void Serialize(xengine::CStream& s, xengine::LoadType& opt)
+    {
+        SetNull();
+        s.Serialize(nVersion, opt);
+        s.Serialize(nType, opt);
+        s.Serialize(nTimeStamp, opt);
+        s.Serialize(hashPrev, opt);
+        s.Serialize(hashMerkle, opt);
+        s.Serialize(vchProof, opt);
+        s.Serialize(txMint, opt);
+        xengine::CVarInt varTx;
+        s >> varTx;
+        for (uint64 i = 0; i < varTx.nValue; i++)
+        {
+            SkipTx(s);
+        }
+        s.Serialize(vchSig, opt);
+        MemoizeTxHash();
+    }
+    static void SkipTx(xengine::CStream& s)
+    {
+        // fields before the inputs, between the inputs and vchData, and the input size
+        static const std::size_t nHeadSize = sizeof(uint16) * 2 + sizeof(uint32) * 2 + xengine::GetSerializeSize(uint256());
+        static const std::size_t nBodySize = xengine::GetSerializeSize(CDestination()) + sizeof(int64) * 2;
+        static const std::size_t nInputSize = xengine::GetSerializeSize(CTxIn());
+
+        xengine::CVarInt var;
+        s.Skip(nHeadSize);
+        s >> var;
+        if (var.nValue > s.GetSize() / nInputSize)
+        {
+            throw std::runtime_error("tx inputs size error");
+        }
+        s.Skip(var.nValue * nInputSize + nBodySize);
+        s >> var;
+        s.Skip(var.nValue);
+        s >> var;
+        s.Skip(var.nValue);
+    }
+};
+
 inline std::string GetBlockTypeStr(uint16 nType, uint16 nMintType)
 {
     if (nType == CBlock::BLOCK_GENESIS)
@@ -234,31 +310,34 @@ inline std::string GetBlockTypeStr(uint16 nType, uint16 nMintType)
 class CBlockIndex
 {
 public:
-    const uint256* phashBlock;
+    // hot fields used by chain walks first, they fit in 56 bytes without padding
     CBlockIndex* pOrigin;
     CBlockIndex* pPrev;
     CBlockIndex* pNext;
-    uint256 txidMint;
+    CBlockIndex* pSkip;
+    uint32 nTimeStamp;
+    uint32 nHeight;
+    uint32 nFile;
+    uint32 nOffset;
     uint16 nMintType;
     uint16 nVersion;
     uint16 nType;
-    uint32 nTimeStamp;
-    uint32 nHeight;
-    uint64 nRandBeacon;
-    uint256 nChainTrust;
-    int64 nMoneySupply;
     uint8 nProofAlgo;
     uint8 nProofBits;
-    uint32 nFile;
-    uint32 nOffset;
+    uint64 nRandBeacon;
+    int64 nMoneySupply;
+    uint256 hashBlock;
+    uint256 txidMint;
+    uint256 nChainTrust;
 
 public:
     CBlockIndex()
     {
-        phashBlock = nullptr;
+        hashBlock = 0;
         pOrigin = this;
         pPrev = nullptr;
         pNext = nullptr;
+        pSkip = nullptr;
         txidMint = 0;
         nMintType = 0;
         nVersion = 0;
@@ -275,10 +354,11 @@ public:
     }
     CBlockIndex(const CBlock& block, uint32 nFileIn, uint32 nOffsetIn)
     {
-        phashBlock = nullptr;
+        hashBlock = 0;
         pOrigin = this;
         pPrev = nullptr;
         pNext = nullptr;
+        pSkip = nullptr;
         txidMint = (block.IsVacant() ? uint64(0) : block.txMint.GetHash());
         nMintType = block.txMint.nType;
         nVersion = block.nVersion;
@@ -303,9 +383,9 @@ public:
         nFile = nFileIn;
         nOffset = nOffsetIn;
     }
-    uint256 GetBlockHash() const
+    const uint256& GetBlockHash() const
     {
-        return *phashBlock;
+        return hashBlock;
     }
     int GetBlockHeight() const
     {
@@ -387,6 +467,62 @@ public:
         }
         return nSeq;
     }
+    // pSkip points to an ancestor at GetSkipHeight(nHeight), extended blocks share the pSkip of
+    // their primary block. pPrev->pSkip must be built before.
+    void BuildSkip()
+    {
+        if (pPrev == nullptr)
+        {
+            pSkip = nullptr;
+        }
+        else if (pPrev->nHeight == nHeight)
+        {
+            pSkip = pPrev->pSkip;
+        }
+        else
+        {
+            pSkip = pPrev->GetAncestor(GetSkipHeight(nHeight));
+        }
+    }
+    // return the first block (itself included) walking back along pPrev whose height <= nHeightIn,
+    // it is the last block of nHeightIn in the chain. O(log n) by pSkip.
+    CBlockIndex* GetAncestor(int nHeightIn)
+    {
+        if (nHeightIn < 0 || nHeightIn > (int)nHeight)
+        {
+            return nullptr;
+        }
+        CBlockIndex* pIndex = this;
+        while (pIndex != nullptr && (int)pIndex->nHeight > nHeightIn)
+        {
+            int nHeightSkip = GetSkipHeight(pIndex->nHeight);
+            int nHeightSkipPrev = GetSkipHeight(pIndex->nHeight - 1);
+            if (pIndex->pSkip != nullptr
+                && (nHeightSkip == nHeightIn
+                    || (nHeightSkip > nHeightIn && !(nHeightSkipPrev < nHeightSkip - 2 && nHeightSkipPrev >= nHeightIn))))
+            {
+                pIndex = pIndex->pSkip;
+            }
+            else
+            {
+                pIndex = pIndex->pPrev;
+            }
+        }
+        return pIndex;
+    }
+    const CBlockIndex* GetAncestor(int nHeightIn) const
+    {
+        return const_cast<CBlockIndex*>(this)->GetAncestor(nHeightIn);
+    }
+    static int GetSkipHeight(int nHeight)
+    {
+        if (nHeight < 2)
+        {
+            return 0;
+        }
+        // turn off the lowest 1 bit (twice for odd height), any height is reachable in O(log n) jumps
+        return (nHeight & 1) ? ((((nHeight - 1) & (nHeight - 2)) & (((nHeight - 1) & (nHeight - 2)) - 1)) + 1) : (nHeight & (nHeight - 1));
+    }
     const std::string GetBlockType() const
     {
         return GetBlockTypeStr(nType, nMintType);
@@ -409,28 +545,21 @@ class CBlockOutline : public CBlockIndex
     friend class xengine::CStream;
 
 public:
-    uint256 hashBlock;
     uint256 hashPrev;
     uint256 hashOrigin;
 
 public:
     CBlockOutline()
     {
-        hashBlock = 0;
         hashPrev = 0;
         hashOrigin = 0;
     }
     CBlockOutline(const CBlockIndex* pIndex)
       : CBlockIndex(*pIndex)
     {
-        hashBlock = pIndex->GetBlockHash();
         hashPrev = (pPrev ? pPrev->GetBlockHash() : uint64(0));
         hashOrigin = pOrigin->GetBlockHash();
     }
-    uint256 GetBlockHash() const
-    {
-        return hashBlock;
-    }
     std::string ToString() const
     {
         std::ostringstream oss;
@@ -483,4 +612,98 @@ public:
     std::vector<uint256> vBlockHash;
 };
 
+class CCompactBlock
+{
+    friend class xengine::CStream;
+
+public:
+    CCompactBlock()
+      : nNonce(0) {}
+    CCompactBlock(const CBlock& block, uint64 nNonceIn)
+      : nNonce(nNonceIn)
+    {
+        header.nVersion = block.nVersion;
+        header.nType = block.nType;
+        header.nTimeStamp = block.nTimeStamp;
+        header.hashPrev = block.hashPrev;
+        header.hashMerkle = block.hashMerkle;
+        header.vchProof = block.vchProof;
+        header.txMint = block.txMint;
+        header.vchSig = block.vchSig;
+
+        const uint256 hashSalt = GetShortTxIdSalt();
+        vShortTxId.reserve(block.vtx.size());
+        for (const CTransaction& tx : block.vtx)
+        {
+            vShortTxId.push_back(GetShortTxId(hashSalt, tx.GetHash()));
+        }
+    }
+    // short ids are salted by the block and a per-message nonce, so colliding txs can not be prepared in advance
+    uint256 GetShortTxIdSalt() const
+    {
+        return bigbang::crypto::CryptoHash(header.GetHash(), uint256(nNonce));
+    }
+    // keyed SipHash is cheap enough to be run over the whole txpool for every block
+    static uint64 GetShortTxId(const uint256& hashSalt, const uint256& txid)
+    {
+        return (bigbang::crypto::CryptoShortHash(hashSalt, txid.begin(), txid.size()) & 0xFFFFFFFFFFFFULL);
+    }
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(header, opt);
+        s.Serialize(nNonce, opt);
+        s.Serialize(vShortTxId, opt);
+    }
+
+public:
+    CBlock header;
+    uint64 nNonce;
+    std::vector<uint64> vShortTxId;
+};
+
+class CBlockTxnRequest
+{
+    friend class xengine::CStream;
+
+public:
+    CBlockTxnRequest() {}
+    virtual ~CBlockTxnRequest() {}
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vIndex, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    std::vector<uint32> vIndex;
+};
+
+class CBlockTxn
+{
+    friend class xengine::CStream;
+
+public:
+    CBlockTxn() {}
+    virtual ~CBlockTxn() {}
+
+protected:
+    template <typename O>
+    void Serialize(xengine::CStream& s, O& opt)
+    {
+        s.Serialize(hashBlock, opt);
+        s.Serialize(vtx, opt);
+    }
+
+public:
+    uint256 hashBlock;
+    std::vector<CTransaction> vtx;
+};
+
 #endif //COMMON_BLOCK_H
@@ -5,6 +5,8 @@
 #ifndef COMMON_TRANSACTION_H
 #define COMMON_TRANSACTION_H
 
+#include <atomic>
+#include <boost/type_traits/is_same.hpp>
 #include <set>
 #include <stream/datastream.h>
 #include <stream/stream.h>
@@ -87,6 +89,73 @@ protected:
     }
 };
 
+// A hash computed on first use and kept until Reset. Several threads may fill it
+// at once, only the first one stores the result and the others use their own.
+class CHashMemo
+{
+public:
+    CHashMemo()
+      : nState(MEMO_EMPTY), nHit(0) {}
+    CHashMemo(const CHashMemo& memo)
+      : nState(MEMO_EMPTY), nHit(0)
+    {
+        *this = memo;
+    }
+    CHashMemo& operator=(const CHashMemo& memo)
+    {
+        if (this != &memo)
+        {
+            if (memo.nState.load(std::memory_order_acquire) == MEMO_READY)
+            {
+                hash = memo.hash;
+                nState.store(MEMO_READY, std::memory_order_release);
+            }
+            else
+            {
+                nState.store(MEMO_EMPTY, std::memory_order_relaxed);
+            }
+            nHit.store(0, std::memory_order_relaxed);
+        }
+        return *this;
+    }
+    void Reset()
+    {
+        nState.store(MEMO_EMPTY, std::memory_order_relaxed);
+    }
+    template <typename F>
+    uint256 Get(F fnCalc) const
+    {
+        uint8 n = nState.load(std::memory_order_acquire);
+        if (n == MEMO_READY)
+        {
+            nHit.fetch_add(1, std::memory_order_relaxed);
+            return hash;
+        }
+        uint256 hashCalc = fnCalc();
+        if (n == MEMO_EMPTY && nState.compare_exchange_strong(n, MEMO_FILLING, std::memory_order_acquire))
+        {
+            hash = hashCalc;
+            nState.store(MEMO_READY, std::memory_order_release);
+        }
+        return hashCalc;
+    }
+    uint32 GetHitCount() const
+    {
+        return nHit.load(std::memory_order_relaxed);
+    }
+
+protected:
+    enum
+    {
+        MEMO_EMPTY = 0,
+        MEMO_FILLING = 1,
+        MEMO_READY = 2
+    };
+    mutable std::atomic<uint8> nState;
+    mutable std::atomic<uint32> nHit;
+    mutable uint256 hash;
+};
+
 class CTransaction
 {
     friend class xengine::CStream;
@@ -115,6 +184,7 @@ public:
         TX_DEFI_MINT_HEIGHT = 0x0003 // setting DeFi mint height Tx
     };
     CTransaction()
+      : fMemoHash(false)
     {
         SetNull();
     }
@@ -132,6 +202,7 @@ public:
         nTxFee = 0;
         vchData.clear();
         vchSig.clear();
+        InvalidateHash();
     }
     bool IsNull() const
     {
@@ -175,18 +246,43 @@ public:
     }
     uint256 GetHash() const
     {
-        xengine::CBufStream ss;
-        ss << (*this);
-
-        uint256 hash = bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-
-        return uint256(nTimeStamp, uint224(hash));
+        if (fMemoHash)
+        {
+            return memoHash.Get([this] { return CalcHash(); });
+        }
+        return CalcHash();
     }
     uint256 GetSignatureHash() const
     {
-        xengine::CBufStream ss;
-        ss << nVersion << nType << nTimeStamp << nLockUntil << hashAnchor << vInput << sendTo << nAmount << nTxFee << vchData;
-        return bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
+        if (fMemoHash)
+        {
+            return memoSigHash.Get([this] { return CalcSignatureHash(); });
+        }
+        return CalcSignatureHash();
+    }
+    // Memoized-hash mode: txid and signature hash are computed on the first call and kept.
+    // A memoized tx is immutable, its fields are public but must not be edited in place
+    // (SetNull/SetLockUntil/deserialization drop the kept hashes, other edits need
+    // InvalidateHash()). Only enable it on block, pool and peer txs, never on txs that are
+    // being built or signed.
+    void MemoizeHash(bool fEnable = true) const
+    {
+        fMemoHash = fEnable;
+        InvalidateHash();
+    }
+    bool IsMemoizeHash() const
+    {
+        return fMemoHash;
+    }
+    void InvalidateHash() const
+    {
+        memoHash.Reset();
+        memoSigHash.Reset();
+    }
+    // Number of txid/signature hash computations skipped since the hashes were kept
+    uint32 GetHashSavedCount() const
+    {
+        return memoHash.GetHitCount() + memoSigHash.GetHitCount();
     }
 
     int64 GetChange(int64 nValueIn) const
@@ -208,6 +304,7 @@ public:
             return false;
         }
         nLockUntil = (n << 31) | nHeight;
+        InvalidateHash();
         return true;
     }
     friend bool operator==(const CTransaction& a, const CTransaction& b)
@@ -234,7 +331,30 @@ protected:
         s.Serialize(nTxFee, opt);
         s.Serialize(vchData, opt);
         s.Serialize(vchSig, opt);
+        if (boost::is_same<O, xengine::LoadType>::value)
+        {
+            InvalidateHash();
+        }
+    }
+    uint256 CalcHash() const
+    {
+        xengine::CBufStream ss;
+        ss << (*this);
+
+        uint256 hash = bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
+        return uint256(nTimeStamp, uint224(hash));
+    }
+    uint256 CalcSignatureHash() const
+    {
+        xengine::CBufStream ss;
+        ss << nVersion << nType << nTimeStamp << nLockUntil << hashAnchor << vInput << sendTo << nAmount << nTxFee << vchData;
+        return bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
     }
+
+protected:
+    mutable bool fMemoHash;
+    mutable CHashMemo memoHash;
+    mutable CHashMemo memoSigHash;
 };
 
 class CTxOut
@@ -561,6 +681,27 @@ public:
     virtual bool FoundTx(const uint256& hashFork, const CAssembledTx& tx) = 0;
 };
 
+// Position of a chunked FilterTx scan, nHeight is the next height to scan and
+// hashBlock the last block scanned. If a reorg takes hashBlock off the fork the
+// cursor starts over with fRestart set, so the caller drops what it has found.
+// With the address tx index the heights holding a filtered address are listed
+// once up to nIndexedHeight, setHeight keeps the ones left to scan.
+class CTxFilterCursor
+{
+public:
+    int nHeight;
+    uint256 hashBlock;
+    bool fEnd;
+    bool fRestart;
+    bool fIndexed;
+    int nIndexedHeight;
+    std::set<int> setHeight;
+
+public:
+    CTxFilterCursor(const int nHeightIn = 0)
+      : nHeight(nHeightIn), fEnd(false), fRestart(false), fIndexed(false), nIndexedHeight(-1) {}
+};
+
 class CTxId : public uint256
 {
 public:
@@ -122,6 +122,13 @@ uint256 CryptoHash(const uint256& h1, const uint256& h2)
     return hash;
 }
 
+uint64 CryptoShortHash(const uint256& key, const void* msg, size_t len)
+{
+    uint64 hash;
+    crypto_shorthash_siphash24((uint8*)&hash, (const uint8*)msg, len, key.begin());
+    return hash;
+}
+
 uint256 CryptoPowHash(const void* msg, size_t len)
 {
     uint256 hash;
@@ -182,6 +189,199 @@ bool CryptoVerify(const uint256& pubkey, const void* md, const size_t len, const
             && !crypto_sign_ed25519_verify_detached(&vchSig[0], (const uint8*)md, len, (const uint8*)&pubkey));
 }
 
+// batch verify
+static const uint8 ed25519Order[32] = { 0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                                        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10 };
+static const uint8 ed25519Prime[32] = { 0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f };
+
+// unpack a canonical point which is not small order
+static bool UnpackBatchPoint(const uint8* md32, CEdwards25519& point)
+{
+    uint8 y[32];
+    memcpy(y, md32, 32);
+    y[31] &= 0x7f;
+    if (curve25519::Compare32(y, ed25519Prime) >= 0 || !point.UnpackFast(md32))
+    {
+        return false;
+    }
+    CEdwards25519 p8 = point;
+    p8 += p8;
+    p8 += p8;
+    p8 += p8;
+    return (p8 != CEdwards25519());
+}
+
+// c bits from nBit of little-endian 32 bytes scalar
+static uint32 GetScalarWindow(const uint8* s, const size_t nBit, const size_t c)
+{
+    size_t nByte = nBit / 8;
+    uint32 v = s[nByte];
+    if (nByte + 1 < 32)
+    {
+        v |= ((uint32)s[nByte + 1]) << 8;
+    }
+    if (nByte + 2 < 32)
+    {
+        v |= ((uint32)s[nByte + 2]) << 16;
+    }
+    return (v >> (nBit % 8)) & ((1U << c) - 1);
+}
+
+// sum(vScalar[i] * vPoint[i])
+// few points: interleaved 4 bits windows with a table of each point (Straus)
+// many points: bucket method (Pippenger), window bits grows with the number of points
+static CEdwards25519 MultiScalarMult(const vector<CSC25519>& vScalar, const vector<CEdwards25519>& vPoint)
+{
+    const size_t n = vPoint.size();
+    CEdwards25519 r;
+    bool fStart = false;
+
+    if (n < 128)
+    {
+        const size_t c = 4;
+        const size_t nTable = (1U << c) - 1;
+        vector<CEdwards25519> vTable(n * nTable);
+        for (size_t i = 0; i < n; i++)
+        {
+            vTable[i * nTable] = vPoint[i];
+            for (size_t k = 1; k < nTable; k++)
+            {
+                vTable[i * nTable + k] = vTable[i * nTable + k - 1] + vPoint[i];
+            }
+        }
+
+        for (int nWin = 256 / c - 1; nWin >= 0; nWin--)
+        {
+            for (size_t k = 0; fStart && k < c; k++)
+            {
+                r += r;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                uint32 nDigit = GetScalarWindow(vScalar[i].Begin(), nWin * c, c);
+                if (nDigit != 0)
+                {
+                    r += vTable[i * nTable + nDigit - 1];
+                    fStart = true;
+                }
+            }
+        }
+        return r;
+    }
+
+    const size_t c = (n < 512) ? 6 : ((n < 2048) ? 7 : 8);
+    const size_t nBucket = (1U << c) - 1;
+    vector<CEdwards25519> vBucket(nBucket);
+    vector<bool> vUsed(nBucket);
+    for (int nWin = (256 + c - 1) / c - 1; nWin >= 0; nWin--)
+    {
+        for (size_t k = 0; fStart && k < c; k++)
+        {
+            r += r;
+        }
+
+        vUsed.assign(nBucket, false);
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32 nDigit = GetScalarWindow(vScalar[i].Begin(), nWin * c, c);
+            if (nDigit != 0)
+            {
+                if (vUsed[nDigit - 1])
+                {
+                    vBucket[nDigit - 1] += vPoint[i];
+                }
+                else
+                {
+                    vBucket[nDigit - 1] = vPoint[i];
+                    vUsed[nDigit - 1] = true;
+                }
+            }
+        }
+
+        // sum(j * bucket[j]) = sum(sum(bucket[k], k >= j))
+        CEdwards25519 running;
+        bool fRunning = false;
+        for (int j = nBucket - 1; j >= 0; j--)
+        {
+            if (vUsed[j])
+            {
+                running += vBucket[j];
+                fRunning = true;
+            }
+            if (fRunning)
+            {
+                r += running;
+                fStart = true;
+            }
+        }
+    }
+    return r;
+}
+
+bool CryptoBatchVerify(const vector<uint256>& vPubKey, const vector<vector<uint8>>& vMsg, const vector<vector<uint8>>& vSig)
+{
+    const size_t n = vSig.size();
+    if (vPubKey.size() != n || vMsg.size() != n)
+    {
+        return false;
+    }
+    if (n == 0)
+    {
+        return true;
+    }
+
+    vector<CSC25519> vScalar;
+    vector<CEdwards25519> vPoint;
+    vScalar.reserve(n * 2);
+    vPoint.reserve(n * 2);
+    CSC25519 sumS;
+    for (size_t i = 0; i < n; i++)
+    {
+        const vector<uint8>& vchSig = vSig[i];
+        if (vchSig.size() != 64 || curve25519::Compare32(&vchSig[32], ed25519Order) >= 0)
+        {
+            return false;
+        }
+
+        CEdwards25519 R, P;
+        if (!UnpackBatchPoint(&vchSig[0], R) || !UnpackBatchPoint(vPubKey[i].begin(), P))
+        {
+            return false;
+        }
+
+        // hi = sha512(R,P,M)
+        crypto_hash_sha512_state state;
+        crypto_hash_sha512_init(&state);
+        crypto_hash_sha512_update(&state, &vchSig[0], 32);
+        crypto_hash_sha512_update(&state, vPubKey[i].begin(), 32);
+        crypto_hash_sha512_update(&state, vMsg[i].data(), vMsg[i].size());
+        uint8 hash[64];
+        crypto_hash_sha512_final(&state, hash);
+        CSC25519 h = CSC25519::Reduce64(hash);
+
+        // zi is random 128 bits
+        uint8 md32[32] = { 0 };
+        randombytes_buf(md32, 16);
+        CSC25519 z(md32);
+
+        sumS += z * CSC25519(&vchSig[32]);
+        vScalar.push_back(z);
+        vPoint.push_back(-R);
+        vScalar.push_back(z * h);
+        vPoint.push_back(-P);
+    }
+
+    CEdwards25519 sB;
+    sB.Generate(sumS);
+    // 8 * (sB - sum(zi * Ri) - sum((zi * hi) * Pi)) == 0
+    CEdwards25519 r = sB + MultiScalarMult(vScalar, vPoint);
+    r += r;
+    r += r;
+    r += r;
+    return (r == CEdwards25519());
+}
+
 // return the nIndex key is signed in multiple signature
 static bool IsSigned(const uint8* pIndex, const size_t nLen, const size_t nIndex)
 {
@@ -96,6 +96,8 @@ void CryptoGetRand256(uint256& u);
 uint256 CryptoHash(const void* msg, std::size_t len);
 uint256 CryptoHash(const uint256& h1, const uint256& h2);
 uint256 CryptoPowHash(const void* msg, size_t len);
+// SipHash-2-4 keyed by the first 16 bytes of key, for hash tables and short ids
+uint64 CryptoShortHash(const uint256& key, const void* msg, std::size_t len);
 
 // SHA256
 uint256 CryptoSHA256(const void* msg, size_t len);
@@ -112,6 +114,17 @@ uint256 CryptoImportKey(CCryptoKey& key, const uint256& secret);
 void CryptoSign(const CCryptoKey& key, const void* md, const std::size_t len, std::vector<uint8>& vchSig);
 bool CryptoVerify(const uint256& pubkey, const void* md, const std::size_t len, const std::vector<uint8>& vchSig);
 
+// batch verify:
+//   verify n standard ed25519 signatures (vchSig[i] of msg[i] by pubkey[i]) at once.
+//   (sum(zi * Si)) * B - sum(zi * Ri) - sum((zi * hi) * Pi) == 0, zi is random 128 bits, hi = sha512(Ri,Pi,Mi)
+//   return true if all signatures are valid. If false, at least one is invalid and caller
+//   should fall back to CryptoVerify to locate it.
+//   non-canonical S, non-canonical or small order R/P are rejected as libsodium does. The equation is multiplied
+//   by the cofactor 8, so the result does not depend on zi. Every signature passed CryptoVerify passes batch verify,
+//   but a crafted signature whose R/P has a torsion component always passes batch verify while CryptoVerify
+//   rejects it. So don't use it as the only check in consensus.
+bool CryptoBatchVerify(const std::vector<uint256>& vPubKey, const std::vector<std::vector<uint8>>& vMsg, const std::vector<std::vector<uint8>>& vSig);
+
 // assume:
 //   1. 1 <= i <= j <= n
 //   2. Pi is the i-th public key
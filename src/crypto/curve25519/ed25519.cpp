@@ -74,6 +74,27 @@ bool CEdwards25519::Unpack(const uint8_t* md32)
     return true;
 }
 
+bool CEdwards25519::UnpackFast(const uint8_t* md32)
+{
+    fZ = CFP25519(1);
+    fY = CFP25519(md32);
+    CFP25519 y2 = CFP25519(md32).Square();
+    CFP25519 u = y2 - fZ;
+    fX = u.SqrtRatio(y2 * ecd + fZ);
+    if (fX.IsZero())
+    {
+        fT = CFP25519();
+        return u.IsZero();
+    }
+
+    if (fX.Parity() != (md32[31] >> 7))
+    {
+        fX = -fX;
+    }
+    fT = fX * fY;
+    return true;
+}
+
 void CEdwards25519::Pack(uint8_t* md32) const
 {
     CFP25519 zi = fZ.Inverse();
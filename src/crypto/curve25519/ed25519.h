@@ -33,6 +33,9 @@ public:
         *this = base.ScalarMult(t, fPreComputation);
     }
     bool Unpack(const uint8_t* md32);
+    // same as Unpack with one exponentiation instead of an inversion and a square root,
+    // only used by batch verification
+    bool UnpackFast(const uint8_t* md32);
     void Pack(uint8_t* md32) const;
     const CEdwards25519 ScalarMult(const uint8_t* u8, std::size_t size, const bool fPreComputation = false) const;
     template <typename T>
@@ -18,6 +18,9 @@ static const uint64_t halfPrime[4] = { 0xFFFFFFFFFFFFFFF6, 0xFFFFFFFFFFFFFFFF,
                                        0xFFFFFFFFFFFFFFFF, 0x3FFFFFFFFFFFFFFF };
 static const uint64_t minusOne[4] = { 0xFFFFFFFFFFFFFFEC, 0xFFFFFFFFFFFFFFFF,
                                       0xFFFFFFFFFFFFFFFF, 0x7FFFFFFFFFFFFFFF };
+/* sqrt(-1) */
+static const uint8_t sqrtMinusOne[32] = { 0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4, 0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+                                          0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b, 0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b };
 
 CFP25519::CFP25519()
 {
@@ -226,6 +229,33 @@ const CFP25519 CFP25519::Sqrt() const
     return CFP25519();
 }
 
+const CFP25519 CFP25519::SqrtRatio(const CFP25519& v) const
+{
+    // x = u * v^3 * (u * v^7) ^ ((p-5)/8), u = value
+    CFP25519 v3 = v;
+    v3.Square();
+    v3 *= v;
+    CFP25519 v7 = v3;
+    v7.Square();
+    v7 *= v;
+    CFP25519 x = *this * v3 * (*this * v7).Power58Chain();
+
+    // v * x^2 == u, return x
+    // v * x^2 == -u, return x * sqrt(-1)
+    CFP25519 vx2 = x;
+    vx2.Square();
+    vx2 *= v;
+    if (vx2 == *this)
+    {
+        return x;
+    }
+    else if (vx2 == -*this)
+    {
+        return x * CFP25519(sqrtMinusOne);
+    }
+    return CFP25519();
+}
+
 CFP25519& CFP25519::Square()
 {
     *this *= *this;
@@ -374,4 +404,74 @@ const CFP25519 CFP25519::Power58() const
     return g;
 }
 
+const CFP25519 CFP25519::Power58Chain() const
+{
+    // addition chain of (prime-5)/8 = 2^252 - 3, no inversion
+    CFP25519 t0, t1, t2;
+    // g^2, g^9, g^11
+    t0 = *this;
+    t0.Square();
+    t1 = t0;
+    t1.Square();
+    t1.Square();
+    t1 *= *this;
+    t0 *= t1;
+    // g^(2^5 - 1)
+    t0.Square();
+    t0 *= t1;
+    // g^(2^10 - 1)
+    t1 = t0;
+    for (int i = 0; i < 5; i++)
+    {
+        t1.Square();
+    }
+    t0 *= t1;
+    // g^(2^20 - 1)
+    t1 = t0;
+    for (int i = 0; i < 10; i++)
+    {
+        t1.Square();
+    }
+    t1 *= t0;
+    // g^(2^40 - 1)
+    t2 = t1;
+    for (int i = 0; i < 20; i++)
+    {
+        t2.Square();
+    }
+    t1 *= t2;
+    // g^(2^50 - 1)
+    for (int i = 0; i < 10; i++)
+    {
+        t1.Square();
+    }
+    t0 *= t1;
+    // g^(2^100 - 1)
+    t1 = t0;
+    for (int i = 0; i < 50; i++)
+    {
+        t1.Square();
+    }
+    t1 *= t0;
+    // g^(2^200 - 1)
+    t2 = t1;
+    for (int i = 0; i < 100; i++)
+    {
+        t2.Square();
+    }
+    t1 *= t2;
+    // g^(2^250 - 1)
+    for (int i = 0; i < 50; i++)
+    {
+        t1.Square();
+    }
+    t0 *= t1;
+    // g^(2^252 - 3)
+    t0.Square();
+    t0.Square();
+    t0 *= *this;
+
+    return t0;
+}
+
 } // namespace curve25519
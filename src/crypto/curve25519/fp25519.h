@@ -30,6 +30,9 @@ public:
     const CFP25519 Power(const uint8_t* md32) const;
     // return (value ^ 1/2) % prime
     const CFP25519 Sqrt() const;
+    // return (value / v) ^ 1/2 % prime with single exponentiation, or 0 if not square.
+    // only used by batch verification, the result may be the other root of Sqrt
+    const CFP25519 SqrtRatio(const CFP25519& v) const;
     // value = value * value
     CFP25519& Square();
     // value == 0
@@ -66,6 +69,8 @@ protected:
     void Reduce();
     // return pow(value, (prime - 5)/8) % prime
     const CFP25519 Power58() const;
+    // same as Power58 by addition chain without inversion
+    const CFP25519 Power58Chain() const;
 
 public:
     uint64_t value[4];
@@ -43,6 +43,7 @@ enum RPCErrorCode
     RPC_REQUEST_ID_NOT_FOUND = -13,    //!< Request id is missing when get response
     RPC_VERSION_OUT_OF_DATE = -14,     //!< Request version is out of date
     RPC_REQUEST_FUNC_OBSOLETE = -15,   //!< Requested function is obsolete
+    RPC_REQUEST_TIMEOUT = -16,         //!< Request waited in the queue too long
 
     //! Aliases for backward compatibility
     RPC_TRANSACTION_ERROR = RPC_VERIFY_ERROR,
@@ -20,7 +20,7 @@ namespace network
 
 CBbPeer::CBbPeer(CPeerNet* pPeerNetIn, CIOClient* pClientIn, uint64 nNonceIn,
                  bool fInBoundIn, uint32 nMsgMagicIn, uint32 nHsTimerIdIn)
-  : CPeer(pPeerNetIn, pClientIn, nNonceIn, fInBoundIn), nMsgMagic(nMsgMagicIn), nHsTimerId(nHsTimerIdIn), nPingTimerId(0), nPingMillisTime(0), nPingSeq(0)
+  : CPeer(pPeerNetIn, pClientIn, nNonceIn, fInBoundIn), nMsgMagic(nMsgMagicIn), nHsTimerId(nHsTimerIdIn), nPingTimerId(0), nPingMillisTime(0), nPingSeq(0), nRecvChecksum(0)
 {
 }
 
@@ -168,6 +168,13 @@ bool CBbPeer::ParseMessageHeader()
     return false;
 }
 
+void CBbPeer::HashPayload()
+{
+    // called on the client strand when the payload arrives, off the io proc strand
+    CBufStream& ss = ReadStream();
+    nRecvChecksum = bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize()).Get32();
+}
+
 bool CBbPeer::HandshakeReadHeader()
 {
     if (!ParseMessageHeader())
@@ -177,9 +184,10 @@ bool CBbPeer::HandshakeReadHeader()
 
     if (hdrRecv.nPayloadSize != 0)
     {
-        Read(hdrRecv.nPayloadSize, boost::bind(&CBbPeer::HandshakeReadCompleted, this));
+        Read(hdrRecv.nPayloadSize, boost::bind(&CBbPeer::HandshakeReadCompleted, this), boost::bind(&CBbPeer::HashPayload, this));
         return true;
     }
+    HashPayload();
     return HandshakeReadCompleted();
 }
 
@@ -192,17 +200,17 @@ bool CBbPeer::HandleReadHeader()
 
     if (hdrRecv.nPayloadSize != 0)
     {
-        Read(hdrRecv.nPayloadSize, boost::bind(&CBbPeer::HandleReadCompleted, this));
+        Read(hdrRecv.nPayloadSize, boost::bind(&CBbPeer::HandleReadCompleted, this), boost::bind(&CBbPeer::HashPayload, this));
         return true;
     }
+    HashPayload();
     return HandleReadCompleted();
 }
 
 bool CBbPeer::HandshakeReadCompleted()
 {
     CBufStream& ss = ReadStream();
-    uint256 hash = bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-    if (hdrRecv.nPayloadChecksum == hash.Get32() && hdrRecv.GetChannel() == PROTO_CHN_NETWORK)
+    if (hdrRecv.nPayloadChecksum == nRecvChecksum && hdrRecv.GetChannel() == PROTO_CHN_NETWORK)
     {
         int64 nTimeRecv = GetTime();
         int nCmd = hdrRecv.GetCommand();
@@ -259,8 +267,7 @@ bool CBbPeer::HandshakeCompleted()
 bool CBbPeer::HandleReadCompleted()
 {
     CBufStream& ss = ReadStream();
-    uint256 hash = bigbang::crypto::CryptoHash(ss.GetData(), ss.GetSize());
-    if (hdrRecv.nPayloadChecksum == hash.Get32())
+    if (hdrRecv.nPayloadChecksum == nRecvChecksum)
     {
         try
         {
@@ -41,6 +41,7 @@ protected:
     void SendHelloAck();
     void SendPing();
     bool ParseMessageHeader();
+    void HashPayload();
     bool HandshakeReadHeader();
     bool HandshakeReadCompleted();
     virtual bool HandshakeCompleted();
@@ -66,6 +67,7 @@ protected:
     uint32 nMsgMagic;
     uint32 nHsTimerId;
     CPeerMessageHeader hdrRecv;
+    uint32 nRecvChecksum;
 
     std::map<CInv, uint32> mapRequest;
     std::queue<std::pair<uint256, CInv>> queAskFor;
@@ -32,6 +32,11 @@ enum
     EVENT_PEER_BLOCK,
     EVENT_PEER_GETFAIL,
     EVENT_PEER_MSGRSP,
+    EVENT_PEER_GETHEADERS,
+    EVENT_PEER_HEADERS,
+    EVENT_PEER_CMPCTBLOCK,
+    EVENT_PEER_GETBLOCKTXN,
+    EVENT_PEER_BLOCKTXN,
     EVENT_PEER_BULLETIN,
     EVENT_PEER_GETDELEGATED,
     EVENT_PEER_DISTRIBUTE,
@@ -218,6 +223,11 @@ typedef TYPE_PEERDATAEVENT(EVENT_PEER_TX, CTransaction) CEventPeerTx;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCK, CBlock) CEventPeerBlock;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETFAIL, std::vector<CInv>) CEventPeerGetFail;
 typedef TYPE_PEERDATAEVENT(EVENT_PEER_MSGRSP, CMsgRsp) CEventPeerMsgRsp;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETHEADERS, CBlockLocator) CEventPeerGetHeaders;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_HEADERS, std::vector<CBlock>) CEventPeerHeaders;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_CMPCTBLOCK, CCompactBlock) CEventPeerCmpctBlock;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_GETBLOCKTXN, CBlockTxnRequest) CEventPeerGetBlockTxn;
+typedef TYPE_PEERDATAEVENT(EVENT_PEER_BLOCKTXN, CBlockTxn) CEventPeerBlockTxn;
 
 typedef TYPE_PEERDELEGATEDEVENT(EVENT_PEER_BULLETIN, CEventPeerDelegatedBulletin) CEventPeerBulletin;
 typedef TYPE_PEERDELEGATEDEVENT(EVENT_PEER_GETDELEGATED, CEventPeerDelegatedGetData) CEventPeerGetDelegated;
@@ -239,6 +249,11 @@ public:
     DECLARE_EVENTHANDLER(CEventPeerBlock);
     DECLARE_EVENTHANDLER(CEventPeerGetFail);
     DECLARE_EVENTHANDLER(CEventPeerMsgRsp);
+    DECLARE_EVENTHANDLER(CEventPeerGetHeaders);
+    DECLARE_EVENTHANDLER(CEventPeerHeaders);
+    DECLARE_EVENTHANDLER(CEventPeerCmpctBlock);
+    DECLARE_EVENTHANDLER(CEventPeerGetBlockTxn);
+    DECLARE_EVENTHANDLER(CEventPeerBlockTxn);
     DECLARE_EVENTHANDLER(CEventPeerBulletin);
     DECLARE_EVENTHANDLER(CEventPeerGetDelegated);
     DECLARE_EVENTHANDLER(CEventPeerDistribute);
@@ -143,6 +143,41 @@ bool CBbPeerNet::HandleEvent(CEventPeerMsgRsp& eventMsgRsp)
     return SendDataMessage(eventMsgRsp.nNonce, PROTO_CMD_MSGRSP, ssPayload);
 }
 
+bool CBbPeerNet::HandleEvent(CEventPeerGetHeaders& eventGetHeaders)
+{
+    CBufStream ssPayload;
+    ssPayload << eventGetHeaders;
+    return SendDataMessage(eventGetHeaders.nNonce, PROTO_CMD_GETHEADERS, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerHeaders& eventHeaders)
+{
+    CBufStream ssPayload;
+    ssPayload << eventHeaders;
+    return SendDataMessage(eventHeaders.nNonce, PROTO_CMD_HEADERS, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerCmpctBlock& eventCmpctBlock)
+{
+    CBufStream ssPayload;
+    ssPayload << eventCmpctBlock;
+    return SendDataMessage(eventCmpctBlock.nNonce, PROTO_CMD_CMPCTBLOCK, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventGetBlockTxn;
+    return SendDataMessage(eventGetBlockTxn.nNonce, PROTO_CMD_GETBLOCKTXN, ssPayload);
+}
+
+bool CBbPeerNet::HandleEvent(CEventPeerBlockTxn& eventBlockTxn)
+{
+    CBufStream ssPayload;
+    ssPayload << eventBlockTxn;
+    return SendDataMessage(eventBlockTxn.nNonce, PROTO_CMD_BLOCKTXN, ssPayload);
+}
+
 bool CBbPeerNet::HandleEvent(CEventPeerBulletin& eventBulletin)
 {
     CBufStream ssPayload;
@@ -612,6 +647,61 @@ bool CBbPeerNet::HandlePeerRecvMessage(CPeer* pPeer, int nChannel, int nCommand,
             }
         }
         break;
+        case PROTO_CMD_GETHEADERS:
+        {
+            CEventPeerGetHeaders* pEvent = new CEventPeerGetHeaders(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_HEADERS:
+        {
+            CEventPeerHeaders* pEvent = new CEventPeerHeaders(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_CMPCTBLOCK:
+        {
+            CEventPeerCmpctBlock* pEvent = new CEventPeerCmpctBlock(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_GETBLOCKTXN:
+        {
+            CEventPeerGetBlockTxn* pEvent = new CEventPeerGetBlockTxn(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
+        case PROTO_CMD_BLOCKTXN:
+        {
+            CEventPeerBlockTxn* pEvent = new CEventPeerBlockTxn(pBbPeer->GetNonce(), hashFork);
+            if (pEvent != nullptr)
+            {
+                ssPayload >> pEvent->data;
+                pNetChannel->PostEvent(pEvent);
+                return true;
+            }
+        }
+        break;
         default:
             break;
         }
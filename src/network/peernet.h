@@ -68,6 +68,11 @@ protected:
     bool HandleEvent(CEventPeerBlock& eventBlock) override;
     bool HandleEvent(CEventPeerGetFail& eventGetFail) override;
     bool HandleEvent(CEventPeerMsgRsp& eventMsgRsp) override;
+    bool HandleEvent(CEventPeerGetHeaders& eventGetHeaders) override;
+    bool HandleEvent(CEventPeerHeaders& eventHeaders) override;
+    bool HandleEvent(CEventPeerCmpctBlock& eventCmpctBlock) override;
+    bool HandleEvent(CEventPeerGetBlockTxn& eventGetBlockTxn) override;
+    bool HandleEvent(CEventPeerBlockTxn& eventBlockTxn) override;
     bool HandleEvent(CEventPeerBulletin& eventBulletin) override;
     bool HandleEvent(CEventPeerGetDelegated& eventGetDelegated) override;
     bool HandleEvent(CEventPeerDistribute& eventDistribute) override;
@@ -19,6 +19,8 @@ enum
 {
     NODE_NETWORK = (1 << 0),
     NODE_DELEGATED = (1 << 1),
+    NODE_HEADERS = (1 << 2),
+    NODE_COMPACTBLOCK = (1 << 3),
 };
 
 enum
@@ -50,6 +52,11 @@ enum
     PROTO_CMD_BLOCK = 7,
     PROTO_CMD_GETFAIL = 8,
     PROTO_CMD_MSGRSP = 9,
+    PROTO_CMD_GETHEADERS = 10,
+    PROTO_CMD_HEADERS = 11,
+    PROTO_CMD_CMPCTBLOCK = 12,
+    PROTO_CMD_GETBLOCKTXN = 13,
+    PROTO_CMD_BLOCKTXN = 14,
 };
 
 enum
@@ -168,6 +175,7 @@ public:
         MSG_BLOCK,
         MSG_DISTRIBUTE,
         MSG_PUBLISH,
+        MSG_CMPCT_BLOCK,
     };
     enum
     {
@@ -16,17 +16,12 @@ namespace bigbang
 namespace storage
 {
 
-#define ADDRESS_FLUSH_INTERVAL (60)
-
 //////////////////////////////
 // CForkAddressDB
 
-CForkAddressDB::CForkAddressDB(const boost::filesystem::path& pathDB)
+CForkAddressDB::CForkAddressDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork)
 {
-    CLevelDBArguments args;
-    args.path = pathDB.string();
-    args.syncwrite = false;
-    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    CKVDBEngine* engine = CLevelDBShared::NewForkEngine(pathDB, spShared, CLevelDBShared::TABLE_ADDRESS, hashFork);
 
     if (!CKVDB::Open(engine))
     {
@@ -37,7 +32,7 @@ CForkAddressDB::CForkAddressDB(const boost::filesystem::path& pathDB)
 CForkAddressDB::~CForkAddressDB()
 {
     Close();
-    dblCache.Clear();
+    cacheWrite.Clear();
 }
 
 bool CForkAddressDB::RemoveAll()
@@ -46,15 +41,15 @@ bool CForkAddressDB::RemoveAll()
     {
         return false;
     }
-    dblCache.Clear();
+    cacheWrite.Clear();
     return true;
 }
 
 bool CForkAddressDB::UpdateAddress(const vector<pair<CDestination, CAddrInfo>>& vAddNew, const vector<CDestination>& vRemove)
 {
-    xengine::CWriteLock wlock(rwUpper);
+    CacheType::CWriteView view(cacheWrite);
 
-    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapUpper = view.mapUpper;
 
     for (const auto& addr : vRemove)
     {
@@ -68,11 +63,11 @@ bool CForkAddressDB::UpdateAddress(const vector<pair<CDestination, CAddrInfo>>&
             continue;
         }
         CAddrInfo addrInfo;
-        if (!GetAddress(vd.first, addrInfo))
+        if (!GetAddress(view, vd.first, addrInfo))
         {
             bool fLoop = false;
             CAddrInfo addrParentInfo;
-            if (GetAddress(vd.second.destParent, addrInfo))
+            if (GetAddress(view, vd.second.destParent, addrInfo))
             {
                 addrParentInfo = addrInfo;
                 while (1)
@@ -82,7 +77,7 @@ bool CForkAddressDB::UpdateAddress(const vector<pair<CDestination, CAddrInfo>>&
                         fLoop = true;
                         break;
                     }
-                    if (addrInfo.destRoot.IsNull() || !GetAddress(addrInfo.destRoot, addrInfo))
+                    if (addrInfo.destRoot.IsNull() || !GetAddress(view, addrInfo.destRoot, addrInfo))
                     {
                         break;
                     }
@@ -223,37 +218,10 @@ bool CForkAddressDB::WriteAddress(const CDestination& dest, const CAddrInfo& add
 
 bool CForkAddressDB::ReadAddress(const CDestination& dest, CAddrInfo& addrInfo)
 {
+    if (cacheWrite.Find(dest, addrInfo))
     {
-        xengine::CReadLock rlock(rwUpper);
-
-        MapType& mapUpper = dblCache.GetUpperMap();
-        typename MapType::iterator it = mapUpper.find(dest);
-        if (it != mapUpper.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                addrInfo = (*it).second;
-                return true;
-            }
-            return false;
-        }
+        return !addrInfo.IsNull();
     }
-
-    {
-        xengine::CReadLock rlock(rwLower);
-        MapType& mapLower = dblCache.GetLowerMap();
-        typename MapType::iterator it = mapLower.find(dest);
-        if (it != mapLower.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                addrInfo = (*it).second;
-                return true;
-            }
-            return false;
-        }
-    }
-
     return Read(dest, addrInfo);
 }
 
@@ -266,15 +234,14 @@ bool CForkAddressDB::Copy(CForkAddressDB& dbAddress)
 
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
         if (!WalkThrough(boost::bind(&CForkAddressDB::CopyWalker, this, _1, _2, boost::ref(dbAddress))))
         {
             return false;
         }
 
-        dbAddress.SetCache(dblCache);
+        dbAddress.cacheWrite.CopyFrom(view);
     }
     catch (exception& e)
     {
@@ -288,11 +255,10 @@ bool CForkAddressDB::WalkThroughAddress(CForkAddressDBWalker& walker)
 {
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        MapType& mapLower = dblCache.GetLowerMap();
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
 
         if (!WalkThrough(boost::bind(&CForkAddressDB::LoadWalker, this, _1, _2, boost::ref(walker),
                                      boost::ref(mapUpper), boost::ref(mapLower))))
@@ -300,7 +266,7 @@ bool CForkAddressDB::WalkThroughAddress(CForkAddressDBWalker& walker)
             return false;
         }
 
-        for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+        for (MapType::const_iterator it = mapLower.begin(); it != mapLower.end(); ++it)
         {
             const CDestination& dest = (*it).first;
             const CAddrInfo& addrInfo = (*it).second;
@@ -312,7 +278,7 @@ bool CForkAddressDB::WalkThroughAddress(CForkAddressDBWalker& walker)
                 }
             }
         }
-        for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+        for (MapType::const_iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
         {
             const CDestination& dest = (*it).first;
             const CAddrInfo& addrInfo = (*it).second;
@@ -361,100 +327,23 @@ bool CForkAddressDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
     return walker.Walk(dest, addrInfo);
 }
 
-bool CForkAddressDB::GetAddress(const CDestination& dest, CAddrInfo& addrInfo)
+bool CForkAddressDB::GetAddress(const CacheType::CWriteView& view, const CDestination& dest, CAddrInfo& addrInfo)
 {
+    if (view.Find(dest, addrInfo))
     {
-        MapType& mapUpper = dblCache.GetUpperMap();
-        typename MapType::iterator it = mapUpper.find(dest);
-        if (it != mapUpper.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                addrInfo = (*it).second;
-                return true;
-            }
-            return false;
-        }
-    }
-
-    {
-        MapType& mapLower = dblCache.GetLowerMap();
-        typename MapType::iterator it = mapLower.find(dest);
-        if (it != mapLower.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                addrInfo = (*it).second;
-                return true;
-            }
-            return false;
-        }
+        return !addrInfo.IsNull();
     }
-
     return Read(dest, addrInfo);
 }
 
-bool CForkAddressDB::Flush()
-{
-    xengine::CUpgradeLock ulock(rwLower);
-
-    vector<pair<CDestination, CAddrInfo>> vAddNew;
-    vector<CDestination> vRemove;
-
-    MapType& mapLower = dblCache.GetLowerMap();
-    for (typename MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
-    {
-        CAddrInfo& addrInfo = (*it).second;
-        if (!addrInfo.IsNull())
-        {
-            vAddNew.push_back(*it);
-        }
-        else
-        {
-            vRemove.push_back((*it).first);
-        }
-    }
-
-    if (!TxnBegin())
-    {
-        return false;
-    }
-
-    for (const auto& addr : vAddNew)
-    {
-        Write(addr.first, addr.second);
-    }
-
-    for (int i = 0; i < vRemove.size(); i++)
-    {
-        Erase(vRemove[i]);
-    }
-
-    if (!TxnCommit())
-    {
-        return false;
-    }
-
-    ulock.Upgrade();
-
-    {
-        xengine::CWriteLock wlock(rwUpper);
-        dblCache.Flip();
-    }
-
-    return true;
-}
-
 //////////////////////////////
 // CAddressDB
 
 CAddressDB::CAddressDB()
 {
-    pThreadFlush = nullptr;
-    fStopFlush = true;
 }
 
-bool CAddressDB::Initialize(const boost::filesystem::path& pathData, const bool fFlush)
+bool CAddressDB::Initialize(const boost::filesystem::path& pathData)
 {
     pathAddress = pathData / "address";
 
@@ -468,51 +357,21 @@ bool CAddressDB::Initialize(const boost::filesystem::path& pathData, const bool
         return false;
     }
 
-    if (fFlush)
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
     {
-        fStopFlush = false;
-        pThreadFlush = new boost::thread(boost::bind(&CAddressDB::FlushProc, this));
-        if (pThreadFlush == nullptr)
-        {
-            fStopFlush = true;
-            return false;
-        }
+        return false;
     }
+
     return true;
 }
 
 void CAddressDB::Deinitialize()
 {
-    if (pThreadFlush)
-    {
-        {
-            boost::unique_lock<boost::mutex> lock(mtxFlush);
-            fStopFlush = true;
-        }
-        condFlush.notify_all();
-        pThreadFlush->join();
-        delete pThreadFlush;
-        pThreadFlush = nullptr;
-
-        {
-            CWriteLock wlock(rwAccess);
-
-            for (map<uint256, std::shared_ptr<CForkAddressDB>>::iterator it = mapAddressDB.begin();
-                 it != mapAddressDB.end(); ++it)
-            {
-                std::shared_ptr<CForkAddressDB> spAddress = (*it).second;
-
-                spAddress->Flush();
-                spAddress->Flush();
-            }
-            mapAddressDB.clear();
-        }
-    }
-    else
     {
         CWriteLock wlock(rwAccess);
         mapAddressDB.clear();
     }
+    spShared.reset();
 }
 
 bool CAddressDB::AddNewFork(const uint256& hashFork)
@@ -525,7 +384,7 @@ bool CAddressDB::AddNewFork(const uint256& hashFork)
         return true;
     }
 
-    std::shared_ptr<CForkAddressDB> spAddress(new CForkAddressDB(pathAddress / hashFork.GetHex()));
+    std::shared_ptr<CForkAddressDB> spAddress(new CForkAddressDB(pathAddress / hashFork.GetHex(), spShared, hashFork));
     if (spAddress == nullptr || !spAddress->IsValid())
     {
         return false;
@@ -628,53 +487,14 @@ bool CAddressDB::WalkThrough(const uint256& hashFork, CForkAddressDBWalker& walk
     return false;
 }
 
-void CAddressDB::Flush(const uint256& hashFork)
+void CAddressDB::ListWriteBackDB(vector<std::shared_ptr<CWriteBackDB>>& vDB)
 {
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
     CReadLock rlock(rwAccess);
 
-    map<uint256, std::shared_ptr<CForkAddressDB>>::iterator it = mapAddressDB.find(hashFork);
-    if (it != mapAddressDB.end())
+    for (map<uint256, std::shared_ptr<CForkAddressDB>>::iterator it = mapAddressDB.begin();
+         it != mapAddressDB.end(); ++it)
     {
-        (*it).second->Flush();
-    }
-}
-
-void CAddressDB::FlushProc()
-{
-    SetThreadName("AddressDB");
-    boost::system_time timeout = boost::get_system_time();
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
-    while (!fStopFlush)
-    {
-        timeout += boost::posix_time::seconds(ADDRESS_FLUSH_INTERVAL);
-
-        while (!fStopFlush)
-        {
-            if (!condFlush.timed_wait(lock, timeout))
-            {
-                break;
-            }
-        }
-
-        if (!fStopFlush)
-        {
-            vector<std::shared_ptr<CForkAddressDB>> vAddressDB;
-            vAddressDB.reserve(mapAddressDB.size());
-            {
-                CReadLock rlock(rwAccess);
-
-                for (map<uint256, std::shared_ptr<CForkAddressDB>>::iterator it = mapAddressDB.begin();
-                     it != mapAddressDB.end(); ++it)
-                {
-                    vAddressDB.push_back((*it).second);
-                }
-            }
-            for (int i = 0; i < vAddressDB.size(); i++)
-            {
-                vAddressDB[i]->Flush();
-            }
-        }
+        vDB.push_back((*it).second);
     }
 }
 
@@ -5,9 +5,8 @@
 #ifndef STORAGE_ADDRESSDB_H
 #define STORAGE_ADDRESSDB_H
 
-#include <boost/thread/thread.hpp>
-
 #include "transaction.h"
+#include "writecache.h"
 #include "xengine.h"
 
 namespace bigbang
@@ -15,6 +14,8 @@ namespace bigbang
 namespace storage
 {
 
+class CLevelDBShared;
+
 //////////////////////////////
 // CAddrInfo
 
@@ -81,42 +82,10 @@ public:
 //////////////////////////////
 // CForkAddressDB
 
-class CForkAddressDB : public xengine::CKVDB
+class CForkAddressDB : public CForkWriteBackDB<CDestination, CAddrInfo>
 {
-    typedef std::map<CDestination, CAddrInfo> MapType;
-    class CDblMap
-    {
-    public:
-        CDblMap()
-          : nIdxUpper(0) {}
-        MapType& GetUpperMap()
-        {
-            return mapCache[nIdxUpper];
-        }
-        MapType& GetLowerMap()
-        {
-            return mapCache[nIdxUpper ^ 1];
-        }
-        void Flip()
-        {
-            MapType& mapLower = mapCache[nIdxUpper ^ 1];
-            mapLower.clear();
-            nIdxUpper = nIdxUpper ^ 1;
-        }
-        void Clear()
-        {
-            mapCache[0].clear();
-            mapCache[1].clear();
-            nIdxUpper = 0;
-        }
-
-    protected:
-        MapType mapCache[2];
-        int nIdxUpper;
-    };
-
 public:
-    CForkAddressDB(const boost::filesystem::path& pathDB);
+    CForkAddressDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork);
     ~CForkAddressDB();
     bool RemoveAll();
     bool UpdateAddress(const std::vector<std::pair<CDestination, CAddrInfo>>& vAddNew, const std::vector<CDestination>& vRemove);
@@ -124,31 +93,21 @@ public:
     bool WriteAddress(const CDestination& dest, const CAddrInfo& addrInfo);
     bool ReadAddress(const CDestination& dest, CAddrInfo& addrInfo);
     bool Copy(CForkAddressDB& dbAddress);
-    void SetCache(const CDblMap& dblCacheIn)
-    {
-        dblCache = dblCacheIn;
-    }
     bool WalkThroughAddress(CForkAddressDBWalker& walker);
-    bool Flush();
 
 protected:
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkAddressDB& dbAddress);
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkAddressDBWalker& walker, const MapType& mapUpper, const MapType& mapLower);
-    bool GetAddress(const CDestination& dest, CAddrInfo& addrInfo);
-
-protected:
-    xengine::CRWAccess rwUpper;
-    xengine::CRWAccess rwLower;
-    CDblMap dblCache;
+    bool GetAddress(const CacheType::CWriteView& view, const CDestination& dest, CAddrInfo& addrInfo);
 };
 
-class CAddressDB
+class CAddressDB : public CWriteBackTable
 {
 public:
     CAddressDB();
-    bool Initialize(const boost::filesystem::path& pathData, const bool fFlush = true);
+    bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool Exists(const uint256& hashFork)
     {
@@ -163,20 +122,13 @@ public:
     bool Retrieve(const uint256& hashFork, const CDestination& dest, CAddrInfo& addrInfo);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkAddressDBWalker& walker);
-    void Flush(const uint256& hashFork);
-
-protected:
-    void FlushProc();
+    void ListWriteBackDB(std::vector<std::shared_ptr<CWriteBackDB>>& vDB) override;
 
 protected:
     boost::filesystem::path pathAddress;
+    std::shared_ptr<CLevelDBShared> spShared;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkAddressDB>> mapAddressDB;
-
-    boost::mutex mtxFlush;
-    boost::condition_variable condFlush;
-    boost::thread* pThreadFlush;
-    bool fStopFlush;
 };
 
 } // namespace storage
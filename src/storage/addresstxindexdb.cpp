@@ -11,13 +11,13 @@
 using namespace std;
 using namespace xengine;
 
+#define ADDRESS_TX_COUNT_CACHE_SIZE 10000
+
 namespace bigbang
 {
 namespace storage
 {
 
-#define ADDRESS_TXINDEX_FLUSH_INTERVAL (600)
-
 //////////////////////////////
 // CGetAddressTxIndexWalker
 
@@ -65,15 +65,39 @@ bool CGetAddressTxIndexWalker::Walk(const CAddrTxIndex& key, const CAddrTxInfo&
     return true;
 }
 
+//////////////////////////////
+// CListAddressTxHeightWalker
+
+bool CListAddressTxHeightWalker::Walk(const CAddrTxIndex& key, const CAddrTxInfo& value)
+{
+    if (key.GetHeight() >= nStartHeight)
+    {
+        setHeight.insert(key.GetHeight());
+    }
+    return true;
+}
+
+//////////////////////////////
+// CPageAddressTxIndexWalker
+
+bool CPageAddressTxIndexWalker::Walk(const CAddrTxIndex& key, const CAddrTxInfo& value)
+{
+    nWalkCount++;
+    if (nCount > 0)
+    {
+        vTxIndex.push_back(make_pair(key, value));
+        return (vTxIndex.size() < nCount);
+    }
+    return true;
+}
+
 //////////////////////////////
 // CForkAddressTxIndexDB
 
-CForkAddressTxIndexDB::CForkAddressTxIndexDB(const boost::filesystem::path& pathDB)
+CForkAddressTxIndexDB::CForkAddressTxIndexDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork)
+  : cacheTxCount(ADDRESS_TX_COUNT_CACHE_SIZE)
 {
-    CLevelDBArguments args;
-    args.path = pathDB.string();
-    args.syncwrite = false;
-    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    CKVDBEngine* engine = CLevelDBShared::NewForkEngine(pathDB, spShared, CLevelDBShared::TABLE_ADDRESSTXINDEX, hashFork);
 
     if (!CKVDB::Open(engine))
     {
@@ -84,7 +108,7 @@ CForkAddressTxIndexDB::CForkAddressTxIndexDB(const boost::filesystem::path& path
 CForkAddressTxIndexDB::~CForkAddressTxIndexDB()
 {
     Close();
-    dblCache.Clear();
+    cacheWrite.Clear();
 }
 
 bool CForkAddressTxIndexDB::RemoveAll()
@@ -93,26 +117,49 @@ bool CForkAddressTxIndexDB::RemoveAll()
     {
         return false;
     }
-    dblCache.Clear();
+    cacheWrite.Clear();
+    cacheTxCount.Clear();
     return true;
 }
 
 bool CForkAddressTxIndexDB::UpdateAddressTxIndex(const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew, const vector<CAddrTxIndex>& vRemove)
 {
-    xengine::CWriteLock wlock(rwUpper);
+    CacheType::CWriteView view(cacheWrite);
 
-    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapUpper = view.mapUpper;
 
+    // keep cached tx counts in step, a key missing from the upper cache is new when
+    // added and present when removed
+    map<CDestination, int64> mapDelta;
     for (const auto& vd : vAddNew)
     {
+        MapType::iterator it = mapUpper.find(vd.first);
+        if (it == mapUpper.end() || it->second.IsNull())
+        {
+            mapDelta[vd.first.dest]++;
+        }
         mapUpper[vd.first] = vd.second;
     }
 
     for (const auto& vd : vRemove)
     {
+        MapType::iterator it = mapUpper.find(vd);
+        if (it == mapUpper.end() || !it->second.IsNull())
+        {
+            mapDelta[vd.dest]--;
+        }
         mapUpper[vd].SetNull();
     }
 
+    for (const auto& vd : mapDelta)
+    {
+        int64 nTxCount = 0;
+        if (cacheTxCount.Retrieve(vd.first, nTxCount))
+        {
+            cacheTxCount.AddNew(vd.first, nTxCount + vd.second);
+        }
+    }
+
     return true;
 }
 
@@ -137,6 +184,7 @@ bool CForkAddressTxIndexDB::RepairAddressTxIndex(const vector<pair<CAddrTxIndex,
     {
         return false;
     }
+    cacheTxCount.Clear();
     return true;
 }
 
@@ -147,83 +195,177 @@ bool CForkAddressTxIndexDB::WriteAddressTxIndex(const CAddrTxIndex& key, const C
 
 bool CForkAddressTxIndexDB::ReadAddressTxIndex(const CAddrTxIndex& key, CAddrTxInfo& value)
 {
+    if (cacheWrite.Find(key, value))
     {
-        xengine::CReadLock rlock(rwUpper);
+        return !value.IsNull();
+    }
+    return Read(CAddrTxIndex(key.dest, BSwap64(key.nHeightSeq), key.txid), value);
+}
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        typename MapType::iterator it = mapUpper.find(key);
-        if (it != mapUpper.end())
+int64 CForkAddressTxIndexDB::RetrieveAddressTxIndex(const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
+{
+    if ((nPrevHeight < -1 || nPrevTxSeq == -1) && nOffset == -1)
+    {
+        // last count tx, walked back from the end of dest
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vTxIndex;
+        if (!ListAddressTxIndex(dest, -1, true, (nCount > 0 ? nCount : 0), vTxIndex))
         {
-            if (!it->second.IsNull())
-            {
-                value = it->second;
-                return true;
-            }
-            return false;
+            return -1;
         }
+        mapAddrTxIndex.insert(vTxIndex.begin(), vTxIndex.end());
+        return vTxIndex.size();
     }
+    CGetAddressTxIndexWalker walker(nPrevHeight, nPrevTxSeq, nOffset, nCount, mapAddrTxIndex);
+    WalkThroughAddressTxIndex(walker, dest, nPrevHeight, nPrevTxSeq);
+    return walker.nCurPos;
+}
+
+bool CForkAddressTxIndexDB::RetrieveTxIndex(const CAddrTxIndex& addrTxIndex, CAddrTxInfo& addrTxInfo)
+{
+    return Read(CAddrTxIndex(addrTxIndex.dest, BSwap64(addrTxIndex.nHeightSeq), addrTxIndex.txid), addrTxInfo);
+}
 
+bool CForkAddressTxIndexDB::ListAddressTxIndex(const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                               vector<pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex)
+{
+    vTxIndex.clear();
+    if (dest.IsNull())
+    {
+        return false;
+    }
+
+    try
     {
-        xengine::CReadLock rlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
-        MapType& mapLower = dblCache.GetLowerMap();
-        typename MapType::iterator it = mapLower.find(key);
-        if (it != mapLower.end())
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
+
+        // the page holds keys after the cursor in walk order, a negative cursor starts at the end
+        int64 nBegin = 0;
+        int64 nEnd = numeric_limits<int64>::max();
+        if (nHeightSeqCursor >= 0 && fReverse)
+        {
+            nEnd = nHeightSeqCursor;
+        }
+        else if (nHeightSeqCursor >= 0)
+        {
+            nBegin = nHeightSeqCursor + 1;
+        }
+
+        // seek by key, cached keys are skipped by LoadWalker
+        CPageAddressTxIndexWalker walker(nCount);
+        bool fRet = false;
+        if (fReverse)
+        {
+            fRet = WalkThroughOfPrefixReverse(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                                          boost::ref(mapUpper), boost::ref(mapLower)),
+                                              make_pair(dest, BSwap64(nEnd)), dest);
+        }
+        else
+        {
+            fRet = WalkThroughOfPrefix(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                                   boost::ref(mapUpper), boost::ref(mapLower)),
+                                       make_pair(dest, BSwap64(nBegin)), dest);
+        }
+        if (!fRet)
+        {
+            return false;
+        }
+
+        // merge cached changes of dest in the cursor range
+        MapType mapPage(walker.vTxIndex.begin(), walker.vTxIndex.end());
+        const CAddrTxIndex keyBegin(dest, nBegin, uint256());
+        for (MapType::const_iterator it = mapLower.lower_bound(keyBegin); it != mapLower.end() && it->first.dest == dest && it->first.nHeightSeq < nEnd; ++it)
+        {
+            if (!mapUpper.count(it->first) && !it->second.IsNull())
+            {
+                mapPage.insert(*it);
+            }
+        }
+        for (MapType::const_iterator it = mapUpper.lower_bound(keyBegin); it != mapUpper.end() && it->first.dest == dest && it->first.nHeightSeq < nEnd; ++it)
         {
             if (!it->second.IsNull())
             {
-                value = it->second;
-                return true;
+                mapPage.insert(*it);
             }
-            return false;
         }
-    }
 
-    return Read(CAddrTxIndex(key.dest, BSwap64(key.nHeightSeq), key.txid), value);
+        vTxIndex.reserve((nCount != 0 && nCount < mapPage.size()) ? nCount : mapPage.size());
+        if (fReverse)
+        {
+            for (MapType::reverse_iterator it = mapPage.rbegin(); it != mapPage.rend() && (nCount == 0 || vTxIndex.size() < nCount); ++it)
+            {
+                vTxIndex.push_back(*it);
+            }
+        }
+        else
+        {
+            for (MapType::iterator it = mapPage.begin(); it != mapPage.end() && (nCount == 0 || vTxIndex.size() < nCount); ++it)
+            {
+                vTxIndex.push_back(*it);
+            }
+        }
+    }
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
 }
 
-int64 CForkAddressTxIndexDB::RetrieveAddressTxIndex(const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
+bool CForkAddressTxIndexDB::GetAddressTxCount(const CDestination& dest, int64& nTxCount)
 {
-    if ((nPrevHeight < -1 || nPrevTxSeq == -1) && nOffset == -1)
+    if (dest.IsNull())
     {
-        // last count tx
-        if (dest.IsNull())
+        return false;
+    }
+
+    try
+    {
+        CacheType::CReadView view(cacheWrite);
+
+        if (cacheTxCount.Retrieve(dest, nTxCount))
         {
-            return -1;
+            return true;
         }
-        CGetAddressTxIndexWalker walker(-2, -1, -1, nCount, mapAddrTxIndex);
-        WalkThroughAddressTxIndex(walker, dest, -2, -1);
-        if (!walker.vCacheAddrTxInfo.empty())
+
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
+
+        CPageAddressTxIndexWalker walker(0);
+        if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                     boost::ref(mapUpper), boost::ref(mapLower)),
+                         dest, true))
         {
-            int64 nSetOffset;
-            if (nCount >= 0)
-            {
-                nSetOffset = walker.vCacheAddrTxInfo.size() - nCount;
-                if (nSetOffset < 0)
-                {
-                    nSetOffset = 0;
-                }
-            }
-            else
+            return false;
+        }
+
+        nTxCount = walker.nWalkCount;
+        const CAddrTxIndex keyFirst(dest, 0, uint256());
+        for (MapType::const_iterator it = mapLower.lower_bound(keyFirst); it != mapLower.end() && it->first.dest == dest; ++it)
+        {
+            if (!mapUpper.count(it->first) && !it->second.IsNull())
             {
-                nSetOffset = 0;
+                nTxCount++;
             }
-            auto it = walker.vCacheAddrTxInfo.begin() + nSetOffset;
-            for (; it != walker.vCacheAddrTxInfo.end(); ++it)
+        }
+        for (MapType::const_iterator it = mapUpper.lower_bound(keyFirst); it != mapUpper.end() && it->first.dest == dest; ++it)
+        {
+            if (!it->second.IsNull())
             {
-                mapAddrTxIndex.insert(make_pair(it->first, it->second));
+                nTxCount++;
             }
         }
-        return walker.vCacheAddrTxInfo.size();
+        cacheTxCount.AddNew(dest, nTxCount);
     }
-    CGetAddressTxIndexWalker walker(nPrevHeight, nPrevTxSeq, nOffset, nCount, mapAddrTxIndex);
-    WalkThroughAddressTxIndex(walker, dest, nPrevHeight, nPrevTxSeq);
-    return walker.nCurPos;
-}
-
-bool CForkAddressTxIndexDB::RetrieveTxIndex(const CAddrTxIndex& addrTxIndex, CAddrTxInfo& addrTxInfo)
-{
-    return Read(CAddrTxIndex(addrTxIndex.dest, BSwap64(addrTxIndex.nHeightSeq), addrTxIndex.txid), addrTxInfo);
+    catch (exception& e)
+    {
+        StdError(__PRETTY_FUNCTION__, e.what());
+        return false;
+    }
+    return true;
 }
 
 bool CForkAddressTxIndexDB::Copy(CForkAddressTxIndexDB& dbAddressTxIndex)
@@ -235,15 +377,14 @@ bool CForkAddressTxIndexDB::Copy(CForkAddressTxIndexDB& dbAddressTxIndex)
 
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
         if (!WalkThrough(boost::bind(&CForkAddressTxIndexDB::CopyWalker, this, _1, _2, boost::ref(dbAddressTxIndex))))
         {
             return false;
         }
 
-        dbAddressTxIndex.SetCache(dblCache);
+        dbAddressTxIndex.cacheWrite.CopyFrom(view);
     }
     catch (exception& e)
     {
@@ -257,11 +398,10 @@ bool CForkAddressTxIndexDB::WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalke
 {
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        MapType& mapLower = dblCache.GetLowerMap();
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
 
         if (dest.IsNull())
         {
@@ -294,7 +434,7 @@ bool CForkAddressTxIndexDB::WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalke
             }
         }
 
-        for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+        for (MapType::const_iterator it = mapLower.begin(); it != mapLower.end(); ++it)
         {
             const CAddrTxIndex& key = (*it).first;
             const CAddrTxInfo& value = (*it).second;
@@ -306,7 +446,7 @@ bool CForkAddressTxIndexDB::WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalke
                 }
             }
         }
-        for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+        for (MapType::const_iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
         {
             const CAddrTxIndex& key = (*it).first;
             const CAddrTxInfo& value = (*it).second;
@@ -346,6 +486,7 @@ bool CForkAddressTxIndexDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
     CAddrTxIndex key;
     CAddrTxInfo value;
     ssKey >> key;
+    key.nHeightSeq = BSwap64(key.nHeightSeq);
 
     if (mapUpper.count(key) || mapLower.count(key))
     {
@@ -353,59 +494,13 @@ bool CForkAddressTxIndexDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
     }
 
     ssValue >> value;
-    key.nHeightSeq = BSwap64(key.nHeightSeq);
 
     return walker.Walk(key, value);
 }
 
-bool CForkAddressTxIndexDB::Flush()
+CAddrTxIndex CForkAddressTxIndexDB::GetDBKey(const CAddrTxIndex& key) const
 {
-    xengine::CUpgradeLock ulock(rwLower);
-
-    vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
-    vector<CAddrTxIndex> vRemove;
-
-    MapType& mapLower = dblCache.GetLowerMap();
-    for (typename MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
-    {
-        if (it->second.IsNull())
-        {
-            vRemove.push_back(CAddrTxIndex(it->first.dest, BSwap64(it->first.nHeightSeq), it->first.txid));
-        }
-        else
-        {
-            vAddNew.push_back(make_pair(CAddrTxIndex(it->first.dest, BSwap64(it->first.nHeightSeq), it->first.txid), it->second));
-        }
-    }
-
-    if (!TxnBegin())
-    {
-        return false;
-    }
-
-    for (const auto& addr : vAddNew)
-    {
-        Write(addr.first, addr.second);
-    }
-
-    for (int i = 0; i < vRemove.size(); i++)
-    {
-        Erase(vRemove[i]);
-    }
-
-    if (!TxnCommit())
-    {
-        return false;
-    }
-
-    ulock.Upgrade();
-
-    {
-        xengine::CWriteLock wlock(rwUpper);
-        dblCache.Flip();
-    }
-
-    return true;
+    return CAddrTxIndex(key.dest, BSwap64(key.nHeightSeq), key.txid);
 }
 
 //////////////////////////////
@@ -413,11 +508,9 @@ bool CForkAddressTxIndexDB::Flush()
 
 CAddressTxIndexDB::CAddressTxIndexDB()
 {
-    pThreadFlush = nullptr;
-    fStopFlush = true;
 }
 
-bool CAddressTxIndexDB::Initialize(const boost::filesystem::path& pathData, const bool fFlush)
+bool CAddressTxIndexDB::Initialize(const boost::filesystem::path& pathData)
 {
     pathAddress = pathData / "addresstxindex";
 
@@ -431,51 +524,21 @@ bool CAddressTxIndexDB::Initialize(const boost::filesystem::path& pathData, cons
         return false;
     }
 
-    if (fFlush)
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
     {
-        fStopFlush = false;
-        pThreadFlush = new boost::thread(boost::bind(&CAddressTxIndexDB::FlushProc, this));
-        if (pThreadFlush == nullptr)
-        {
-            fStopFlush = true;
-            return false;
-        }
+        return false;
     }
+
     return true;
 }
 
 void CAddressTxIndexDB::Deinitialize()
 {
-    if (pThreadFlush)
-    {
-        {
-            boost::unique_lock<boost::mutex> lock(mtxFlush);
-            fStopFlush = true;
-        }
-        condFlush.notify_all();
-        pThreadFlush->join();
-        delete pThreadFlush;
-        pThreadFlush = nullptr;
-
-        {
-            CWriteLock wlock(rwAccess);
-
-            for (map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.begin();
-                 it != mapAddressDB.end(); ++it)
-            {
-                std::shared_ptr<CForkAddressTxIndexDB> spAddress = (*it).second;
-
-                spAddress->Flush();
-                spAddress->Flush();
-            }
-            mapAddressDB.clear();
-        }
-    }
-    else
     {
         CWriteLock wlock(rwAccess);
         mapAddressDB.clear();
     }
+    spShared.reset();
 }
 
 bool CAddressTxIndexDB::AddNewFork(const uint256& hashFork)
@@ -488,7 +551,7 @@ bool CAddressTxIndexDB::AddNewFork(const uint256& hashFork)
         return true;
     }
 
-    std::shared_ptr<CForkAddressTxIndexDB> spAddress(new CForkAddressTxIndexDB(pathAddress / hashFork.GetHex()));
+    std::shared_ptr<CForkAddressTxIndexDB> spAddress(new CForkAddressTxIndexDB(pathAddress / hashFork.GetHex(), spShared, hashFork));
     if (spAddress == nullptr || !spAddress->IsValid())
     {
         return false;
@@ -606,53 +669,55 @@ bool CAddressTxIndexDB::WalkThrough(const uint256& hashFork, CForkAddressTxIndex
     return false;
 }
 
-void CAddressTxIndexDB::Flush(const uint256& hashFork)
+bool CAddressTxIndexDB::ListTxHeight(const uint256& hashFork, const CDestination& dest, const int nStartHeight, set<int>& setHeight)
 {
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
     CReadLock rlock(rwAccess);
 
     map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.find(hashFork);
-    if (it != mapAddressDB.end())
+    if (it == mapAddressDB.end())
     {
-        (*it).second->Flush();
+        return false;
     }
+    // seek to the first entry of dest at nStartHeight
+    CListAddressTxHeightWalker walker(nStartHeight, setHeight);
+    return (*it).second->WalkThroughAddressTxIndex(walker, dest, nStartHeight, 0);
 }
 
-void CAddressTxIndexDB::FlushProc()
+bool CAddressTxIndexDB::ListAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                           vector<pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex)
 {
-    SetThreadName("AddressTxIndexDB");
-    boost::system_time timeout = boost::get_system_time();
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
-    while (!fStopFlush)
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
     {
-        timeout += boost::posix_time::seconds(ADDRESS_TXINDEX_FLUSH_INTERVAL);
+        StdLog("CAddressTxIndexDB", "ListAddressTxIndex: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->ListAddressTxIndex(dest, nHeightSeqCursor, fReverse, nCount, vTxIndex);
+}
 
-        while (!fStopFlush)
-        {
-            if (!condFlush.timed_wait(lock, timeout))
-            {
-                break;
-            }
-        }
+bool CAddressTxIndexDB::GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount)
+{
+    CReadLock rlock(rwAccess);
 
-        if (!fStopFlush)
-        {
-            vector<std::shared_ptr<CForkAddressTxIndexDB>> vAddressDB;
-            vAddressDB.reserve(mapAddressDB.size());
-            {
-                CReadLock rlock(rwAccess);
+    map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressTxIndexDB", "GetAddressTxCount: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->GetAddressTxCount(dest, nTxCount);
+}
 
-                for (map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.begin();
-                     it != mapAddressDB.end(); ++it)
-                {
-                    vAddressDB.push_back((*it).second);
-                }
-            }
-            for (int i = 0; i < vAddressDB.size(); i++)
-            {
-                vAddressDB[i]->Flush();
-            }
-        }
+void CAddressTxIndexDB::ListWriteBackDB(vector<std::shared_ptr<CWriteBackDB>>& vDB)
+{
+    CReadLock rlock(rwAccess);
+
+    for (map<uint256, std::shared_ptr<CForkAddressTxIndexDB>>::iterator it = mapAddressDB.begin();
+         it != mapAddressDB.end(); ++it)
+    {
+        vDB.push_back((*it).second);
     }
 }
 
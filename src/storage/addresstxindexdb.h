@@ -5,9 +5,8 @@
 #ifndef STORAGE_ADDRESSTXINDEXDB_H
 #define STORAGE_ADDRESSTXINDEXDB_H
 
-#include <boost/thread/thread.hpp>
-
 #include "transaction.h"
+#include "writecache.h"
 #include "xengine.h"
 
 namespace bigbang
@@ -15,6 +14,8 @@ namespace bigbang
 namespace storage
 {
 
+class CLevelDBShared;
+
 //////////////////////////////
 // CForkAddressTxIndexDBWalker
 
@@ -45,44 +46,43 @@ public:
 };
 
 //////////////////////////////
-// CForkAddressTxIndexDB
+// CListAddressTxHeightWalker
 
-class CForkAddressTxIndexDB : public xengine::CKVDB
+class CListAddressTxHeightWalker : public CForkAddressTxIndexDBWalker
 {
-    typedef std::map<CAddrTxIndex, CAddrTxInfo> MapType;
-    class CDblMap
-    {
-    public:
-        CDblMap()
-          : nIdxUpper(0) {}
-        MapType& GetUpperMap()
-        {
-            return mapCache[nIdxUpper];
-        }
-        MapType& GetLowerMap()
-        {
-            return mapCache[nIdxUpper ^ 1];
-        }
-        void Flip()
-        {
-            MapType& mapLower = mapCache[nIdxUpper ^ 1];
-            mapLower.clear();
-            nIdxUpper = nIdxUpper ^ 1;
-        }
-        void Clear()
-        {
-            mapCache[0].clear();
-            mapCache[1].clear();
-            nIdxUpper = 0;
-        }
-
-    protected:
-        MapType mapCache[2];
-        int nIdxUpper;
-    };
+public:
+    CListAddressTxHeightWalker(const int nStartHeightIn, std::set<int>& setHeightIn)
+      : nStartHeight(nStartHeightIn), setHeight(setHeightIn) {}
+    bool Walk(const CAddrTxIndex& key, const CAddrTxInfo& value) override;
+
+public:
+    int nStartHeight;
+    std::set<int>& setHeight;
+};
+
+//////////////////////////////
+// CPageAddressTxIndexWalker
+
+class CPageAddressTxIndexWalker : public CForkAddressTxIndexDBWalker
+{
+public:
+    CPageAddressTxIndexWalker(const std::size_t nCountIn)
+      : nCount(nCountIn), nWalkCount(0) {}
+    bool Walk(const CAddrTxIndex& key, const CAddrTxInfo& value) override;
+
+public:
+    std::size_t nCount;
+    std::size_t nWalkCount;
+    std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>> vTxIndex;
+};
+
+//////////////////////////////
+// CForkAddressTxIndexDB
 
+class CForkAddressTxIndexDB : public CForkWriteBackDB<CAddrTxIndex, CAddrTxInfo>
+{
 public:
-    CForkAddressTxIndexDB(const boost::filesystem::path& pathDB);
+    CForkAddressTxIndexDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork);
     ~CForkAddressTxIndexDB();
     bool RemoveAll();
     bool UpdateAddressTxIndex(const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddNew, const std::vector<CAddrTxIndex>& vRemove);
@@ -91,13 +91,11 @@ public:
     bool ReadAddressTxIndex(const CAddrTxIndex& key, CAddrTxInfo& value);
     int64 RetrieveAddressTxIndex(const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex);
     bool RetrieveTxIndex(const CAddrTxIndex& addrTxIndex, CAddrTxInfo& addrTxInfo);
+    bool ListAddressTxIndex(const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                            std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex);
+    bool GetAddressTxCount(const CDestination& dest, int64& nTxCount);
     bool Copy(CForkAddressTxIndexDB& dbAddressTxIndex);
-    void SetCache(const CDblMap& dblCacheIn)
-    {
-        dblCache = dblCacheIn;
-    }
     bool WalkThroughAddressTxIndex(CForkAddressTxIndexDBWalker& walker, const CDestination& dest = CDestination(), const int nPrevHeight = -2, const uint64 nPrevTxSeq = -1);
-    bool Flush();
 
 protected:
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
@@ -105,17 +103,18 @@ protected:
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkAddressTxIndexDBWalker& walker, const MapType& mapUpper, const MapType& mapLower);
 
+    // height sequence is stored big endian to keep a destination's keys in chain order
+    CAddrTxIndex GetDBKey(const CAddrTxIndex& key) const override;
+
 protected:
-    xengine::CRWAccess rwUpper;
-    xengine::CRWAccess rwLower;
-    CDblMap dblCache;
+    xengine::CCache<CDestination, int64> cacheTxCount;
 };
 
-class CAddressTxIndexDB
+class CAddressTxIndexDB : public CWriteBackTable
 {
 public:
     CAddressTxIndexDB();
-    bool Initialize(const boost::filesystem::path& pathData, const bool fFlush = true);
+    bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool Exists(const uint256& hashFork)
     {
@@ -130,20 +129,17 @@ public:
     bool RetrieveTxIndex(const uint256& hashFork, const CAddrTxIndex& addrTxIndex, CAddrTxInfo& addrTxInfo);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkAddressTxIndexDBWalker& walker);
-    void Flush(const uint256& hashFork);
-
-protected:
-    void FlushProc();
+    bool ListTxHeight(const uint256& hashFork, const CDestination& dest, const int nStartHeight, std::set<int>& setHeight);
+    bool ListAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                            std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex);
+    bool GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount);
+    void ListWriteBackDB(std::vector<std::shared_ptr<CWriteBackDB>>& vDB) override;
 
 protected:
     boost::filesystem::path pathAddress;
+    std::shared_ptr<CLevelDBShared> spShared;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkAddressTxIndexDB>> mapAddressDB;
-
-    boost::mutex mtxFlush;
-    boost::condition_variable condFlush;
-    boost::thread* pThreadFlush;
-    bool fStopFlush;
 };
 
 } // namespace storage
@@ -16,17 +16,20 @@ namespace bigbang
 namespace storage
 {
 
-#define ADDRESS_UNSPENT_FLUSH_INTERVAL (600)
+static string GetAddrUnspentKeyBytes(const CAddrUnspentKey& key)
+{
+    CBufStream ss;
+    ss << key;
+    return string(ss.GetData(), ss.GetSize());
+}
 
 //////////////////////////////
 // CForkAddressUnspentDB
 
-CForkAddressUnspentDB::CForkAddressUnspentDB(const boost::filesystem::path& pathDB, const uint256& hashLastBlockIn)
+CForkAddressUnspentDB::CForkAddressUnspentDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared,
+                                             const uint256& hashFork, const uint256& hashLastBlockIn)
 {
-    CLevelDBArguments args;
-    args.path = pathDB.string();
-    args.syncwrite = false;
-    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    CKVDBEngine* engine = CLevelDBShared::NewForkEngine(pathDB, spShared, CLevelDBShared::TABLE_ADDRESSUNSPENT, hashFork);
 
     if (!CKVDB::Open(engine))
     {
@@ -38,7 +41,7 @@ CForkAddressUnspentDB::CForkAddressUnspentDB(const boost::filesystem::path& path
 CForkAddressUnspentDB::~CForkAddressUnspentDB()
 {
     Close();
-    dblCache.Clear();
+    cacheWrite.Clear();
 }
 
 bool CForkAddressUnspentDB::RemoveAll()
@@ -47,15 +50,15 @@ bool CForkAddressUnspentDB::RemoveAll()
     {
         return false;
     }
-    dblCache.Clear();
+    cacheWrite.Clear();
     return true;
 }
 
 bool CForkAddressUnspentDB::UpdateAddressUnspent(const uint256& hashLastBlockIn, const vector<CTxUnspent>& vAddNew, const vector<CTxUnspent>& vRemove)
 {
-    xengine::CWriteLock wlock(rwUpper);
+    CacheType::CWriteView view(cacheWrite);
 
-    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapUpper = view.mapUpper;
 
     for (const auto& vd : vAddNew)
     {
@@ -102,49 +105,108 @@ bool CForkAddressUnspentDB::WriteAddressUnspent(const CAddrUnspentKey& out, cons
 
 bool CForkAddressUnspentDB::ReadAddressUnspent(const CAddrUnspentKey& out, CUnspentOut& unspent)
 {
+    if (cacheWrite.Find(out, unspent))
     {
-        xengine::CReadLock rlock(rwUpper);
+        return !unspent.IsNull();
+    }
+    return Read(out, unspent);
+}
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        typename MapType::iterator it = mapUpper.find(out);
-        if (it != mapUpper.end())
+bool CForkAddressUnspentDB::RetrieveAddressUnspent(const CDestination& dest, map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut)
+{
+    if (dest.IsNull())
+    {
+        return false;
+    }
+    CGetSingleAddressUnspentWalker walker(mapUnspent);
+    return WalkThroughAddressUnspent(walker, dest, hashLastBlockOut);
+}
+
+bool CForkAddressUnspentDB::ListAddressUnspent(const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax,
+                                               vector<pair<CAddrUnspentKey, CUnspentOut>>& vUnspent)
+{
+    vUnspent.clear();
+    if (dest.IsNull())
+    {
+        return false;
+    }
+
+    try
+    {
+        CacheType::CReadView view(cacheWrite);
+
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
+
+        // Seek to the cursor inside the destination prefix, cached keys are skipped by LoadWalker
+        const CAddrUnspentKey keyBegin(dest, outBegin);
+        CPageAddressUnspentWalker walker(outBegin, nMax);
+        bool fRet = false;
+        if (outBegin.IsNull())
+        {
+            fRet = WalkThrough(boost::bind(&CForkAddressUnspentDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                           boost::ref(mapUpper), boost::ref(mapLower)),
+                               dest, true);
+        }
+        else
+        {
+            fRet = WalkThroughOfPrefix(boost::bind(&CForkAddressUnspentDB::LoadWalker, this, _1, _2, boost::ref(walker),
+                                                   boost::ref(mapUpper), boost::ref(mapLower)),
+                                       keyBegin, dest);
+        }
+        if (!fRet)
         {
-            if (!it->second.IsNull())
-            {
-                unspent = it->second;
-                return true;
-            }
             return false;
         }
-    }
 
-    {
-        xengine::CReadLock rlock(rwLower);
+        // Merge cached changes in the same byte order as the db keys
+        map<string, pair<CAddrUnspentKey, CUnspentOut>> mapPage;
+        for (const auto& vd : walker.vUnspent)
+        {
+            mapPage.insert(make_pair(GetAddrUnspentKeyBytes(vd.first), vd));
+        }
 
-        MapType& mapLower = dblCache.GetLowerMap();
-        typename MapType::iterator it = mapLower.find(out);
-        if (it != mapLower.end())
+        const string strBegin = (outBegin.IsNull() ? string() : GetAddrUnspentKeyBytes(keyBegin));
+        const CAddrUnspentKey keyFirst(dest, CTxOutPoint(uint256(), 0));
+        for (MapType::const_iterator it = mapLower.lower_bound(keyFirst); it != mapLower.end() && it->first.dest == dest; ++it)
+        {
+            if (!mapUpper.count(it->first) && !it->second.IsNull())
+            {
+                string strKey = GetAddrUnspentKeyBytes(it->first);
+                if (strKey > strBegin)
+                {
+                    mapPage.insert(make_pair(strKey, *it));
+                }
+            }
+        }
+        for (MapType::const_iterator it = mapUpper.lower_bound(keyFirst); it != mapUpper.end() && it->first.dest == dest; ++it)
         {
             if (!it->second.IsNull())
             {
-                unspent = it->second;
-                return true;
+                string strKey = GetAddrUnspentKeyBytes(it->first);
+                if (strKey > strBegin)
+                {
+                    mapPage.insert(make_pair(strKey, *it));
+                }
             }
-            return false;
         }
-    }
 
-    return Read(out, unspent);
-}
-
-bool CForkAddressUnspentDB::RetrieveAddressUnspent(const CDestination& dest, map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut)
-{
-    if (dest.IsNull())
+        vUnspent.reserve((nMax != 0 && nMax < mapPage.size()) ? nMax : mapPage.size());
+        for (const auto& vd : mapPage)
+        {
+            if (nMax != 0 && vUnspent.size() >= nMax)
+            {
+                break;
+            }
+            vUnspent.push_back(vd.second);
+        }
+    }
+    catch (exception& e)
     {
+        StdError(__PRETTY_FUNCTION__, e.what());
         return false;
     }
-    CGetSingleAddressUnspentWalker walker(mapUnspent);
-    return WalkThroughAddressUnspent(walker, dest, hashLastBlockOut);
+    return true;
 }
 
 bool CForkAddressUnspentDB::Copy(CForkAddressUnspentDB& dbAddressUnspent)
@@ -156,15 +218,14 @@ bool CForkAddressUnspentDB::Copy(CForkAddressUnspentDB& dbAddressUnspent)
 
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
         if (!WalkThrough(boost::bind(&CForkAddressUnspentDB::CopyWalker, this, _1, _2, boost::ref(dbAddressUnspent))))
         {
             return false;
         }
 
-        dbAddressUnspent.SetCache(dblCache);
+        dbAddressUnspent.cacheWrite.CopyFrom(view);
     }
     catch (exception& e)
     {
@@ -178,11 +239,10 @@ bool CForkAddressUnspentDB::WalkThroughAddressUnspent(CForkAddressUnspentDBWalke
 {
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        MapType& mapLower = dblCache.GetLowerMap();
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
 
         if (dest.IsNull())
         {
@@ -202,7 +262,7 @@ bool CForkAddressUnspentDB::WalkThroughAddressUnspent(CForkAddressUnspentDBWalke
             }
         }
 
-        for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+        for (MapType::const_iterator it = mapLower.begin(); it != mapLower.end(); ++it)
         {
             const CAddrUnspentKey& out = (*it).first;
             const CUnspentOut& unspent = (*it).second;
@@ -214,7 +274,7 @@ bool CForkAddressUnspentDB::WalkThroughAddressUnspent(CForkAddressUnspentDBWalke
                 }
             }
         }
-        for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+        for (MapType::const_iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
         {
             const CAddrUnspentKey& out = (*it).first;
             const CUnspentOut& unspent = (*it).second;
@@ -264,66 +324,14 @@ bool CForkAddressUnspentDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
     return walker.Walk(out, unspent);
 }
 
-bool CForkAddressUnspentDB::Flush()
-{
-    xengine::CUpgradeLock ulock(rwLower);
-
-    vector<pair<CAddrUnspentKey, CUnspentOut>> vAddNew;
-    vector<CAddrUnspentKey> vRemove;
-
-    MapType& mapLower = dblCache.GetLowerMap();
-    for (typename MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
-    {
-        if (it->second.IsNull())
-        {
-            vRemove.push_back(it->first);
-        }
-        else
-        {
-            vAddNew.push_back(*it);
-        }
-    }
-
-    if (!TxnBegin())
-    {
-        return false;
-    }
-
-    for (const auto& addr : vAddNew)
-    {
-        Write(addr.first, addr.second);
-    }
-
-    for (int i = 0; i < vRemove.size(); i++)
-    {
-        Erase(vRemove[i]);
-    }
-
-    if (!TxnCommit())
-    {
-        return false;
-    }
-
-    ulock.Upgrade();
-
-    {
-        xengine::CWriteLock wlock(rwUpper);
-        dblCache.Flip();
-    }
-
-    return true;
-}
-
 //////////////////////////////
 // CAddressUnspentDB
 
 CAddressUnspentDB::CAddressUnspentDB()
 {
-    pThreadFlush = nullptr;
-    fStopFlush = true;
 }
 
-bool CAddressUnspentDB::Initialize(const boost::filesystem::path& pathData, const bool fFlush)
+bool CAddressUnspentDB::Initialize(const boost::filesystem::path& pathData)
 {
     pathAddress = pathData / "addressunspent";
 
@@ -337,50 +345,21 @@ bool CAddressUnspentDB::Initialize(const boost::filesystem::path& pathData, cons
         return false;
     }
 
-    if (fFlush)
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
     {
-        fStopFlush = false;
-        pThreadFlush = new boost::thread(boost::bind(&CAddressUnspentDB::FlushProc, this));
-        if (pThreadFlush == nullptr)
-        {
-            fStopFlush = true;
-            return false;
-        }
+        return false;
     }
+
     return true;
 }
 
 void CAddressUnspentDB::Deinitialize()
 {
-    if (pThreadFlush)
-    {
-        {
-            boost::unique_lock<boost::mutex> lock(mtxFlush);
-            fStopFlush = true;
-        }
-        condFlush.notify_all();
-        pThreadFlush->join();
-        delete pThreadFlush;
-        pThreadFlush = nullptr;
-
-        {
-            CWriteLock wlock(rwAccess);
-
-            for (map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.begin();
-                 it != mapAddressDB.end(); ++it)
-            {
-                std::shared_ptr<CForkAddressUnspentDB> spAddress = (*it).second;
-
-                spAddress->Flush();
-                spAddress->Flush();
-            }
-            mapAddressDB.clear();
-        }
-    }
-    else
     {
+        CWriteLock wlock(rwAccess);
         mapAddressDB.clear();
     }
+    spShared.reset();
 }
 
 bool CAddressUnspentDB::AddNewFork(const uint256& hashFork, const uint256& hashLastBlock)
@@ -393,7 +372,7 @@ bool CAddressUnspentDB::AddNewFork(const uint256& hashFork, const uint256& hashL
         return true;
     }
 
-    std::shared_ptr<CForkAddressUnspentDB> spAddress(new CForkAddressUnspentDB(pathAddress / hashFork.GetHex(), hashLastBlock));
+    std::shared_ptr<CForkAddressUnspentDB> spAddress(new CForkAddressUnspentDB(pathAddress / hashFork.GetHex(), spShared, hashFork, hashLastBlock));
     if (spAddress == nullptr || !spAddress->IsValid())
     {
         return false;
@@ -467,6 +446,20 @@ bool CAddressUnspentDB::RetrieveAddressUnspent(const uint256& hashFork, const CD
     return it->second->RetrieveAddressUnspent(dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CAddressUnspentDB::ListAddressUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax,
+                                           vector<pair<CAddrUnspentKey, CUnspentOut>>& vUnspent)
+{
+    CReadLock rlock(rwAccess);
+
+    map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.find(hashFork);
+    if (it == mapAddressDB.end())
+    {
+        StdLog("CAddressUnspentDB", "ListAddressUnspent: find fork fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    return it->second->ListAddressUnspent(dest, outBegin, nMax, vUnspent);
+}
+
 bool CAddressUnspentDB::Copy(const uint256& srcFork, const uint256& destFork)
 {
     CReadLock rlock(rwAccess);
@@ -499,53 +492,14 @@ bool CAddressUnspentDB::WalkThrough(const uint256& hashFork, CForkAddressUnspent
     return false;
 }
 
-void CAddressUnspentDB::Flush(const uint256& hashFork)
+void CAddressUnspentDB::ListWriteBackDB(vector<std::shared_ptr<CWriteBackDB>>& vDB)
 {
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
     CReadLock rlock(rwAccess);
 
-    map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.find(hashFork);
-    if (it != mapAddressDB.end())
-    {
-        (*it).second->Flush();
-    }
-}
-
-void CAddressUnspentDB::FlushProc()
-{
-    SetThreadName("AddressUnspentDB");
-    boost::system_time timeout = boost::get_system_time();
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
-    while (!fStopFlush)
+    for (map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.begin();
+         it != mapAddressDB.end(); ++it)
     {
-        timeout += boost::posix_time::seconds(ADDRESS_UNSPENT_FLUSH_INTERVAL);
-
-        while (!fStopFlush)
-        {
-            if (!condFlush.timed_wait(lock, timeout))
-            {
-                break;
-            }
-        }
-
-        if (!fStopFlush)
-        {
-            vector<std::shared_ptr<CForkAddressUnspentDB>> vAddressDB;
-            vAddressDB.reserve(mapAddressDB.size());
-            {
-                CReadLock rlock(rwAccess);
-
-                for (map<uint256, std::shared_ptr<CForkAddressUnspentDB>>::iterator it = mapAddressDB.begin();
-                     it != mapAddressDB.end(); ++it)
-                {
-                    vAddressDB.push_back((*it).second);
-                }
-            }
-            for (int i = 0; i < vAddressDB.size(); i++)
-            {
-                vAddressDB[i]->Flush();
-            }
-        }
+        vDB.push_back((*it).second);
     }
 }
 
@@ -5,9 +5,8 @@
 #ifndef STORAGE_ADDRESSUNSPENTDB_H
 #define STORAGE_ADDRESSUNSPENTDB_H
 
-#include <boost/thread/thread.hpp>
-
 #include "transaction.h"
+#include "writecache.h"
 #include "xengine.h"
 
 namespace bigbang
@@ -15,6 +14,8 @@ namespace bigbang
 namespace storage
 {
 
+class CLevelDBShared;
+
 //////////////////////////////
 // CAddrUnspentKey
 
@@ -98,44 +99,36 @@ public:
 };
 
 //////////////////////////////
-// CForkAddressUnspentDB
+// CPageAddressUnspentWalker
 
-class CForkAddressUnspentDB : public xengine::CKVDB
+class CPageAddressUnspentWalker : public CForkAddressUnspentDBWalker
 {
-    typedef std::map<CAddrUnspentKey, CUnspentOut> MapType;
-    class CDblMap
+public:
+    CPageAddressUnspentWalker(const CTxOutPoint& outBeginIn, uint32 nMaxIn)
+      : outBegin(outBeginIn), nMax(nMaxIn) {}
+    bool Walk(const CAddrUnspentKey& out, const CUnspentOut& unspent) override
     {
-    public:
-        CDblMap()
-          : nIdxUpper(0) {}
-        MapType& GetUpperMap()
-        {
-            return mapCache[nIdxUpper];
-        }
-        MapType& GetLowerMap()
-        {
-            return mapCache[nIdxUpper ^ 1];
-        }
-        void Flip()
+        if (out.out == outBegin)
         {
-            MapType& mapLower = mapCache[nIdxUpper ^ 1];
-            mapLower.clear();
-            nIdxUpper = nIdxUpper ^ 1;
-        }
-        void Clear()
-        {
-            mapCache[0].clear();
-            mapCache[1].clear();
-            nIdxUpper = 0;
+            return true;
         }
+        vUnspent.push_back(std::make_pair(out, unspent));
+        return (nMax == 0 || vUnspent.size() < nMax);
+    }
 
-    protected:
-        MapType mapCache[2];
-        int nIdxUpper;
-    };
+public:
+    const CTxOutPoint& outBegin;
+    uint32 nMax;
+    std::vector<std::pair<CAddrUnspentKey, CUnspentOut>> vUnspent;
+};
+
+//////////////////////////////
+// CForkAddressUnspentDB
 
+class CForkAddressUnspentDB : public CForkWriteBackDB<CAddrUnspentKey, CUnspentOut>
+{
 public:
-    CForkAddressUnspentDB(const boost::filesystem::path& pathDB, const uint256& hashLastBlockIn);
+    CForkAddressUnspentDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork, const uint256& hashLastBlockIn);
     ~CForkAddressUnspentDB();
     bool RemoveAll();
     bool UpdateAddressUnspent(const uint256& hashLastBlockIn, const std::vector<CTxUnspent>& vAddNew, const std::vector<CTxUnspent>& vRemove);
@@ -143,13 +136,9 @@ public:
     bool WriteAddressUnspent(const CAddrUnspentKey& out, const CUnspentOut& unspent);
     bool ReadAddressUnspent(const CAddrUnspentKey& out, CUnspentOut& unspent);
     bool RetrieveAddressUnspent(const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
+    bool ListAddressUnspent(const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vUnspent);
     bool Copy(CForkAddressUnspentDB& dbAddressUnspent);
-    void SetCache(const CDblMap& dblCacheIn)
-    {
-        dblCache = dblCacheIn;
-    }
     bool WalkThroughAddressUnspent(CForkAddressUnspentDBWalker& walker, const CDestination& dest, uint256& hashLastBlockOut);
-    bool Flush();
 
 protected:
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
@@ -158,17 +147,14 @@ protected:
                     CForkAddressUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower);
 
 protected:
-    xengine::CRWAccess rwUpper;
-    xengine::CRWAccess rwLower;
-    CDblMap dblCache;
     uint256 hashLastBlock;
 };
 
-class CAddressUnspentDB
+class CAddressUnspentDB : public CWriteBackTable
 {
 public:
     CAddressUnspentDB();
-    bool Initialize(const boost::filesystem::path& pathData, const bool fFlush = true);
+    bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool Exists(const uint256& hashFork)
     {
@@ -180,22 +166,16 @@ public:
     bool UpdateAddressUnspent(const uint256& hashFork, const uint256& hashLastBlockIn, const std::vector<CTxUnspent>& vAddNew, const std::vector<CTxUnspent>& vRemove);
     bool RepairAddressUnspent(const uint256& hashFork, const std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vAddUpdate, const std::vector<CAddrUnspentKey>& vRemove);
     bool RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
+    bool ListAddressUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vUnspent);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkAddressUnspentDBWalker& walker);
-    void Flush(const uint256& hashFork);
-
-protected:
-    void FlushProc();
+    void ListWriteBackDB(std::vector<std::shared_ptr<CWriteBackDB>>& vDB) override;
 
 protected:
     boost::filesystem::path pathAddress;
+    std::shared_ptr<CLevelDBShared> spShared;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkAddressUnspentDB>> mapAddressDB;
-
-    boost::mutex mtxFlush;
-    boost::condition_variable condFlush;
-    boost::thread* pThreadFlush;
-    bool fStopFlush;
 };
 
 } // namespace storage
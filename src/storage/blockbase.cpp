@@ -19,28 +19,13 @@ using namespace xengine;
 
 #define BLOCKFILE_PREFIX "block"
 #define LOGFILE_NAME "storage.log"
+#define FILTER_BLOCK_PER_WORKER 64
+#define MAX_PENDING_OUTLINE 64
 namespace bigbang
 {
 namespace storage
 {
 
-//////////////////////////////
-// CBlockBaseDBWalker
-
-class CBlockWalker : public CBlockDBWalker
-{
-public:
-    CBlockWalker(CBlockBase* pBaseIn)
-      : pBase(pBaseIn) {}
-    bool Walk(CBlockOutline& outline) override
-    {
-        return pBase->LoadIndex(outline);
-    }
-
-public:
-    CBlockBase* pBase;
-};
-
 //////////////////////////////
 // CBlockView
 
@@ -440,7 +425,7 @@ CBlockBase::~CBlockBase()
     tsBlock.Deinitialize();
 }
 
-bool CBlockBase::Initialize(const path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fDebug, const bool fAddrTxIndexIn, const bool fRenewDB)
+bool CBlockBase::Initialize(const path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fDebug, const bool fAddrTxIndexIn, const std::size_t nBlockCacheSize, const uint32 nSyncRecords, const uint32 nSyncInterval, const bool fRenewDB)
 {
     fCfgAddrTxIndex = fAddrTxIndexIn;
     hashGenesisBlock = hashGenesisBlockIn;
@@ -458,6 +443,8 @@ bool CBlockBase::Initialize(const path& pathDataLocation, const uint256& hashGen
         return false;
     }
 
+    tsBlock.SetCacheSize(nBlockCacheSize);
+    tsBlock.SetSyncPolicy(nSyncRecords, nSyncInterval);
     if (!tsBlock.Initialize(pathDataLocation / "block", BLOCKFILE_PREFIX))
     {
         dbBlock.Deinitialize();
@@ -487,6 +474,7 @@ bool CBlockBase::Initialize(const path& pathDataLocation, const uint256& hashGen
 
 void CBlockBase::Deinitialize()
 {
+    CommitOutline();
     dbBlock.Deinitialize();
     tsBlock.Deinitialize();
     {
@@ -522,6 +510,10 @@ void CBlockBase::Clear()
 {
     CWriteLock wlock(rwAccess);
 
+    {
+        boost::unique_lock<boost::mutex> lock(mtxOutline);
+        vOutlinePending.clear();
+    }
     dbBlock.RemoveAll();
     ClearCache();
 }
@@ -562,10 +554,9 @@ bool CBlockBase::Initiate(const uint256& hashGenesis, const CBlock& blockGenesis
             return false;
         }
 
-        if (!dbBlock.AddNewBlock(CBlockOutline(pIndexNew)))
         {
-            StdTrace("BlockBase", "Add New genesis Block %s block failed", hashGenesis.ToString().c_str());
-            return false;
+            boost::unique_lock<boost::mutex> lock(mtxOutline);
+            vOutlinePending.push_back(CBlockOutline(pIndexNew));
         }
 
         CDelegateContext ctxtDelegate;
@@ -633,6 +624,11 @@ bool CBlockBase::Initiate(const uint256& hashGenesis, const CBlock& blockGenesis
         {
             CWriteLock wForkLock(spFork->GetRWAccess());
 
+            if (!CommitOutline())
+            {
+                StdTrace("BlockBase", "Add New genesis Block %s block failed", hashGenesis.ToString().c_str());
+                return false;
+            }
             if (!dbBlock.UpdateFork(hashGenesis, hashGenesis, uint64(0), vTxNew, vector<uint256>(), vAddrTxNew, vector<CAddrTxIndex>(), vAddNew, vector<CTxUnspent>()))
             {
                 StdTrace("BlockBase", "Update Fork %s failed", hashGenesis.ToString().c_str());
@@ -669,12 +665,15 @@ bool CBlockBase::AddNew(const uint256& hash, CBlockEx& block, CBlockIndex** ppIn
         }
     }
 
+    // the block is buffered and its outline waits for the next CommitOutline,
+    // which stores it once the block file is flushed
     uint32 nFile, nOffset;
     if (!tsBlock.Write(block, nFile, nOffset))
     {
         StdError("BlockBase", "Add new block: write block failed, block: %s", hash.ToString().c_str());
         return false;
     }
+    size_t nPendingOutline = 0;
     {
         CWriteLock wlock(rwAccess);
 
@@ -685,31 +684,33 @@ bool CBlockBase::AddNew(const uint256& hash, CBlockEx& block, CBlockIndex** ppIn
             return false;
         }
 
-        if (!dbBlock.AddNewBlock(CBlockOutline(pIndexNew)))
-        {
-            StdError("BlockBase", "Add new block: AddNewBlock failed, block: %s", hash.ToString().c_str());
-            //mapIndex.erase(hash);
-            RemoveBlockIndex(pIndexNew->GetOriginHash(), hash);
-            delete pIndexNew;
-            return false;
-        }
-
         if (pIndexNew->IsPrimary())
         {
             if (!UpdateDelegate(hash, block, CDiskPos(nFile, nOffset), ctxtDelegate))
             {
                 StdTrace("BlockBase", "Add new block: Update delegate failed, block: %s", hash.ToString().c_str());
-                dbBlock.RemoveBlock(hash);
                 //mapIndex.erase(hash);
                 RemoveBlockIndex(pIndexNew->GetOriginHash(), hash);
-                delete pIndexNew;
+                arenaIndex.Delete(pIndexNew);
                 return false;
             }
         }
 
+        {
+            boost::unique_lock<boost::mutex> lock(mtxOutline);
+            vOutlinePending.push_back(CBlockOutline(pIndexNew));
+            nPendingOutline = vOutlinePending.size();
+        }
+
         *ppIndexNew = pIndexNew;
     }
 
+    // side chain blocks are not committed with a fork update, so bound how many wait
+    if (nPendingOutline >= MAX_PENDING_OUTLINE)
+    {
+        CommitOutline();
+    }
+
     Log("B", "AddNew block, hash=%s", hash.ToString().c_str());
     return true;
 }
@@ -801,6 +802,30 @@ bool CBlockBase::Retrieve(const CBlockIndex* pIndex, CBlockEx& block)
     return true;
 }
 
+bool CBlockBase::RetrieveHeader(const uint256& hash, CBlock& header)
+{
+    header.SetNull();
+
+    CBlockIndex* pIndex;
+    {
+        CReadLock rlock(rwAccess);
+
+        if (!(pIndex = GetIndex(hash)))
+        {
+            StdTrace("BlockBase", "RetrieveHeader::GetIndex %s block failed", hash.ToString().c_str());
+            return false;
+        }
+    }
+    CBlockHeaderRecord record;
+    if (!tsBlock.Read(record, pIndex->nFile, pIndex->nOffset, false))
+    {
+        StdTrace("BlockBase", "RetrieveHeader::Read %s block failed", hash.ToString().c_str());
+        return false;
+    }
+    header = record;
+    return true;
+}
+
 bool CBlockBase::RetrieveIndex(const uint256& hash, CBlockIndex** ppIndex)
 {
     CReadLock rlock(rwAccess);
@@ -826,6 +851,23 @@ bool CBlockBase::RetrieveFork(const uint256& hash, CBlockIndex** ppIndex)
     return false;
 }
 
+bool CBlockBase::RetrieveForkHeightIndex(const uint256& hashFork, int nHeight, CBlockIndex** ppIndex)
+{
+    CReadLock rlock(rwAccess);
+
+    boost::shared_ptr<CBlockFork> spFork = GetFork(hashFork);
+    if (spFork != nullptr)
+    {
+        CReadLock rForkLock(spFork->GetRWAccess());
+
+        *ppIndex = spFork->GetIndexByHeight(nHeight);
+
+        return (*ppIndex != nullptr);
+    }
+
+    return false;
+}
+
 bool CBlockBase::RetrieveFork(const string& strName, CBlockIndex** ppIndex)
 {
     CReadLock rlock(rwAccess);
@@ -1275,12 +1317,29 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
     vector<CTxUnspent> vRemoveUnspent;
     view.GetUnspentChanges(vAddNewUnspent, vRemoveUnspent);
 
+    vector<CBlockEx> vAdd;
+    vector<CBlockEx> vRemove;
+    vector<pair<CDestination, CAddrInfo>> vNewAddress;
+    vector<CDestination> vRemoveAddress;
+    if (spFork->GetProfile().nForkType == FORK_TYPE_DEFI)
+    {
+        view.GetBlockChanges(vAdd, vRemove);
+        GetDeFiRelationChanges(vAdd, vRemove, vNewAddress, vRemoveAddress);
+    }
+
     if (hashFork == view.GetForkHash())
     {
         spFork->UpgradeToWrite();
     }
 
-    if (!dbBlock.UpdateFork(hashFork, pIndexNew->GetBlockHash(), view.GetForkHash(), vTxNew, vTxDel, vAddrTxNew, vAddrTxDel, vAddNewUnspent, vRemoveUnspent))
+    // the fork must only point at blocks and txs that are in the files
+    if (!CommitOutline())
+    {
+        StdTrace("BlockBase", "CommitBlockView::Commit block outline failed");
+        return false;
+    }
+    if (!dbBlock.UpdateFork(hashFork, pIndexNew->GetBlockHash(), view.GetForkHash(), vTxNew, vTxDel, vAddrTxNew, vAddrTxDel,
+                            vAddNewUnspent, vRemoveUnspent, vNewAddress, vRemoveAddress))
     {
         StdTrace("BlockBase", "CommitBlockView::Update fork %s  failed", hashFork.ToString().c_str());
         return false;
@@ -1289,15 +1348,7 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
 
     if (spFork->GetProfile().nForkType == FORK_TYPE_DEFI)
     {
-        vector<CBlockEx> vAdd;
-        vector<CBlockEx> vRemove;
-        view.GetBlockChanges(vAdd, vRemove);
-
-        if (!AddDeFiRelation(hashFork, spFork, vAdd, vRemove))
-        {
-            StdTrace("BlockBase", "CommitBlockView: AddDeFiRelation fail, fork: %s", hashFork.ToString().c_str());
-            return false;
-        }
+        AddDeFiRelation(spFork, vNewAddress, vRemoveAddress);
 
         if (!UpdateDeFiMintHeight(hashFork, spFork, vAdd, vRemove))
         {
@@ -1311,54 +1362,100 @@ bool CBlockBase::CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew)
     return true;
 }
 
-bool CBlockBase::LoadIndex(CBlockOutline& outline)
+bool CBlockBase::LoadIndex(vector<CBlockOutline>& vOutline, size_t nWorker)
 {
-    uint256 hash = outline.GetBlockHash();
-    CBlockIndex* pIndexNew = nullptr;
-
-    map<uint256, CBlockIndex*>::iterator mi = mapIndex.find(hash);
-    if (mi != mapIndex.end())
-    {
-        pIndexNew = (*mi).second;
-        *pIndexNew = static_cast<CBlockIndex&>(outline);
-    }
-    else
+    // first pass: allocate and insert every index, single threaded
+    mapIndex.reserve(mapIndex.size() + vOutline.size());
+    vector<CBlockIndex*> vIndex(vOutline.size());
+    for (size_t i = 0; i < vOutline.size(); i++)
     {
-        pIndexNew = new CBlockIndex(static_cast<CBlockIndex&>(outline));
-        if (pIndexNew == nullptr)
+        CBlockIndex* pIndex = mapIndex.find(vOutline[i].GetBlockHash());
+        if (pIndex != nullptr)
         {
-            Log("B", "LoadIndex: new CBlockIndex fail");
-            return false;
+            *pIndex = static_cast<CBlockIndex&>(vOutline[i]);
+        }
+        else
+        {
+            pIndex = arenaIndex.New(static_cast<CBlockIndex&>(vOutline[i]));
+            mapIndex.insert(pIndex);
         }
-        mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
+        pIndex->pPrev = nullptr;
+        pIndex->pSkip = nullptr;
+        pIndex->pOrigin = pIndex;
+        vIndex[i] = pIndex;
     }
 
-    pIndexNew->phashBlock = &((*mi).first);
-    pIndexNew->pPrev = nullptr;
-    pIndexNew->pOrigin = pIndexNew;
+    // second pass: link prev and origin on the workers, the map is read only here
+    vector<uint8> vMissing(vOutline.size(), 0);
+    atomic<size_t> nNext(0);
+    boost::thread_group workers;
+    for (size_t i = 1; i < nWorker; i++)
+    {
+        workers.create_thread(boost::bind(&CBlockBase::LinkIndex, this, boost::cref(vOutline), boost::cref(vIndex),
+                                          boost::ref(vMissing), boost::ref(nNext)));
+    }
+    LinkIndex(vOutline, vIndex, vMissing, nNext);
+    workers.join_all();
 
-    if (outline.hashPrev != 0)
+    for (size_t i = 0; i < vOutline.size(); i++)
     {
-        pIndexNew->pPrev = GetOrCreateIndex(outline.hashPrev);
-        if (pIndexNew->pPrev == nullptr)
+        CBlockIndex* pIndex = vIndex[i];
+        if (vMissing[i])
         {
-            Log("B", "LoadIndex: GetOrCreateIndex prev block index fail");
-            return false;
+            // blocks without a loaded prev or origin get an empty index as before
+            if (vOutline[i].hashPrev != 0 && pIndex->pPrev == nullptr
+                && (pIndex->pPrev = GetOrCreateIndex(vOutline[i].hashPrev)) == nullptr)
+            {
+                Log("B", "LoadIndex: GetOrCreateIndex prev block index fail");
+                return false;
+            }
+            if (!pIndex->IsOrigin() && pIndex->pOrigin == pIndex
+                && (pIndex->pOrigin = GetOrCreateIndex(vOutline[i].hashOrigin)) == nullptr)
+            {
+                Log("B", "LoadIndex: GetOrCreateIndex origin block index fail");
+                return false;
+            }
         }
+        UpdateBlockHeightIndex(pIndex->GetOriginHash(), vOutline[i].GetBlockHash(), pIndex->nTimeStamp, CDestination(), uint256());
     }
+    return true;
+}
 
-    if (!pIndexNew->IsOrigin())
+void CBlockBase::LinkIndex(const vector<CBlockOutline>& vOutline, const vector<CBlockIndex*>& vIndex,
+                           vector<uint8>& vMissing, atomic<size_t>& nNext)
+{
+    const size_t nChunk = 1024;
+    for (;;)
     {
-        pIndexNew->pOrigin = GetOrCreateIndex(outline.hashOrigin);
-        if (pIndexNew->pOrigin == nullptr)
+        size_t nBegin = nNext.fetch_add(nChunk);
+        if (nBegin >= vOutline.size())
         {
-            Log("B", "LoadIndex: GetOrCreateIndex origin block index fail");
-            return false;
+            break;
+        }
+        size_t nEnd = min(nBegin + nChunk, vOutline.size());
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            const CBlockOutline& outline = vOutline[i];
+            CBlockIndex* pIndex = vIndex[i];
+            if (outline.hashPrev != 0)
+            {
+                pIndex->pPrev = GetIndex(outline.hashPrev);
+                vMissing[i] |= (pIndex->pPrev == nullptr);
+            }
+            if (!pIndex->IsOrigin())
+            {
+                CBlockIndex* pOrigin = GetIndex(outline.hashOrigin);
+                if (pOrigin != nullptr)
+                {
+                    pIndex->pOrigin = pOrigin;
+                }
+                else
+                {
+                    vMissing[i] = 1;
+                }
+            }
         }
     }
-
-    UpdateBlockHeightIndex(pIndexNew->GetOriginHash(), hash, pIndexNew->nTimeStamp, CDestination(), uint256());
-    return true;
 }
 
 bool CBlockBase::LoadTx(CTransaction& tx, uint32 nTxFile, uint32 nTxOffset, uint256& hashFork)
@@ -1379,6 +1476,12 @@ bool CBlockBase::LoadTx(CTransaction& tx, uint32 nTxFile, uint32 nTxOffset, uint
 }
 
 bool CBlockBase::FilterTx(const uint256& hashFork, CTxFilter& filter)
+{
+    CTxFilterCursor cursor;
+    return FilterTx(hashFork, filter, cursor, 0);
+}
+
+bool CBlockBase::FilterTx(const uint256& hashFork, CTxFilter& filter, CTxFilterCursor& cursor, size_t nMaxBlock)
 {
     CReadLock rlock(rwAccess);
 
@@ -1391,36 +1494,126 @@ bool CBlockBase::FilterTx(const uint256& hashFork, CTxFilter& filter)
 
     CReadLock rForkLock(spFork->GetRWAccess());
 
-    for (CBlockIndex* pIndex = spFork->GetOrigin(); pIndex != nullptr; pIndex = pIndex->pNext)
+    CBlockIndex* pIndex = spFork->GetOrigin();
+    if (cursor.hashBlock != 0)
     {
-        CBlockEx block;
-        if (!tsBlock.Read(block, pIndex->nFile, pIndex->nOffset))
+        // a chunk ends with the last block of a height, it is still that on the fork unless a reorg took it
+        CBlockIndex* pIndexPrev = GetIndex(cursor.hashBlock);
+        if (pIndexPrev == nullptr || spFork->GetIndexByHeight(pIndexPrev->GetBlockHeight()) != pIndexPrev)
         {
-            StdLog("BlockBase", "FilterTx: Block read fail, nFile: %d, nOffset: %d.", pIndex->nFile, pIndex->nOffset);
+            StdLog("BlockBase", "FilterTx: block %s left fork %s, restart the scan",
+                   cursor.hashBlock.GetHex().c_str(), hashFork.GetHex().c_str());
+            cursor = CTxFilterCursor();
+            cursor.fRestart = true;
+            return true;
+        }
+        pIndex = pIndexPrev->pNext;
+    }
+    else if (cursor.nHeight > pIndex->GetBlockHeight())
+    {
+        CBlockIndex* pIndexPrev = spFork->GetLast()->GetAncestor(cursor.nHeight - 1);
+        pIndex = (pIndexPrev != nullptr ? pIndexPrev->pNext : nullptr);
+    }
+
+    // with the address tx index only heights holding a filtered address are read,
+    // they are listed once per scan, later blocks are read in full
+    if (cursor.nIndexedHeight < 0)
+    {
+        cursor.fIndexed = dbBlock.ListAddressTxHeight(hashFork, filter.setDest, cursor.nHeight, cursor.setHeight);
+        cursor.nIndexedHeight = spFork->GetLast()->GetBlockHeight();
+        if (!cursor.fIndexed)
+        {
+            cursor.setHeight.clear();
+        }
+    }
+
+    vector<CBlockIndex*> vIndex;
+    CollectFilterBlock(pIndex, nMaxBlock, cursor, vIndex);
+    cursor.setHeight.erase(cursor.setHeight.begin(), cursor.setHeight.lower_bound(cursor.nHeight));
+
+    // bodies left out of an imported snapshot can not be scanned
+    const uint32 nFirstFile = tsBlock.GetFirstFile();
+    vIndex.erase(remove_if(vIndex.begin(), vIndex.end(), [nFirstFile](const CBlockIndex* p) { return p->nFile < nFirstFile; }),
+                 vIndex.end());
+
+    // block ranges are read and matched in parallel, found txs are reported in chain order
+    vector<vector<CAssembledTx>> vFound(vIndex.size());
+    vector<uint8> vRead(vIndex.size(), 0);
+    auto fnRead = [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < vIndex.size(); i += nStep)
+        {
+            vRead[i] = FilterBlockTx(vIndex[i], filter.setDest, vFound[i]);
+        }
+    };
+    size_t nWorker = min((size_t)max(boost::thread::hardware_concurrency(), 1U), vIndex.size() / FILTER_BLOCK_PER_WORKER + 1);
+    boost::thread_group workers;
+    for (size_t i = 1; i < nWorker; i++)
+    {
+        workers.create_thread([&fnRead, i, nWorker]() { fnRead(i, nWorker); });
+    }
+    fnRead(0, nWorker);
+    workers.join_all();
+
+    for (size_t i = 0; i < vIndex.size(); i++)
+    {
+        if (!vRead[i])
+        {
+            StdLog("BlockBase", "FilterTx: Block read fail, nFile: %d, nOffset: %d.", vIndex[i]->nFile, vIndex[i]->nOffset);
             return false;
         }
-        int nBlockHeight = pIndex->GetBlockHeight();
-        if (block.txMint.nAmount > 0 && filter.setDest.count(block.txMint.sendTo))
+        for (const CAssembledTx& tx : vFound[i])
         {
-            if (!filter.FoundTx(hashFork, CAssembledTx(block.txMint, nBlockHeight)))
+            if (!filter.FoundTx(hashFork, tx))
             {
-                StdLog("BlockBase", "FilterTx: FoundTx mint tx fail, txid: %s.", block.txMint.GetHash().GetHex().c_str());
+                StdLog("BlockBase", "FilterTx: FoundTx tx fail, txid: %s.", tx.GetHash().GetHex().c_str());
                 return false;
             }
         }
-        for (int i = 0; i < block.vtx.size(); i++)
+    }
+    return true;
+}
+
+void CBlockBase::CollectFilterBlock(CBlockIndex* pIndex, size_t nMaxBlock, CTxFilterCursor& cursor,
+                                    vector<CBlockIndex*>& vIndex)
+{
+    for (; pIndex != nullptr; pIndex = pIndex->pNext)
+    {
+        int nHeight = pIndex->GetBlockHeight();
+        if (nMaxBlock > 0 && vIndex.size() >= nMaxBlock && nHeight != vIndex.back()->GetBlockHeight())
         {
-            CTransaction& tx = block.vtx[i];
-            CTxContxt& ctxt = block.vTxContxt[i];
+            break;
+        }
+        if (!cursor.fIndexed || nHeight > cursor.nIndexedHeight || cursor.setHeight.count(nHeight))
+        {
+            vIndex.push_back(pIndex);
+        }
+        cursor.nHeight = nHeight + 1;
+        cursor.hashBlock = pIndex->GetBlockHash();
+    }
+    cursor.fEnd = (pIndex == nullptr);
+}
 
-            if (filter.setDest.count(tx.sendTo) || filter.setDest.count(ctxt.destIn))
-            {
-                if (!filter.FoundTx(hashFork, CAssembledTx(tx, nBlockHeight, ctxt.destIn, ctxt.GetValueIn())))
-                {
-                    StdLog("BlockBase", "FilterTx: FoundTx tx fail, txid: %s.", tx.GetHash().GetHex().c_str());
-                    return false;
-                }
-            }
+bool CBlockBase::FilterBlockTx(const CBlockIndex* pIndex, const set<CDestination>& setDest, vector<CAssembledTx>& vTx)
+{
+    // a scan touches each block once, keep it out of the block cache
+    CBlockEx block;
+    if (!tsBlock.Read(block, pIndex->nFile, pIndex->nOffset, false))
+    {
+        return false;
+    }
+    int nBlockHeight = pIndex->GetBlockHeight();
+    if (block.txMint.nAmount > 0 && setDest.count(block.txMint.sendTo))
+    {
+        vTx.push_back(CAssembledTx(block.txMint, nBlockHeight));
+    }
+    for (int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction& tx = block.vtx[i];
+        const CTxContxt& ctxt = block.vTxContxt[i];
+
+        if (setDest.count(tx.sendTo) || setDest.count(ctxt.destIn))
+        {
+            vTx.push_back(CAssembledTx(tx, nBlockHeight, ctxt.destIn, ctxt.GetValueIn()));
         }
     }
     return true;
@@ -1540,14 +1733,12 @@ bool CBlockBase::GetForkBlockLocator(const uint256& hashFork, CBlockLocator& loc
             }
             break;
         }
-        for (int i = 0; i < nIncStep && !pIndex->IsOrigin(); i++)
+        int nHeight = max(pIndex->GetBlockHeight() - nIncStep, pIndex->pOrigin->GetBlockHeight());
+        pIndex = (pIndex->pPrev != nullptr ? pIndex->pPrev->GetAncestor(nHeight) : nullptr);
+        if (pIndex == nullptr)
         {
-            pIndex = pIndex->pPrev;
-            if (pIndex == nullptr)
-            {
-                hashDepth = 0;
-                break;
-            }
+            hashDepth = 0;
+            break;
         }
     }
 
@@ -2027,18 +2218,38 @@ bool CBlockBase::CheckInputSingleAddressForTxWithChange(const uint256& txid)
 }
 
 bool CBlockBase::ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent)
+{
+    return ListForkUnspent(hashFork, dest, CTxOutPoint(), nMax, vUnspent);
+}
+
+bool CBlockBase::ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent)
 {
     vUnspent.clear();
-    CListUnspentWalker walker(hashFork, dest, nMax);
-    dbBlock.WalkThroughUnspent(hashFork, walker);
-    vUnspent = walker.vUnspent;
+    vector<pair<CAddrUnspentKey, CUnspentOut>> vAddrUnspent;
+    if (!dbBlock.ListAddressUnspent(hashFork, dest, outBegin, nMax, vAddrUnspent))
+    {
+        StdLog("CBlockBase", "ListForkUnspent: List address unspent fail, fork: %s", hashFork.GetHex().c_str());
+        return false;
+    }
+    vUnspent.reserve(vAddrUnspent.size());
+    for (const auto& vd : vAddrUnspent)
+    {
+        const CUnspentOut& unspent = vd.second;
+        vUnspent.push_back(CTxUnspent(vd.first.out, CTxOut(dest, unspent.nAmount, unspent.nTxTime, unspent.nLockUntil),
+                                      unspent.nTxType, unspent.nHeight));
+    }
     return true;
 }
 
 bool CBlockBase::ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent)
 {
-    CListUnspentBatchWalker walker(hashFork, mapUnspent, nMax);
-    dbBlock.WalkThroughUnspent(hashFork, walker);
+    for (auto& vd : mapUnspent)
+    {
+        if (!ListForkUnspent(hashFork, vd.first, nMax, vd.second))
+        {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -2057,22 +2268,52 @@ int64 CBlockBase::RetrieveAddressTxList(const uint256& hashFork, const CDestinat
     }
     for (const auto& vd : mapAddrTxIndex)
     {
-        if (vd.second.nDirection == CAddrTxInfo::TXI_DIRECTION_TO)
-        {
-            vTx.push_back(CTxInfo(vd.first.txid, hashFork, vd.second.nTxType, vd.second.nTimeStamp,
-                                  vd.second.nLockUntil, vd.first.GetHeight(), vd.first.GetSeq(), vd.second.destPeer, vd.first.dest,
-                                  vd.second.nAmount, vd.second.nTxFee, 0));
-        }
-        else
-        {
-            vTx.push_back(CTxInfo(vd.first.txid, hashFork, vd.second.nTxType, vd.second.nTimeStamp,
-                                  vd.second.nLockUntil, vd.first.GetHeight(), vd.first.GetSeq(), vd.first.dest, vd.second.destPeer,
-                                  vd.second.nAmount, vd.second.nTxFee, 0));
-        }
+        vTx.push_back(GetAddrTxInfo(hashFork, vd.first, vd.second));
     }
     return nGetEndPos;
 }
 
+bool CBlockBase::ListAddressTxPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                   vector<CTxInfo>& vTx, int64& nHeightSeqNext)
+{
+    vector<pair<CAddrTxIndex, CAddrTxInfo>> vTxIndex;
+    if (!dbBlock.ListAddressTxIndex(hashFork, dest, nHeightSeqCursor, fReverse, nCount, vTxIndex))
+    {
+        return false;
+    }
+    vTx.reserve(vTxIndex.size());
+    for (const auto& vd : vTxIndex)
+    {
+        vTx.push_back(GetAddrTxInfo(hashFork, vd.first, vd.second));
+    }
+    // a full page may have more after it
+    nHeightSeqNext = ((nCount > 0 && vTxIndex.size() == nCount) ? vTxIndex.back().first.nHeightSeq : -1);
+    return true;
+}
+
+bool CBlockBase::GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount)
+{
+    return dbBlock.GetAddressTxCount(hashFork, dest, nTxCount);
+}
+
+CTxInfo CBlockBase::GetAddrTxInfo(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo)
+{
+    if (txInfo.nDirection == CAddrTxInfo::TXI_DIRECTION_TO)
+    {
+        return CTxInfo(txIndex.txid, hashFork, txInfo.nTxType, txInfo.nTimeStamp,
+                       txInfo.nLockUntil, txIndex.GetHeight(), txIndex.GetSeq(), txInfo.destPeer, txIndex.dest,
+                       txInfo.nAmount, txInfo.nTxFee, 0);
+    }
+    return CTxInfo(txIndex.txid, hashFork, txInfo.nTxType, txInfo.nTimeStamp,
+                   txInfo.nLockUntil, txIndex.GetHeight(), txIndex.GetSeq(), txIndex.dest, txInfo.destPeer,
+                   txInfo.nAmount, txInfo.nTxFee, 0);
+}
+
+void CBlockBase::GetBlockCacheStat(xengine::CCacheStat& stat)
+{
+    tsBlock.GetCacheStat(stat);
+}
+
 bool CBlockBase::ListForkAllAddressAmount(const uint256& hashFork, CBlockView& view, std::map<CDestination, int64>& mapAddressAmount)
 {
     std::vector<CTxUnspent> vAddNew;
@@ -2092,11 +2333,9 @@ bool CBlockBase::ListForkAllAddressAmount(const uint256& hashFork, CBlockView& v
     return true;
 }
 
-bool CBlockBase::AddDeFiRelation(const uint256& hashFork, boost::shared_ptr<CBlockFork> spFork, const vector<CBlockEx>& vAdd, const vector<CBlockEx>& vRemove)
+void CBlockBase::GetDeFiRelationChanges(const vector<CBlockEx>& vAdd, const vector<CBlockEx>& vRemove,
+                                        vector<pair<CDestination, CAddrInfo>>& vNewAddress, vector<CDestination>& vRemoveAddress)
 {
-    vector<pair<CDestination, CAddrInfo>> vNewAddress;
-    vector<CDestination> vRemoveAddress;
-
     for (const CBlockEx& block : vRemove)
     {
         for (int i = block.vtx.size() - 1; i >= 0; --i)
@@ -2121,12 +2360,11 @@ bool CBlockBase::AddDeFiRelation(const uint256& hashFork, boost::shared_ptr<CBlo
             }
         }
     }
+}
 
-    if (!dbBlock.UpdateAddressInfo(hashFork, vNewAddress, vRemoveAddress))
-    {
-        return false;
-    }
-
+void CBlockBase::AddDeFiRelation(boost::shared_ptr<CBlockFork> spFork, const vector<pair<CDestination, CAddrInfo>>& vNewAddress,
+                                 const vector<CDestination>& vRemoveAddress)
+{
     // update CBlockFork::relation
     auto& relation = spFork->GetRelation();
     for (auto& addr : vRemoveAddress)
@@ -2146,8 +2384,6 @@ bool CBlockBase::AddDeFiRelation(const uint256& hashFork, boost::shared_ptr<CBlo
         }
         StdDebug("CBlockBase", "Add relation in memory, key: %s", addr.first.GetPubKey().ToString().c_str());
     }
-
-    return true;
 }
 
 bool CBlockBase::GetDeFiRelation(const uint256& hashFork, const CDestination& destIn, CAddrInfo& addrInfo)
@@ -2542,7 +2778,8 @@ bool CBlockBase::VerifySameChain(const uint256& hashPrevBlock, const uint256& ha
     {
         return false;
     }
-    while (pAfterIndex->GetBlockHeight() >= pPrevIndex->GetBlockHeight())
+    pAfterIndex = pAfterIndex->GetAncestor(pPrevIndex->GetBlockHeight());
+    while (pAfterIndex != nullptr && pAfterIndex->GetBlockHeight() == pPrevIndex->GetBlockHeight())
     {
         if (pAfterIndex == pPrevIndex)
         {
@@ -2611,44 +2848,41 @@ bool CBlockBase::GetPrimaryHeightBlockTime(const uint256& hashLastBlock, int nHe
     {
         return false;
     }
-    while (pIndex && pIndex->GetBlockHeight() >= nHeight)
+    pIndex = pIndex->GetAncestor(nHeight);
+    if (pIndex == nullptr || pIndex->GetBlockHeight() != nHeight)
     {
-        if (pIndex->GetBlockHeight() == nHeight)
-        {
-            hashBlock = pIndex->GetBlockHash();
-            nTime = pIndex->GetBlockTime();
-            return true;
-        }
-        pIndex = pIndex->pPrev;
+        return false;
     }
-    return false;
+    hashBlock = pIndex->GetBlockHash();
+    nTime = pIndex->GetBlockTime();
+    return true;
 }
 
 CBlockIndex* CBlockBase::GetIndex(const uint256& hash) const
 {
-    map<uint256, CBlockIndex*>::const_iterator mi = mapIndex.find(hash);
-    return (mi != mapIndex.end() ? (*mi).second : nullptr);
+    return mapIndex.find(hash);
 }
 
 CBlockIndex* CBlockBase::GetOrCreateIndex(const uint256& hash)
 {
-    map<uint256, CBlockIndex*>::const_iterator mi = mapIndex.find(hash);
-    if (mi == mapIndex.end())
+    CBlockIndex* pIndex = mapIndex.find(hash);
+    if (pIndex == nullptr)
     {
-        CBlockIndex* pIndexNew = new CBlockIndex();
-        mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
-        if (mi == mapIndex.end())
-        {
-            return nullptr;
-        }
-        pIndexNew->phashBlock = &((*mi).first);
+        pIndex = arenaIndex.New();
+        pIndex->hashBlock = hash;
+        mapIndex.insert(pIndex);
     }
-    return ((*mi).second);
+    return pIndex;
 }
 
 CBlockIndex* CBlockBase::GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIndex, vector<CBlockIndex*>& vPath)
 {
     vPath.clear();
+    if (pIndexRef->GetBlockHeight() > pIndex->GetBlockHeight())
+    {
+        // blocks of reference chain higher than pIndex are not in branch
+        pIndexRef = pIndexRef->GetAncestor(pIndex->GetBlockHeight());
+    }
     while (pIndex != pIndexRef)
     {
         if (pIndexRef->GetBlockTime() > pIndex->GetBlockTime())
@@ -2670,6 +2904,26 @@ CBlockIndex* CBlockBase::GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIndex,
     return pIndex;
 }
 
+void CBlockBase::BuildIndexSkip()
+{
+    // indexes are loaded out of order, build skip from ancestor to descendant
+    vector<CBlockIndex*> vPath;
+    for (CBlockIndexMap::const_iterator mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
+    {
+        CBlockIndex* pIndex = *mi;
+        while (pIndex != nullptr && pIndex->pPrev != nullptr && pIndex->pSkip == nullptr)
+        {
+            vPath.push_back(pIndex);
+            pIndex = pIndex->pPrev;
+        }
+        for (vector<CBlockIndex*>::reverse_iterator it = vPath.rbegin(); it != vPath.rend(); ++it)
+        {
+            (*it)->BuildSkip();
+        }
+        vPath.clear();
+    }
+}
+
 CBlockIndex* CBlockBase::GetOriginIndex(const uint256& txidMint) const
 {
     for (map<uint256, boost::shared_ptr<CBlockFork>>::const_iterator mi = mapFork.begin(); mi != mapFork.end(); ++mi)
@@ -2709,19 +2963,17 @@ void CBlockBase::UpdateBlockRef(const uint256& hashFork, const uint256& hashBloc
 
 CBlockIndex* CBlockBase::AddNewIndex(const uint256& hash, const CBlock& block, uint32 nFile, uint32 nOffset, uint256 nChainTrust)
 {
-    CBlockIndex* pIndexNew = new CBlockIndex(block, nFile, nOffset);
+    CBlockIndex* pIndexNew = arenaIndex.New(block, nFile, nOffset);
     if (pIndexNew != nullptr)
     {
-        map<uint256, CBlockIndex*>::iterator mi = mapIndex.insert(make_pair(hash, pIndexNew)).first;
-        pIndexNew->phashBlock = &((*mi).first);
+        pIndexNew->hashBlock = hash;
+        mapIndex.insert(pIndexNew);
 
         int64 nMoneySupply = block.GetBlockMint();
         uint64 nRandBeacon = block.GetBlockBeacon();
         CBlockIndex* pIndexPrev = nullptr;
-        map<uint256, CBlockIndex*>::iterator miPrev = mapIndex.find(block.hashPrev);
-        if (miPrev != mapIndex.end())
+        if ((pIndexPrev = mapIndex.find(block.hashPrev)) != nullptr)
         {
-            pIndexPrev = (*miPrev).second;
             pIndexNew->pPrev = pIndexPrev;
             if (!pIndexNew->IsOrigin())
             {
@@ -2734,6 +2986,7 @@ CBlockIndex* CBlockBase::AddNewIndex(const uint256& hash, const CBlock& block, u
         pIndexNew->nMoneySupply = nMoneySupply;
         pIndexNew->nChainTrust = nChainTrust;
         pIndexNew->nRandBeacon = nRandBeacon;
+        pIndexNew->BuildSkip();
 
         uint256 hashRefBlock;
         if (!block.IsPrimary() && !block.vchProof.empty()
@@ -3120,12 +3373,12 @@ CBlockIndex* CBlockBase::GetLongChainLastBlock(const uint256& hashFork, int nSta
 
 void CBlockBase::ClearCache()
 {
-    map<uint256, CBlockIndex*>::iterator mi;
-    for (mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
+    for (CBlockIndexMap::const_iterator mi = mapIndex.begin(); mi != mapIndex.end(); ++mi)
     {
-        delete (*mi).second;
+        arenaIndex.Delete(*mi);
     }
     mapIndex.clear();
+    arenaIndex.Clear();
     mapForkHeightIndex.clear();
     mapFork.clear();
 }
@@ -3135,13 +3388,28 @@ bool CBlockBase::LoadDB()
     CWriteLock wlock(rwAccess);
 
     ClearCache();
-    CBlockWalker walker(this);
-    if (!dbBlock.WalkThroughBlock(walker))
+    size_t nWorker = std::max(boost::thread::hardware_concurrency(), 1U);
+    vector<CBlockOutline> vOutline;
+    if (!dbBlock.LoadBlockOutline(vOutline, nWorker))
     {
-        StdLog("CBlockBase", "LoadDB: WalkThroughBlock fail");
+        StdLog("CBlockBase", "LoadDB: LoadBlockOutline fail");
         ClearCache();
         return false;
     }
+    if (!RemoveUnstoredOutline(vOutline))
+    {
+        StdLog("CBlockBase", "LoadDB: RemoveUnstoredOutline fail");
+        ClearCache();
+        return false;
+    }
+    if (!LoadIndex(vOutline, nWorker))
+    {
+        StdLog("CBlockBase", "LoadDB: LoadIndex fail");
+        ClearCache();
+        return false;
+    }
+    vector<CBlockOutline>().swap(vOutline);
+    BuildIndexSkip();
 
     vector<pair<uint256, uint256>> vFork;
     if (!dbBlock.ListFork(vFork))
@@ -3176,6 +3444,72 @@ bool CBlockBase::LoadDB()
     return true;
 }
 
+bool CBlockBase::CommitOutline()
+{
+    // one flush of the block file covers every outline stored after it
+    boost::unique_lock<boost::mutex> lock(mtxOutline);
+    if (!tsBlock.Flush())
+    {
+        StdError("BlockBase", "CommitOutline: flush block file failed, pending: %lu", vOutlinePending.size());
+        return false;
+    }
+    if (!vOutlinePending.empty())
+    {
+        if (!dbBlock.AddNewBlock(vOutlinePending))
+        {
+            StdError("BlockBase", "CommitOutline: add block outline failed, pending: %lu", vOutlinePending.size());
+            return false;
+        }
+        vOutlinePending.clear();
+    }
+    return true;
+}
+
+bool CBlockBase::RemoveUnstoredOutline(vector<CBlockOutline>& vOutline)
+{
+    // blocks are flushed before their outline is stored, but without a sync
+    // policy the file may still lose its tail at a power loss
+    map<uint32, size_t> mapFileSize;
+    size_t nKeep = 0;
+    for (size_t i = 0; i < vOutline.size(); i++)
+    {
+        const CBlockOutline& outline = vOutline[i];
+        if (outline.nFile < tsBlock.GetFirstFile())
+        {
+            // the body was left out of the snapshot this chain was imported from
+            if (nKeep != i)
+            {
+                vOutline[nKeep] = outline;
+            }
+            nKeep++;
+            continue;
+        }
+        auto it = mapFileSize.find(outline.nFile);
+        if (it == mapFileSize.end())
+        {
+            it = mapFileSize.insert(make_pair(outline.nFile, tsBlock.GetSize(outline.nFile))).first;
+        }
+        if (outline.nOffset < it->second)
+        {
+            if (nKeep != i)
+            {
+                vOutline[nKeep] = outline;
+            }
+            nKeep++;
+        }
+        else
+        {
+            StdLog("CBlockBase", "LoadDB: block %s is not in file %u, remove it", outline.GetBlockHash().GetHex().c_str(), outline.nFile);
+            if (!dbBlock.RemoveBlock(outline.GetBlockHash()))
+            {
+                return false;
+            }
+        }
+    }
+    vOutline.resize(nKeep);
+    return true;
+}
+
 bool CBlockBase::SetupLog(const path& pathLocation, bool fDebug)
 {
 
@@ -8,6 +8,7 @@
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
 #include <list>
 #include <map>
 #include <numeric>
@@ -117,6 +118,21 @@ public:
                 pIndexNext = pIndex;
             }
         }
+        UpdateHeightIndex();
+    }
+    // the last block of nHeight in the chain of pIndexLast, O(1) from fork origin, O(log n) before origin
+    CBlockIndex* GetIndexByHeight(int nHeight) const
+    {
+        if (pIndexLast == nullptr || nHeight < 0 || nHeight > pIndexLast->GetBlockHeight())
+        {
+            return nullptr;
+        }
+        int nOriginHeight = pIndexOrigin->GetBlockHeight();
+        if (nHeight >= nOriginHeight)
+        {
+            return vHeightIndex[nHeight - nOriginHeight];
+        }
+        return (pIndexOrigin->pPrev != nullptr ? pIndexOrigin->pPrev->GetAncestor(nHeight) : nullptr);
     }
 
     xengine::CForest<CDestination, CDestination>& GetRelation()
@@ -124,11 +140,40 @@ public:
         return relation;
     }
 
+protected:
+    void UpdateHeightIndex()
+    {
+        if (pIndexLast == nullptr)
+        {
+            vHeightIndex.clear();
+            return;
+        }
+        int nOriginHeight = pIndexOrigin->GetBlockHeight();
+        vHeightIndex.resize(pIndexLast->GetBlockHeight() - nOriginHeight + 1, nullptr);
+        // rewrite from the last block back to the fork point of the previous chain
+        CBlockIndex* pIndex = pIndexLast;
+        while (pIndex != nullptr && pIndex->GetBlockHeight() >= nOriginHeight)
+        {
+            int nHeight = pIndex->GetBlockHeight();
+            CBlockIndex*& pSlot = vHeightIndex[nHeight - nOriginHeight];
+            if (pSlot == pIndex)
+            {
+                break;
+            }
+            pSlot = pIndex;
+            while (pIndex != nullptr && pIndex->GetBlockHeight() == nHeight)
+            {
+                pIndex = pIndex->pPrev;
+            }
+        }
+    }
+
 protected:
     mutable xengine::CRWAccess rwAccess;
     CProfile forkProfile;
     CBlockIndex* pIndexLast;
     CBlockIndex* pIndexOrigin;
+    std::vector<CBlockIndex*> vHeightIndex;
     xengine::CForest<CDestination, CDestination> relation;
 };
 
@@ -251,6 +296,42 @@ protected:
     std::map<uint32, std::map<uint256, CBlockHeightIndex>> mapHeightIndex;
 };
 
+class CBlockIndexKeyOf
+{
+public:
+    const uint256& operator()(const CBlockIndex* pIndex) const
+    {
+        return pIndex->hashBlock;
+    }
+};
+
+class CBlockHashHasher
+{
+public:
+    std::size_t operator()(const uint256& hash) const
+    {
+        return (std::size_t)(hash.Get64(0) ^ hash.Get64(1) ^ hash.Get64(2) ^ hash.Get64(3));
+    }
+};
+
+// Block index table keyed by the hash stored inline in CBlockIndex, so an
+// entry costs one pointer slot instead of a node holding another copy of the hash.
+class CBlockIndexMap : public xengine::COpenHashTable<uint256, CBlockIndex*, CBlockIndexKeyOf, CBlockHashHasher>
+{
+    typedef xengine::COpenHashTable<uint256, CBlockIndex*, CBlockIndexKeyOf, CBlockHashHasher> base;
+
+public:
+    CBlockIndex* find(const uint256& hash) const
+    {
+        base::const_iterator it = base::find(hash);
+        return (it != end() ? *it : nullptr);
+    }
+    bool insert(CBlockIndex* pIndex)
+    {
+        return base::insert(pIndex).second;
+    }
+};
+
 class CBlockBase
 {
     friend class CBlockView;
@@ -258,7 +339,7 @@ class CBlockBase
 public:
     CBlockBase();
     ~CBlockBase();
-    bool Initialize(const boost::filesystem::path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fDebug, const bool fAddrTxIndexIn, const bool fRenewDB = false);
+    bool Initialize(const boost::filesystem::path& pathDataLocation, const uint256& hashGenesisBlockIn, const bool fDebug, const bool fAddrTxIndexIn, const std::size_t nBlockCacheSize, const uint32 nSyncRecords, const uint32 nSyncInterval, const bool fRenewDB = false);
     void Deinitialize();
     void Clear();
     bool IsEmpty() const;
@@ -272,8 +353,10 @@ public:
     bool Retrieve(const CBlockIndex* pIndex, CBlock& block);
     bool Retrieve(const uint256& hash, CBlockEx& block);
     bool Retrieve(const CBlockIndex* pIndex, CBlockEx& block);
+    bool RetrieveHeader(const uint256& hash, CBlock& header);
     bool RetrieveIndex(const uint256& hash, CBlockIndex** ppIndex);
     bool RetrieveFork(const uint256& hash, CBlockIndex** ppIndex);
+    bool RetrieveForkHeightIndex(const uint256& hashFork, int nHeight, CBlockIndex** ppIndex);
     bool RetrieveFork(const std::string& strName, CBlockIndex** ppIndex);
     bool RetrieveProfile(const uint256& hash, CProfile& profile);
     bool RetrieveForkContext(const uint256& hash, CForkContext& ctxt);
@@ -293,9 +376,9 @@ public:
     bool GetBlockView(const uint256& hash, CBlockView& view, bool fCommitable = false, bool fGetBranchBlock = true);
     bool GetForkBlockView(const uint256& hashFork, CBlockView& view);
     bool CommitBlockView(CBlockView& view, CBlockIndex* pIndexNew);
-    bool LoadIndex(CBlockOutline& diskIndex);
     bool LoadTx(CTransaction& tx, uint32 nTxFile, uint32 nTxOffset, uint256& hashFork);
     bool FilterTx(const uint256& hashFork, CTxFilter& filter);
+    bool FilterTx(const uint256& hashFork, CTxFilter& filter, CTxFilterCursor& cursor, std::size_t nMaxBlock);
     bool FilterTx(const uint256& hashFork, int nDepth, CTxFilter& filter);
     bool ListForkContext(std::vector<CForkContext>& vForkCtxt, std::map<uint256, CValidForkId>& mapValidForkId);
     bool GetForkBlockLocator(const uint256& hashFork, CBlockLocator& locator, uint256& hashDepth, int nIncStep);
@@ -303,9 +386,14 @@ public:
     bool CheckConsistency(int nCheckLevel, int nCheckDepth);
     bool CheckInputSingleAddressForTxWithChange(const uint256& txid);
     bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, uint32 nMax, std::vector<CTxUnspent>& vUnspent);
+    bool ListForkUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<CTxUnspent>& vUnspent);
     bool ListForkUnspentBatch(const uint256& hashFork, uint32 nMax, std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent);
     bool RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
     int64 RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::vector<CTxInfo>& vTx);
+    bool ListAddressTxPage(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                           std::vector<CTxInfo>& vTx, int64& nHeightSeqNext);
+    bool GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount);
+    void GetBlockCacheStat(xengine::CCacheStat& stat);
 
     // DeFi
     template <typename D, typename Convert>
@@ -363,7 +451,10 @@ public:
     }
 
     bool ListForkAllAddressAmount(const uint256& hashFork, CBlockView& view, std::map<CDestination, int64>& mapAddressAmount);
-    bool AddDeFiRelation(const uint256& hashFork, boost::shared_ptr<CBlockFork> spFork, const std::vector<CBlockEx>& vAdd, const std::vector<CBlockEx>& vRemove);
+    static void GetDeFiRelationChanges(const std::vector<CBlockEx>& vAdd, const std::vector<CBlockEx>& vRemove,
+                                       std::vector<std::pair<CDestination, CAddrInfo>>& vNewAddress, std::vector<CDestination>& vRemoveAddress);
+    void AddDeFiRelation(boost::shared_ptr<CBlockFork> spFork, const std::vector<std::pair<CDestination, CAddrInfo>>& vNewAddress,
+                         const std::vector<CDestination>& vRemoveAddress);
     bool GetDeFiRelation(const uint256& hashFork, const CDestination& destIn, CAddrInfo& addrInfo);
     bool InitDeFiRelation(const uint256& hashFork);
     bool CheckAddDeFiRelation(const uint256& hashFork, const CDestination& dest, const CDestination& parent);
@@ -386,8 +477,12 @@ public:
 protected:
     CBlockIndex* GetIndex(const uint256& hash) const;
     CBlockIndex* GetOrCreateIndex(const uint256& hash);
+    bool LoadIndex(std::vector<CBlockOutline>& vOutline, std::size_t nWorker);
+    void LinkIndex(const std::vector<CBlockOutline>& vOutline, const std::vector<CBlockIndex*>& vIndex,
+                   std::vector<uint8>& vMissing, std::atomic<std::size_t>& nNext);
     CBlockIndex* GetBranch(CBlockIndex* pIndexRef, CBlockIndex* pIndex, std::vector<CBlockIndex*>& vPath);
     CBlockIndex* GetOriginIndex(const uint256& txidMint) const;
+    void BuildIndexSkip();
     void UpdateBlockHeightIndex(const uint256& hashFork, const uint256& hashBlock, uint32 nBlockTimeStamp, const CDestination& destMint, const uint256& hashRefBlock);
     void RemoveBlockIndex(const uint256& hashFork, const uint256& hashBlock);
     void UpdateBlockRef(const uint256& hashFork, const uint256& hashBlock, const uint256& hashRefBlock);
@@ -399,12 +494,18 @@ protected:
     bool VerifyDelegateVote(const uint256& hash, CBlockEx& block, int64 nMinEnrollAmount, CDelegateContext& ctxtDelegate);
     bool UpdateDelegate(const uint256& hash, CBlockEx& block, const CDiskPos& posBlock, CDelegateContext& ctxtDelegate);
     bool GetTxUnspent(const uint256 fork, const CTxOutPoint& out, CTxOut& unspent);
+    static CTxInfo GetAddrTxInfo(const uint256& hashFork, const CAddrTxIndex& txIndex, const CAddrTxInfo& txInfo);
+    static void CollectFilterBlock(CBlockIndex* pIndex, std::size_t nMaxBlock, CTxFilterCursor& cursor,
+                                   std::vector<CBlockIndex*>& vIndex);
+    bool FilterBlockTx(const CBlockIndex* pIndex, const std::set<CDestination>& setDest, std::vector<CAssembledTx>& vTx);
     bool GetTxNewIndex(CBlockView& view, CBlockIndex* pIndexNew, std::vector<std::pair<uint256, CTxIndex>>& vTxNew, std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddrTxNew);
     bool IsValidBlock(CBlockIndex* pForkLast, const uint256& hashBlock);
     bool VerifyValidBlock(CBlockIndex* pIndexGenesisLast, const CBlockIndex* pIndex);
     CBlockIndex* GetLongChainLastBlock(const uint256& hashFork, int nStartHeight, CBlockIndex* pIndexGenesisLast, const std::set<uint256>& setInvalidHash);
     void ClearCache();
     bool LoadDB();
+    bool CommitOutline();
+    bool RemoveUnstoredOutline(std::vector<CBlockOutline>& vOutline);
     bool InitDeFiRelation(boost::shared_ptr<CBlockFork> spFork);
     bool SetupLog(const boost::filesystem::path& pathDataLocation, bool fDebug);
     void Log(const char* pszIdent, const char* pszFormat, ...)
@@ -447,7 +548,10 @@ protected:
     bool fCfgAddrTxIndex;
     CBlockDB dbBlock;
     CTimeSeriesCached tsBlock;
-    std::map<uint256, CBlockIndex*> mapIndex;
+    boost::mutex mtxOutline;
+    std::vector<CBlockOutline> vOutlinePending;
+    CBlockIndexMap mapIndex;
+    xengine::CObjectArena<CBlockIndex> arenaIndex;
     std::map<uint256, CForkHeightIndex> mapForkHeightIndex;
     std::map<uint256, boost::shared_ptr<CBlockFork>> mapFork;
 };
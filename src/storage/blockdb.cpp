@@ -4,15 +4,20 @@
 
 #include "blockdb.h"
 
+#include "leveldbeng.h"
 #include "stream/datastream.h"
 
 using namespace std;
+using namespace xengine;
 
 namespace bigbang
 {
 namespace storage
 {
 
+#define CACHE_FLUSH_INTERVAL (60)
+#define CACHE_FLUSH_PENDING (200000)
+
 //////////////////////////////
 // CBlockDB
 
@@ -70,11 +75,29 @@ bool CBlockDB::Initialize(const boost::filesystem::path& pathData, const uint256
             return false;
         }
     }
+
+    std::shared_ptr<CLevelDBShared> spShared;
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
+    {
+        return false;
+    }
+    flusherCache.AddTable(&dbUnspent);
+    flusherCache.AddTable(&dbAddress);
+    flusherCache.AddTable(&dbAddressUnspent);
+    if (fDbCfgAddrTxIndex)
+    {
+        flusherCache.AddTable(&dbAddressTxIndex);
+    }
+    if (!flusherCache.Start(spShared, CACHE_FLUSH_INTERVAL, CACHE_FLUSH_PENDING))
+    {
+        return false;
+    }
     return LoadFork();
 }
 
 void CBlockDB::Deinitialize()
 {
+    flusherCache.Stop();
     dbAddress.Deinitialize();
     dbAddressUnspent.Deinitialize();
     if (fDbCfgAddrTxIndex)
@@ -212,13 +235,17 @@ bool CBlockDB::ListFork(vector<pair<uint256, uint256>>& vFork)
 bool CBlockDB::UpdateFork(const uint256& hash, const uint256& hashRefBlock, const uint256& hashForkBased,
                           const vector<pair<uint256, CTxIndex>>& vTxNew, const vector<uint256>& vTxDel,
                           const vector<pair<CAddrTxIndex, CAddrTxInfo>>& vAddrTxNew, const vector<CAddrTxIndex>& vAddrTxDel,
-                          const vector<CTxUnspent>& vAddNewUnspent, const vector<CTxUnspent>& vRemoveUnspent)
+                          const vector<CTxUnspent>& vAddNewUnspent, const vector<CTxUnspent>& vRemoveUnspent,
+                          const vector<pair<CDestination, CAddrInfo>>& vNewAddress, const vector<CDestination>& vRemoveAddress)
 {
     if (!dbUnspent.Exists(hash))
     {
         return false;
     }
 
+    // the cached tables of one block are flushed together
+    CReadLock rlock(flusherCache.GetCommitAccess());
+
     bool fIgnoreTxDel = false;
     if (hashForkBased != hash && hashForkBased != 0)
     {
@@ -261,6 +288,16 @@ bool CBlockDB::UpdateFork(const uint256& hash, const uint256& hashRefBlock, cons
         }
     }
 
+    if (!vNewAddress.empty() || !vRemoveAddress.empty())
+    {
+        if (!dbAddress.Update(hash, vNewAddress, vRemoveAddress))
+        {
+            return false;
+        }
+    }
+
+    flusherCache.AddPending((vAddNewUnspent.size() + vRemoveUnspent.size()) * 2 + vAddrTxNew.size() + vAddrTxDel.size()
+                            + vNewAddress.size() + vRemoveAddress.size());
     return true;
 }
 
@@ -269,6 +306,11 @@ bool CBlockDB::AddNewBlock(const CBlockOutline& outline)
     return dbBlockIndex.AddNewBlock(outline);
 }
 
+bool CBlockDB::AddNewBlock(const vector<CBlockOutline>& vOutline)
+{
+    return dbBlockIndex.AddNewBlock(vOutline);
+}
+
 bool CBlockDB::RemoveBlock(const uint256& hash)
 {
     return dbBlockIndex.RemoveBlock(hash);
@@ -279,12 +321,6 @@ bool CBlockDB::UpdateDelegateContext(const uint256& hash, const CDelegateContext
     return dbDelegate.AddNew(hash, ctxtDelegate);
 }
 
-bool CBlockDB::UpdateAddressInfo(const uint256& hashFork, const vector<pair<CDestination, CAddrInfo>>& vNewAddress,
-                                 const vector<CDestination>& vRemoveAddress)
-{
-    return dbAddress.Update(hashFork, vNewAddress, vRemoveAddress);
-}
-
 bool CBlockDB::GetAddressInfo(const uint256& hashFork, const CDestination& destIn, CAddrInfo& addrInfo)
 {
     return dbAddress.Retrieve(hashFork, destIn, addrInfo);
@@ -295,6 +331,11 @@ bool CBlockDB::WalkThroughBlock(CBlockDBWalker& walker)
     return dbBlockIndex.WalkThroughBlock(walker);
 }
 
+bool CBlockDB::LoadBlockOutline(vector<CBlockOutline>& vOutline, size_t nWorker)
+{
+    return dbBlockIndex.LoadBlockOutline(vOutline, nWorker);
+}
+
 bool CBlockDB::RetrieveTxIndex(const uint256& txid, CTxIndex& txIndex, uint256& fork)
 {
     txIndex.SetNull();
@@ -343,6 +384,11 @@ bool CBlockDB::RetrieveAddressUnspent(const uint256& hashFork, const CDestinatio
     return dbAddressUnspent.RetrieveAddressUnspent(hashFork, dest, mapUnspent, hashLastBlockOut);
 }
 
+bool CBlockDB::ListAddressUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, vector<pair<CAddrUnspentKey, CUnspentOut>>& vUnspent)
+{
+    return dbAddressUnspent.ListAddressUnspent(hashFork, dest, outBegin, nMax, vUnspent);
+}
+
 int64 CBlockDB::RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex)
 {
     if (fDbCfgAddrTxIndex)
@@ -352,6 +398,41 @@ int64 CBlockDB::RetrieveAddressTxList(const uint256& hashFork, const CDestinatio
     return -1;
 }
 
+bool CBlockDB::ListAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const size_t nCount,
+                                  vector<pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex)
+{
+    if (!fDbCfgAddrTxIndex)
+    {
+        return false;
+    }
+    return dbAddressTxIndex.ListAddressTxIndex(hashFork, dest, nHeightSeqCursor, fReverse, nCount, vTxIndex);
+}
+
+bool CBlockDB::GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount)
+{
+    if (!fDbCfgAddrTxIndex)
+    {
+        return false;
+    }
+    return dbAddressTxIndex.GetAddressTxCount(hashFork, dest, nTxCount);
+}
+
+bool CBlockDB::ListAddressTxHeight(const uint256& hashFork, const set<CDestination>& setDest, const int nStartHeight, set<int>& setHeight)
+{
+    if (!fDbCfgAddrTxIndex)
+    {
+        return false;
+    }
+    for (const CDestination& dest : setDest)
+    {
+        if (!dbAddressTxIndex.ListTxHeight(hashFork, dest, nStartHeight, setHeight))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CBlockDB::LoadFork()
 {
     vector<pair<uint256, uint256>> vFork;
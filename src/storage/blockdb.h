@@ -16,6 +16,7 @@
 #include "transaction.h"
 #include "txindexdb.h"
 #include "unspentdb.h"
+#include "writecache.h"
 
 namespace bigbang
 {
@@ -41,14 +42,16 @@ public:
     bool UpdateFork(const uint256& hash, const uint256& hashRefBlock, const uint256& hashForkBased,
                     const std::vector<std::pair<uint256, CTxIndex>>& vTxNew, const std::vector<uint256>& vTxDel,
                     const std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vAddrTxNew, const std::vector<CAddrTxIndex>& vAddrTxDel,
-                    const std::vector<CTxUnspent>& vAddNewUnspent, const std::vector<CTxUnspent>& vRemoveUnspent);
+                    const std::vector<CTxUnspent>& vAddNewUnspent, const std::vector<CTxUnspent>& vRemoveUnspent,
+                    const std::vector<std::pair<CDestination, CAddrInfo>>& vNewAddress = std::vector<std::pair<CDestination, CAddrInfo>>(),
+                    const std::vector<CDestination>& vRemoveAddress = std::vector<CDestination>());
     bool AddNewBlock(const CBlockOutline& outline);
+    bool AddNewBlock(const std::vector<CBlockOutline>& vOutline);
     bool RemoveBlock(const uint256& hash);
     bool UpdateDelegateContext(const uint256& hash, const CDelegateContext& ctxtDelegate);
-    bool UpdateAddressInfo(const uint256& hashFork, const std::vector<std::pair<CDestination, CAddrInfo>>& vNewAddress,
-                           const std::vector<CDestination>& vRemoveAddress);
     bool GetAddressInfo(const uint256& hashFork, const CDestination& destIn, CAddrInfo& addrInfo);
     bool WalkThroughBlock(CBlockDBWalker& walker);
+    bool LoadBlockOutline(std::vector<CBlockOutline>& vOutline, std::size_t nWorker);
     bool RetrieveTxIndex(const uint256& txid, CTxIndex& txIndex, uint256& fork);
     bool RetrieveTxIndex(const uint256& fork, const uint256& txid, CTxIndex& txIndex);
     bool RetrieveTxUnspent(const uint256& fork, const CTxOutPoint& out, CTxOut& unspent);
@@ -59,7 +62,12 @@ public:
     bool RetrieveEnroll(int height, const std::vector<uint256>& vBlockRange,
                         std::map<CDestination, CDiskPos>& mapEnrollTxPos);
     bool RetrieveAddressUnspent(const uint256& hashFork, const CDestination& dest, std::map<CTxOutPoint, CUnspentOut>& mapUnspent, uint256& hashLastBlockOut);
+    bool ListAddressUnspent(const uint256& hashFork, const CDestination& dest, const CTxOutPoint& outBegin, uint32 nMax, std::vector<std::pair<CAddrUnspentKey, CUnspentOut>>& vUnspent);
     int64 RetrieveAddressTxList(const uint256& hashFork, const CDestination& dest, const int nPrevHeight, const uint64 nPrevTxSeq, const int64 nOffset, const int64 nCount, std::map<CAddrTxIndex, CAddrTxInfo>& mapAddrTxIndex);
+    bool ListAddressTxIndex(const uint256& hashFork, const CDestination& dest, const int64 nHeightSeqCursor, const bool fReverse, const std::size_t nCount,
+                            std::vector<std::pair<CAddrTxIndex, CAddrTxInfo>>& vTxIndex);
+    bool GetAddressTxCount(const uint256& hashFork, const CDestination& dest, int64& nTxCount);
+    bool ListAddressTxHeight(const uint256& hashFork, const std::set<CDestination>& setDest, const int nStartHeight, std::set<int>& setHeight);
 
 protected:
     bool LoadFork();
@@ -74,6 +82,7 @@ protected:
     CAddressDB dbAddress;
     CAddressUnspentDB dbAddressUnspent;
     CAddressTxIndexDB dbAddressTxIndex;
+    CWriteBackFlusher flusherCache;
 };
 
 } // namespace storage
@@ -4,6 +4,8 @@
 
 #include "blockindexdb.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "leveldbeng.h"
 
 using namespace std;
@@ -46,6 +48,23 @@ bool CBlockIndexDB::AddNewBlock(const CBlockOutline& outline)
     return Write(outline.GetBlockHash(), outline);
 }
 
+bool CBlockIndexDB::AddNewBlock(const vector<CBlockOutline>& vOutline)
+{
+    if (!TxnBegin())
+    {
+        return false;
+    }
+    for (const CBlockOutline& outline : vOutline)
+    {
+        if (!Write(outline.GetBlockHash(), outline))
+        {
+            TxnAbort();
+            return false;
+        }
+    }
+    return TxnCommit();
+}
+
 bool CBlockIndexDB::RemoveBlock(const uint256& hashBlock)
 {
     return Erase(hashBlock);
@@ -61,6 +80,26 @@ bool CBlockIndexDB::WalkThroughBlock(CBlockDBWalker& walker)
     return WalkThrough(boost::bind(&CBlockIndexDB::LoadBlockWalker, this, _1, _2, boost::ref(walker)));
 }
 
+bool CBlockIndexDB::LoadBlockOutline(vector<CBlockOutline>& vOutline, size_t nWorker)
+{
+    // the iterator is sequential, so only copy the raw values out of it into a
+    // bounded batch, which the workers decode in chunks before it is refilled
+    nWorker = max(nWorker, size_t(1));
+    vector<string> vRaw(nWorker * DECODE_BATCH_CHUNK_COUNT * DECODE_CHUNK_SIZE);
+    size_t nRaw = 0;
+    bool fFail = false;
+
+    vOutline.clear();
+    if (!WalkThrough(boost::bind(&CBlockIndexDB::LoadRawWalker, this, _1, _2, boost::ref(vRaw), boost::ref(nRaw),
+                                 boost::ref(vOutline), nWorker, boost::ref(fFail)))
+        || fFail || !DecodeOutlineBatch(vRaw, nRaw, vOutline, nWorker))
+    {
+        vOutline.clear();
+        return false;
+    }
+    return true;
+}
+
 void CBlockIndexDB::Clear()
 {
     RemoveAll();
@@ -73,5 +112,70 @@ bool CBlockIndexDB::LoadBlockWalker(CBufStream& ssKey, CBufStream& ssValue, CBlo
     return walker.Walk(outline);
 }
 
+bool CBlockIndexDB::LoadRawWalker(CBufStream& ssKey, CBufStream& ssValue, vector<string>& vRaw, size_t& nRaw,
+                                  vector<CBlockOutline>& vOutline, size_t nWorker, bool& fFail)
+{
+    if (nRaw == vRaw.size() && !DecodeOutlineBatch(vRaw, nRaw, vOutline, nWorker))
+    {
+        fFail = true;
+        return false;
+    }
+    // the strings keep their capacity, so a refilled batch does not allocate
+    vRaw[nRaw++].assign(ssValue.GetData(), ssValue.GetSize());
+    return true;
+}
+
+bool CBlockIndexDB::DecodeOutlineBatch(const vector<string>& vRaw, size_t& nRaw, vector<CBlockOutline>& vOutline, size_t nWorker)
+{
+    if (nRaw == 0)
+    {
+        return true;
+    }
+    const size_t nBase = vOutline.size();
+    vOutline.resize(nBase + nRaw);
+
+    atomic<size_t> nNext(0);
+    atomic<bool> fFail(false);
+    boost::thread_group workers;
+    for (size_t i = 1; i < nWorker && i * DECODE_CHUNK_SIZE < nRaw; i++)
+    {
+        workers.create_thread(boost::bind(&CBlockIndexDB::DecodeOutline, this, boost::cref(vRaw), nRaw, &vOutline[nBase],
+                                          boost::ref(nNext), boost::ref(fFail)));
+    }
+    DecodeOutline(vRaw, nRaw, &vOutline[nBase], nNext, fFail);
+    workers.join_all();
+
+    nRaw = 0;
+    return !fFail;
+}
+
+void CBlockIndexDB::DecodeOutline(const vector<string>& vRaw, size_t nRaw, CBlockOutline* pOutline,
+                                  atomic<size_t>& nNext, atomic<bool>& fFail)
+{
+    while (!fFail)
+    {
+        size_t nBegin = nNext.fetch_add(DECODE_CHUNK_SIZE);
+        if (nBegin >= nRaw)
+        {
+            break;
+        }
+        size_t nEnd = min(nBegin + DECODE_CHUNK_SIZE, nRaw);
+        try
+        {
+            for (size_t i = nBegin; i < nEnd; i++)
+            {
+                CBufStream ss;
+                ss.Write(vRaw[i].data(), vRaw[i].size());
+                ss >> pOutline[i];
+            }
+        }
+        catch (exception& e)
+        {
+            StdError("CBlockIndexDB", "DecodeOutline: %s", e.what());
+            fFail = true;
+        }
+    }
+}
+
 } // namespace storage
 } // namespace bigbang
@@ -5,6 +5,8 @@
 #ifndef STORAGE_BLOCKINDEXDB_H
 #define STORAGE_BLOCKINDEXDB_H
 
+#include <atomic>
+
 #include "block.h"
 #include "xengine.h"
 
@@ -26,14 +28,28 @@ public:
     bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool AddNewBlock(const CBlockOutline& outline);
+    bool AddNewBlock(const std::vector<CBlockOutline>& vOutline);
     bool RemoveBlock(const uint256& hashBlock);
     bool RetrieveBlock(const uint256& hashBlock, CBlockOutline& outline);
     bool WalkThroughBlock(CBlockDBWalker& walker);
+    bool LoadBlockOutline(std::vector<CBlockOutline>& vOutline, std::size_t nWorker);
     void Clear();
 
 protected:
+    enum
+    {
+        DECODE_CHUNK_SIZE = 1024,
+        DECODE_BATCH_CHUNK_COUNT = 4
+    };
     bool LoadBlockWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                          CBlockDBWalker& walker);
+    bool LoadRawWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
+                       std::vector<std::string>& vRaw, std::size_t& nRaw,
+                       std::vector<CBlockOutline>& vOutline, std::size_t nWorker, bool& fFail);
+    bool DecodeOutlineBatch(const std::vector<std::string>& vRaw, std::size_t& nRaw,
+                            std::vector<CBlockOutline>& vOutline, std::size_t nWorker);
+    void DecodeOutline(const std::vector<std::string>& vRaw, std::size_t nRaw, CBlockOutline* pOutline,
+                       std::atomic<std::size_t>& nNext, std::atomic<bool>& fFail);
 };
 
 } // namespace storage
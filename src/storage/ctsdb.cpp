@@ -27,12 +27,15 @@ CCTSIndex::~CCTSIndex()
 {
 }
 
-bool CCTSIndex::Initialize(const boost::filesystem::path& pathCTSDB)
+bool CCTSIndex::Initialize(const boost::filesystem::path& pathCTSDB, CKVDBEngine* engine)
 {
-    CLevelDBArguments args;
-    args.path = (pathCTSDB / "index").string();
-    args.syncwrite = false;
-    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    if (engine == nullptr)
+    {
+        CLevelDBArguments args(CLevelDBArguments::PROFILE_TXINDEX);
+        args.path = (pathCTSDB / "index").string();
+        args.syncwrite = false;
+        engine = new CLevelDBEngine(args);
+    }
 
     if (!Open(engine))
     {
@@ -25,7 +25,7 @@ class CCTSIndex : public xengine::CKVDB
 public:
     CCTSIndex();
     ~CCTSIndex();
-    bool Initialize(const boost::filesystem::path& pathCTSDB);
+    bool Initialize(const boost::filesystem::path& pathCTSDB, xengine::CKVDBEngine* engine = nullptr);
     void Deinitialize();
     bool Update(const std::vector<int64>& vTime, const std::vector<CDiskPos>& vPos,
                 const std::vector<int64>& vDel);
@@ -170,7 +170,7 @@ class CCTSDB
     };
 
 public:
-    bool Initialize(const boost::filesystem::path& pathCTSDB)
+    bool Initialize(const boost::filesystem::path& pathCTSDB, xengine::CKVDBEngine* engine = nullptr)
     {
         if (!boost::filesystem::exists(pathCTSDB))
         {
@@ -182,7 +182,7 @@ public:
             return false;
         }
 
-        if (!dbIndex.Initialize(pathCTSDB))
+        if (!dbIndex.Initialize(pathCTSDB, engine))
         {
             return false;
         }
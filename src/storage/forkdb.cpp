@@ -27,7 +27,8 @@ bool CForkDB::Initialize(const boost::filesystem::path& pathData, const uint256&
     args.path = (pathData / "fork").string();
     args.syncwrite = false;
     args.files = 16;
-    args.cache = 2 << 20;
+    args.cache = 1 << 20;
+    args.buffer = 512 << 10;
 
     CLevelDBEngine* engine = new CLevelDBEngine(args);
 
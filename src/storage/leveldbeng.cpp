@@ -4,11 +4,13 @@
 
 #include "leveldbeng.h"
 
-#include <boost/filesystem/path.hpp>
+#include <boost/filesystem.hpp>
 
 #include "leveldb/cache.h"
 #include "leveldb/filter_policy.h"
 
+using namespace std;
+using namespace boost::filesystem;
 using namespace xengine;
 
 namespace bigbang
@@ -16,23 +18,53 @@ namespace bigbang
 namespace storage
 {
 
-CLevelDBArguments::CLevelDBArguments()
+CLevelDBProfile CLevelDBArguments::profiles[CLevelDBArguments::PROFILE_MAX] = {
+    CLevelDBProfile(),
+    CLevelDBProfile(),
+    CLevelDBProfile(),
+    CLevelDBProfile(),
+    CLevelDBProfile(1 << 20, 1 << 20, 8)
+};
+int CLevelDBArguments::nBloomBits = 10;
+
+CLevelDBArguments::CLevelDBArguments(int nProfile)
 {
-    cache = 32 << 20;
+    const CLevelDBProfile& profile = GetProfile(nProfile);
+    cache = profile.nCache;
+    buffer = profile.nBuffer;
     syncwrite = false;
-    files = 256;
+    files = profile.nFiles;
+    bloombits = nBloomBits;
 }
 
 CLevelDBArguments::~CLevelDBArguments()
 {
 }
 
+void CLevelDBArguments::SetProfile(int nProfile, const CLevelDBProfile& profile)
+{
+    if (nProfile >= 0 && nProfile < PROFILE_MAX)
+    {
+        profiles[nProfile] = profile;
+    }
+}
+
+const CLevelDBProfile& CLevelDBArguments::GetProfile(int nProfile)
+{
+    return profiles[(nProfile >= 0 && nProfile < PROFILE_MAX) ? nProfile : PROFILE_DEFAULT];
+}
+
+void CLevelDBArguments::SetBloomBits(int nBits)
+{
+    nBloomBits = nBits;
+}
+
 CLevelDBEngine::CLevelDBEngine(CLevelDBArguments& arguments)
   : path(arguments.path)
 {
-    options.block_cache = leveldb::NewLRUCache(arguments.cache / 2);
-    options.write_buffer_size = arguments.cache / 4;
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(arguments.cache);
+    options.write_buffer_size = arguments.buffer;
+    options.filter_policy = (arguments.bloombits > 0 ? leveldb::NewBloomFilterPolicy(arguments.bloombits) : nullptr);
     options.create_if_missing = true;
     options.compression = leveldb::kNoCompression;
     options.max_open_files = arguments.files;
@@ -221,5 +253,594 @@ bool CLevelDBEngine::MoveNext(CBufStream& ssKey, CBufStream& ssValue)
     return true;
 }
 
+bool CLevelDBEngine::MoveBefore(CBufStream& ssKey)
+{
+    delete piter;
+
+    leveldb::Slice slKey(ssKey.GetData(), ssKey.GetSize());
+
+    if ((piter = pdb->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    piter->Seek(slKey);
+    if (piter->Valid())
+    {
+        piter->Prev();
+    }
+    else
+    {
+        piter->SeekToLast();
+    }
+
+    return true;
+}
+
+bool CLevelDBEngine::MovePrev(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (piter == nullptr || !piter->Valid())
+        return false;
+
+    leveldb::Slice slKey = piter->key();
+    leveldb::Slice slValue = piter->value();
+
+    ssKey.Write(slKey.data(), slKey.size());
+    ssValue.Write(slValue.data(), slValue.size());
+
+    piter->Prev();
+
+    return true;
+}
+
+//////////////////////////////
+// CLevelDBShared
+
+#define SHARED_FORKDB_BATCH (4096)
+
+boost::mutex CLevelDBShared::mtxShared;
+std::map<std::string, std::weak_ptr<CLevelDBShared>> CLevelDBShared::mapShared;
+
+CLevelDBShared::CLevelDBShared(const CLevelDBArguments& arguments)
+  : pdb(nullptr), pbatchGroup(nullptr), fBatchAbort(false)
+{
+    options.block_cache = leveldb::NewLRUCache(arguments.cache);
+    options.write_buffer_size = arguments.buffer;
+    options.filter_policy = (arguments.bloombits > 0 ? leveldb::NewBloomFilterPolicy(arguments.bloombits) : nullptr);
+    options.create_if_missing = true;
+    options.compression = leveldb::kNoCompression;
+    options.max_open_files = arguments.files;
+
+    leveldb::Status status = leveldb::DB::Open(options, arguments.path, &pdb);
+    if (!status.ok())
+    {
+        StdError("CLevelDBShared", "Open fail, path: %s, msg: %s", arguments.path.c_str(), status.ToString().c_str());
+        pdb = nullptr;
+    }
+}
+
+CLevelDBShared::~CLevelDBShared()
+{
+    delete pbatchGroup;
+    pbatchGroup = nullptr;
+    delete pdb;
+    pdb = nullptr;
+    delete options.filter_policy;
+    options.filter_policy = nullptr;
+    delete options.block_cache;
+    options.block_cache = nullptr;
+}
+
+bool CLevelDBShared::IsSharedLayout(const boost::filesystem::path& pathData)
+{
+    return is_directory(pathData / "forkdb");
+}
+
+std::shared_ptr<CLevelDBShared> CLevelDBShared::Open(const boost::filesystem::path& pathData)
+{
+    CLevelDBArguments args;
+    GetArguments(pathData / "forkdb", args);
+
+    boost::unique_lock<boost::mutex> lock(mtxShared);
+    std::shared_ptr<CLevelDBShared> spShared = mapShared[args.path].lock();
+    if (spShared == nullptr)
+    {
+        spShared = std::make_shared<CLevelDBShared>(args);
+        if (spShared->GetDB() == nullptr)
+        {
+            return nullptr;
+        }
+        mapShared[args.path] = spShared;
+    }
+    return spShared;
+}
+
+bool CLevelDBShared::Migrate(const boost::filesystem::path& pathData)
+{
+    if (IsSharedLayout(pathData))
+    {
+        return true;
+    }
+
+    const struct
+    {
+        int nTable;
+        const char* pszDir;
+        const char* pszSubDir;
+    } tables[] = {
+        { TABLE_UNSPENT, "unspent", "" },
+        { TABLE_ADDRESS, "address", "" },
+        { TABLE_ADDRESSUNSPENT, "addressunspent", "" },
+        { TABLE_ADDRESSTXINDEX, "addresstxindex", "" },
+        { TABLE_TXINDEX, "txindex", "index" }
+    };
+
+    // build the shared db aside, it only replaces the per fork layout when complete
+    boost::filesystem::path pathTemp = pathData / "forkdb.migrate";
+    vector<boost::filesystem::path> vMigrated;
+    try
+    {
+        remove_all(pathTemp);
+
+        CLevelDBArguments args;
+        GetArguments(pathTemp, args);
+        CLevelDBShared dbShared(args);
+        if (dbShared.GetDB() == nullptr)
+        {
+            return false;
+        }
+
+        for (const auto& table : tables)
+        {
+            boost::filesystem::path pathTable = pathData / table.pszDir;
+            if (!is_directory(pathTable))
+            {
+                continue;
+            }
+            for (directory_iterator it(pathTable); it != directory_iterator(); ++it)
+            {
+                string strName = it->path().filename().string();
+                uint256 hashFork;
+                if (strName.size() != 64 || hashFork.SetHex(strName) != 64)
+                {
+                    continue;
+                }
+                boost::filesystem::path pathDB = it->path() / table.pszSubDir;
+                if (!is_directory(pathDB))
+                {
+                    continue;
+                }
+
+                leveldb::Options optionsFork;
+                leveldb::DB* pdbFork = nullptr;
+                leveldb::Status status = leveldb::DB::Open(optionsFork, pathDB.string(), &pdbFork);
+                if (!status.ok())
+                {
+                    StdError("CLevelDBShared", "Migrate: open fail, path: %s, msg: %s", pathDB.string().c_str(), status.ToString().c_str());
+                    return false;
+                }
+
+                const string strPrefix = GetPrefix(table.nTable, hashFork);
+                size_t nCount = 0;
+                leveldb::WriteBatch batch;
+                leveldb::Iterator* piter = pdbFork->NewIterator(leveldb::ReadOptions());
+                for (piter->SeekToFirst(); piter->Valid(); piter->Next())
+                {
+                    batch.Put(strPrefix + piter->key().ToString(), piter->value());
+                    if (++nCount % SHARED_FORKDB_BATCH == 0)
+                    {
+                        status = dbShared.GetDB()->Write(leveldb::WriteOptions(), &batch);
+                        batch.Clear();
+                        if (!status.ok())
+                        {
+                            break;
+                        }
+                    }
+                }
+                if (status.ok())
+                {
+                    status = piter->status();
+                }
+                if (status.ok())
+                {
+                    status = dbShared.GetDB()->Write(leveldb::WriteOptions(), &batch);
+                }
+                delete piter;
+                delete pdbFork;
+                if (!status.ok())
+                {
+                    StdError("CLevelDBShared", "Migrate: copy fail, path: %s, msg: %s", pathDB.string().c_str(), status.ToString().c_str());
+                    return false;
+                }
+
+                StdLog("CLevelDBShared", "Migrate: %s, count: %lu", pathDB.string().c_str(), nCount);
+                vMigrated.push_back(pathDB);
+            }
+        }
+
+        leveldb::WriteOptions syncoptions;
+        syncoptions.sync = true;
+        leveldb::WriteBatch batch;
+        if (!dbShared.GetDB()->Write(syncoptions, &batch).ok())
+        {
+            return false;
+        }
+    }
+    catch (exception& e)
+    {
+        StdError("CLevelDBShared", "Migrate: %s", e.what());
+        return false;
+    }
+
+    try
+    {
+        rename(pathTemp, pathData / "forkdb");
+        for (const boost::filesystem::path& pathDB : vMigrated)
+        {
+            remove_all(pathDB);
+        }
+    }
+    catch (exception& e)
+    {
+        StdError("CLevelDBShared", "Migrate: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+xengine::CKVDBEngine* CLevelDBShared::NewForkEngine(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared,
+                                                    int nTable, const uint256& hashFork)
+{
+    if (spShared != nullptr)
+    {
+        return new CLevelDBPrefixEngine(spShared, GetPrefix(nTable, hashFork));
+    }
+
+    int nProfile = CLevelDBArguments::PROFILE_ADDRESS;
+    if (nTable == TABLE_UNSPENT)
+    {
+        nProfile = CLevelDBArguments::PROFILE_UNSPENT;
+    }
+    else if (nTable == TABLE_TXINDEX)
+    {
+        nProfile = CLevelDBArguments::PROFILE_TXINDEX;
+    }
+
+    CLevelDBArguments args(nProfile);
+    args.path = pathDB.string();
+    args.syncwrite = false;
+    return new CLevelDBEngine(args);
+}
+
+void CLevelDBShared::GetArguments(const boost::filesystem::path& pathShared, CLevelDBArguments& arguments)
+{
+    // the shared db holds every fork table, so it gets their budgets combined
+    const int nProfiles[] = { CLevelDBArguments::PROFILE_UNSPENT, CLevelDBArguments::PROFILE_ADDRESS, CLevelDBArguments::PROFILE_TXINDEX };
+    arguments.path = pathShared.string();
+    arguments.cache = 0;
+    arguments.buffer = 0;
+    arguments.files = 0;
+    for (int nProfile : nProfiles)
+    {
+        const CLevelDBProfile& profile = CLevelDBArguments::GetProfile(nProfile);
+        arguments.cache += profile.nCache;
+        arguments.buffer += profile.nBuffer;
+        arguments.files += profile.nFiles;
+    }
+    arguments.syncwrite = false;
+}
+
+std::string CLevelDBShared::GetPrefix(int nTable, const uint256& hashFork)
+{
+    string strPrefix(1, (char)nTable);
+    strPrefix.append((const char*)hashFork.begin(), hashFork.size());
+    return strPrefix;
+}
+
+bool CLevelDBShared::BatchBegin()
+{
+    boost::unique_lock<boost::mutex> lock(mtxBatch);
+    if (pbatchGroup != nullptr || pdb == nullptr)
+    {
+        return false;
+    }
+    pbatchGroup = new leveldb::WriteBatch();
+    idBatch = boost::this_thread::get_id();
+    fBatchAbort = false;
+    return true;
+}
+
+bool CLevelDBShared::BatchCommit()
+{
+    leveldb::WriteBatch* pbatch = nullptr;
+    bool fAbort = false;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxBatch);
+        pbatch = pbatchGroup;
+        fAbort = fBatchAbort;
+        pbatchGroup = nullptr;
+        idBatch = boost::thread::id();
+    }
+    if (pbatch == nullptr)
+    {
+        return false;
+    }
+
+    bool fRet = false;
+    if (!fAbort)
+    {
+        leveldb::WriteOptions syncoptions;
+        syncoptions.sync = true;
+        leveldb::Status status = pdb->Write(syncoptions, pbatch);
+        if (!(fRet = status.ok()))
+        {
+            StdError("CLevelDBShared", "BatchCommit: write fail, msg: %s", status.ToString().c_str());
+        }
+    }
+    delete pbatch;
+    return fRet;
+}
+
+void CLevelDBShared::BatchAbort()
+{
+    boost::unique_lock<boost::mutex> lock(mtxBatch);
+    delete pbatchGroup;
+    pbatchGroup = nullptr;
+    idBatch = boost::thread::id();
+}
+
+leveldb::WriteBatch* CLevelDBShared::JoinBatch()
+{
+    boost::unique_lock<boost::mutex> lock(mtxBatch);
+    if (pbatchGroup != nullptr && idBatch == boost::this_thread::get_id())
+    {
+        return pbatchGroup;
+    }
+    return nullptr;
+}
+
+void CLevelDBShared::AbortJoined()
+{
+    boost::unique_lock<boost::mutex> lock(mtxBatch);
+    fBatchAbort = true;
+}
+
+//////////////////////////////
+// CLevelDBPrefixEngine
+
+CLevelDBPrefixEngine::CLevelDBPrefixEngine(std::shared_ptr<CLevelDBShared> spSharedIn, const std::string& strPrefixIn)
+  : spShared(spSharedIn), strPrefix(strPrefixIn), piter(nullptr), pbatch(nullptr), fJoined(false)
+{
+    readoptions.verify_checksums = true;
+
+    writeoptions.sync = false;
+    batchoptions.sync = true;
+}
+
+CLevelDBPrefixEngine::~CLevelDBPrefixEngine()
+{
+    Close();
+}
+
+bool CLevelDBPrefixEngine::Open()
+{
+    return (spShared != nullptr && spShared->GetDB() != nullptr);
+}
+
+void CLevelDBPrefixEngine::Close()
+{
+    if (!fJoined)
+    {
+        delete pbatch;
+    }
+    pbatch = nullptr;
+    fJoined = false;
+    delete piter;
+    piter = nullptr;
+}
+
+bool CLevelDBPrefixEngine::TxnBegin()
+{
+    if (pbatch != nullptr)
+    {
+        return false;
+    }
+    if ((pbatch = spShared->JoinBatch()) != nullptr)
+    {
+        fJoined = true;
+        return true;
+    }
+    return ((pbatch = new leveldb::WriteBatch()) != nullptr);
+}
+
+bool CLevelDBPrefixEngine::TxnCommit()
+{
+    if (fJoined)
+    {
+        // written with the group batch
+        pbatch = nullptr;
+        fJoined = false;
+        return true;
+    }
+    if (pbatch != nullptr)
+    {
+        leveldb::Status status = spShared->GetDB()->Write(batchoptions, pbatch);
+        delete pbatch;
+        pbatch = nullptr;
+        return status.ok();
+    }
+    return false;
+}
+
+void CLevelDBPrefixEngine::TxnAbort()
+{
+    if (fJoined)
+    {
+        spShared->AbortJoined();
+        pbatch = nullptr;
+        fJoined = false;
+        return;
+    }
+    delete pbatch;
+    pbatch = nullptr;
+}
+
+bool CLevelDBPrefixEngine::Get(CBufStream& ssKey, CBufStream& ssValue)
+{
+    std::string strValue;
+    leveldb::Status status = spShared->GetDB()->Get(readoptions, GetKey(ssKey), &strValue);
+    if (status.ok())
+    {
+        ssValue.Write(strValue.data(), strValue.size());
+        return true;
+    }
+    return false;
+}
+
+bool CLevelDBPrefixEngine::Put(CBufStream& ssKey, CBufStream& ssValue, bool fOverwrite)
+{
+    std::string strKey = GetKey(ssKey);
+    if (!fOverwrite)
+    {
+        std::string strValue;
+        leveldb::Status status = spShared->GetDB()->Get(readoptions, strKey, &strValue);
+        if (status.ok() || !status.IsNotFound())
+        {
+            return false;
+        }
+    }
+
+    leveldb::Slice slValue(ssValue.GetData(), ssValue.GetSize());
+    if (pbatch != nullptr)
+    {
+        pbatch->Put(strKey, slValue);
+        return true;
+    }
+
+    return spShared->GetDB()->Put(writeoptions, strKey, slValue).ok();
+}
+
+bool CLevelDBPrefixEngine::Remove(CBufStream& ssKey)
+{
+    std::string strKey = GetKey(ssKey);
+    if (pbatch != nullptr)
+    {
+        pbatch->Delete(strKey);
+        return true;
+    }
+
+    return spShared->GetDB()->Delete(writeoptions, strKey).ok();
+}
+
+bool CLevelDBPrefixEngine::RemoveAll()
+{
+    Close();
+
+    leveldb::DB* pdb = spShared->GetDB();
+    leveldb::Iterator* pit = pdb->NewIterator(readoptions);
+    leveldb::WriteBatch batch;
+    size_t nCount = 0;
+    bool fRet = true;
+    for (pit->Seek(strPrefix); pit->Valid() && pit->key().starts_with(strPrefix); pit->Next())
+    {
+        batch.Delete(pit->key());
+        if (++nCount % SHARED_FORKDB_BATCH == 0)
+        {
+            fRet = pdb->Write(writeoptions, &batch).ok();
+            batch.Clear();
+            if (!fRet)
+            {
+                break;
+            }
+        }
+    }
+    delete pit;
+
+    return (fRet && pdb->Write(batchoptions, &batch).ok());
+}
+
+bool CLevelDBPrefixEngine::MoveFirst()
+{
+    delete piter;
+
+    if ((piter = spShared->GetDB()->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    piter->Seek(strPrefix);
+
+    return true;
+}
+
+bool CLevelDBPrefixEngine::MoveTo(CBufStream& ssKey)
+{
+    delete piter;
+
+    if ((piter = spShared->GetDB()->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    piter->Seek(GetKey(ssKey));
+
+    return true;
+}
+
+bool CLevelDBPrefixEngine::MoveNext(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (piter == nullptr || !piter->Valid() || !piter->key().starts_with(strPrefix))
+        return false;
+
+    leveldb::Slice slKey = piter->key();
+    leveldb::Slice slValue = piter->value();
+
+    ssKey.Write(slKey.data() + strPrefix.size(), slKey.size() - strPrefix.size());
+    ssValue.Write(slValue.data(), slValue.size());
+
+    piter->Next();
+
+    return true;
+}
+
+bool CLevelDBPrefixEngine::MoveBefore(CBufStream& ssKey)
+{
+    delete piter;
+
+    if ((piter = spShared->GetDB()->NewIterator(readoptions)) == nullptr)
+    {
+        return false;
+    }
+
+    // keys of this table sort below any key beyond the end of the db
+    piter->Seek(GetKey(ssKey));
+    if (piter->Valid())
+    {
+        piter->Prev();
+    }
+    else
+    {
+        piter->SeekToLast();
+    }
+
+    return true;
+}
+
+bool CLevelDBPrefixEngine::MovePrev(CBufStream& ssKey, CBufStream& ssValue)
+{
+    if (piter == nullptr || !piter->Valid() || !piter->key().starts_with(strPrefix))
+        return false;
+
+    leveldb::Slice slKey = piter->key();
+    leveldb::Slice slValue = piter->value();
+
+    ssKey.Write(slKey.data() + strPrefix.size(), slKey.size() - strPrefix.size());
+    ssValue.Write(slValue.data(), slValue.size());
+
+    piter->Prev();
+
+    return true;
+}
+
 } // namespace storage
 } // namespace bigbang
@@ -5,9 +5,14 @@
 #ifndef STORAGE_LEVELDBENG_H
 #define STORAGE_LEVELDBENG_H
 #include <boost/filesystem/path.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
+#include <map>
+#include <memory>
 
+#include "uint256.h"
 #include "xengine.h"
 
 namespace bigbang
@@ -15,17 +20,51 @@ namespace bigbang
 namespace storage
 {
 
+// Cache, write buffer and file budget of one kind of table
+class CLevelDBProfile
+{
+public:
+    CLevelDBProfile(size_t nCacheIn = 16 << 20, size_t nBufferIn = 8 << 20, int nFilesIn = 256)
+      : nCache(nCacheIn), nBuffer(nBufferIn), nFiles(nFilesIn) {}
+
+public:
+    size_t nCache;
+    size_t nBuffer;
+    int nFiles;
+};
+
 class CLevelDBArguments
 {
 public:
-    CLevelDBArguments();
+    enum
+    {
+        PROFILE_DEFAULT = 0,
+        PROFILE_UNSPENT = 1,
+        PROFILE_ADDRESS = 2,
+        PROFILE_TXINDEX = 3,
+        PROFILE_WALLET = 4,
+        PROFILE_MAX = 5
+    };
+
+public:
+    CLevelDBArguments(int nProfile = PROFILE_DEFAULT);
     ~CLevelDBArguments();
+    // set before any database is opened
+    static void SetProfile(int nProfile, const CLevelDBProfile& profile);
+    static const CLevelDBProfile& GetProfile(int nProfile);
+    static void SetBloomBits(int nBits);
 
 public:
     std::string path;
     size_t cache;
+    size_t buffer;
     bool syncwrite;
     int files;
+    int bloombits;
+
+protected:
+    static CLevelDBProfile profiles[PROFILE_MAX];
+    static int nBloomBits;
 };
 
 class CLevelDBEngine : public xengine::CKVDBEngine
@@ -46,6 +85,8 @@ public:
     bool MoveFirst() override;
     bool MoveTo(xengine::CBufStream& ssKey) override;
     bool MoveNext(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
+    bool MoveBefore(xengine::CBufStream& ssKey) override;
+    bool MovePrev(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
 
 protected:
     std::string path;
@@ -58,6 +99,95 @@ protected:
     leveldb::WriteOptions batchoptions;
 };
 
+// One LevelDB in <datadir>/forkdb holding the per fork tables of every fork.
+// Keys are prefixed with the table id and the fork hash, so all forks share
+// one block cache, write buffer and set of file handles.
+class CLevelDBShared
+{
+public:
+    enum
+    {
+        TABLE_UNSPENT = 1,
+        TABLE_ADDRESS = 2,
+        TABLE_ADDRESSUNSPENT = 3,
+        TABLE_ADDRESSTXINDEX = 4,
+        TABLE_TXINDEX = 5
+    };
+
+public:
+    CLevelDBShared(const CLevelDBArguments& arguments);
+    ~CLevelDBShared();
+    leveldb::DB* GetDB()
+    {
+        return pdb;
+    }
+    static bool IsSharedLayout(const boost::filesystem::path& pathData);
+    static std::shared_ptr<CLevelDBShared> Open(const boost::filesystem::path& pathData);
+    static bool Migrate(const boost::filesystem::path& pathData);
+    static xengine::CKVDBEngine* NewForkEngine(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared,
+                                               int nTable, const uint256& hashFork);
+    // Fork engine transactions begun on the calling thread join one batch,
+    // which is written atomically by BatchCommit
+    bool BatchBegin();
+    bool BatchCommit();
+    void BatchAbort();
+    leveldb::WriteBatch* JoinBatch();
+    void AbortJoined();
+
+protected:
+    static void GetArguments(const boost::filesystem::path& pathShared, CLevelDBArguments& arguments);
+    static std::string GetPrefix(int nTable, const uint256& hashFork);
+
+protected:
+    leveldb::DB* pdb;
+    leveldb::Options options;
+    boost::mutex mtxBatch;
+    leveldb::WriteBatch* pbatchGroup;
+    boost::thread::id idBatch;
+    bool fBatchAbort;
+    static boost::mutex mtxShared;
+    static std::map<std::string, std::weak_ptr<CLevelDBShared>> mapShared;
+};
+
+// Key range of one fork table in the shared LevelDB
+class CLevelDBPrefixEngine : public xengine::CKVDBEngine
+{
+public:
+    CLevelDBPrefixEngine(std::shared_ptr<CLevelDBShared> spSharedIn, const std::string& strPrefixIn);
+    ~CLevelDBPrefixEngine();
+
+    bool Open() override;
+    void Close() override;
+    bool TxnBegin() override;
+    bool TxnCommit() override;
+    void TxnAbort() override;
+    bool Get(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
+    bool Put(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue, bool fOverwrite) override;
+    bool Remove(xengine::CBufStream& ssKey) override;
+    bool RemoveAll() override;
+    bool MoveFirst() override;
+    bool MoveTo(xengine::CBufStream& ssKey) override;
+    bool MoveNext(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
+    bool MoveBefore(xengine::CBufStream& ssKey) override;
+    bool MovePrev(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue) override;
+
+protected:
+    std::string GetKey(xengine::CBufStream& ssKey) const
+    {
+        return strPrefix + std::string(ssKey.GetData(), ssKey.GetSize());
+    }
+
+protected:
+    std::shared_ptr<CLevelDBShared> spShared;
+    std::string strPrefix;
+    leveldb::Iterator* piter;
+    leveldb::WriteBatch* pbatch;
+    bool fJoined;
+    leveldb::ReadOptions readoptions;
+    leveldb::WriteOptions writeoptions;
+    leveldb::WriteOptions batchoptions;
+};
+
 } // namespace storage
 } // namespace bigbang
 
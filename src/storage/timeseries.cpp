@@ -14,6 +14,11 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #endif*/
+#if !defined(WIN32) && !defined(_WIN32)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
 
 using namespace std;
 using namespace boost::filesystem;
@@ -24,16 +29,45 @@ namespace bigbang
 namespace storage
 {
 
+//////////////////////////////
+// CMappedFile
+
+bool CMappedFile::Open(const string& strPath)
+{
+    try
+    {
+        size_t nFileSize = file_size(path(strPath));
+        if (nFileSize > 0)
+        {
+            boost::interprocess::file_mapping mapping(strPath.c_str(), boost::interprocess::read_only);
+            boost::interprocess::mapped_region(mapping, boost::interprocess::read_only, 0, nFileSize).swap(region);
+        }
+        nSize = nFileSize;
+    }
+    catch (exception& e)
+    {
+        StdError("CMappedFile", "Open: map file fail, file: %s, msg: %s", strPath.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
 //////////////////////////////
 // CTimeSeriesBase
 
+const uint32 CTimeSeriesBase::nMagicNum = 0x5E33A1EF;
+
 CTimeSeriesBase::CTimeSeriesBase()
+  : fpAppend(nullptr), nAppendFile(0), nAppendSize(0), nFlushedEnd(~(uint64)0),
+    nSyncRecords(0), nSyncInterval(0), nUnsyncedRecords(0), nLastSyncTime(0)
 {
+    nFirstFile = 0;
     nLastFile = 0;
 }
 
 CTimeSeriesBase::~CTimeSeriesBase()
 {
+    ResetAppender();
 }
 
 bool CTimeSeriesBase::Initialize(const path& pathLocationIn, const string& strPrefixIn)
@@ -48,15 +82,47 @@ bool CTimeSeriesBase::Initialize(const path& pathLocationIn, const string& strPr
         return false;
     }
 
+    ResetAppender();
     pathLocation = pathLocationIn;
     strPrefix = strPrefixIn;
-    nLastFile = 1;
+    nFirstFile = 1;
+    if (!exists(pathLocation / FileName(nFirstFile)))
+    {
+        // a snapshot may ship the later files only, appending goes on after them
+        for (directory_iterator it(pathLocation); it != directory_iterator(); ++it)
+        {
+            string strName = it->path().filename().string();
+            uint32 nFile = 0;
+            if (strName.size() == strPrefix.size() + 11 && strName.compare(0, strPrefix.size() + 1, strPrefix + "_") == 0
+                && sscanf(strName.c_str() + strPrefix.size() + 1, "%6u.dat", &nFile) == 1 && nFile > 0
+                && FileName(nFile) == strName && (nFirstFile == 1 || nFile < nFirstFile))
+            {
+                nFirstFile = nFile;
+            }
+        }
+    }
+    nLastFile = nFirstFile;
 
     return CheckDiskSpace();
 }
 
 void CTimeSeriesBase::Deinitialize()
 {
+    ResetAppender();
+}
+
+void CTimeSeriesBase::SetSyncPolicy(uint32 nSyncRecordsIn, uint32 nSyncIntervalIn)
+{
+    boost::unique_lock<boost::mutex> lock(mtxWriter);
+    nSyncRecords = nSyncRecordsIn;
+    nSyncInterval = nSyncIntervalIn;
+    nLastSyncTime = GetTime();
+}
+
+bool CTimeSeriesBase::Flush()
+{
+    boost::unique_lock<boost::mutex> lock(mtxWriter);
+    return FlushAppender();
 }
 
 bool CTimeSeriesBase::CheckDiskSpace()
@@ -221,13 +287,150 @@ bool CTimeSeriesBase::RepairFile(uint32 nFile, uint32 nOffset)
     }
 }
 
+void CTimeSeriesBase::FlushPending(const CDiskPos& pos)
+{
+    if ((((uint64)pos.nFile << 32) | pos.nOffset) >= nFlushedEnd)
+    {
+        boost::unique_lock<boost::mutex> lock(mtxWriter);
+        FlushAppender();
+    }
+}
+
+void CTimeSeriesBase::ResetAppender()
+{
+    boost::unique_lock<boost::mutex> lock(mtxWriter);
+    CloseAppender();
+}
+
+bool CTimeSeriesBase::OpenAppender()
+{
+    if (fpAppend != nullptr && nAppendSize < MAX_FILE_SIZE - MAX_CHUNK_SIZE - 8)
+    {
+        return true;
+    }
+    // the full file keeps its buffered records until they are written
+    if (fpAppend != nullptr && !FlushAppender())
+    {
+        return false;
+    }
+    CloseAppender();
+
+    uint32 nFile;
+    string pathFile;
+    if (!GetLastFilePath(nFile, pathFile))
+    {
+        return false;
+    }
+    try
+    {
+        nAppendSize = file_size(path(pathFile));
+    }
+    catch (exception& e)
+    {
+        StdError("TimeSeriesBase", "OpenAppender: get file size fail, file: %s, msg: %s", pathFile.c_str(), e.what());
+        return false;
+    }
+    fpAppend = fopen(pathFile.c_str(), "ab");
+    if (fpAppend == nullptr)
+    {
+        StdError("TimeSeriesBase", "OpenAppender: fopen fail, file: %s", pathFile.c_str());
+        return false;
+    }
+    // records are already gathered in ssAppend
+    setvbuf(fpAppend, nullptr, _IONBF, 0);
+    nAppendFile = nFile;
+    nFlushedEnd = ((uint64)nAppendFile << 32) | nAppendSize;
+    return true;
+}
+
+bool CTimeSeriesBase::FlushAppender()
+{
+    return FlushAppender(ssAppend.GetSize());
+}
+
+bool CTimeSeriesBase::FlushAppender(size_t nLength)
+{
+    // bytes past nLength are a partly serialized record and are dropped. Records
+    // that are not written stay in the buffer, their positions are already handed out
+    if (fpAppend == nullptr)
+    {
+        return true;
+    }
+    size_t nWritten = (nLength > 0 ? fwrite(ssAppend.GetData(), 1, nLength, fpAppend) : 0);
+    if (nWritten != nLength)
+    {
+        StdError("TimeSeriesBase", "FlushAppender: fwrite fail, file: %d, written: %lu, length: %lu", nAppendFile, nWritten, nLength);
+        TruncateAppender(nLength);
+        ssAppend.consume(nWritten);
+        clearerr(fpAppend);
+        nFlushedEnd = ((uint64)nAppendFile << 32) | (nAppendSize - ssAppend.GetSize());
+        return false;
+    }
+    ssAppend.Clear();
+    nFlushedEnd = ((uint64)nAppendFile << 32) | nAppendSize;
+
+    if (nUnsyncedRecords > 0
+        && ((nSyncRecords > 0 && nUnsyncedRecords >= nSyncRecords)
+            || (nSyncInterval > 0 && GetTime() - nLastSyncTime >= nSyncInterval)))
+    {
+        return SyncAppender();
+    }
+    return true;
+}
+
+void CTimeSeriesBase::TruncateAppender(size_t nLength)
+{
+    if (nLength < ssAppend.GetSize())
+    {
+        CBufStream ssKeep;
+        ssKeep.Write(ssAppend.GetData(), nLength);
+        ssAppend.Clear();
+        ssAppend.Write(ssKeep.GetData(), ssKeep.GetSize());
+    }
+}
+
+bool CTimeSeriesBase::SyncAppender()
+{
+#if !defined(WIN32) && !defined(_WIN32)
+    int nRet = fsync(fileno(fpAppend));
+#else
+    int nRet = _commit(_fileno(fpAppend));
+#endif
+    if (nRet != 0)
+    {
+        StdError("TimeSeriesBase", "SyncAppender: sync fail, file: %d", nAppendFile);
+        return false;
+    }
+    nUnsyncedRecords = 0;
+    nLastSyncTime = GetTime();
+    return true;
+}
+
+void CTimeSeriesBase::CloseAppender()
+{
+    if (fpAppend != nullptr)
+    {
+        if (!FlushAppender() && ssAppend.GetSize() > 0)
+        {
+            StdError("TimeSeriesBase", "CloseAppender: drop %lu unwritten bytes, file: %d", ssAppend.GetSize(), nAppendFile);
+            ssAppend.Clear();
+        }
+        else if (nUnsyncedRecords > 0 && (nSyncRecords > 0 || nSyncInterval > 0))
+        {
+            SyncAppender();
+        }
+        fclose(fpAppend);
+        fpAppend = nullptr;
+    }
+    nUnsyncedRecords = 0;
+    nFlushedEnd = ~(uint64)0;
+}
+
 //////////////////////////////
 // CTimeSeriesCached
 
-const uint32 CTimeSeriesCached::nMagicNum = 0x5E33A1EF;
-
 CTimeSeriesCached::CTimeSeriesCached()
-  : cacheStream(FILE_CACHE_SIZE)
+  : cacheObject(FILE_CACHE_SIZE)
 {
 }
 
@@ -243,58 +446,78 @@ bool CTimeSeriesCached::Initialize(const path& pathLocationIn, const string& str
         return false;
     }
 
-    {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        ResetCache();
-    }
+    cacheObject.Clear();
     return true;
 }
 
 void CTimeSeriesCached::Deinitialize()
 {
-    boost::unique_lock<boost::mutex> lock(mtxCache);
-
-    ResetCache();
+    CTimeSeriesBase::Deinitialize();
+    cacheObject.Clear();
+    ResetMappedFile();
 }
 
-void CTimeSeriesCached::ResetCache()
+void CTimeSeriesCached::SetCacheSize(size_t nCacheSize)
 {
-    cacheStream.Clear();
-    mapCachePos.clear();
+    cacheObject.SetCapacity(nCacheSize);
 }
 
-bool CTimeSeriesCached::VacateCache(uint32 nNeeded)
+void CTimeSeriesCached::GetCacheStat(CCacheStat& stat)
 {
-    const size_t nHdrSize = 12;
+    cacheObject.GetStat(stat);
+}
 
-    while (cacheStream.GetBufFreeSpace() < nNeeded + nHdrSize)
+std::shared_ptr<CMappedFile> CTimeSeriesCached::GetMappedFile(uint32 nFile, size_t nEnd)
+{
     {
-        CDiskPos diskpos;
-        uint32 nSize = 0;
-
-        try
+        boost::shared_lock<boost::shared_mutex> rlock(mtxMapped);
+        map<uint32, std::shared_ptr<CMappedFile>>::iterator it = mapMappedFile.find(nFile);
+        if (it != mapMappedFile.end() && it->second->GetSize() >= nEnd)
         {
-            cacheStream.Rewind();
-            cacheStream >> diskpos >> nSize;
+            return it->second;
         }
-        catch (exception& e)
+    }
+
+    boost::unique_lock<boost::shared_mutex> wlock(mtxMapped);
+    map<uint32, std::shared_ptr<CMappedFile>>::iterator it = mapMappedFile.find(nFile);
+    if (it != mapMappedFile.end() && it->second->GetSize() >= nEnd)
+    {
+        return it->second;
+    }
+
+    // the file grew since it was mapped, readers keep the old mapping until they finish
+    string pathFile;
+    if (!GetFilePath(nFile, pathFile))
+    {
+        return nullptr;
+    }
+    if (it != mapMappedFile.end())
+    {
+        boost::system::error_code ec;
+        uint64 nFileSize = file_size(path(pathFile), ec);
+        if (ec || nFileSize <= it->second->GetSize())
         {
-            StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
+            return nullptr;
         }
-
-        mapCachePos.erase(diskpos);
-        cacheStream.Consume(nSize + nHdrSize);
     }
-    return true;
+    std::shared_ptr<CMappedFile> spFile(new CMappedFile);
+    if (!spFile->Open(pathFile))
+    {
+        return nullptr;
+    }
+    mapMappedFile[nFile] = spFile;
+    return (spFile->GetSize() >= nEnd ? spFile : nullptr);
+}
+
+void CTimeSeriesCached::ResetMappedFile()
+{
+    boost::unique_lock<boost::shared_mutex> wlock(mtxMapped);
+    mapMappedFile.clear();
 }
 
 //////////////////////////////
 // CTimeSeriesChunk
 
-const uint32 CTimeSeriesChunk::nMagicNum = 0x5E33A1EF;
-
 CTimeSeriesChunk::CTimeSeriesChunk()
 {
 }
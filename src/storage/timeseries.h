@@ -6,16 +6,62 @@
 #define STORAGE_TIMESERIES_H
 
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
+#include <memory>
+#include <typeinfo>
 #include <xengine.h>
 
 #include "uint256.h"
 
+class CBlock;
+class CBlockEx;
+
 namespace bigbang
 {
 namespace storage
 {
 
+// Types that are written as whole records, a read of them starts at a record and
+// its frame is checked. Other reads, such as txs in a block, point into a record.
+template <typename T>
+struct CTimeSeriesRecord
+{
+    enum
+    {
+        value = false
+    };
+};
+
+template <>
+struct CTimeSeriesRecord<CBlock>
+{
+    enum
+    {
+        value = true
+    };
+};
+
+template <>
+struct CTimeSeriesRecord<CBlockEx>
+{
+    enum
+    {
+        value = true
+    };
+};
+
+template <>
+struct CTimeSeriesRecord<CBlockHeaderRecord>
+{
+    enum
+    {
+        value = true
+    };
+};
+
 class CDiskPos
 {
     friend class xengine::CStream;
@@ -43,6 +89,12 @@ public:
     {
         return (nFile < b.nFile || (nFile == b.nFile && nOffset < b.nOffset));
     }
+    friend std::size_t hash_value(const CDiskPos& pos)
+    {
+        std::size_t seed = pos.nOffset;
+        boost::hash_combine(seed, pos.nFile);
+        return seed;
+    }
 
 protected:
     template <typename O>
@@ -53,6 +105,33 @@ protected:
     }
 };
 
+// Deserialized object of any type, only handed back as the type it was stored with
+class CCachedObject
+{
+public:
+    CCachedObject()
+      : pType(nullptr) {}
+    template <typename T>
+    CCachedObject(const T& t)
+      : pType(&typeid(T)), spObject(std::make_shared<T>(t))
+    {
+    }
+    template <typename T>
+    bool Get(T& t) const
+    {
+        if (pType == nullptr || *pType != typeid(T))
+        {
+            return false;
+        }
+        t = *std::static_pointer_cast<const T>(spObject);
+        return true;
+    }
+
+protected:
+    const std::type_info* pType;
+    std::shared_ptr<const void> spObject;
+};
+
 template <typename T>
 class CTSWalker
 {
@@ -60,6 +139,26 @@ public:
     virtual bool Walk(const T& t, uint32 nFile, uint32 nOffset) = 0;
 };
 
+class CMappedFile
+{
+public:
+    CMappedFile()
+      : nSize(0) {}
+    bool Open(const std::string& strPath);
+    const char* GetData() const
+    {
+        return static_cast<const char*>(region.get_address());
+    }
+    std::size_t GetSize() const
+    {
+        return nSize;
+    }
+
+protected:
+    boost::interprocess::mapped_region region;
+    std::size_t nSize;
+};
+
 class CTimeSeriesBase
 {
 public:
@@ -67,6 +166,13 @@ public:
     ~CTimeSeriesBase();
     virtual bool Initialize(const boost::filesystem::path& pathLocationIn, const std::string& strPrefixIn);
     virtual void Deinitialize();
+    void SetSyncPolicy(uint32 nSyncRecordsIn, uint32 nSyncIntervalIn);
+    bool Flush();
+    // files before the first one were left out of a snapshot
+    uint32 GetFirstFile() const
+    {
+        return nFirstFile;
+    }
 
 protected:
     bool CheckDiskSpace();
@@ -76,16 +182,78 @@ protected:
     bool RemoveFollowUpFile(uint32 nBeginFile);
     bool TruncateFile(const std::string& pathFile, uint32 nOffset);
     bool RepairFile(uint32 nFile, uint32 nOffset);
+    void FlushPending(const CDiskPos& pos);
+    void ResetAppender();
+    // Records are appended to a user space buffer of the last file, which is
+    // written out when it is full, on Flush, or when a reader reaches into it.
+    // If writing out a full buffer fails the record is taken back and false is
+    // returned, so pos must not be stored then. The caller holds mtxWriter.
+    template <typename T>
+    bool Append(const T& t, CDiskPos& pos, uint32& nSize)
+    {
+        if (!OpenAppender())
+        {
+            return false;
+        }
+        std::size_t nBuffered = ssAppend.GetSize();
+        try
+        {
+            nSize = ssAppend.GetSerializeSize(t);
+            ssAppend << nMagicNum << nSize << t;
+        }
+        catch (std::exception& e)
+        {
+            xengine::StdError(__PRETTY_FUNCTION__, e.what());
+            FlushAppender(nBuffered);
+            return false;
+        }
+        pos.nFile = nAppendFile;
+        pos.nOffset = nAppendSize + 8;
+        nAppendSize += nSize + 8;
+        ++nUnsyncedRecords;
+        if (ssAppend.GetSize() < WRITE_BUFFER_SIZE || FlushAppender())
+        {
+            return true;
+        }
+        // a record partly in the file already can only be completed by a later flush
+        if (ssAppend.GetSize() < nSize + 8)
+        {
+            return true;
+        }
+        TruncateAppender(ssAppend.GetSize() - nSize - 8);
+        nAppendSize -= nSize + 8;
+        --nUnsyncedRecords;
+        return false;
+    }
+    bool OpenAppender();
+    bool FlushAppender();
+    bool FlushAppender(std::size_t nLength);
+    void TruncateAppender(std::size_t nLength);
+    bool SyncAppender();
+    void CloseAppender();
 
 protected:
     enum
     {
         MAX_FILE_SIZE = 0x7F000000,
-        MAX_CHUNK_SIZE = 0x200000
+        MAX_CHUNK_SIZE = 0x200000,
+        WRITE_BUFFER_SIZE = 0x100000
     };
     boost::filesystem::path pathLocation;
     std::string strPrefix;
+    uint32 nFirstFile;
     uint32 nLastFile;
+    boost::mutex mtxWriter;
+    FILE* fpAppend;
+    uint32 nAppendFile;
+    uint32 nAppendSize;
+    xengine::CBufStream ssAppend;
+    std::atomic<uint64> nFlushedEnd;
+    uint32 nSyncRecords;
+    uint32 nSyncInterval;
+    uint32 nUnsyncedRecords;
+    int64 nLastSyncTime;
+    static const uint32 nMagicNum;
 };
 
 class CTimeSeriesCached : public CTimeSeriesBase
@@ -95,143 +263,96 @@ public:
     ~CTimeSeriesCached();
     bool Initialize(const boost::filesystem::path& pathLocationIn, const std::string& strPrefixIn);
     void Deinitialize();
+    void SetCacheSize(std::size_t nCacheSize);
+    void GetCacheStat(xengine::CCacheStat& stat);
     template <typename T>
     bool Write(const T& t, uint32& nFile, uint32& nOffset, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        std::string pathFile;
-        if (!GetLastFilePath(nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.SeekToEnd();
-            uint32 nSize = fs.GetSerializeSize(t);
-            fs << nMagicNum << nSize;
-            nOffset = fs.GetCurPos();
-            fs << t;
-        }
-        catch (std::exception& e)
+        CDiskPos pos;
+        if (!Write(t, pos, fWriteCache))
         {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
             return false;
         }
-        if (fWriteCache)
-        {
-            if (!WriteToCache(t, CDiskPos(nFile, nOffset)))
-            {
-                ResetCache();
-            }
-        }
+        nFile = pos.nFile;
+        nOffset = pos.nOffset;
         return true;
     }
     template <typename T>
     bool Write(const T& t, CDiskPos& pos, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        std::string pathFile;
-        if (!GetLastFilePath(pos.nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.SeekToEnd();
-            uint32 nSize = fs.GetSerializeSize(t);
-            fs << nMagicNum << nSize;
-            pos.nOffset = fs.GetCurPos();
-            fs << t;
-        }
-        catch (std::exception& e)
+        uint32 nSize = 0;
         {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
+            boost::unique_lock<boost::mutex> lock(mtxWriter);
+            if (!Append(t, pos, nSize))
+            {
+                return false;
+            }
         }
         if (fWriteCache)
         {
-            if (!WriteToCache(t, pos))
-            {
-                ResetCache();
-            }
+            WriteToCache(t, pos, nSize);
         }
         return true;
     }
     template <typename T>
     bool Read(T& t, uint32 nFile, uint32 nOffset, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
-        if (ReadFromCache(t, CDiskPos(nFile, nOffset)))
-        {
-            return true;
-        }
-
-        std::string pathFile;
-        if (!GetFilePath(nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            // Open history file to read
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.Seek(nOffset);
-            fs >> t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-
-        if (fWriteCache)
-        {
-            if (!WriteToCache(t, CDiskPos(nFile, nOffset)))
-            {
-                ResetCache();
-            }
-        }
-        return true;
+        return Read(t, CDiskPos(nFile, nOffset), fWriteCache);
     }
     template <typename T>
     bool Read(T& t, const CDiskPos& pos, bool fWriteCache = true)
     {
-        boost::unique_lock<boost::mutex> lock(mtxCache);
-
         if (ReadFromCache(t, pos))
         {
             return true;
         }
 
-        std::string pathFile;
-        if (!GetFilePath(pos.nFile, pathFile))
+        FlushPending(pos);
+        if (!ReadMapped(t, pos.nFile, pos.nOffset))
         {
-            return false;
-        }
-        try
-        {
-            // Open history file to read
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.Seek(pos.nOffset);
-            fs >> t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
+            std::string pathFile;
+            if (!GetFilePath(pos.nFile, pathFile))
+            {
+                return false;
+            }
+            try
+            {
+                // Open history file to read
+                xengine::CFileStream fs(pathFile.c_str());
+                uint32 nMagic = 0, nSize = 0;
+                if (CTimeSeriesRecord<T>::value)
+                {
+                    if (pos.nOffset < 8)
+                    {
+                        return false;
+                    }
+                    fs.Seek(pos.nOffset - 8);
+                    fs >> nMagic >> nSize;
+                    if (nMagic != nMagicNum || (uint64)pos.nOffset + nSize > fs.GetSize())
+                    {
+                        xengine::StdError("TimeSeriesCached", "Read: frame error, nFile: %d, nOffset: %d, nMagic: %x, nSize: %d",
+                                          pos.nFile, pos.nOffset, nMagic, nSize);
+                        return false;
+                    }
+                }
+                fs.Seek(pos.nOffset);
+                fs >> t;
+                if (CTimeSeriesRecord<T>::value && fs.GetCurPos() - pos.nOffset > nSize)
+                {
+                    xengine::StdError("TimeSeriesCached", "Read: record overruns its frame, nFile: %d, nOffset: %d", pos.nFile, pos.nOffset);
+                    return false;
+                }
+            }
+            catch (std::exception& e)
+            {
+                xengine::StdError(__PRETTY_FUNCTION__, e.what());
+                return false;
+            }
         }
 
         if (fWriteCache)
         {
-            if (!WriteToCache(t, pos))
-            {
-                ResetCache();
-            }
+            WriteToCache(t, pos, xengine::GetSerializeSize(t));
         }
         return true;
     }
@@ -239,12 +360,13 @@ public:
     bool WalkThrough(CTSWalker<T>& walker, uint32& nLastFileRet, uint32& nLastPosRet, bool fRepairFile)
     {
         bool fRet = true;
-        uint32 nFile = 1;
+        uint32 nFile = nFirstFile;
         uint32 nOffset = 0;
         nLastFileRet = 0;
         nLastPosRet = 0;
         std::string pathFile;
 
+        ResetAppender();
         while (GetFilePath(nFile, pathFile) && fRet)
         {
             nLastFileRet = nFile;
@@ -316,6 +438,9 @@ public:
             {
                 if (fRepairFile)
                 {
+                    // no mapped read may run into the truncated tail
+                    boost::unique_lock<boost::shared_mutex> wlock(mtxMappedRead);
+                    ResetMappedFile();
                     if (!RepairFile(nFile, nOffset))
                     {
                         xengine::StdError("TimeSeriesCached", "WalkThrough: RepairFile fail");
@@ -333,6 +458,7 @@ public:
     template <typename T>
     bool ReadDirect(T& t, uint32 nFile, uint32 nOffset)
     {
+        FlushPending(CDiskPos(nFile, nOffset));
         std::string pathFile;
         if (!GetFilePath(nFile, pathFile))
         {
@@ -352,8 +478,9 @@ public:
     }
     size_t GetSize(const uint32 nFile = -1)
     {
-        uint32 nFileNo = (nFile == -1) ? 1 : nFile;
+        uint32 nFileNo = (nFile == -1) ? nFirstFile : nFile;
         size_t nOffset = 0;
+        Flush();
         std::string pathFile;
         while (GetFilePath(nFileNo, pathFile))
         {
@@ -381,54 +508,72 @@ public:
     }
 
 protected:
-    void ResetCache();
-    bool VacateCache(uint32 nNeeded);
     template <typename T>
-    bool WriteToCache(const T& t, const CDiskPos& diskpos)
+    void WriteToCache(const T& t, const CDiskPos& diskpos, std::size_t nSize)
     {
-        if (mapCachePos.count(diskpos))
-        {
-            return true;
-        }
-        uint32 nSize = cacheStream.GetSerializeSize(t);
-        if (!VacateCache(nSize))
+        cacheObject.AddNew(diskpos, CCachedObject(t), nSize);
+    }
+    template <typename T>
+    bool ReadFromCache(T& t, const CDiskPos& diskpos)
+    {
+        CCachedObject obj;
+        return (cacheObject.Retrieve(diskpos, obj) && obj.Get(t));
+    }
+    std::shared_ptr<CMappedFile> GetMappedFile(uint32 nFile, std::size_t nEnd);
+    void ResetMappedFile();
+    // A record read is bounded by its frame, which is checked against the mapping.
+    // Other positions point into a record (txs in a block) and are bounded by the
+    // mapping. A read running past the mapping is retried only if the file has grown,
+    // anything else falls back to the stream read.
+    template <typename T>
+    bool ReadMapped(T& t, uint32 nFile, uint32 nOffset)
+    {
+        const bool fRecord = CTimeSeriesRecord<T>::value;
+        if (fRecord && nOffset < 8)
         {
             return false;
         }
-        try
-        {
-            std::size_t nPos;
-            cacheStream << diskpos << nSize;
-            nPos = cacheStream.GetWritePos();
-            cacheStream << t;
-            mapCachePos.insert(std::make_pair(diskpos, nPos));
-            return true;
-        }
-        catch (std::exception& e)
+        boost::shared_lock<boost::shared_mutex> rlock(mtxMappedRead);
+        std::shared_ptr<CMappedFile> spFile = GetMappedFile(nFile, (std::size_t)nOffset + 1);
+        std::size_t nEnd = 0;
+        if (spFile && fRecord)
         {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
+            uint32 nMagic = 0, nSize = 0;
+            try
+            {
+                xengine::CReadStream rs(spFile->GetData() + nOffset - 8, 8);
+                rs >> nMagic >> nSize;
+            }
+            catch (...)
+            {
+                return false;
+            }
+            if (nMagic != nMagicNum)
+            {
+                return false;
+            }
+            nEnd = (std::size_t)nOffset + nSize;
+            if (nEnd > spFile->GetSize())
+            {
+                spFile = GetMappedFile(nFile, nEnd);
+            }
         }
-        return false;
-    }
-    template <typename T>
-    bool ReadFromCache(T& t, const CDiskPos& diskpos)
-    {
-        std::map<CDiskPos, size_t>::iterator it = mapCachePos.find(diskpos);
-        if (it != mapCachePos.end())
+        for (int i = 0; i < 2 && spFile; i++)
         {
-            if (cacheStream.Seek((*it).second))
+            try
             {
-                try
-                {
-                    cacheStream >> t;
-                    return true;
-                }
-                catch (std::exception& e)
-                {
-                    xengine::StdError(__PRETTY_FUNCTION__, e.what());
-                }
+                xengine::CReadStream rs(spFile->GetData() + nOffset, (fRecord ? nEnd : spFile->GetSize()) - nOffset);
+                rs >> t;
+                return true;
+            }
+            catch (...)
+            {
+            }
+            if (fRecord)
+            {
+                break;
             }
-            ResetCache();
+            spFile = GetMappedFile(nFile, spFile->GetSize() + 1);
         }
         return false;
     }
@@ -438,10 +583,10 @@ protected:
     {
         FILE_CACHE_SIZE = 0x2000000
     };
-    boost::mutex mtxCache;
-    xengine::CCircularStream cacheStream;
-    std::map<CDiskPos, std::size_t> mapCachePos;
-    static const uint32 nMagicNum;
+    xengine::CShardedCache<CDiskPos, CCachedObject> cacheObject;
+    boost::shared_mutex mtxMapped;
+    boost::shared_mutex mtxMappedRead;
+    std::map<uint32, std::shared_ptr<CMappedFile>> mapMappedFile;
 };
 
 class CTimeSeriesChunk : public CTimeSeriesBase
@@ -454,67 +599,30 @@ public:
     {
         boost::unique_lock<boost::mutex> lock(mtxWriter);
 
-        std::string pathFile;
-        if (!GetLastFilePath(pos.nFile, pathFile))
-        {
-            return false;
-        }
-        try
-        {
-            xengine::CFileStream fs(pathFile.c_str());
-            fs.SeekToEnd();
-            uint32 nSize = fs.GetSerializeSize(t);
-            fs << nMagicNum << nSize;
-            pos.nOffset = fs.GetCurPos();
-            fs << t;
-        }
-        catch (std::exception& e)
-        {
-            xengine::StdError(__PRETTY_FUNCTION__, e.what());
-            return false;
-        }
-        return true;
+        uint32 nSize = 0;
+        return Append(t, pos, nSize);
     }
     template <typename T>
     bool WriteBatch(const typename std::vector<T>& vBatch, std::vector<CDiskPos>& vPos)
     {
         boost::unique_lock<boost::mutex> lock(mtxWriter);
 
-        size_t n = 0;
-
-        while (n < vBatch.size())
+        for (const T& t : vBatch)
         {
-            uint32 nFile, nOffset;
-            std::string pathFile;
-            if (!GetLastFilePath(nFile, pathFile))
-            {
-                return false;
-            }
-            try
-            {
-                xengine::CFileStream fs(pathFile.c_str());
-                fs.SeekToEnd();
-                do
-                {
-                    uint32 nSize = fs.GetSerializeSize(vBatch[n]);
-                    fs << nMagicNum << nSize;
-                    nOffset = fs.GetCurPos();
-                    fs << vBatch[n++];
-                    vPos.push_back(CDiskPos(nFile, nOffset));
-                } while (n < vBatch.size() && nOffset < MAX_FILE_SIZE - MAX_CHUNK_SIZE - 8);
-            }
-            catch (std::exception& e)
+            CDiskPos pos;
+            uint32 nSize = 0;
+            if (!Append(t, pos, nSize))
             {
-                xengine::StdError(__PRETTY_FUNCTION__, e.what());
                 return false;
             }
+            vPos.push_back(pos);
         }
-
-        return true;
+        return FlushAppender();
     }
     template <typename T>
     bool Read(T& t, const CDiskPos& pos)
     {
+        FlushPending(pos);
         std::string pathFile;
         if (!GetFilePath(pos.nFile, pathFile))
         {
@@ -534,10 +642,6 @@ public:
         }
         return true;
     }
-
-protected:
-    boost::mutex mtxWriter;
-    static const uint32 nMagicNum;
 };
 
 } // namespace storage
@@ -6,6 +6,8 @@
 
 #include <boost/bind.hpp>
 
+#include "leveldbeng.h"
+
 using namespace std;
 using namespace xengine;
 
@@ -38,6 +40,11 @@ bool CTxIndexDB::Initialize(const boost::filesystem::path& pathData, const bool
         return false;
     }
 
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
+    {
+        return false;
+    }
+
     if (fFlush)
     {
         fStopFlush = false;
@@ -83,6 +90,7 @@ void CTxIndexDB::Deinitialize()
         CWriteLock wlock(rwAccess);
         mapTxDB.clear();
     }
+    spShared.reset();
 }
 
 bool CTxIndexDB::LoadFork(const uint256& hashFork)
@@ -95,8 +103,14 @@ bool CTxIndexDB::LoadFork(const uint256& hashFork)
         return true;
     }
 
+    boost::filesystem::path pathFork = pathTxIndex / hashFork.GetHex();
+    CKVDBEngine* engine = nullptr;
+    if (spShared != nullptr)
+    {
+        engine = CLevelDBShared::NewForkEngine(pathFork / "index", spShared, CLevelDBShared::TABLE_TXINDEX, hashFork);
+    }
     std::shared_ptr<CForkTxDB> spTxDB(new CForkTxDB());
-    if (spTxDB == nullptr || !spTxDB->Initialize(pathTxIndex / hashFork.GetHex()))
+    if (spTxDB == nullptr || !spTxDB->Initialize(pathFork, engine))
     {
         return false;
     }
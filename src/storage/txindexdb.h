@@ -16,6 +16,8 @@ namespace bigbang
 namespace storage
 {
 
+class CLevelDBShared;
+
 class CTxIndexDB
 {
     typedef CCTSDB<uint224, CTxIndex, CCTSChunkSnappy<uint224, CTxIndex>> CForkTxDB;
@@ -38,6 +40,7 @@ protected:
 
 protected:
     boost::filesystem::path pathTxIndex;
+    std::shared_ptr<CLevelDBShared> spShared;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkTxDB>> mapTxDB;
 
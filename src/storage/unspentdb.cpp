@@ -16,17 +16,12 @@ namespace bigbang
 namespace storage
 {
 
-#define UNSPENT_FLUSH_INTERVAL (60)
-
 //////////////////////////////
 // CForkUnspentDB
 
-CForkUnspentDB::CForkUnspentDB(const boost::filesystem::path& pathDB)
+CForkUnspentDB::CForkUnspentDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork)
 {
-    CLevelDBArguments args;
-    args.path = pathDB.string();
-    args.syncwrite = false;
-    CLevelDBEngine* engine = new CLevelDBEngine(args);
+    CKVDBEngine* engine = CLevelDBShared::NewForkEngine(pathDB, spShared, CLevelDBShared::TABLE_UNSPENT, hashFork);
 
     if (!CKVDB::Open(engine))
     {
@@ -37,7 +32,7 @@ CForkUnspentDB::CForkUnspentDB(const boost::filesystem::path& pathDB)
 CForkUnspentDB::~CForkUnspentDB()
 {
     Close();
-    dblCache.Clear();
+    cacheWrite.Clear();
 }
 
 bool CForkUnspentDB::RemoveAll()
@@ -46,15 +41,15 @@ bool CForkUnspentDB::RemoveAll()
     {
         return false;
     }
-    dblCache.Clear();
+    cacheWrite.Clear();
     return true;
 }
 
 bool CForkUnspentDB::UpdateUnspent(const vector<CTxUnspent>& vAddNew, const vector<CTxUnspent>& vRemove)
 {
-    xengine::CWriteLock wlock(rwUpper);
+    CacheType::CWriteView view(cacheWrite);
 
-    MapType& mapUpper = dblCache.GetUpperMap();
+    MapType& mapUpper = view.mapUpper;
 
     for (const CTxUnspent& unspent : vAddNew)
     {
@@ -100,37 +95,10 @@ bool CForkUnspentDB::WriteUnspent(const CTxOutPoint& txout, const CTxOut& output
 
 bool CForkUnspentDB::ReadUnspent(const CTxOutPoint& txout, CTxOut& output)
 {
+    if (cacheWrite.Find(txout, output))
     {
-        xengine::CReadLock rlock(rwUpper);
-
-        MapType& mapUpper = dblCache.GetUpperMap();
-        typename MapType::iterator it = mapUpper.find(txout);
-        if (it != mapUpper.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                output = (*it).second;
-                return true;
-            }
-            return false;
-        }
-    }
-
-    {
-        xengine::CReadLock rlock(rwLower);
-        MapType& mapLower = dblCache.GetLowerMap();
-        typename MapType::iterator it = mapLower.find(txout);
-        if (it != mapLower.end())
-        {
-            if (!(*it).second.IsNull())
-            {
-                output = (*it).second;
-                return true;
-            }
-            return false;
-        }
+        return !output.IsNull();
     }
-
     return Read(txout, output);
 }
 
@@ -143,15 +111,14 @@ bool CForkUnspentDB::Copy(CForkUnspentDB& dbUnspent)
 
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
         if (!WalkThrough(boost::bind(&CForkUnspentDB::CopyWalker, this, _1, _2, boost::ref(dbUnspent))))
         {
             return false;
         }
 
-        dbUnspent.SetCache(dblCache);
+        dbUnspent.cacheWrite.CopyFrom(view);
     }
     catch (exception& e)
     {
@@ -165,11 +132,10 @@ bool CForkUnspentDB::WalkThroughUnspent(CForkUnspentDBWalker& walker)
 {
     try
     {
-        xengine::CReadLock rulock(rwUpper);
-        xengine::CReadLock rdlock(rwLower);
+        CacheType::CReadView view(cacheWrite);
 
-        MapType& mapUpper = dblCache.GetUpperMap();
-        MapType& mapLower = dblCache.GetLowerMap();
+        const MapType& mapUpper = view.mapUpper;
+        const MapType& mapLower = view.mapLower;
 
         if (!WalkThrough(boost::bind(&CForkUnspentDB::LoadWalker, this, _1, _2, boost::ref(walker),
                                      boost::ref(mapUpper), boost::ref(mapLower))))
@@ -177,7 +143,7 @@ bool CForkUnspentDB::WalkThroughUnspent(CForkUnspentDBWalker& walker)
             return false;
         }
 
-        for (MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
+        for (MapType::const_iterator it = mapLower.begin(); it != mapLower.end(); ++it)
         {
             const CTxOutPoint& txout = (*it).first;
             const CTxOut& output = (*it).second;
@@ -189,7 +155,7 @@ bool CForkUnspentDB::WalkThroughUnspent(CForkUnspentDBWalker& walker)
                 }
             }
         }
-        for (MapType::iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
+        for (MapType::const_iterator it = mapUpper.begin(); it != mapUpper.end(); ++it)
         {
             const CTxOutPoint& txout = (*it).first;
             const CTxOut& output = (*it).second;
@@ -238,67 +204,14 @@ bool CForkUnspentDB::LoadWalker(CBufStream& ssKey, CBufStream& ssValue,
     return walker.Walk(txout, output);
 }
 
-bool CForkUnspentDB::Flush()
-{
-    xengine::CUpgradeLock ulock(rwLower);
-
-    vector<pair<CTxOutPoint, CTxOut>> vAddNew;
-    vector<CTxOutPoint> vRemove;
-
-    MapType& mapLower = dblCache.GetLowerMap();
-    for (typename MapType::iterator it = mapLower.begin(); it != mapLower.end(); ++it)
-    {
-        CTxOut& output = (*it).second;
-        if (!output.IsNull())
-        {
-            vAddNew.push_back(*it);
-        }
-        else
-        {
-            vRemove.push_back((*it).first);
-        }
-    }
-
-    if (!TxnBegin())
-    {
-        return false;
-    }
-
-    for (int i = 0; i < vAddNew.size(); i++)
-    {
-        Write(vAddNew[i].first, vAddNew[i].second);
-    }
-
-    for (int i = 0; i < vRemove.size(); i++)
-    {
-        Erase(vRemove[i]);
-    }
-
-    if (!TxnCommit())
-    {
-        return false;
-    }
-
-    ulock.Upgrade();
-
-    {
-        xengine::CWriteLock wlock(rwUpper);
-        dblCache.Flip();
-    }
-
-    return true;
-}
-
 //////////////////////////////
 // CUnspentDB
 
 CUnspentDB::CUnspentDB()
 {
-    pThreadFlush = nullptr;
-    fStopFlush = true;
 }
 
-bool CUnspentDB::Initialize(const boost::filesystem::path& pathData, const bool fFlush)
+bool CUnspentDB::Initialize(const boost::filesystem::path& pathData)
 {
     pathUnspent = pathData / "unspent";
 
@@ -312,51 +225,20 @@ bool CUnspentDB::Initialize(const boost::filesystem::path& pathData, const bool
         return false;
     }
 
-    if (fFlush)
+    if (CLevelDBShared::IsSharedLayout(pathData) && !(spShared = CLevelDBShared::Open(pathData)))
     {
-        fStopFlush = false;
-        pThreadFlush = new boost::thread(boost::bind(&CUnspentDB::FlushProc, this));
-        if (pThreadFlush == nullptr)
-        {
-            fStopFlush = true;
-            return false;
-        }
+        return false;
     }
     return true;
 }
 
 void CUnspentDB::Deinitialize()
 {
-    if (pThreadFlush)
-    {
-        {
-            boost::unique_lock<boost::mutex> lock(mtxFlush);
-            fStopFlush = true;
-        }
-        condFlush.notify_all();
-        pThreadFlush->join();
-        delete pThreadFlush;
-        pThreadFlush = nullptr;
-
-        {
-            CWriteLock wlock(rwAccess);
-
-            for (map<uint256, std::shared_ptr<CForkUnspentDB>>::iterator it = mapUnspentDB.begin();
-                 it != mapUnspentDB.end(); ++it)
-            {
-                std::shared_ptr<CForkUnspentDB> spUnspent = (*it).second;
-
-                spUnspent->Flush();
-                spUnspent->Flush();
-            }
-            mapUnspentDB.clear();
-        }
-    }
-    else
     {
         CWriteLock wlock(rwAccess);
         mapUnspentDB.clear();
     }
+    spShared.reset();
 }
 
 bool CUnspentDB::AddNewFork(const uint256& hashFork)
@@ -369,7 +251,7 @@ bool CUnspentDB::AddNewFork(const uint256& hashFork)
         return true;
     }
 
-    std::shared_ptr<CForkUnspentDB> spUnspent(new CForkUnspentDB(pathUnspent / hashFork.GetHex()));
+    std::shared_ptr<CForkUnspentDB> spUnspent(new CForkUnspentDB(pathUnspent / hashFork.GetHex(), spShared, hashFork));
     if (spUnspent == nullptr || !spUnspent->IsValid())
     {
         return false;
@@ -472,53 +354,14 @@ bool CUnspentDB::WalkThrough(const uint256& hashFork, CForkUnspentDBWalker& walk
     return false;
 }
 
-void CUnspentDB::Flush(const uint256& hashFork)
+void CUnspentDB::ListWriteBackDB(vector<std::shared_ptr<CWriteBackDB>>& vDB)
 {
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
     CReadLock rlock(rwAccess);
 
-    map<uint256, std::shared_ptr<CForkUnspentDB>>::iterator it = mapUnspentDB.find(hashFork);
-    if (it != mapUnspentDB.end())
-    {
-        (*it).second->Flush();
-    }
-}
-
-void CUnspentDB::FlushProc()
-{
-    SetThreadName("UnspentDB");
-    boost::system_time timeout = boost::get_system_time();
-    boost::unique_lock<boost::mutex> lock(mtxFlush);
-    while (!fStopFlush)
+    for (map<uint256, std::shared_ptr<CForkUnspentDB>>::iterator it = mapUnspentDB.begin();
+         it != mapUnspentDB.end(); ++it)
     {
-        timeout += boost::posix_time::seconds(UNSPENT_FLUSH_INTERVAL);
-
-        while (!fStopFlush)
-        {
-            if (!condFlush.timed_wait(lock, timeout))
-            {
-                break;
-            }
-        }
-
-        if (!fStopFlush)
-        {
-            vector<std::shared_ptr<CForkUnspentDB>> vUnspentDB;
-            vUnspentDB.reserve(mapUnspentDB.size());
-            {
-                CReadLock rlock(rwAccess);
-
-                for (map<uint256, std::shared_ptr<CForkUnspentDB>>::iterator it = mapUnspentDB.begin();
-                     it != mapUnspentDB.end(); ++it)
-                {
-                    vUnspentDB.push_back((*it).second);
-                }
-            }
-            for (int i = 0; i < vUnspentDB.size(); i++)
-            {
-                vUnspentDB[i]->Flush();
-            }
-        }
+        vDB.push_back((*it).second);
     }
 }
 
@@ -5,9 +5,8 @@
 #ifndef STORAGE_UNSPENTDB_H
 #define STORAGE_UNSPENTDB_H
 
-#include <boost/thread/thread.hpp>
-
 #include "transaction.h"
+#include "writecache.h"
 #include "xengine.h"
 
 namespace bigbang
@@ -15,6 +14,8 @@ namespace bigbang
 namespace storage
 {
 
+class CLevelDBShared;
+
 //////////////////////////////
 // CForkUnspentDBWalker
 
@@ -57,84 +58,6 @@ public:
     const std::map<CTxOutPoint, CTxUnspent>& mapUnspentUTXO;
 };
 
-//////////////////////////////
-// CListUnspentWalker
-
-class CListUnspentWalker : public CForkUnspentDBWalker
-{
-public:
-    CListUnspentWalker(const uint256& forkidIn, const CDestination& destOwnerIn, uint32 maxIn)
-      : forkId(forkidIn), destOwner(destOwnerIn), nMax(maxIn), nCounter(0) {}
-    bool Walk(const CTxOutPoint& txout, const CTxOut& output) override
-    {
-        if (nMax != 0 && nCounter >= nMax)
-        {
-            return false; //exit walk through processing
-        }
-        if (destOwner == output.destTo)
-        {
-            vUnspent.push_back(CTxUnspent(txout, output));
-            ++nCounter;
-        }
-        return true; //continue walk through processing
-    }
-
-public:
-    const uint256& forkId;
-    const CDestination& destOwner;
-    uint32 nMax;
-    uint32 nCounter;
-    std::vector<CTxUnspent> vUnspent;
-};
-
-//////////////////////////////
-// CListUnspentBatchWalker
-
-class CListUnspentBatchWalker : public CForkUnspentDBWalker
-{
-public:
-    CListUnspentBatchWalker(const uint256& forkidIn, std::map<CDestination, std::vector<CTxUnspent>>& mapOwnersIn, uint32 maxIn)
-      : forkId(forkidIn), mapUnspent(mapOwnersIn), nMax(maxIn)
-    {
-        for (const auto& i : mapUnspent)
-        {
-            mapCount.insert(std::make_pair(i.first, 0));
-        }
-    }
-    bool Walk(const CTxOutPoint& txout, const CTxOut& output) override
-    {
-        if (nMax != 0 && AllFill())
-        {
-            return false; //exit walk through processing
-        }
-        if (mapUnspent.count(output.destTo) && (nMax == 0 || mapUnspent[output.destTo].size() < nMax))
-        {
-            mapUnspent[output.destTo].emplace_back(CTxUnspent(txout, output));
-            ++mapCount[output.destTo];
-        }
-        return true; //continue walk through processing
-    }
-
-private:
-    bool AllFill() const
-    {
-        for (const auto& i : mapCount)
-        {
-            if (i.second < nMax)
-            {
-                return false;
-            }
-        }
-        return true;
-    }
-
-public:
-    const uint256& forkId;
-    uint32 nMax;
-    std::map<CDestination, std::vector<CTxUnspent>>& mapUnspent;
-    std::map<CDestination, uint8> mapCount;
-};
-
 //////////////////////////////
 // CListAddressUnspentWalker
 
@@ -163,42 +86,10 @@ public:
 //////////////////////////////
 // CForkUnspentDB
 
-class CForkUnspentDB : public xengine::CKVDB
+class CForkUnspentDB : public CForkWriteBackDB<CTxOutPoint, CTxOut>
 {
-    typedef std::map<CTxOutPoint, CTxOut> MapType;
-    class CDblMap
-    {
-    public:
-        CDblMap()
-          : nIdxUpper(0) {}
-        MapType& GetUpperMap()
-        {
-            return mapCache[nIdxUpper];
-        }
-        MapType& GetLowerMap()
-        {
-            return mapCache[nIdxUpper ^ 1];
-        }
-        void Flip()
-        {
-            MapType& mapLower = mapCache[nIdxUpper ^ 1];
-            mapLower.clear();
-            nIdxUpper = nIdxUpper ^ 1;
-        }
-        void Clear()
-        {
-            mapCache[0].clear();
-            mapCache[1].clear();
-            nIdxUpper = 0;
-        }
-
-    protected:
-        MapType mapCache[2];
-        int nIdxUpper;
-    };
-
 public:
-    CForkUnspentDB(const boost::filesystem::path& pathDB);
+    CForkUnspentDB(const boost::filesystem::path& pathDB, std::shared_ptr<CLevelDBShared> spShared, const uint256& hashFork);
     ~CForkUnspentDB();
     bool RemoveAll();
     bool UpdateUnspent(const std::vector<CTxUnspent>& vAddNew, const std::vector<CTxUnspent>& vRemove);
@@ -206,30 +97,20 @@ public:
     bool WriteUnspent(const CTxOutPoint& txout, const CTxOut& output);
     bool ReadUnspent(const CTxOutPoint& txout, CTxOut& output);
     bool Copy(CForkUnspentDB& dbUnspent);
-    void SetCache(const CDblMap& dblCacheIn)
-    {
-        dblCache = dblCacheIn;
-    }
     bool WalkThroughUnspent(CForkUnspentDBWalker& walker);
-    bool Flush();
 
 protected:
     bool CopyWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkUnspentDB& dbUnspent);
     bool LoadWalker(xengine::CBufStream& ssKey, xengine::CBufStream& ssValue,
                     CForkUnspentDBWalker& walker, const MapType& mapUpper, const MapType& mapLower);
-
-protected:
-    xengine::CRWAccess rwUpper;
-    xengine::CRWAccess rwLower;
-    CDblMap dblCache;
 };
 
-class CUnspentDB
+class CUnspentDB : public CWriteBackTable
 {
 public:
     CUnspentDB();
-    bool Initialize(const boost::filesystem::path& pathData, const bool fFlush = true);
+    bool Initialize(const boost::filesystem::path& pathData);
     void Deinitialize();
     bool Exists(const uint256& hashFork)
     {
@@ -244,20 +125,13 @@ public:
     bool Retrieve(const uint256& hashFork, const CTxOutPoint& txout, CTxOut& output);
     bool Copy(const uint256& srcFork, const uint256& destFork);
     bool WalkThrough(const uint256& hashFork, CForkUnspentDBWalker& walker);
-    void Flush(const uint256& hashFork);
-
-protected:
-    void FlushProc();
+    void ListWriteBackDB(std::vector<std::shared_ptr<CWriteBackDB>>& vDB) override;
 
 protected:
     boost::filesystem::path pathUnspent;
+    std::shared_ptr<CLevelDBShared> spShared;
     xengine::CRWAccess rwAccess;
     std::map<uint256, std::shared_ptr<CForkUnspentDB>> mapUnspentDB;
-
-    boost::mutex mtxFlush;
-    boost::condition_variable condFlush;
-    boost::thread* pThreadFlush;
-    bool fStopFlush;
 };
 
 } // namespace storage
@@ -22,11 +22,9 @@ namespace storage
 
 bool CWalletAddrDB::Initialize(const boost::filesystem::path& pathWallet)
 {
-    CLevelDBArguments args;
+    CLevelDBArguments args(CLevelDBArguments::PROFILE_WALLET);
     args.path = (pathWallet / "addr").string();
     args.syncwrite = true;
-    args.files = 8;
-    args.cache = 1 << 20;
 
     CLevelDBEngine* engine = new CLevelDBEngine(args);
 
@@ -0,0 +1,175 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "writecache.h"
+
+#include <boost/bind.hpp>
+
+#include "leveldbeng.h"
+
+using namespace std;
+using namespace xengine;
+
+namespace bigbang
+{
+namespace storage
+{
+
+//////////////////////////////
+// CWriteBackFlusher
+
+CWriteBackFlusher::CWriteBackFlusher()
+  : nInterval(0), nMaxPending(0), nPending(0), pThreadFlush(nullptr), fStopFlush(true), fFlushNow(false)
+{
+}
+
+CWriteBackFlusher::~CWriteBackFlusher()
+{
+    Stop();
+}
+
+void CWriteBackFlusher::AddTable(CWriteBackTable* pTable)
+{
+    vTable.push_back(pTable);
+}
+
+bool CWriteBackFlusher::Start(std::shared_ptr<CLevelDBShared> spSharedIn, const int nIntervalIn, const size_t nMaxPendingIn)
+{
+    spShared = spSharedIn;
+    nInterval = nIntervalIn;
+    nMaxPending = nMaxPendingIn;
+    nPending = 0;
+    fFlushNow = false;
+
+    fStopFlush = false;
+    pThreadFlush = new boost::thread(boost::bind(&CWriteBackFlusher::FlushProc, this));
+    if (pThreadFlush == nullptr)
+    {
+        fStopFlush = true;
+        return false;
+    }
+    return true;
+}
+
+void CWriteBackFlusher::Stop()
+{
+    if (pThreadFlush)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mtxFlush);
+            fStopFlush = true;
+        }
+        condFlush.notify_all();
+        pThreadFlush->join();
+        delete pThreadFlush;
+        pThreadFlush = nullptr;
+
+        Flush();
+    }
+    vTable.clear();
+    spShared.reset();
+}
+
+bool CWriteBackFlusher::Flush()
+{
+    boost::unique_lock<boost::mutex> lockWrite(mtxWrite);
+
+    vector<std::shared_ptr<CWriteBackDB>> vDB;
+    for (CWriteBackTable* pTable : vTable)
+    {
+        pTable->ListWriteBackDB(vDB);
+    }
+
+    {
+        CWriteLock wlock(rwCommit);
+        for (const std::shared_ptr<CWriteBackDB>& spDB : vDB)
+        {
+            spDB->FlushPrepare();
+        }
+    }
+    {
+        boost::unique_lock<boost::mutex> lock(mtxFlush);
+        nPending = 0;
+        fFlushNow = false;
+    }
+
+    // snapshots that fail to write stay cached and are merged into the next flush
+    bool fBatch = (spShared != nullptr && spShared->BatchBegin());
+    bool fRet = true;
+    for (const std::shared_ptr<CWriteBackDB>& spDB : vDB)
+    {
+        if (!spDB->FlushWrite())
+        {
+            fRet = false;
+            break;
+        }
+    }
+    if (fBatch)
+    {
+        if (fRet)
+        {
+            fRet = spShared->BatchCommit();
+        }
+        else
+        {
+            spShared->BatchAbort();
+        }
+    }
+    if (!fRet)
+    {
+        StdError("CWriteBackFlusher", "Flush: write fail, tables: %lu", vDB.size());
+        return false;
+    }
+
+    for (const std::shared_ptr<CWriteBackDB>& spDB : vDB)
+    {
+        spDB->FlushComplete();
+    }
+    return true;
+}
+
+void CWriteBackFlusher::AddPending(const size_t nChange)
+{
+    bool fNotify = false;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxFlush);
+        nPending += nChange;
+        if (nMaxPending > 0 && nPending >= nMaxPending && !fFlushNow)
+        {
+            fNotify = fFlushNow = true;
+        }
+    }
+    if (fNotify)
+    {
+        condFlush.notify_all();
+    }
+}
+
+void CWriteBackFlusher::FlushProc()
+{
+    SetThreadName("WriteBackFlush");
+    boost::unique_lock<boost::mutex> lock(mtxFlush);
+    while (!fStopFlush)
+    {
+        boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds(nInterval);
+
+        while (!fStopFlush && !fFlushNow)
+        {
+            if (!condFlush.timed_wait(lock, timeout))
+            {
+                break;
+            }
+        }
+
+        if (!fStopFlush)
+        {
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+}
+
+} // namespace storage
+} // namespace bigbang
@@ -0,0 +1,291 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef STORAGE_WRITECACHE_H
+#define STORAGE_WRITECACHE_H
+
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <memory>
+
+#include "xengine.h"
+
+namespace bigbang
+{
+namespace storage
+{
+
+class CLevelDBShared;
+
+//////////////////////////////
+// CWriteBackCache
+
+// Changes of one fork table waiting for the database. Updates go to the upper
+// map, a flush merges them into an immutable lower snapshot, writes it and
+// drops it once the write is committed. A null value marks an erased key.
+template <typename K, typename V>
+class CWriteBackCache
+{
+public:
+    typedef std::map<K, V> MapType;
+    typedef std::shared_ptr<const MapType> MapPtr;
+
+    // Both levels under one read lock, for walks that merge the cache with the database
+    class CReadView
+    {
+    public:
+        CReadView(CWriteBackCache& cache)
+          : rlock(cache.rwAccess), spLower(cache.spLower), mapUpper(cache.mapUpper), mapLower(*spLower) {}
+        bool IsCached(const K& key) const
+        {
+            return (mapUpper.count(key) || mapLower.count(key));
+        }
+
+    protected:
+        xengine::CReadLock rlock;
+        MapPtr spLower;
+
+    public:
+        const MapType& mapUpper;
+        const MapType& mapLower;
+    };
+
+    // Upper level under the write lock, the lower level stays readable
+    class CWriteView
+    {
+    public:
+        CWriteView(CWriteBackCache& cache)
+          : wlock(cache.rwAccess), spLower(cache.spLower), mapUpper(cache.mapUpper), mapLower(*spLower) {}
+        bool Find(const K& key, V& value) const
+        {
+            return CWriteBackCache::Find(mapUpper, mapLower, key, value);
+        }
+
+    protected:
+        xengine::CWriteLock wlock;
+        MapPtr spLower;
+
+    public:
+        MapType& mapUpper;
+        const MapType& mapLower;
+    };
+
+public:
+    CWriteBackCache()
+      : spLower(new MapType()) {}
+    // true if key is cached, value is null when it is erased
+    bool Find(const K& key, V& value)
+    {
+        xengine::CReadLock rlock(rwAccess);
+        return Find(mapUpper, *spLower, key, value);
+    }
+    std::size_t GetSize()
+    {
+        xengine::CReadLock rlock(rwAccess);
+        return (mapUpper.size() + spLower->size());
+    }
+    void Clear()
+    {
+        xengine::CWriteLock wlock(rwAccess);
+        mapUpper.clear();
+        spLower.reset(new MapType());
+    }
+    // both levels seen by the view of another cache become the upper level of this one
+    void CopyFrom(const CReadView& view)
+    {
+        MapType mapCopy(view.mapLower);
+        for (const auto& vd : view.mapUpper)
+        {
+            mapCopy[vd.first] = vd.second;
+        }
+        xengine::CWriteLock wlock(rwAccess);
+        mapUpper.swap(mapCopy);
+        spLower.reset(new MapType());
+    }
+    // merge the upper level into the lower snapshot, a snapshot left by a failed write is kept
+    MapPtr Prepare()
+    {
+        xengine::CWriteLock wlock(rwAccess);
+        if (!mapUpper.empty())
+        {
+            std::shared_ptr<MapType> spMerge(new MapType());
+            if (spLower->empty())
+            {
+                spMerge->swap(mapUpper);
+            }
+            else
+            {
+                *spMerge = *spLower;
+                for (const auto& vd : mapUpper)
+                {
+                    (*spMerge)[vd.first] = vd.second;
+                }
+                mapUpper.clear();
+            }
+            spLower = spMerge;
+        }
+        return spLower;
+    }
+    // drop the snapshot once it is in the database
+    void Complete(const MapPtr& spFlushed)
+    {
+        xengine::CWriteLock wlock(rwAccess);
+        if (spLower == spFlushed && !spLower->empty())
+        {
+            spLower.reset(new MapType());
+        }
+    }
+
+protected:
+    static bool Find(const MapType& mapUpper, const MapType& mapLower, const K& key, V& value)
+    {
+        typename MapType::const_iterator it = mapUpper.find(key);
+        if (it == mapUpper.end() && (it = mapLower.find(key)) == mapLower.end())
+        {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+protected:
+    xengine::CRWAccess rwAccess;
+    MapType mapUpper;
+    MapPtr spLower;
+};
+
+//////////////////////////////
+// CWriteBackDB
+
+// One fork table taking part in a flush
+class CWriteBackDB
+{
+public:
+    virtual ~CWriteBackDB() {}
+    virtual void FlushPrepare() = 0;
+    virtual bool FlushWrite() = 0;
+    virtual void FlushComplete() = 0;
+};
+
+//////////////////////////////
+// CForkWriteBackDB
+
+template <typename K, typename V>
+class CForkWriteBackDB : public xengine::CKVDB, public CWriteBackDB
+{
+public:
+    typedef CWriteBackCache<K, V> CacheType;
+    typedef typename CacheType::MapType MapType;
+
+public:
+    void FlushPrepare() override
+    {
+        spFlush = cacheWrite.Prepare();
+    }
+    bool FlushWrite() override
+    {
+        if (spFlush == nullptr || spFlush->empty())
+        {
+            return true;
+        }
+        if (!TxnBegin())
+        {
+            return false;
+        }
+        for (const auto& vd : *spFlush)
+        {
+            if (vd.second.IsNull())
+            {
+                Erase(GetDBKey(vd.first));
+            }
+            else
+            {
+                Write(GetDBKey(vd.first), vd.second);
+            }
+        }
+        return TxnCommit();
+    }
+    void FlushComplete() override
+    {
+        cacheWrite.Complete(spFlush);
+        spFlush.reset();
+    }
+    // flush this table alone, for use without a CWriteBackFlusher
+    bool Flush()
+    {
+        FlushPrepare();
+        if (!FlushWrite())
+        {
+            return false;
+        }
+        FlushComplete();
+        return true;
+    }
+
+protected:
+    virtual K GetDBKey(const K& key) const
+    {
+        return key;
+    }
+
+protected:
+    CacheType cacheWrite;
+    typename CacheType::MapPtr spFlush;
+};
+
+//////////////////////////////
+// CWriteBackTable
+
+class CWriteBackTable
+{
+public:
+    virtual ~CWriteBackTable() {}
+    virtual void ListWriteBackDB(std::vector<std::shared_ptr<CWriteBackDB>>& vDB) = 0;
+};
+
+//////////////////////////////
+// CWriteBackFlusher
+
+// Flushes the caches of all tables together, on an interval or once enough
+// changes are pending. Block commits hold the read side of the commit lock, so
+// a flush never splits one. With the shared fork layout all tables are written
+// in one atomic batch.
+class CWriteBackFlusher
+{
+public:
+    CWriteBackFlusher();
+    ~CWriteBackFlusher();
+    void AddTable(CWriteBackTable* pTable);
+    bool Start(std::shared_ptr<CLevelDBShared> spSharedIn, const int nIntervalIn, const std::size_t nMaxPendingIn);
+    void Stop();
+    bool Flush();
+    void AddPending(const std::size_t nChange);
+    xengine::CRWAccess& GetCommitAccess()
+    {
+        return rwCommit;
+    }
+
+protected:
+    void FlushProc();
+
+protected:
+    std::vector<CWriteBackTable*> vTable;
+    std::shared_ptr<CLevelDBShared> spShared;
+    int nInterval;
+    std::size_t nMaxPending;
+    std::size_t nPending;
+    xengine::CRWAccess rwCommit;
+    boost::mutex mtxWrite;
+
+    boost::mutex mtxFlush;
+    boost::condition_variable condFlush;
+    boost::thread* pThreadFlush;
+    bool fStopFlush;
+    bool fFlushNow;
+};
+
+} // namespace storage
+} // namespace bigbang
+
+#endif //STORAGE_WRITECACHE_H
@@ -5,13 +5,18 @@
 #ifndef XENGINE_CACHE_H
 #define XENGINE_CACHE_H
 
+#include <boost/functional/hash.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "rwlock.h"
+#include "type.h"
 
 namespace xengine
 {
@@ -81,6 +86,11 @@ public:
         CWriteLock wlock(rwAccess);
         cntrCache.clear();
     }
+    std::size_t GetCount() const
+    {
+        CReadLock rlock(rwAccess);
+        return cntrCache.size();
+    }
 
 protected:
     mutable CRWAccess rwAccess;
@@ -88,6 +98,175 @@ protected:
     std::size_t nMaxCount;
 };
 
+class CCacheStat
+{
+public:
+    CCacheStat()
+      : nCapacity(0), nSize(0), nCount(0), nHit(0), nMiss(0), nEviction(0) {}
+
+public:
+    std::size_t nCapacity;
+    std::size_t nSize;
+    std::size_t nCount;
+    uint64 nHit;
+    uint64 nMiss;
+    uint64 nEviction;
+};
+
+// Size bounded LRU cache. Keys are spread over shards by hash, each shard has
+// its own lock and an equal part of the capacity, so readers of different keys
+// rarely contend. nCharge is the caller's estimate of the entry size.
+template <typename K, typename V, typename H = boost::hash<K>>
+class CShardedCache
+{
+    class CKeyValue
+    {
+    public:
+        K key;
+        mutable V value;
+        std::size_t nCharge;
+
+    public:
+        CKeyValue() {}
+        CKeyValue(const K& keyIn, const V& valueIn, std::size_t nChargeIn)
+          : key(keyIn), value(valueIn), nCharge(nChargeIn) {}
+    };
+    typedef boost::multi_index_container<
+        CKeyValue,
+        boost::multi_index::indexed_by<
+            boost::multi_index::ordered_unique<boost::multi_index::member<CKeyValue, K, &CKeyValue::key>>,
+            boost::multi_index::sequenced<>>>
+        CKeyValueContainer;
+    typedef typename CKeyValueContainer::template nth_index<1>::type CKeyValueList;
+
+    class CShard
+    {
+    public:
+        CShard()
+          : nSize(0), nCapacity(0) {}
+
+    public:
+        boost::mutex mtxShard;
+        CKeyValueContainer cntrCache;
+        std::size_t nSize;
+        std::size_t nCapacity;
+    };
+
+public:
+    CShardedCache(std::size_t nCapacityIn = 0, std::size_t nShardCount = 16)
+      : nCapacity(0), nHit(0), nMiss(0), nEviction(0)
+    {
+        for (std::size_t i = 0; i < (nShardCount ? nShardCount : 1); i++)
+        {
+            vShard.push_back(std::unique_ptr<CShard>(new CShard));
+        }
+        SetCapacity(nCapacityIn);
+    }
+    void SetCapacity(std::size_t nCapacityIn)
+    {
+        nCapacity = nCapacityIn;
+        for (auto& spShard : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(spShard->mtxShard);
+            spShard->nCapacity = nCapacityIn / vShard.size();
+            Evict(*spShard);
+        }
+    }
+    bool Retrieve(const K& key, V& value)
+    {
+        CShard& shard = GetShard(key);
+        {
+            boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+            typename CKeyValueContainer::iterator it = shard.cntrCache.find(key);
+            if (it != shard.cntrCache.end())
+            {
+                CKeyValueList& listCache = shard.cntrCache.template get<1>();
+                listCache.relocate(listCache.end(), shard.cntrCache.template project<1>(it));
+                value = (*it).value;
+                ++nHit;
+                return true;
+            }
+        }
+        ++nMiss;
+        return false;
+    }
+    void AddNew(const K& key, const V& value, std::size_t nCharge)
+    {
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        typename CKeyValueContainer::iterator it = shard.cntrCache.find(key);
+        if (it != shard.cntrCache.end())
+        {
+            shard.nSize -= (*it).nCharge;
+            shard.cntrCache.erase(it);
+        }
+        if (nCharge > shard.nCapacity)
+        {
+            return;
+        }
+        shard.cntrCache.insert(CKeyValue(key, value, nCharge));
+        shard.nSize += nCharge;
+        Evict(shard);
+    }
+    void Remove(const K& key)
+    {
+        CShard& shard = GetShard(key);
+        boost::unique_lock<boost::mutex> lock(shard.mtxShard);
+        typename CKeyValueContainer::iterator it = shard.cntrCache.find(key);
+        if (it != shard.cntrCache.end())
+        {
+            shard.nSize -= (*it).nCharge;
+            shard.cntrCache.erase(it);
+        }
+    }
+    void Clear()
+    {
+        for (auto& spShard : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(spShard->mtxShard);
+            spShard->cntrCache.clear();
+            spShard->nSize = 0;
+        }
+    }
+    void GetStat(CCacheStat& stat)
+    {
+        stat = CCacheStat();
+        stat.nCapacity = nCapacity;
+        for (auto& spShard : vShard)
+        {
+            boost::unique_lock<boost::mutex> lock(spShard->mtxShard);
+            stat.nSize += spShard->nSize;
+            stat.nCount += spShard->cntrCache.size();
+        }
+        stat.nHit = nHit;
+        stat.nMiss = nMiss;
+        stat.nEviction = nEviction;
+    }
+
+protected:
+    CShard& GetShard(const K& key)
+    {
+        return *vShard[H()(key) % vShard.size()];
+    }
+    void Evict(CShard& shard)
+    {
+        CKeyValueList& listCache = shard.cntrCache.template get<1>();
+        while (shard.nSize > shard.nCapacity && !listCache.empty())
+        {
+            shard.nSize -= listCache.front().nCharge;
+            listCache.pop_front();
+            ++nEviction;
+        }
+    }
+
+protected:
+    std::vector<std::unique_ptr<CShard>> vShard;
+    std::size_t nCapacity;
+    std::atomic<uint64> nHit;
+    std::atomic<uint64> nMiss;
+    std::atomic<uint64> nEviction;
+};
+
 } // namespace xengine
 
 #endif //XENGINE_CACHE_H
@@ -31,6 +31,8 @@ public:
     virtual bool MoveFirst() = 0;
     virtual bool MoveTo(CBufStream& ssKey) = 0;
     virtual bool MoveNext(CBufStream& ssKey, CBufStream& ssValue) = 0;
+    virtual bool MoveBefore(CBufStream& ssKey) = 0;
+    virtual bool MovePrev(CBufStream& ssKey, CBufStream& ssValue) = 0;
 };
 
 class CKVDB
@@ -373,6 +375,50 @@ protected:
         return false;
     }
 
+    // walk keys below keyEnd which start with keyPrefix, in descending order
+    template <typename K, typename P>
+    bool WalkThroughOfPrefixReverse(WalkerFunc fnWalker, const K& keyEnd, const P& keyPrefix)
+    {
+        try
+        {
+            boost::recursive_mutex::scoped_lock lock(mtx);
+
+            if (dbEngine == nullptr)
+                return false;
+
+            CBufStream ssKeyEnd;
+            ssKeyEnd << keyEnd;
+            CBufStream ssKeyPrefix;
+            ssKeyPrefix << keyPrefix;
+
+            if (!dbEngine->MoveBefore(ssKeyEnd))
+                return false;
+
+            for (;;)
+            {
+                CBufStream ssKey, ssValue;
+                if (!dbEngine->MovePrev(ssKey, ssValue))
+                    break;
+
+                if (ssKey.GetSize() < ssKeyPrefix.GetSize())
+                    break;
+
+                if (memcmp(ssKey.GetData(), ssKeyPrefix.GetData(), ssKeyPrefix.GetSize()) != 0)
+                    break;
+
+                if (!fnWalker(ssKey, ssValue))
+                    break;
+            }
+            return true;
+        }
+        catch (std::exception& e)
+        {
+            StdError(__PRETTY_FUNCTION__, e.what());
+        }
+
+        return false;
+    }
+
 protected:
     boost::recursive_mutex mtx;
     CKVDBEngine* dbEngine;
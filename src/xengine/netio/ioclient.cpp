@@ -8,6 +8,7 @@
 #include <boost/bind.hpp>
 
 #include "iocontainer.h"
+#include "ioproc.h"
 #include "util.h"
 
 using namespace std;
@@ -18,10 +19,11 @@ namespace xengine
 
 ///////////////////////////////
 // CIOClient
-CIOClient::CIOClient(CIOContainer* pContainerIn)
-  : pContainer(pContainerIn)
+CIOClient::CIOClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice)
+  : pContainer(pContainerIn), strandClient(ioservice), strandProc(pContainerIn->GetIOProc()->GetIoStrand())
 {
     nRefCount = 0;
+    fClosing = false;
 }
 
 CIOClient::~CIOClient()
@@ -57,12 +59,12 @@ const tcp::endpoint CIOClient::GetLocal()
     return (tcp::endpoint());
 }
 
-void CIOClient::Close()
+void CIOClient::Close(CallBackRelease fnReleasedIn)
 {
-    if (IsSocketOpen())
+    fnReleased = fnReleasedIn;
+    if (!fClosing)
     {
-        CloseSocket();
-        epRemote = tcp::endpoint();
+        CloseInStrand(false);
     }
     Release();
 }
@@ -71,62 +73,59 @@ void CIOClient::Release()
 {
     if (--nRefCount <= 0)
     {
-        if (IsSocketOpen())
-        {
-            CloseSocket();
-            epRemote = tcp::endpoint();
-        }
-        pContainer->ClientClose(this);
+        CloseInStrand(true);
     }
 }
 
 void CIOClient::Shutdown()
 {
-    CloseSocket();
-    epRemote = tcp::endpoint();
+    CloseInStrand(false);
 }
 
 void CIOClient::Accept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
     ++nRefCount;
+    fClosing = false;
     AsyncAccept(acceptor, fnAccepted);
 }
 
 void CIOClient::Connect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
     ++nRefCount;
+    fClosing = false;
     AsyncConnect(epRemote, fnConnected);
 }
 
 void CIOClient::ConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
     ++nRefCount;
+    fClosing = false;
     AsyncConnectByBindAddress(epLocal, epRemote, fnConnected);
 }
 
-void CIOClient::Read(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCompleted)
+void CIOClient::Read(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCompleted, CallBackFunc fnReceived)
 {
     ++nRefCount;
-    AsyncRead(ssRecv, nLength, fnCompleted);
+    RunInStrand(boost::bind(&CIOClient::AsyncRead, this, boost::ref(ssRecv), nLength, BindCompleted(fnCompleted, fnReceived)));
 }
 
 void CIOClient::ReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
 {
     ++nRefCount;
-    AsyncReadUntil(ssRecv, delim, fnCompleted);
+    RunInStrand(boost::bind(&CIOClient::AsyncReadUntil, this, boost::ref(ssRecv), delim, BindCompleted(fnCompleted)));
 }
 
 void CIOClient::Write(CBufStream& ssSend, CallBackFunc fnCompleted)
 {
     ++nRefCount;
-    AsyncWrite(ssSend, fnCompleted);
+    RunInStrand(boost::bind(&CIOClient::AsyncWrite, this, boost::ref(ssSend), BindCompleted(fnCompleted)));
 }
 
 void CIOClient::HandleCompleted(CallBackFunc fnCompleted,
                                 const boost::system::error_code& err, size_t transferred)
 {
     Release();
-    if (err != boost::asio::error::operation_aborted && IsSocketOpen())
+    if (err != boost::asio::error::operation_aborted && !fClosing)
     {
         fnCompleted(!err ? transferred : 0);
     }
@@ -134,18 +133,107 @@ void CIOClient::HandleCompleted(CallBackFunc fnCompleted,
 
 void CIOClient::HandleConnCompleted(CallBackConn fnCompleted, const boost::system::error_code& err)
 {
-    fnCompleted(IsSocketOpen() ? err : boost::asio::error::operation_aborted);
+    fnCompleted(!fClosing ? err : boost::asio::error::operation_aborted);
 
-    if (!IsSocketOpen() && nRefCount)
+    if (fClosing && nRefCount)
     {
         Release();
     }
 }
 
+void CIOClient::HandleIOCompleted(CallBackFunc fnCompleted, CallBackFunc fnReceived,
+                                  const boost::system::error_code& err, size_t transferred)
+{
+    // per connection work, such as framing checks, runs here in parallel with other clients.
+    // Once the client is closing its owner may be going away, so the data is dropped
+    if (!err && fnReceived && !fClosing && IsSocketOpen())
+    {
+        fnReceived(transferred);
+    }
+    if (IsSingleThread())
+    {
+        HandleCompleted(fnCompleted, err, transferred);
+    }
+    else
+    {
+        strandProc.dispatch(boost::bind(&CIOClient::HandleCompleted, this, fnCompleted, err, transferred));
+    }
+}
+
+CIOClient::CallBackIO CIOClient::BindCompleted(CallBackFunc fnCompleted, CallBackFunc fnReceived)
+{
+    return boost::bind(&CIOClient::HandleIOCompleted, this, fnCompleted, fnReceived,
+                       boost::asio::placeholders::error,
+                       boost::asio::placeholders::bytes_transferred);
+}
+
+bool CIOClient::IsSingleThread()
+{
+    return (pContainer->GetIOProc()->GetIoThreadCount() <= 1);
+}
+
+void CIOClient::RunInStrand(const boost::function<void()>& fn)
+{
+    // with one io thread, or none left after a halt, nothing runs concurrently with the caller
+    if (IsSingleThread() || pContainer->GetIOProc()->GetIoService().stopped() || strandClient.running_in_this_thread())
+    {
+        fn();
+    }
+    else
+    {
+        strandClient.post(fn);
+    }
+}
+
+void CIOClient::CloseInStrand(bool fRelease)
+{
+    // the close is queued behind the socket work of the client, never waited for.
+    // A released client goes back to its container only after its socket is closed,
+    // so a reused client can not be hit by a late close
+    epRemote = tcp::endpoint();
+    fClosing = true;
+    if (IsSingleThread() || pContainer->GetIOProc()->GetIoService().stopped() || strandClient.running_in_this_thread())
+    {
+        if (IsSocketOpen())
+        {
+            CloseSocket();
+        }
+        if (fRelease)
+        {
+            ReleaseInProc();
+        }
+    }
+    else
+    {
+        strandClient.post([this, fRelease]() {
+            if (IsSocketOpen())
+            {
+                CloseSocket();
+            }
+            if (fRelease)
+            {
+                strandProc.dispatch([this]() { ReleaseInProc(); });
+            }
+        });
+    }
+}
+
+void CIOClient::ReleaseInProc()
+{
+    // the owner drops the buffers of the client before the client can be reused
+    CallBackRelease fn;
+    fn.swap(fnReleased);
+    if (fn)
+    {
+        fn();
+    }
+    pContainer->ClientClose(this);
+}
+
 ///////////////////////////////
 // CSocketClient
 CSocketClient::CSocketClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice)
-  : CIOClient(pContainerIn), sockClient(ioservice)
+  : CIOClient(pContainerIn, ioservice), sockClient(ioservice)
 {
 }
 
@@ -156,14 +244,14 @@ CSocketClient::~CSocketClient()
 
 void CSocketClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
-    acceptor.async_accept(sockClient, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                  fnAccepted, boost::asio::placeholders::error));
+    acceptor.async_accept(sockClient, strandProc.wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                  fnAccepted, boost::asio::placeholders::error)));
 }
 
 void CSocketClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, strandProc.wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                   fnConnected, boost::asio::placeholders::error)));
 }
 
 void CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -178,38 +266,32 @@ void CSocketClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, cons
         sockClient.open(boost::asio::ip::tcp::v6());
         sockClient.bind(epLocal);
     }
-    sockClient.async_connect(epRemote, boost::bind(&CSocketClient::HandleConnCompleted, this,
-                                                   fnConnected, boost::asio::placeholders::error));
+    sockClient.async_connect(epRemote, strandProc.wrap(boost::bind(&CSocketClient::HandleConnCompleted, this,
+                                                                   fnConnected, boost::asio::placeholders::error)));
 }
 
-void CSocketClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCompleted)
+void CSocketClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackIO fnHandler)
 {
     boost::asio::async_read(sockClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            strandClient.wrap(fnHandler));
 }
 
-void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
+void CSocketClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackIO fnHandler)
 {
     boost::asio::async_read_until(sockClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  strandClient.wrap(fnHandler));
 }
 
-void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
+void CSocketClient::AsyncWrite(CBufStream& ssSend, CallBackIO fnHandler)
 {
     boost::asio::async_write(sockClient,
                              (boost::asio::streambuf&)ssSend,
                              boost::asio::transfer_all(),
-                             boost::bind(&CSocketClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             strandClient.wrap(fnHandler));
 }
 
 const tcp::endpoint CSocketClient::SocketGetRemote()
@@ -237,7 +319,7 @@ bool CSocketClient::IsSocketOpen()
 CSSLClient::CSSLClient(CIOContainer* pContainerIn, boost::asio::io_service& ioserivce,
                        boost::asio::ssl::context& context,
                        const string& strVerifyHost)
-  : CIOClient(pContainerIn), sslClient(ioserivce, context)
+  : CIOClient(pContainerIn, ioserivce), sslClient(ioserivce, context)
 {
     /*if (!strVerifyHost.empty())
     {
@@ -257,17 +339,19 @@ CSSLClient::~CSSLClient()
 void CSSLClient::AsyncAccept(tcp::acceptor& acceptor, CallBackConn fnAccepted)
 {
     acceptor.async_accept(sslClient.lowest_layer(),
-                          boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
-                                      boost::asio::ssl::stream_base::server,
-                                      boost::asio::placeholders::error));
+                          strandClient.wrap(
+                              boost::bind(&CSSLClient::HandleConnected, this, fnAccepted,
+                                          boost::asio::ssl::stream_base::server,
+                                          boost::asio::placeholders::error)));
 }
 
 void CSSLClient::AsyncConnect(const tcp::endpoint& epRemote, CallBackConn fnConnected)
 {
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           strandClient.wrap(
+                                               boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                           boost::asio::ssl::stream_base::client,
+                                                           boost::asio::placeholders::error)));
 }
 
 void CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const tcp::endpoint& epRemote, CallBackConn fnConnected)
@@ -283,38 +367,33 @@ void CSSLClient::AsyncConnectByBindAddress(const tcp::endpoint& epLocal, const t
         sslClient.lowest_layer().bind(epLocal);
     }
     sslClient.lowest_layer().async_connect(epRemote,
-                                           boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
-                                                       boost::asio::ssl::stream_base::client,
-                                                       boost::asio::placeholders::error));
+                                           strandClient.wrap(
+                                               boost::bind(&CSSLClient::HandleConnected, this, fnConnected,
+                                                           boost::asio::ssl::stream_base::client,
+                                                           boost::asio::placeholders::error)));
 }
 
-void CSSLClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackFunc fnCompleted)
+void CSSLClient::AsyncRead(CBufStream& ssRecv, size_t nLength, CallBackIO fnHandler)
 {
     boost::asio::async_read(sslClient,
                             (boost::asio::streambuf&)ssRecv,
                             boost::asio::transfer_exactly(nLength),
-                            boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred));
+                            strandClient.wrap(fnHandler));
 }
 
-void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackFunc fnCompleted)
+void CSSLClient::AsyncReadUntil(CBufStream& ssRecv, const string& delim, CallBackIO fnHandler)
 {
     boost::asio::async_read_until(sslClient,
                                   (boost::asio::streambuf&)ssRecv,
                                   delim,
-                                  boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
+                                  strandClient.wrap(fnHandler));
 }
 
-void CSSLClient::AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted)
+void CSSLClient::AsyncWrite(CBufStream& ssSend, CallBackIO fnHandler)
 {
     boost::asio::async_write(sslClient,
                              (boost::asio::streambuf&)ssSend,
-                             boost::bind(&CSSLClient::HandleCompleted, this, fnCompleted,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred));
+                             strandClient.wrap(fnHandler));
 }
 
 const tcp::endpoint CSSLClient::SocketGetRemote()
@@ -343,12 +422,12 @@ void CSSLClient::HandleConnected(CallBackConn fnHandshaked,
 {
     if (!err)
     {
-        sslClient.async_handshake(type, boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
-                                                    boost::asio::placeholders::error));
+        sslClient.async_handshake(type, strandClient.wrap(strandProc.wrap(boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked,
+                                                                                      boost::asio::placeholders::error))));
     }
     else
     {
-        HandleConnCompleted(fnHandshaked, err);
+        strandProc.dispatch(boost::bind(&CSSLClient::HandleConnCompleted, this, fnHandshaked, err));
     }
 }
 
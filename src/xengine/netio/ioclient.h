@@ -7,6 +7,7 @@
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
+#include <atomic>
 #include <boost/function.hpp>
 #include <string>
 
@@ -22,18 +23,25 @@ class CIOClient
 public:
     typedef boost::function<void(std::size_t)> CallBackFunc;
     typedef boost::function<void(const boost::system::error_code&)> CallBackConn;
+    typedef boost::function<void(const boost::system::error_code&, std::size_t)> CallBackIO;
+    typedef boost::function<void()> CallBackRelease;
 
-    CIOClient(CIOContainer* pContainerIn);
+    CIOClient(CIOContainer* pContainerIn, boost::asio::io_service& ioservice);
     virtual ~CIOClient();
     const boost::asio::ip::tcp::endpoint GetRemote();
     const boost::asio::ip::tcp::endpoint GetLocal();
-    void Close();
+    // fnReleased runs on the io proc strand once the socket is closed and no
+    // socket work of the client is pending, the buffers given to Read and Write
+    // must stay alive until then
+    void Close(CallBackRelease fnReleasedIn = CallBackRelease());
     void Release();
     void Shutdown();
     void Accept(boost::asio::ip::tcp::acceptor& acceptor, CallBackConn fnAccepted);
     void Connect(const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected);
     void ConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected);
-    void Read(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted);
+    // fnReceived runs on the client strand once the data is in ssRecv, before
+    // fnCompleted is handed to the io proc strand
+    void Read(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted, CallBackFunc fnReceived = CallBackFunc());
     void ReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted);
     void Write(CBufStream& ssSend, CallBackFunc fnCompleted);
 
@@ -41,6 +49,13 @@ protected:
     void HandleCompleted(CallBackFunc fnCompleted,
                          const boost::system::error_code& err, std::size_t transferred);
     void HandleConnCompleted(CallBackConn fnCompleted, const boost::system::error_code& err);
+    void HandleIOCompleted(CallBackFunc fnCompleted, CallBackFunc fnReceived,
+                           const boost::system::error_code& err, std::size_t transferred);
+    CallBackIO BindCompleted(CallBackFunc fnCompleted, CallBackFunc fnReceived = CallBackFunc());
+    bool IsSingleThread();
+    void RunInStrand(const boost::function<void()>& fn);
+    void CloseInStrand(bool fRelease);
+    void ReleaseInProc();
     virtual const boost::asio::ip::tcp::endpoint SocketGetRemote() = 0;
     virtual const boost::asio::ip::tcp::endpoint SocketGetLocal() = 0;
     virtual void CloseSocket() = 0;
@@ -48,14 +63,21 @@ protected:
     virtual void AsyncAccept(boost::asio::ip::tcp::acceptor& acceptor, CallBackConn fnAccepted) = 0;
     virtual void AsyncConnect(const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) = 0;
     virtual void AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) = 0;
-    virtual void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) = 0;
-    virtual void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) = 0;
-    virtual void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) = 0;
+    virtual void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackIO fnHandler) = 0;
+    virtual void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackIO fnHandler) = 0;
+    virtual void AsyncWrite(CBufStream& ssSend, CallBackIO fnHandler) = 0;
 
 protected:
     CIOContainer* pContainer;
     boost::asio::ip::tcp::endpoint epRemote;
     int nRefCount;
+    // set when the close is requested, read from both strands instead of the socket state
+    std::atomic<bool> fClosing;
+    CallBackRelease fnReleased;
+    // Socket work and fnReceived of the client run in its own strand. With
+    // several io threads, completions are then handed to the io proc strand
+    boost::asio::io_service::strand strandClient;
+    boost::asio::io_service::strand& strandProc;
 };
 
 class CSocketClient : public CIOClient
@@ -68,9 +90,9 @@ protected:
     void AsyncAccept(boost::asio::ip::tcp::acceptor& acceptor, CallBackConn fnAccepted) override;
     void AsyncConnect(const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
     void AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
-    void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) override;
-    void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) override;
-    void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) override;
+    void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackIO fnHandler) override;
+    void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackIO fnHandler) override;
+    void AsyncWrite(CBufStream& ssSend, CallBackIO fnHandler) override;
     const boost::asio::ip::tcp::endpoint SocketGetRemote() override;
     const boost::asio::ip::tcp::endpoint SocketGetLocal() override;
     void CloseSocket() override;
@@ -92,9 +114,9 @@ protected:
     void AsyncAccept(boost::asio::ip::tcp::acceptor& acceptor, CallBackConn fnAccepted) override;
     void AsyncConnect(const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
     void AsyncConnectByBindAddress(const boost::asio::ip::tcp::endpoint& epLocal, const boost::asio::ip::tcp::endpoint& epRemote, CallBackConn fnConnected) override;
-    void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackFunc fnCompleted) override;
-    void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackFunc fnCompleted) override;
-    void AsyncWrite(CBufStream& ssSend, CallBackFunc fnCompleted) override;
+    void AsyncRead(CBufStream& ssRecv, std::size_t nLength, CallBackIO fnHandler) override;
+    void AsyncReadUntil(CBufStream& ssRecv, const std::string& delim, CallBackIO fnHandler) override;
+    void AsyncWrite(CBufStream& ssSend, CallBackIO fnHandler) override;
     const boost::asio::ip::tcp::endpoint SocketGetRemote() override;
     const boost::asio::ip::tcp::endpoint SocketGetLocal() override;
     void CloseSocket() override;
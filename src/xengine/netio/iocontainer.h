@@ -30,6 +30,10 @@ public:
     virtual void ClientClose(CIOClient* pClient) = 0;
     virtual std::size_t GetIdleCount();
     virtual const boost::asio::ip::tcp::endpoint GetServiceEndpoint();
+    CIOProc* GetIOProc()
+    {
+        return pIOProc;
+    }
 
 protected:
     CIOProc* pIOProc;
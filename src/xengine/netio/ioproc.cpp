@@ -5,6 +5,7 @@
 #include "ioproc.h"
 
 #include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace std;
 using boost::asio::ip::tcp;
@@ -73,7 +74,7 @@ void CIOCompletion::Reset()
 
 CIOProc::CIOProc(const string& ownKeyIn)
   : IIOProc(ownKeyIn),
-    thrIOProc(ownKeyIn, boost::bind(&CIOProc::IOThreadFunc, this)),
+    thrIOProc(ownKeyIn, boost::bind(&CIOProc::IOThreadFunc, this)), nIoThreadCount(1),
     ioStrand(ioService), resolverHost(ioService), ioOutBound(this), ioSSLOutBound(this),
     timerHeartbeat(ioService, IOPROC_HEARTBEAT)
 {
@@ -93,6 +94,16 @@ boost::asio::io_service::strand& CIOProc::GetIoStrand()
     return ioStrand;
 }
 
+void CIOProc::SetIoThreadCount(size_t nThreadCount)
+{
+    nIoThreadCount = (nThreadCount > 0 ? nThreadCount : 1);
+}
+
+size_t CIOProc::GetIoThreadCount() const
+{
+    return nIoThreadCount;
+}
+
 bool CIOProc::DispatchEvent(CEvent* pEvent)
 {
     bool fResult = false;
@@ -266,9 +277,9 @@ void CIOProc::ResolveHost(const CNetHost& host)
     ss << host.nPort;
     tcp::resolver::query query(host.strHost, ss.str());
     resolverHost.async_resolve(query,
-                               boost::bind(&CIOProc::IOProcHandleResolved, this, host,
-                                           boost::asio::placeholders::error,
-                                           boost::asio::placeholders::iterator));
+                               ioStrand.wrap(boost::bind(&CIOProc::IOProcHandleResolved, this, host,
+                                                         boost::asio::placeholders::error,
+                                                         boost::asio::placeholders::iterator)));
 }
 
 void CIOProc::EnterLoop()
@@ -318,12 +329,20 @@ void CIOProc::IOThreadFunc()
 {
     ioService.reset();
 
-    timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+    timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
     EnterLoop();
 
+    boost::thread_group thrWorker;
+    for (size_t i = 1; i < nIoThreadCount; i++)
+    {
+        thrWorker.create_thread(boost::bind(&CIOProc::IOWorkerFunc, this));
+    }
+
     ioService.run();
 
+    thrWorker.join_all();
+
     LeaveLoop();
 
     timerHeartbeat.cancel();
@@ -333,13 +352,18 @@ void CIOProc::IOThreadFunc()
     mapTimerByExpiry.clear();
 }
 
+void CIOProc::IOWorkerFunc()
+{
+    ioService.run();
+}
+
 void CIOProc::IOProcHeartBeat(const boost::system::error_code& err)
 {
     if (!err)
     {
         /* restart deadline timer */
         timerHeartbeat.expires_at(timerHeartbeat.expires_at() + IOPROC_HEARTBEAT);
-        timerHeartbeat.async_wait(boost::bind(&CIOProc::IOProcHeartBeat, this, _1));
+        timerHeartbeat.async_wait(ioStrand.wrap(boost::bind(&CIOProc::IOProcHeartBeat, this, _1)));
 
         /* handle io timer */
         IOProcPollTimer();
@@ -60,6 +60,8 @@ public:
     virtual ~CIOProc();
     boost::asio::io_service& GetIoService();
     boost::asio::io_service::strand& GetIoStrand();
+    void SetIoThreadCount(std::size_t nThreadCount);
+    std::size_t GetIoThreadCount() const;
     virtual bool DispatchEvent(CEvent* pEvent) override;
     virtual CIOClient* CreateIOClient(CIOContainer* pContainer);
 
@@ -96,6 +98,7 @@ protected:
 
 private:
     void IOThreadFunc();
+    void IOWorkerFunc();
     void IOProcHeartBeat(const boost::system::error_code& err);
     void IOProcPollTimer();
     void IOProcHandleEvent(CEvent* pEvent, std::shared_ptr<CIOCompletion> spComplt);
@@ -104,6 +107,7 @@ private:
 
 private:
     CThread thrIOProc;
+    std::size_t nIoThreadCount;
     boost::asio::io_service ioService;
     boost::asio::io_service::strand ioStrand;
     boost::asio::ip::tcp::resolver resolverHost;
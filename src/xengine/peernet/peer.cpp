@@ -27,11 +27,11 @@ CPeer::~CPeer()
     Close();
 }
 
-void CPeer::Close()
+void CPeer::Close(CIOClient::CallBackRelease fnReleased)
 {
     if (pClient)
     {
-        pClient->Close();
+        pClient->Close(fnReleased);
         pClient = nullptr;
     }
 }
@@ -88,11 +88,11 @@ CBufStream& CPeer::WriteStream()
     return ssSend[indexStream];
 }
 
-void CPeer::Read(size_t nLength, CompltFunc fnComplt)
+void CPeer::Read(size_t nLength, CompltFunc fnComplt, CIOClient::CallBackFunc fnReceived)
 {
     ssRecv.Clear();
     pClient->Read(ssRecv, nLength,
-                  boost::bind(&CPeer::HandleRead, this, _1, fnComplt));
+                  boost::bind(&CPeer::HandleRead, this, _1, fnComplt), fnReceived);
 }
 
 void CPeer::Write()
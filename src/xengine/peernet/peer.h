@@ -25,7 +25,7 @@ public:
 
     CPeer(CPeerNet* pPeerNetIn, CIOClient* pClientIn, uint64 nNonceIn, bool fInBoundIn);
     virtual ~CPeer();
-    void Close();
+    void Close(CIOClient::CallBackRelease fnReleased = CIOClient::CallBackRelease());
     uint64 GetNonce();
     bool IsInBound();
     bool IsWriteable();
@@ -38,7 +38,7 @@ protected:
     CBufStream& ReadStream();
     CBufStream& WriteStream();
 
-    void Read(std::size_t nLength, CompltFunc fnComplt);
+    void Read(std::size_t nLength, CompltFunc fnComplt, CIOClient::CallBackFunc fnReceived = CIOClient::CallBackFunc());
     void Write();
 
     void HandleRead(std::size_t nTransferred, CompltFunc fnComplt);
@@ -29,6 +29,11 @@ CPeerNet::CPeerNet(const string& ownKeyIn)
 
 CPeerNet::~CPeerNet()
 {
+    for (CPeer* pPeer : setClosingPeer)
+    {
+        delete pPeer;
+    }
+    setClosingPeer.clear();
     if (pGarbagePeer)
     {
         delete pGarbagePeer;
@@ -403,7 +408,16 @@ CPeer* CPeerNet::CreatePeer(CIOClient* pClient, uint64 nNonce, bool fInBound)
 
 void CPeerNet::DestroyPeer(CPeer* pPeer)
 {
-    pPeer->Close();
+    // pending reads and writes of the client still use the buffers and callbacks
+    // of the peer, so it is freed only after its client is released
+    setClosingPeer.insert(pPeer);
+    pPeer->Close(boost::bind(&CPeerNet::HandlePeerReleased, this, pPeer));
+}
+
+void CPeerNet::HandlePeerReleased(CPeer* pPeer)
+{
+    // the release may run inside a callback of the peer, keep it for one more round
+    setClosingPeer.erase(pPeer);
     if (pGarbagePeer)
     {
         delete pGarbagePeer;
@@ -85,6 +85,7 @@ protected:
     virtual std::string GetLocalIP();
     virtual CPeer* CreatePeer(CIOClient* pClient, uint64 nNonce, bool fInBound);
     virtual void DestroyPeer(CPeer* pPeer);
+    void HandlePeerReleased(CPeer* pPeer);
     virtual CPeerInfo* GetPeerInfo(CPeer* pPeer, CPeerInfo* pInfo = nullptr);
     bool HandleEvent(CEventPeerNetGetIP& eventGetIP) override;
     bool HandleEvent(CEventPeerNetGetCount& eventGetCount) override;
@@ -109,6 +110,7 @@ protected:
 private:
     CEndpointManager epMngr;
     std::map<uint64, CPeer*> mapPeer;
+    std::set<CPeer*> setClosingPeer;
     CPeer* pGarbagePeer;
 };
 
@@ -63,6 +63,16 @@ public:
         return (*this);
     }
 
+    CStream& Skip(std::size_t n)
+    {
+        ios.ignore(n);
+        if (ios.gcount() != n)
+        {
+            throw std::runtime_error((std::string("stream skip error. To be skipping ") + std::to_string(n) + " but " + std::to_string(ios.gcount())).c_str());
+        }
+        return (*this);
+    }
+
     template <typename T, typename O>
     CStream& Serialize(T& t, O& opt)
     {
@@ -314,6 +324,28 @@ public:
     }
 };
 
+// Read only stream over a memory block owned by the caller
+class CReadStream : public std::streambuf, public CStream
+{
+public:
+    CReadStream(const char* pData, std::size_t nSize)
+      : CStream(this)
+    {
+        char* p = const_cast<char*>(pData);
+        setg(p, p, p + nSize);
+    }
+
+    std::size_t GetSize()
+    {
+        return (std::size_t)(egptr() - gptr());
+    }
+
+    std::size_t GetCurPos() const
+    {
+        return (std::size_t)(gptr() - eback());
+    }
+};
+
 // File stream with compatible serialization mothed
 class CFileStream : public std::filebuf, public CStream
 {
@@ -0,0 +1,100 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef XENGINE_STRUCTURE_ARENA_H
+#define XENGINE_STRUCTURE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xengine
+{
+
+// Object arena. Slots are carved from chunks of N objects and recycled
+// through a free list, chunks are only returned to the system by Clear().
+// Not thread safe, Clear() does not run destructors of live objects.
+template <typename T, std::size_t N = 4096>
+class CObjectArena
+{
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+public:
+    CObjectArena()
+      : nChunkUsed(N), nLive(0) {}
+    CObjectArena(const CObjectArena&) = delete;
+    CObjectArena& operator=(const CObjectArena&) = delete;
+
+    std::size_t Size() const
+    {
+        return nLive;
+    }
+    std::size_t Capacity() const
+    {
+        return vChunk.size() * N;
+    }
+    void* Allocate()
+    {
+        ++nLive;
+        if (!vFree.empty())
+        {
+            void* p = vFree.back();
+            vFree.pop_back();
+            return p;
+        }
+        if (nChunkUsed == N)
+        {
+            vChunk.push_back(std::unique_ptr<Slot[]>(new Slot[N]));
+            nChunkUsed = 0;
+        }
+        return &vChunk.back()[nChunkUsed++];
+    }
+    void Deallocate(void* p)
+    {
+        vFree.push_back(p);
+        --nLive;
+    }
+    template <typename... Args>
+    T* New(Args&&... args)
+    {
+        void* p = Allocate();
+        try
+        {
+            return ::new (p) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Deallocate(p);
+            throw;
+        }
+    }
+    void Delete(T* p)
+    {
+        if (p != nullptr)
+        {
+            p->~T();
+            Deallocate(p);
+        }
+    }
+    void Clear()
+    {
+        vChunk.clear();
+        vFree.clear();
+        nChunkUsed = N;
+        nLive = 0;
+    }
+
+protected:
+    std::vector<std::unique_ptr<Slot[]>> vChunk;
+    std::vector<void*> vFree;
+    std::size_t nChunkUsed;
+    std::size_t nLive;
+};
+
+} // namespace xengine
+
+#endif //XENGINE_STRUCTURE_ARENA_H
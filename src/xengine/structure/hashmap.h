@@ -0,0 +1,306 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef XENGINE_STRUCTURE_HASHMAP_H
+#define XENGINE_STRUCTURE_HASHMAP_H
+
+#include <boost/functional/hash.hpp>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace xengine
+{
+
+// Key of a map slot
+template <typename K, typename V>
+class CSelectFirst
+{
+public:
+    const K& operator()(const std::pair<K, V>& value) const
+    {
+        return value.first;
+    }
+};
+
+// Open addressing hash table with linear probing and backward shift deletion.
+// Slots live in one flat array, so there is no per-entry allocation.
+// The key is taken from a slot by KeyOf, so a value that already holds its
+// key (an index entry pointer) is stored without a copy of the key.
+// Any insertion may rehash: iterators, pointers and references to entries
+// are invalidated by insertion, and iterators by erasure.
+template <typename K, typename T, typename KeyOf, typename H = boost::hash<K>, typename E = std::equal_to<K>>
+class COpenHashTable
+{
+public:
+    typedef T value_type;
+
+    template <typename M, typename R>
+    class CIterator
+    {
+        friend class COpenHashTable;
+
+    public:
+        CIterator()
+          : pMap(nullptr), nPos(0) {}
+        CIterator(M* pMapIn, std::size_t nPosIn)
+          : pMap(pMapIn), nPos(nPosIn)
+        {
+            Skip();
+        }
+        template <typename M2, typename R2>
+        CIterator(const CIterator<M2, R2>& it)
+          : pMap(it.pMap), nPos(it.nPos) {}
+        R& operator*() const
+        {
+            return pMap->vSlot[nPos];
+        }
+        R* operator->() const
+        {
+            return &pMap->vSlot[nPos];
+        }
+        CIterator& operator++()
+        {
+            ++nPos;
+            Skip();
+            return *this;
+        }
+        CIterator operator++(int)
+        {
+            CIterator it(*this);
+            ++(*this);
+            return it;
+        }
+        template <typename M2, typename R2>
+        bool operator==(const CIterator<M2, R2>& it) const
+        {
+            return (nPos == it.nPos);
+        }
+        template <typename M2, typename R2>
+        bool operator!=(const CIterator<M2, R2>& it) const
+        {
+            return (nPos != it.nPos);
+        }
+
+    protected:
+        void Skip()
+        {
+            while (nPos < pMap->vUsed.size() && !pMap->vUsed[nPos])
+            {
+                ++nPos;
+            }
+        }
+
+    public:
+        M* pMap;
+        std::size_t nPos;
+    };
+    typedef CIterator<COpenHashTable, value_type> iterator;
+    typedef CIterator<const COpenHashTable, const value_type> const_iterator;
+
+public:
+    COpenHashTable()
+      : nSize(0) {}
+    std::size_t size() const
+    {
+        return nSize;
+    }
+    bool empty() const
+    {
+        return (nSize == 0);
+    }
+    std::size_t bucket_count() const
+    {
+        return vSlot.size();
+    }
+    void clear()
+    {
+        vSlot.clear();
+        vUsed.clear();
+        nSize = 0;
+    }
+    void reserve(std::size_t n)
+    {
+        std::size_t nCapacity = 16;
+        while (nCapacity * 3 < n * 4)
+        {
+            nCapacity <<= 1;
+        }
+        if (nCapacity > vSlot.size())
+        {
+            Rehash(nCapacity);
+        }
+    }
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+    iterator end()
+    {
+        return iterator(this, vSlot.size());
+    }
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const
+    {
+        return const_iterator(this, vSlot.size());
+    }
+    iterator find(const K& key)
+    {
+        return iterator(this, Lookup(key));
+    }
+    const_iterator find(const K& key) const
+    {
+        return const_iterator(this, Lookup(key));
+    }
+    std::size_t count(const K& key) const
+    {
+        return (Lookup(key) != vSlot.size() ? 1 : 0);
+    }
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        std::size_t nPos = Lookup(keyof(value));
+        if (nPos != vSlot.size())
+        {
+            return std::make_pair(iterator(this, nPos), false);
+        }
+        nPos = Emplace(value);
+        return std::make_pair(iterator(this, nPos), true);
+    }
+    std::size_t erase(const K& key)
+    {
+        std::size_t nPos = Lookup(key);
+        if (nPos == vSlot.size())
+        {
+            return 0;
+        }
+        Remove(nPos);
+        return 1;
+    }
+    void erase(const_iterator it)
+    {
+        Remove(it.nPos);
+    }
+
+protected:
+    std::size_t Home(const K& key) const
+    {
+        // spread low quality hashes before masking
+        uint64_t h = static_cast<uint64_t>(hasher(key));
+        h ^= (h >> 33);
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= (h >> 33);
+        return static_cast<std::size_t>(h) & (vSlot.size() - 1);
+    }
+    std::size_t Lookup(const K& key) const
+    {
+        if (nSize == 0)
+        {
+            return vSlot.size();
+        }
+        const std::size_t nMask = vSlot.size() - 1;
+        for (std::size_t i = Home(key);; i = (i + 1) & nMask)
+        {
+            if (!vUsed[i])
+            {
+                return vSlot.size();
+            }
+            if (equal(keyof(vSlot[i]), key))
+            {
+                return i;
+            }
+        }
+    }
+    std::size_t Emplace(const value_type& value)
+    {
+        if ((nSize + 1) * 4 > vSlot.size() * 3)
+        {
+            Rehash(vSlot.empty() ? 16 : vSlot.size() * 2);
+        }
+        const std::size_t nMask = vSlot.size() - 1;
+        std::size_t i = Home(keyof(value));
+        while (vUsed[i])
+        {
+            i = (i + 1) & nMask;
+        }
+        vSlot[i] = value;
+        vUsed[i] = 1;
+        ++nSize;
+        return i;
+    }
+    void Remove(std::size_t nPos)
+    {
+        const std::size_t nMask = vSlot.size() - 1;
+        std::size_t i = nPos;
+        for (std::size_t j = (i + 1) & nMask; vUsed[j]; j = (j + 1) & nMask)
+        {
+            // keep the entry at j if its home lies cyclically in (i, j]
+            std::size_t k = Home(keyof(vSlot[j]));
+            if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+            {
+                continue;
+            }
+            vSlot[i] = std::move(vSlot[j]);
+            i = j;
+        }
+        vSlot[i] = value_type();
+        vUsed[i] = 0;
+        --nSize;
+    }
+    void Rehash(std::size_t nCapacity)
+    {
+        std::vector<value_type> vOldSlot(nCapacity);
+        std::vector<uint8_t> vOldUsed(nCapacity, 0);
+        vSlot.swap(vOldSlot);
+        vUsed.swap(vOldUsed);
+
+        const std::size_t nMask = nCapacity - 1;
+        for (std::size_t n = 0; n < vOldSlot.size(); n++)
+        {
+            if (vOldUsed[n])
+            {
+                std::size_t i = Home(keyof(vOldSlot[n]));
+                while (vUsed[i])
+                {
+                    i = (i + 1) & nMask;
+                }
+                vSlot[i] = std::move(vOldSlot[n]);
+                vUsed[i] = 1;
+            }
+        }
+    }
+
+protected:
+    std::vector<value_type> vSlot;
+    std::vector<uint8_t> vUsed;
+    std::size_t nSize;
+    KeyOf keyof;
+    H hasher;
+    E equal;
+};
+
+// Open addressing hash map of key and value pairs
+template <typename K, typename V, typename H = boost::hash<K>, typename E = std::equal_to<K>>
+class COpenHashMap : public COpenHashTable<K, std::pair<K, V>, CSelectFirst<K, V>, H, E>
+{
+    typedef COpenHashTable<K, std::pair<K, V>, CSelectFirst<K, V>, H, E> base;
+
+public:
+    V& operator[](const K& key)
+    {
+        std::size_t nPos = base::Lookup(key);
+        if (nPos == base::vSlot.size())
+        {
+            nPos = base::Emplace(std::make_pair(key, V()));
+        }
+        return base::vSlot[nPos].second;
+    }
+};
+
+} // namespace xengine
+
+#endif //XENGINE_STRUCTURE_HASHMAP_H
@@ -0,0 +1,225 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef XENGINE_STRUCTURE_POOLALLOC_H
+#define XENGINE_STRUCTURE_POOLALLOC_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xengine
+{
+
+// Free lists of fixed size nodes carved from chunks. Single owner and not
+// thread safe, the owner serializes access and destroys its containers first.
+// Freed nodes are reused but chunks are only returned when the arena is
+// destroyed, so the owner swaps in a new arena once IsSparse() (see
+// CTxPoolView::Compact) to bound the memory to a few times the live nodes.
+class CNodeArena
+{
+public:
+    enum
+    {
+        CHUNK_NODE_COUNT = 256,
+        SPARSE_CHUNK_COUNT = 16
+    };
+
+public:
+    CNodeArena()
+      : nLive(0) {}
+    CNodeArena(const CNodeArena&) = delete;
+    CNodeArena& operator=(const CNodeArena&) = delete;
+    ~CNodeArena()
+    {
+        assert(nLive == 0);
+        for (void* p : vChunk)
+        {
+            ::operator delete(p);
+        }
+    }
+    void* Allocate(std::size_t nSize)
+    {
+        CFreeNode*& pHead = GetFreeList(nSize);
+        if (pHead == nullptr)
+        {
+            Grow(pHead, NodeSize(nSize));
+        }
+        CFreeNode* pNode = pHead;
+        pHead = pNode->pNext;
+        ++nLive;
+        return pNode;
+    }
+    void Free(void* p, std::size_t nSize)
+    {
+        assert(nLive > 0);
+        CFreeNode*& pHead = GetFreeList(nSize);
+        CFreeNode* pNode = static_cast<CFreeNode*>(p);
+        pNode->pNext = pHead;
+        pHead = pNode;
+        --nLive;
+    }
+    std::size_t GetLiveCount() const
+    {
+        return nLive;
+    }
+    std::size_t GetChunkCount() const
+    {
+        return vChunk.size();
+    }
+    // less than a quarter of the carved nodes are in use
+    bool IsSparse() const
+    {
+        return (vChunk.size() > SPARSE_CHUNK_COUNT && nLive * 4 < vChunk.size() * CHUNK_NODE_COUNT);
+    }
+
+protected:
+    struct CFreeNode
+    {
+        CFreeNode* pNext;
+    };
+    static std::size_t NodeSize(std::size_t nSize)
+    {
+        const std::size_t nAlign = alignof(std::max_align_t);
+        return ((std::max(nSize, sizeof(CFreeNode)) + nAlign - 1) / nAlign * nAlign);
+    }
+    CFreeNode*& GetFreeList(std::size_t nSize)
+    {
+        // a container family uses a handful of node sizes
+        for (auto& vd : vFreeList)
+        {
+            if (vd.first == nSize)
+            {
+                return vd.second;
+            }
+        }
+        vFreeList.push_back(std::make_pair(nSize, (CFreeNode*)nullptr));
+        return vFreeList.back().second;
+    }
+    void Grow(CFreeNode*& pHead, std::size_t nNodeSize)
+    {
+        char* pChunk = static_cast<char*>(::operator new(nNodeSize * CHUNK_NODE_COUNT));
+        vChunk.push_back(pChunk);
+        for (std::size_t i = CHUNK_NODE_COUNT; i > 0; i--)
+        {
+            CFreeNode* pNode = reinterpret_cast<CFreeNode*>(pChunk + (i - 1) * nNodeSize);
+            pNode->pNext = pHead;
+            pHead = pNode;
+        }
+    }
+
+protected:
+    std::vector<std::pair<std::size_t, CFreeNode*>> vFreeList;
+    std::vector<void*> vChunk;
+    std::size_t nLive;
+};
+
+// Node allocator for map/set/multi_index containers. Single objects come from
+// the arena of the owner of the containers, which must outlive them. Arrays
+// (e.g. hash buckets) and allocators without an arena fall back to operator new.
+// The arena follows the container on assignment and swap inside the owner, a
+// copy constructed container gets no arena so that it can leave the owner.
+template <typename T>
+class CPooledAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef CPooledAllocator<U> other;
+    };
+
+public:
+    CPooledAllocator()
+      : pArena(nullptr) {}
+    explicit CPooledAllocator(CNodeArena* pArenaIn)
+      : pArena(pArenaIn) {}
+    template <typename U>
+    CPooledAllocator(const CPooledAllocator<U>& alloc)
+      : pArena(alloc.GetArena()) {}
+
+    CNodeArena* GetArena() const
+    {
+        return pArena;
+    }
+    CPooledAllocator select_on_container_copy_construction() const
+    {
+        return CPooledAllocator();
+    }
+
+    pointer address(reference r) const
+    {
+        return &r;
+    }
+    const_pointer address(const_reference r) const
+    {
+        return &r;
+    }
+    size_type max_size() const
+    {
+        return (size_type(-1) / sizeof(T));
+    }
+    pointer allocate(size_type n, const void* = nullptr)
+    {
+        if (n > max_size())
+        {
+            throw std::bad_alloc();
+        }
+        void* p = (n == 1 && pArena) ? pArena->Allocate(sizeof(T)) : ::operator new(n * sizeof(T));
+        return static_cast<pointer>(p);
+    }
+    void deallocate(pointer p, size_type n)
+    {
+        if (n == 1 && pArena)
+        {
+            pArena->Free(p, sizeof(T));
+        }
+        else
+        {
+            ::operator delete(p);
+        }
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new ((void*)p) U(std::forward<Args>(args)...);
+    }
+    template <typename U>
+    void destroy(U* p)
+    {
+        p->~U();
+    }
+    template <typename U>
+    friend bool operator==(const CPooledAllocator& a, const CPooledAllocator<U>& b)
+    {
+        return (a.pArena == b.GetArena());
+    }
+    template <typename U>
+    friend bool operator!=(const CPooledAllocator& a, const CPooledAllocator<U>& b)
+    {
+        return (a.pArena != b.GetArena());
+    }
+
+protected:
+    CNodeArena* pArena;
+};
+
+} // namespace xengine
+
+#endif //XENGINE_STRUCTURE_POOLALLOC_H
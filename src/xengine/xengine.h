@@ -33,6 +33,9 @@
 #include <rwlock.h>
 #include <stream/datastream.h>
 #include <stream/stream.h>
+#include <structure/arena.h>
+#include <structure/hashmap.h>
+#include <structure/poolalloc.h>
 #include <structure/tree.h>
 #include <type.h>
 #include <util.h>
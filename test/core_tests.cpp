@@ -0,0 +1,97 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "core.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "crypto.h"
+#include "key.h"
+#include "test_big.h"
+#include "transaction.h"
+
+using namespace std;
+using namespace xengine;
+using namespace bigbang;
+
+BOOST_FIXTURE_TEST_SUITE(core_tests, BasicUtfSetup)
+
+class CTestCoreProtocol : public CCoreProtocol
+{
+public:
+    using CCoreProtocol::VerifyTxSignature;
+    size_t GetVerifiedSigCount() const
+    {
+        return cacheVerifiedSig.GetCount();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(verifiedsigcache)
+{
+    CTestCoreProtocol core;
+    core.InitializeGenesisBlock();
+    const uint256 fork = core.GetGenesisBlockHash();
+
+    crypto::CKey key;
+    BOOST_CHECK(key.Renew());
+    CDestination destIn(key.GetPubKey());
+
+    CTransaction tx;
+    tx.nType = CTransaction::TX_TOKEN;
+    tx.nTimeStamp = 1575043200;
+    tx.hashAnchor = fork;
+    tx.vInput.push_back(CTxIn(CTxOutPoint(uint256(uint64(2)), 0)));
+    tx.sendTo = CDestination(crypto::CPubKey(uint256(uint64(1))));
+    tx.nAmount = 100;
+    tx.nTxFee = 10000;
+    BOOST_CHECK(key.Sign(tx.GetSignatureHash(), tx.vchSig));
+    const vector<uint8> vchSig = tx.vchSig;
+    vector<uint8> vchBadSig = vchSig;
+    vchBadSig[0] ^= 1;
+
+    // a bad signature is not cached, a good one is
+    BOOST_CHECK(!core.VerifyTxSignature(tx, destIn, vchBadSig, 100, fork));
+    BOOST_CHECK(core.GetVerifiedSigCount() == 0);
+    BOOST_CHECK(core.VerifyTxSignature(tx, destIn, vchSig, 100, fork));
+    BOOST_CHECK(core.GetVerifiedSigCount() == 1);
+
+    // the same tx at the same height hits the cache without checking the signature
+    BOOST_CHECK(core.VerifyTxSignature(tx, destIn, vchBadSig, 100, fork));
+    BOOST_CHECK(core.GetVerifiedSigCount() == 1);
+
+    // a public key signature does not read the height, another height hits too
+    BOOST_CHECK(core.VerifyTxSignature(tx, destIn, vchBadSig, 101, fork));
+    BOOST_CHECK(core.GetVerifiedSigCount() == 1);
+
+    // another fork misses and is checked again
+    BOOST_CHECK(!core.VerifyTxSignature(tx, destIn, vchBadSig, 100, uint256(uint64(3))));
+    BOOST_CHECK(core.VerifyTxSignature(tx, destIn, vchSig, 100, uint256(uint64(3))));
+    BOOST_CHECK(core.GetVerifiedSigCount() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(workerpool)
+{
+    vector<int> vCount(1000, 0);
+    boost::function<void(size_t)> fnTask = [&](size_t i) { vCount[i]++; };
+
+    // without workers the caller runs all tasks
+    CCoreWorkerPool pool;
+    pool.Execute(vCount.size(), fnTask);
+    BOOST_CHECK(count(vCount.begin(), vCount.end(), 1) == (int)vCount.size());
+
+    // the same workers run every batch
+    pool.Start(3);
+    for (int i = 2; i <= 10; i++)
+    {
+        pool.Execute(vCount.size(), fnTask);
+        BOOST_CHECK(count(vCount.begin(), vCount.end(), i) == (int)vCount.size());
+    }
+    pool.Execute(0, fnTask);
+    pool.Stop();
+
+    pool.Execute(vCount.size(), fnTask);
+    BOOST_CHECK(count(vCount.begin(), vCount.end(), 11) == (int)vCount.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -112,4 +112,145 @@ BOOST_AUTO_TEST_CASE(multisign_defect)
     std::cout << "multisign verify2 count : " << count << "; time per count : " << verifyTime2 / count << "us.; time per key: " << verifyTime2 / signCount << "us." << std::endl;
 }
 
+// the batch kernels against the routines of single and multiple signature verification
+BOOST_AUTO_TEST_CASE(batch_unpack)
+{
+    size_t nValid = 0;
+    for (int k = 0; k < 4000; k++)
+    {
+        uint8 md32[32];
+        randombytes_buf(md32, 32);
+        if (k % 4 == 0)
+        {
+            CEdwards25519 point;
+            point.Generate(CSC25519(md32));
+            point.Pack(md32);
+        }
+
+        CEdwards25519 p0, p1;
+        bool f0 = p0.Unpack(md32);
+        BOOST_CHECK(p1.UnpackFast(md32) == f0);
+        if (f0)
+        {
+            uint8 pack0[32], pack1[32];
+            p0.Pack(pack0);
+            p1.Pack(pack1);
+            BOOST_CHECK(memcmp(pack0, pack1, 32) == 0);
+            nValid++;
+        }
+
+        uint8 mv[32];
+        randombytes_buf(mv, 32);
+        CFP25519 u(md32), v(mv);
+        CFP25519 r0 = (u / v).Sqrt();
+        CFP25519 r1 = u.SqrtRatio(v);
+        BOOST_CHECK(r1 == r0 || r1 == -r0);
+    }
+    BOOST_CHECK(nValid >= 1000);
+}
+
+// messages of 0 to 95 bytes
+static void MakeBatchSig(const size_t nCount, std::vector<uint256>& vPubKey, std::vector<std::vector<uint8>>& vMsg,
+                         std::vector<std::vector<uint8>>& vSig)
+{
+    for (size_t i = 0; i < nCount; i++)
+    {
+        CCryptoKey key;
+        CryptoMakeNewKey(key);
+        std::vector<uint8> msg(i % 96);
+        randombytes_buf(msg.data(), msg.size());
+        std::vector<uint8> vchSig;
+        CryptoSign(key, msg.data(), msg.size(), vchSig);
+        vPubKey.push_back(key.pubkey);
+        vMsg.push_back(msg);
+        vSig.push_back(vchSig);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_verify)
+{
+    // 64 signatures and more give 128 points and more, which take the bucket method
+    const size_t nMax = 160;
+    std::vector<uint256> vPubKey;
+    std::vector<std::vector<uint8>> vMsg, vSig;
+    MakeBatchSig(nMax, vPubKey, vMsg, vSig);
+
+    BOOST_CHECK(CryptoBatchVerify(std::vector<uint256>(), std::vector<std::vector<uint8>>(), std::vector<std::vector<uint8>>()));
+    BOOST_CHECK(!CryptoBatchVerify(vPubKey, std::vector<std::vector<uint8>>(), vSig));
+
+    for (size_t n : { 1, 2, 3, 31, 32, 63, 64, 128, 160 })
+    {
+        std::vector<uint256> vP(vPubKey.begin(), vPubKey.begin() + n);
+        std::vector<std::vector<uint8>> vM(vMsg.begin(), vMsg.begin() + n), vS(vSig.begin(), vSig.begin() + n);
+        BOOST_CHECK(CryptoBatchVerify(vP, vM, vS));
+
+        // wrong message and message length
+        size_t nBad = CryptoGetRand32() % n;
+        vM[nBad].push_back(0);
+        BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+        vM[nBad] = vMsg[nBad];
+        if (!vM[nBad].empty())
+        {
+            vM[nBad][0] ^= 0x01;
+            BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+            vM[nBad] = vMsg[nBad];
+        }
+
+        // wrong R, S and pubkey
+        vS[nBad][0] ^= 0x01;
+        BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+        vS[nBad] = vSig[nBad];
+        vS[nBad][32] ^= 0x01;
+        BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+        vS[nBad] = vSig[nBad];
+        vP[nBad] = vPubKey[(nBad + 1) % nMax];
+        BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+        vP[nBad] = vPubKey[nBad];
+
+        // non-canonical S (S + L)
+        uint8 sl[32] = { 0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10 };
+        uint256 u(std::vector<uint8>(sl, sl + 32));
+        u += uint256(std::vector<uint8>(vS[nBad].begin() + 32, vS[nBad].end()));
+        memcpy(&vS[nBad][32], u.begin(), 32);
+        BOOST_CHECK(!CryptoBatchVerify(vP, vM, vS));
+        vS[nBad] = vSig[nBad];
+
+        BOOST_CHECK(CryptoBatchVerify(vP, vM, vS));
+    }
+
+    // agrees with single verify
+    for (size_t i = 0; i < nMax; i++)
+    {
+        BOOST_CHECK(CryptoVerify(vPubKey[i], vMsg[i].data(), vMsg[i].size(), vSig[i]));
+    }
+}
+
+// compare with single verify, run with --run_test=crypto_tests/batch_verify_bench
+BOOST_AUTO_TEST_CASE(batch_verify_bench, *boost::unit_test::disabled())
+{
+    const size_t nMax = 1024;
+    std::vector<uint256> vPubKey;
+    std::vector<std::vector<uint8>> vMsg, vSig;
+    MakeBatchSig(nMax, vPubKey, vMsg, vSig);
+
+    for (size_t n : { 16, 64, 256, 1024 })
+    {
+        std::vector<uint256> vP(vPubKey.begin(), vPubKey.begin() + n);
+        std::vector<std::vector<uint8>> vM(vMsg.begin(), vMsg.begin() + n), vS(vSig.begin(), vSig.begin() + n);
+
+        boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+        for (size_t i = 0; i < n; i++)
+        {
+            BOOST_CHECK(CryptoVerify(vP[i], vM[i].data(), vM[i].size(), vS[i]));
+        }
+        boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::universal_time();
+        BOOST_CHECK(CryptoBatchVerify(vP, vM, vS));
+        boost::posix_time::ptime t2 = boost::posix_time::microsec_clock::universal_time();
+
+        std::cout << "batch verify count : " << n << "; single verify time per sig : " << (t1 - t0).total_microseconds() / n
+                  << "us.; batch verify time per sig : " << (t2 - t1).total_microseconds() / n << "us." << std::endl;
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,202 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "recovery.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "block.h"
+#include "core.h"
+#include "test_big.h"
+#include "timeseries.h"
+
+using namespace std;
+using namespace xengine;
+using namespace bigbang;
+using namespace bigbang::storage;
+using namespace boost::filesystem;
+
+BOOST_FIXTURE_TEST_SUITE(recovery_tests, BasicUtfSetup)
+
+// connects the replayed blocks after the context free checks only
+class CReplayDispatcher : public IDispatcher
+{
+public:
+    CReplayDispatcher(ICoreProtocol* pCoreProtocolIn)
+      : pCoreProtocol(pCoreProtocolIn) {}
+    Errno AddNewBlock(const CBlock& block, uint64 nNonce = 0) override
+    {
+        Errno err = pCoreProtocol->ValidateBlock(block);
+        if (err == OK)
+        {
+            vBlockHash.push_back(block.GetHash());
+        }
+        return err;
+    }
+    Errno AddNewTx(const CTransaction& tx, uint64 nNonce = 0) override
+    {
+        return FAILED;
+    }
+    bool AddNewDistribute(const uint256& hashAnchor, const CDestination& dest, const vector<unsigned char>& vchDistribute) override
+    {
+        return false;
+    }
+    bool AddNewPublish(const uint256& hashAnchor, const CDestination& dest, const vector<unsigned char>& vchPublish) override
+    {
+        return false;
+    }
+    void SetConsensus(const CAgreementBlock& agreeBlock) override {}
+    void CheckAllSubForkLastBlock() override {}
+
+public:
+    ICoreProtocol* pCoreProtocol;
+    vector<uint256> vBlockHash;
+};
+
+class CTestRecovery : public CRecovery
+{
+public:
+    CTestRecovery(ICoreProtocol* pCoreProtocolIn, IDispatcher* pDispatcherIn)
+    {
+        pCoreProtocol = pCoreProtocolIn;
+        pDispatcher = pDispatcherIn;
+    }
+    using CRecovery::Replay;
+};
+
+BOOST_AUTO_TEST_CASE(trustedreplay)
+{
+    // more blocks than the pipeline holds, none of them is signed
+    const int nBlockCount = 600;
+
+    CCoreProtocol core;
+    core.InitializeGenesisBlock();
+
+    path pathBlock = temp_directory_path() / unique_path();
+    create_directories(pathBlock);
+
+    vector<uint256> vHash;
+    uint32 nFirstOffset = 0;
+    {
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, "block"));
+
+        CBlock genesis;
+        core.GetGenesisBlock(genesis);
+        uint32 nFile, nOffset;
+        BOOST_CHECK(tsBlock.Write(CBlockEx(genesis), nFile, nOffset));
+
+        uint256 hashPrev = genesis.GetHash();
+        for (int i = 1; i <= nBlockCount; i++)
+        {
+            CBlock block;
+            block.nType = CBlock::BLOCK_PRIMARY;
+            block.nTimeStamp = genesis.nTimeStamp + i * 60;
+            block.hashPrev = hashPrev;
+            block.txMint.nType = CTransaction::TX_WORK;
+            block.txMint.nTimeStamp = block.nTimeStamp;
+            block.txMint.sendTo = CDestination(crypto::CPubKey(uint256(uint64(i))));
+            block.txMint.nAmount = 100;
+            block.hashMerkle = block.CalcMerkleTreeRoot();
+            BOOST_CHECK(tsBlock.Write(CBlockEx(block), nFile, nOffset));
+            if (i == 1)
+            {
+                nFirstOffset = nOffset;
+            }
+
+            hashPrev = block.GetHash();
+            vHash.push_back(hashPrev);
+        }
+        BOOST_CHECK(tsBlock.Flush());
+        tsBlock.Deinitialize();
+    }
+
+    auto fnReplay = [&](const map<int, uint256>& mapCheckPoint, vector<uint256>& vBlockHash) -> bool {
+        CReplayDispatcher dispatcher(&core);
+        CTestRecovery recovery(&core, &dispatcher);
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, "block"));
+        bool fRet = recovery.Replay(tsBlock, mapCheckPoint);
+        tsBlock.Deinitialize();
+        vBlockHash = dispatcher.vBlockHash;
+        return fRet;
+    };
+
+    // all blocks are below the last checkpoint and come out in file order
+    {
+        map<int, uint256> mapCheckPoint;
+        mapCheckPoint[nBlockCount / 2] = vHash[nBlockCount / 2 - 1];
+        mapCheckPoint[nBlockCount] = vHash[nBlockCount - 1];
+        vector<uint256> vBlockHash;
+        BOOST_CHECK(fnReplay(mapCheckPoint, vBlockHash));
+        BOOST_CHECK(vBlockHash == vHash);
+    }
+
+    // the trusted height is reset once the replay ends
+    {
+        CBlockEx block;
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, "block"));
+        BOOST_CHECK(tsBlock.Read(block, 1, nFirstOffset));
+        tsBlock.Deinitialize();
+        BOOST_CHECK(block.GetHash() == vHash[0]);
+        BOOST_CHECK(core.ValidateBlock(block) == ERR_BLOCK_SIGNATURE_INVALID);
+    }
+
+    // checkpoints that are not on one chain leave nothing to replay
+    {
+        map<int, uint256> mapCheckPoint;
+        mapCheckPoint[nBlockCount / 2] = uint256(uint64(1));
+        mapCheckPoint[nBlockCount] = vHash[nBlockCount - 1];
+        vector<uint256> vBlockHash;
+        BOOST_CHECK(!fnReplay(mapCheckPoint, vBlockHash));
+        BOOST_CHECK(vBlockHash.empty());
+    }
+
+    // a side branch below the last checkpoint is not trusted
+    {
+        CBlockEx blockChain;
+        CBlockEx blockSide;
+        {
+            CTimeSeriesCached tsBlock;
+            BOOST_CHECK(tsBlock.Initialize(pathBlock, "block"));
+            BOOST_CHECK(tsBlock.Read(blockChain, 1, nFirstOffset));
+            blockSide = blockChain;
+            blockSide.txMint.nAmount = 200;
+            blockSide.hashMerkle = blockSide.CalcMerkleTreeRoot();
+            uint32 nFile, nOffset;
+            BOOST_CHECK(tsBlock.Write(blockSide, nFile, nOffset));
+            BOOST_CHECK(tsBlock.Flush());
+            tsBlock.Deinitialize();
+        }
+        BOOST_CHECK(blockSide.GetHash() != vHash[0] && blockSide.hashPrev == blockChain.hashPrev);
+
+        map<int, uint256> mapCheckPoint;
+        mapCheckPoint[nBlockCount] = vHash[nBlockCount - 1];
+        vector<uint256> vBlockHash;
+        BOOST_CHECK(!fnReplay(mapCheckPoint, vBlockHash));
+        BOOST_CHECK(vBlockHash == vHash);
+    }
+
+    // blocks above the last checkpoint need their signatures
+    {
+        map<int, uint256> mapCheckPoint;
+        mapCheckPoint[nBlockCount / 2] = vHash[nBlockCount / 2 - 1];
+        vector<uint256> vBlockHash;
+        BOOST_CHECK(!fnReplay(mapCheckPoint, vBlockHash));
+        BOOST_CHECK(vBlockHash == vector<uint256>(vHash.begin(), vHash.begin() + nBlockCount / 2));
+    }
+
+    // without checkpoints nothing is trusted
+    {
+        vector<uint256> vBlockHash;
+        BOOST_CHECK(!fnReplay(map<int, uint256>(), vBlockHash));
+        BOOST_CHECK(vBlockHash.empty());
+    }
+
+    remove_all(pathBlock);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
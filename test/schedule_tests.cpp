@@ -0,0 +1,112 @@
+// Copyright (c) 2019-2020 The Bigbang developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "schedule.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_big.h"
+
+using namespace std;
+using namespace xengine;
+using namespace bigbang;
+
+BOOST_FIXTURE_TEST_SUITE(schedule_tests, BasicUtfSetup)
+
+static void ReceiveWindow(CInvPeer& peer, int64 nElapse)
+{
+    peer.StartBlockWindow();
+    peer.nBlockWindowTime -= nElapse;
+    for (size_t i = peer.GetBlockWindow(); i > 0; i--)
+    {
+        peer.ReceiveWindowBlock();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockwindow)
+{
+    CInvPeer peer;
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::INIT_BLOCK_WINDOW);
+    BOOST_CHECK(!peer.IsBlockWindowStarted());
+
+    // not timed, nothing changes
+    peer.ReceiveWindowBlock();
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::INIT_BLOCK_WINDOW);
+
+    // fast windows double up to the maximum
+    ReceiveWindow(peer, 0);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::INIT_BLOCK_WINDOW * 2);
+    BOOST_CHECK(peer.IsBlockWindowStarted());
+    for (int i = 0; i < 8; i++)
+    {
+        ReceiveWindow(peer, 0);
+    }
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MAX_BLOCK_WINDOW);
+
+    // on target grows by one, slow shrinks by one, very slow halves
+    peer.nBlockWindow = 8;
+    ReceiveWindow(peer, CInvPeer::BLOCK_WINDOW_TARGET_TIME * 3 / 4);
+    BOOST_CHECK(peer.GetBlockWindow() == 9);
+    ReceiveWindow(peer, CInvPeer::BLOCK_WINDOW_TARGET_TIME * 3);
+    BOOST_CHECK(peer.GetBlockWindow() == 8);
+    ReceiveWindow(peer, CInvPeer::BLOCK_WINDOW_TARGET_TIME * 5);
+    BOOST_CHECK(peer.GetBlockWindow() == 4);
+    ReceiveWindow(peer, CInvPeer::BLOCK_WINDOW_TARGET_TIME * 3 / 2);
+    BOOST_CHECK(peer.GetBlockWindow() == 4);
+
+    // a failure halves the window and stops timing until the next start
+    peer.FailWindowBlock();
+    BOOST_CHECK(peer.GetBlockWindow() == 2);
+    BOOST_CHECK(!peer.IsBlockWindowStarted());
+    for (int i = 0; i < 4; i++)
+    {
+        peer.ReceiveWindowBlock();
+    }
+    BOOST_CHECK(peer.GetBlockWindow() == 2);
+    peer.FailWindowBlock();
+    peer.FailWindowBlock();
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MIN_BLOCK_WINDOW);
+    ReceiveWindow(peer, 0);
+    BOOST_CHECK(peer.GetBlockWindow() == CInvPeer::MIN_BLOCK_WINDOW * 2);
+}
+
+class CWindowSchedule : public CSchedule
+{
+public:
+    using CSchedule::mapPeer;
+};
+
+BOOST_AUTO_TEST_CASE(schedblockwindow)
+{
+    CWindowSchedule sched;
+    const uint64 nNonce = 1;
+    for (int i = 1; i <= 8; i++)
+    {
+        BOOST_CHECK(sched.AddNewInv(network::CInv(network::CInv::MSG_BLOCK, uint256(i, uint224(i))), nNonce));
+    }
+
+    vector<network::CInv> vInv;
+    bool fMissingPrev = false;
+    bool fEmpty = false;
+    BOOST_CHECK(sched.ScheduleBlockInv(nNonce, vInv, 100, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == CInvPeer::INIT_BLOCK_WINDOW);
+    BOOST_CHECK(sched.mapPeer[nNonce].IsBlockWindowStarted());
+
+    // one getfail listing three blocks shrinks the window once
+    for (size_t i = 1; i < vInv.size(); i++)
+    {
+        BOOST_CHECK(sched.CancelAssignedInv(nNonce, vInv[i]));
+    }
+    sched.FailBlockWindow(nNonce);
+    BOOST_CHECK(sched.mapPeer[nNonce].GetBlockWindow() == CInvPeer::INIT_BLOCK_WINDOW / 2);
+    BOOST_CHECK(!sched.mapPeer[nNonce].IsBlockWindowStarted());
+
+    // the top-up restarts timing while a block is still in flight
+    vInv.clear();
+    BOOST_CHECK(sched.ScheduleBlockInv(nNonce, vInv, 100, fMissingPrev, fEmpty));
+    BOOST_CHECK(vInv.size() == CInvPeer::INIT_BLOCK_WINDOW / 2 - 1);
+    BOOST_CHECK(sched.mapPeer[nNonce].IsBlockWindowStarted());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,11 @@
 
 #include "address.h"
 #include "block.h"
+#include "blockbase.h"
+#include "blockindexdb.h"
+#include "forkdb.h"
+#include "leveldbeng.h"
+#include "snapshot.h"
 #include "test_big.h"
 #include "timeseries.h"
 
@@ -100,6 +105,314 @@ BOOST_AUTO_TEST_CASE(timewalk)
     cout << GetLocalTime() << "  WalkThrough success, count: " << walker.nBlockCount << endl;
 }
 
+class CMappedTimeSeries : public CTimeSeriesCached
+{
+public:
+    using CTimeSeriesCached::GetMappedFile;
+    using CTimeSeriesCached::ReadMapped;
+};
+
+BOOST_AUTO_TEST_CASE(mappedread)
+{
+    path pathBlock = path("./.bigbang") / "mappedread";
+    remove_all(pathBlock);
+    create_directories(pathBlock);
+    path pathFile = pathBlock / "block_000001.dat";
+    copy_file(initial_path<path>() / "test/block/block_000001.dat", pathFile);
+
+    // record offsets and hashes through the stdio reader
+    vector<pair<uint32, uint256>> vBlock;
+    vector<vector<uint8>> vSig;
+    uint32 nMintOffset = 0;
+    uint256 txidMint;
+    {
+        xengine::CFileStream fs(pathFile.string().c_str());
+        size_t nFileSize = fs.GetSize();
+        while (fs.GetCurPos() < nFileSize)
+        {
+            uint32 nMagic, nSize;
+            CBlockEx block;
+            fs >> nMagic >> nSize;
+            uint32 nOffset = fs.GetCurPos();
+            fs >> block;
+            vBlock.push_back(make_pair(nOffset, block.GetHash()));
+            vSig.push_back(block.vchSig);
+
+            // the header read steps over the txs and stops inside the record
+            CBlockHeaderRecord header;
+            fs.Seek(nOffset);
+            fs >> header;
+            BOOST_CHECK(header.GetHash() == block.GetHash() && header.vchSig == block.vchSig && header.vtx.empty());
+            BOOST_CHECK(fs.GetCurPos() <= nOffset + nSize);
+            fs.Seek(nOffset + nSize);
+            if (nMintOffset == 0)
+            {
+                nMintOffset = nOffset + block.GetTxSerializedOffset();
+                txidMint = block.txMint.GetHash();
+            }
+        }
+    }
+    BOOST_CHECK(vBlock.size() == 11);
+
+    {
+        CMappedTimeSeries tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+        for (const auto& vd : vBlock)
+        {
+            CBlockEx block;
+            BOOST_CHECK(tsBlock.ReadMapped(block, 1, vd.first));
+            BOOST_CHECK(block.GetHash() == vd.second);
+        }
+        for (size_t i = 0; i < vBlock.size(); i++)
+        {
+            CBlockHeaderRecord header;
+            BOOST_CHECK(tsBlock.ReadMapped(header, 1, vBlock[i].first));
+            BOOST_CHECK(header.GetHash() == vBlock[i].second && header.vchSig == vSig[i]);
+        }
+        // a tx position points into the middle of its block record
+        CTransaction tx;
+        BOOST_CHECK(tsBlock.ReadMapped(tx, 1, nMintOffset));
+        BOOST_CHECK(tx.GetHash() == txidMint);
+        CBlockEx block;
+        BOOST_CHECK(!tsBlock.ReadMapped(block, 2, vBlock[0].first));
+
+        // a block read must start at a record frame, a failed read keeps the mapping
+        std::shared_ptr<CMappedFile> spFile = tsBlock.GetMappedFile(1, 1);
+        BOOST_CHECK(!tsBlock.ReadMapped(block, 1, nMintOffset));
+        BOOST_CHECK(!tsBlock.Read(block, 1, nMintOffset, false));
+        BOOST_CHECK(!tsBlock.ReadMapped(block, 1, 4));
+        BOOST_CHECK(tsBlock.GetMappedFile(1, 1) == spFile);
+        tsBlock.Deinitialize();
+    }
+
+    // a record running past the end of the file fails, earlier records still read
+    resize_file(pathFile, file_size(pathFile) - 10);
+    {
+        CMappedTimeSeries tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+        for (size_t i = 0; i < vBlock.size(); i++)
+        {
+            CBlockEx block;
+            bool fRead = tsBlock.ReadMapped(block, 1, vBlock[i].first);
+            BOOST_CHECK(fRead == (i + 1 < vBlock.size()));
+            BOOST_CHECK(!fRead || block.GetHash() == vBlock[i].second);
+        }
+        CBlockEx block;
+        BOOST_CHECK(!tsBlock.Read(block, 1, vBlock.back().first, false));
+        tsBlock.Deinitialize();
+    }
+    remove_all(pathBlock);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache)
+{
+    // single shard, capacity for ten entries of charge 10
+    CShardedCache<int, int> cache(100, 1);
+    for (int i = 0; i < 10; i++)
+    {
+        cache.AddNew(i, i * 2, 10);
+    }
+    int n = 0;
+    BOOST_CHECK(cache.Retrieve(0, n) && n == 0);
+    cache.AddNew(10, 20, 10);
+    BOOST_CHECK(cache.Retrieve(0, n));
+    BOOST_CHECK(!cache.Retrieve(1, n));
+    cache.AddNew(11, 22, 1000);
+    BOOST_CHECK(!cache.Retrieve(11, n));
+
+    CCacheStat stat;
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nCapacity == 100 && stat.nSize == 100 && stat.nCount == 10);
+    BOOST_CHECK(stat.nHit == 2 && stat.nMiss == 2 && stat.nEviction == 1);
+
+    cache.SetCapacity(50);
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nSize == 50 && stat.nCount == 5 && stat.nEviction == 6);
+    cache.Clear();
+    cache.GetStat(stat);
+    BOOST_CHECK(stat.nSize == 0 && stat.nCount == 0);
+
+    // cached objects are only returned as the type they were stored with
+    path pathBlock = path("./.bigbang") / "blockcache";
+    remove_all(pathBlock);
+    create_directories(pathBlock);
+    copy_file(initial_path<path>() / "test/block/block_000001.dat", pathBlock / "block_000001.dat");
+    {
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+
+        CBlockEx blockEx;
+        BOOST_CHECK(tsBlock.Read(blockEx, 1, 8));
+        BOOST_CHECK(tsBlock.Read(blockEx, 1, 8));
+        CBlock block;
+        BOOST_CHECK(tsBlock.Read(block, 1, 8, false));
+        BOOST_CHECK(block.GetHash() == blockEx.GetHash());
+
+        tsBlock.GetCacheStat(stat);
+        BOOST_CHECK(stat.nCount == 1 && stat.nHit == 2 && stat.nMiss == 1);
+
+        tsBlock.SetCacheSize(0);
+        BOOST_CHECK(tsBlock.Read(blockEx, 1, 8));
+        tsBlock.GetCacheStat(stat);
+        BOOST_CHECK(stat.nCount == 0 && stat.nSize == 0);
+        tsBlock.Deinitialize();
+    }
+    remove_all(pathBlock);
+}
+
+class CBlockPosWalker : public CTSWalker<CBlockEx>
+{
+public:
+    bool Walk(const CBlockEx& t, uint32 nFile, uint32 nOffset) override
+    {
+        vPos.push_back(CDiskPos(nFile, nOffset));
+        return true;
+    }
+
+public:
+    vector<CDiskPos> vPos;
+};
+
+BOOST_AUTO_TEST_CASE(bufferedwrite)
+{
+    path pathBlock = path("./.bigbang") / "bufferedwrite";
+    remove_all(pathBlock);
+    create_directories(pathBlock);
+
+    vector<CBlockEx> vBlock;
+    {
+        xengine::CFileStream fs((initial_path<path>() / "test/block/block_000001.dat").string().c_str());
+        size_t nFileSize = fs.GetSize();
+        while (fs.GetCurPos() < nFileSize)
+        {
+            uint32 nMagic, nSize;
+            CBlockEx block;
+            fs >> nMagic >> nSize >> block;
+            vBlock.push_back(block);
+        }
+    }
+
+    path pathFile = pathBlock / "block_000001.dat";
+    vector<CDiskPos> vPos;
+    {
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+        tsBlock.SetSyncPolicy(4, 0);
+        tsBlock.SetCacheSize(0);
+
+        // records stay in the write buffer until a reader needs them
+        for (size_t i = 0; i < 3; i++)
+        {
+            CDiskPos pos;
+            BOOST_CHECK(tsBlock.Write(vBlock[i], pos));
+            vPos.push_back(pos);
+        }
+        BOOST_CHECK(file_size(pathFile) == 0);
+        CBlockEx block;
+        BOOST_CHECK(tsBlock.Read(block, vPos[1]));
+        BOOST_CHECK(block.GetHash() == vBlock[1].GetHash());
+        BOOST_CHECK(file_size(pathFile) == vPos[2].nOffset + GetSerializeSize(vBlock[2]));
+
+        // one flush writes the records gathered since the last one
+        for (size_t i = 3; i < vBlock.size(); i++)
+        {
+            CDiskPos pos;
+            BOOST_CHECK(tsBlock.Write(vBlock[i], pos));
+            vPos.push_back(pos);
+        }
+        BOOST_CHECK(tsBlock.Flush());
+        BOOST_CHECK(file_size(pathFile) == vPos.back().nOffset + GetSerializeSize(vBlock.back()));
+        for (size_t i = 0; i < vBlock.size(); i++)
+        {
+            BOOST_CHECK(tsBlock.Read(block, vPos[i]));
+            BOOST_CHECK(block.GetHash() == vBlock[i].GetHash());
+        }
+
+        CDiskPos pos;
+        BOOST_CHECK(tsBlock.Write(vBlock[0], pos));
+        vPos.push_back(pos);
+        tsBlock.Deinitialize();
+    }
+
+    // the buffer is written out on deinitialize, the file is laid out as before
+    {
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+        CBlockPosWalker walker;
+        uint32 nLastFile, nLastPos;
+        BOOST_CHECK(tsBlock.WalkThrough(walker, nLastFile, nLastPos, false));
+        BOOST_CHECK(walker.vPos == vPos);
+        BOOST_CHECK(nLastPos == file_size(pathFile));
+        tsBlock.Deinitialize();
+    }
+    remove_all(pathBlock);
+}
+
+class CFailingTimeSeries : public CTimeSeriesCached
+{
+public:
+    // swaps the append file, a read only file makes every write fail
+    FILE* SwapAppendFile(FILE* fp)
+    {
+        std::swap(fp, fpAppend);
+        return fp;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(bufferedwritefail)
+{
+    path pathBlock = path("./.bigbang") / "bufferedwritefail";
+    remove_all(pathBlock);
+    create_directories(pathBlock);
+
+    vector<CBlockEx> vBlock;
+    {
+        xengine::CFileStream fs((initial_path<path>() / "test/block/block_000001.dat").string().c_str());
+        for (size_t i = 0; i < 3; i++)
+        {
+            uint32 nMagic, nSize;
+            CBlockEx block;
+            fs >> nMagic >> nSize >> block;
+            vBlock.push_back(block);
+        }
+    }
+
+    path pathFile = pathBlock / "block_000001.dat";
+    {
+        CFailingTimeSeries tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathBlock, BLOCKFILE_PREFIX));
+        tsBlock.SetCacheSize(0);
+
+        vector<CDiskPos> vPos(vBlock.size());
+        BOOST_CHECK(tsBlock.Write(vBlock[0], vPos[0]));
+        FILE* fpReadOnly = fopen(pathFile.string().c_str(), "rb");
+        FILE* fpAppend = tsBlock.SwapAppendFile(fpReadOnly);
+
+        // handed out positions keep their records in the buffer when the write fails
+        BOOST_CHECK(!tsBlock.Flush());
+        BOOST_CHECK(tsBlock.Write(vBlock[1], vPos[1]));
+        BOOST_CHECK(!tsBlock.Flush());
+        BOOST_CHECK(file_size(pathFile) == 0);
+
+        // a record that fills the buffer is taken back when writing it out fails
+        CDiskPos posFull;
+        BOOST_CHECK(!tsBlock.Write(vector<uint8>(0x100000), posFull, false));
+
+        fclose(tsBlock.SwapAppendFile(fpAppend));
+        BOOST_CHECK(tsBlock.Write(vBlock[2], vPos[2]));
+        BOOST_CHECK(tsBlock.Flush());
+        BOOST_CHECK(file_size(pathFile) == vPos[2].nOffset + GetSerializeSize(vBlock[2]));
+        for (size_t i = 0; i < vBlock.size(); i++)
+        {
+            CBlockEx block;
+            BOOST_CHECK(tsBlock.Read(block, vPos[i]));
+            BOOST_CHECK(block.GetHash() == vBlock[i].GetHash());
+        }
+        tsBlock.Deinitialize();
+    }
+    remove_all(pathBlock);
+}
+
 BOOST_AUTO_TEST_CASE(fileread)
 {
     cout << GetLocalTime() << "  start...." << endl;
@@ -167,4 +480,802 @@ BOOST_AUTO_TEST_CASE(fileread)
     free(pBuf);
 }
 
+static CBlockIndex* WalkAncestor(CBlockIndex* pIndex, int nHeight)
+{
+    while (pIndex != nullptr && pIndex->GetBlockHeight() > nHeight)
+    {
+        pIndex = pIndex->pPrev;
+    }
+    return pIndex;
+}
+
+BOOST_AUTO_TEST_CASE(blockindexskip)
+{
+    // main chain [0, 1000) with extended blocks every 7 heights, branch (500, 1100]
+    vector<CBlockIndex> vIndex(2000);
+    size_t n = 0;
+    CBlockIndex* pGenesis = &vIndex[n++];
+    pGenesis->nType = CBlock::BLOCK_GENESIS;
+
+    CBlockIndex* pLast = pGenesis;
+    CBlockIndex* pBranchFrom = nullptr;
+    for (int h = 1; h < 1000; h++)
+    {
+        for (int i = 0; i < ((h % 7 == 0) ? 2 : 1); i++)
+        {
+            CBlockIndex* pIndex = &vIndex[n++];
+            pIndex->nType = (i == 0 ? CBlock::BLOCK_PRIMARY : CBlock::BLOCK_EXTENDED);
+            pIndex->nHeight = h;
+            pIndex->pOrigin = pGenesis;
+            pIndex->pPrev = pLast;
+            pIndex->BuildSkip();
+            pLast = pIndex;
+        }
+        if (h == 500)
+        {
+            pBranchFrom = pLast;
+        }
+    }
+    CBlockIndex* pMainLast = pLast;
+
+    pLast = pBranchFrom;
+    for (int h = 501; h <= 1100; h++)
+    {
+        CBlockIndex* pIndex = &vIndex[n++];
+        pIndex->nType = CBlock::BLOCK_PRIMARY;
+        pIndex->nHeight = h;
+        pIndex->pOrigin = pGenesis;
+        pIndex->pPrev = pLast;
+        pIndex->BuildSkip();
+        pLast = pIndex;
+    }
+    CBlockIndex* pBranchLast = pLast;
+
+    for (int h = 0; h < 1000; h++)
+    {
+        BOOST_CHECK(pMainLast->GetAncestor(h) == WalkAncestor(pMainLast, h));
+        BOOST_CHECK(pBranchLast->GetAncestor(h) == WalkAncestor(pBranchLast, h));
+    }
+    BOOST_CHECK(pMainLast->GetAncestor(1000) == nullptr);
+    BOOST_CHECK(pMainLast->GetAncestor(-1) == nullptr);
+
+    CBlockFork fork(CProfile(), pMainLast);
+    fork.UpdateNext();
+    for (int h = 0; h < 1000; h++)
+    {
+        BOOST_CHECK(fork.GetIndexByHeight(h) == WalkAncestor(pMainLast, h));
+    }
+    BOOST_CHECK(fork.GetIndexByHeight(1000) == nullptr);
+
+    fork.UpdateLast(pBranchLast);
+    for (int h = 0; h <= 1100; h++)
+    {
+        BOOST_CHECK(fork.GetIndexByHeight(h) == WalkAncestor(pBranchLast, h));
+    }
+
+    CBlockIndex* pRollback = WalkAncestor(pMainLast, 300);
+    fork.UpdateLast(pRollback);
+    for (int h = 0; h <= 300; h++)
+    {
+        BOOST_CHECK(fork.GetIndexByHeight(h) == WalkAncestor(pRollback, h));
+    }
+    BOOST_CHECK(fork.GetIndexByHeight(301) == nullptr);
+}
+
+class CFilterBlockBase : public CBlockBase
+{
+public:
+    using CBlockBase::CollectFilterBlock;
+};
+
+BOOST_AUTO_TEST_CASE(filtercursor)
+{
+    // chain [0, 100) with an extended block at every height divisible by 5
+    vector<CBlockIndex> vIndex(120);
+    size_t n = 0;
+    CBlockIndex* pGenesis = &vIndex[n++];
+    pGenesis->nType = CBlock::BLOCK_GENESIS;
+    CBlockIndex* pLast = pGenesis;
+    for (int h = 1; h < 100; h++)
+    {
+        for (int i = 0; i < ((h % 5 == 0) ? 2 : 1); i++)
+        {
+            CBlockIndex* pIndex = &vIndex[n++];
+            pIndex->nType = (i == 0 ? CBlock::BLOCK_PRIMARY : CBlock::BLOCK_EXTENDED);
+            pIndex->nHeight = h;
+            pIndex->pOrigin = pGenesis;
+            pIndex->pPrev = pLast;
+            pLast = pIndex;
+        }
+    }
+    CBlockFork fork(CProfile(), pLast);
+    fork.UpdateNext();
+
+    // chunks of 7 blocks never split a height and cover the chain once
+    CTxFilterCursor cursor;
+    vector<CBlockIndex*> vAll;
+    size_t nChunk = 0;
+    while (!cursor.fEnd)
+    {
+        vector<CBlockIndex*> vChunk;
+        CBlockIndex* pStart = (cursor.nHeight == 0 ? pGenesis : fork.GetIndexByHeight(cursor.nHeight - 1)->pNext);
+        CFilterBlockBase::CollectFilterBlock(pStart, 7, cursor, vChunk);
+        BOOST_CHECK(vChunk.size() >= 7 || cursor.fEnd);
+        BOOST_CHECK(vChunk.size() <= 8);
+        BOOST_CHECK(cursor.nHeight == vChunk.back()->GetBlockHeight() + 1);
+        BOOST_CHECK(cursor.hashBlock == vChunk.back()->GetBlockHash());
+        BOOST_CHECK(fork.GetIndexByHeight(cursor.nHeight - 1) == vChunk.back());
+        vAll.insert(vAll.end(), vChunk.begin(), vChunk.end());
+        nChunk++;
+    }
+    BOOST_CHECK(vAll.size() == n && vAll.back() == pLast);
+    BOOST_CHECK(cursor.nHeight == 100);
+    BOOST_CHECK(nChunk < n / 7 + 1);
+    for (size_t i = 1; i < vAll.size(); i++)
+    {
+        BOOST_CHECK(vAll[i] == vAll[i - 1]->pNext);
+    }
+
+    // with listed heights only those are taken, the chunk counts them
+    CTxFilterCursor cursorHeight(5);
+    cursorHeight.fIndexed = true;
+    cursorHeight.nIndexedHeight = 99;
+    cursorHeight.setHeight = { 10, 11, 50, 99 };
+    vector<CBlockIndex*> vChunk;
+    CFilterBlockBase::CollectFilterBlock(fork.GetIndexByHeight(4)->pNext, 2, cursorHeight, vChunk);
+    BOOST_CHECK(vChunk.size() == 2 && vChunk[0]->GetBlockHeight() == 10 && vChunk[1]->GetBlockHeight() == 10);
+    BOOST_CHECK(cursorHeight.nHeight == 11 && !cursorHeight.fEnd);
+    vChunk.clear();
+    CFilterBlockBase::CollectFilterBlock(fork.GetIndexByHeight(10)->pNext, 0, cursorHeight, vChunk);
+    BOOST_CHECK(vChunk.size() == 4 && vChunk[0]->GetBlockHeight() == 11 && vChunk[3]->GetBlockHeight() == 99);
+    BOOST_CHECK(cursorHeight.nHeight == 100 && cursorHeight.fEnd);
+
+    // blocks past the listed heights are all taken
+    CTxFilterCursor cursorLate(96);
+    cursorLate.fIndexed = true;
+    cursorLate.nIndexedHeight = 97;
+    vChunk.clear();
+    CFilterBlockBase::CollectFilterBlock(fork.GetIndexByHeight(95)->pNext, 0, cursorLate, vChunk);
+    BOOST_CHECK(vChunk.size() == 2 && vChunk[0]->GetBlockHeight() == 98 && vChunk[1]->GetBlockHeight() == 99);
+    BOOST_CHECK(cursorLate.hashBlock == pLast->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(addressunspentpage)
+{
+    path pathDB = temp_directory_path() / unique_path();
+    {
+        CForkAddressUnspentDB db(pathDB, nullptr, uint256(), uint256());
+        BOOST_CHECK(db.IsValid());
+
+        CDestination destA(crypto::CPubKey(uint256(1)));
+        CDestination destB(crypto::CPubKey(uint256(2)));
+
+        // on disk: 20 outputs of A and 5 of B
+        vector<pair<CAddrUnspentKey, CUnspentOut>> vAddUpdate;
+        for (int i = 0; i < 25; i++)
+        {
+            uint256 txid(uint64(i * 7919 + 13));
+            txid <<= (i % 5) * 48;
+            vAddUpdate.push_back(make_pair(CAddrUnspentKey(i < 20 ? destA : destB, CTxOutPoint(txid, i % 3)),
+                                           CUnspentOut(100 + i, 0, i, 0, i)));
+        }
+        BOOST_CHECK(db.RepairAddressUnspent(vAddUpdate, vector<CAddrUnspentKey>()));
+
+        // in cache: 5 new outputs of A and 3 spent ones
+        vector<CTxUnspent> vAddNew, vRemove;
+        for (int i = 0; i < 5; i++)
+        {
+            vAddNew.push_back(CTxUnspent(CTxOutPoint(uint256(uint64(i * 31 + 5)), 1), CTxOut(destA, 200 + i, i, 0), 0, i));
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            const CAddrUnspentKey& key = vAddUpdate[i * 6].first;
+            vRemove.push_back(CTxUnspent(key.out, CTxOut(destA, 1, 0, 0)));
+        }
+        BOOST_CHECK(db.UpdateAddressUnspent(uint256(), vAddNew, vRemove));
+
+        for (int nPass = 0; nPass < 2; nPass++)
+        {
+            map<CTxOutPoint, CUnspentOut> mapExpected;
+            uint256 hashLastBlock;
+            BOOST_CHECK(db.RetrieveAddressUnspent(destA, mapExpected, hashLastBlock));
+            BOOST_CHECK(mapExpected.size() == 22);
+
+            vector<pair<CAddrUnspentKey, CUnspentOut>> vAll;
+            BOOST_CHECK(db.ListAddressUnspent(destA, CTxOutPoint(), 0, vAll));
+            BOOST_CHECK(vAll.size() == 22);
+
+            map<CTxOutPoint, CUnspentOut> mapPaged;
+            CTxOutPoint outCursor;
+            size_t nPage = 0;
+            for (;;)
+            {
+                vector<pair<CAddrUnspentKey, CUnspentOut>> vPage;
+                BOOST_CHECK(db.ListAddressUnspent(destA, outCursor, 4, vPage));
+                for (size_t i = 0; i < vPage.size(); i++)
+                {
+                    BOOST_CHECK(vPage[i].first.dest == destA);
+                    BOOST_CHECK(vPage[i].first == vAll[nPage * 4 + i].first);
+                    BOOST_CHECK(mapPaged.insert(make_pair(vPage[i].first.out, vPage[i].second)).second);
+                }
+                if (vPage.size() < 4)
+                {
+                    break;
+                }
+                outCursor = vPage.back().first.out;
+                nPage++;
+            }
+            BOOST_CHECK(mapPaged.size() == mapExpected.size());
+            for (const auto& vd : mapExpected)
+            {
+                BOOST_CHECK(mapPaged.count(vd.first) && mapPaged[vd.first].nAmount == vd.second.nAmount);
+            }
+
+            // move the cache to disk and page again
+            BOOST_CHECK(db.Flush());
+            BOOST_CHECK(db.Flush());
+        }
+    }
+    remove_all(pathDB);
+}
+
+
+BOOST_AUTO_TEST_CASE(addresstxheight)
+{
+    path pathDB = temp_directory_path() / unique_path();
+    {
+        CForkAddressTxIndexDB db(pathDB, nullptr, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        CDestination destA(crypto::CPubKey(uint256(1)));
+        CDestination destB(crypto::CPubKey(uint256(2)));
+
+        // on disk: A at heights 0, 10, 20 ... 90, B at every height
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddUpdate;
+        for (int i = 0; i < 100; i++)
+        {
+            CAddrTxInfo txInfo(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, i, 0, 100, 0);
+            if (i % 10 == 0)
+            {
+                vAddUpdate.push_back(make_pair(CAddrTxIndex(destA, i, 0, 1, uint256(uint64(i + 1))), txInfo));
+            }
+            vAddUpdate.push_back(make_pair(CAddrTxIndex(destB, i, 0, 2, uint256(uint64(i + 1000))), txInfo));
+        }
+        BOOST_CHECK(db.RepairAddressTxIndex(vAddUpdate, vector<CAddrTxIndex>()));
+
+        // in cache: A at height 105
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
+        vAddNew.push_back(make_pair(CAddrTxIndex(destA, 105, 0, 1, uint256(uint64(105))), CAddrTxInfo(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 105, 0, 100, 0)));
+        BOOST_CHECK(db.UpdateAddressTxIndex(vAddNew, vector<CAddrTxIndex>()));
+
+        set<int> setHeight;
+        CListAddressTxHeightWalker walkerAll(0, setHeight);
+        BOOST_CHECK(db.WalkThroughAddressTxIndex(walkerAll, destA, 0, 0));
+        BOOST_CHECK(setHeight == set<int>({ 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 105 }));
+
+        setHeight.clear();
+        CListAddressTxHeightWalker walkerFrom(45, setHeight);
+        BOOST_CHECK(db.WalkThroughAddressTxIndex(walkerFrom, destA, 45, 0));
+        BOOST_CHECK(setHeight == set<int>({ 50, 60, 70, 80, 90, 105 }));
+    }
+    remove_all(pathDB);
+}
+
+BOOST_AUTO_TEST_CASE(addresstxpage)
+{
+    path pathDB = temp_directory_path() / unique_path();
+    {
+        CForkAddressTxIndexDB db(pathDB, nullptr, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        CDestination dest(crypto::CPubKey(uint256(1)));
+        CAddrTxInfo txInfo(CAddrTxInfo::TXI_DIRECTION_TO, CDestination(), 0, 0, 0, 100, 0);
+
+        // on disk: heights 0 ... 9, in cache: height 10, height 3 removed
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddUpdate;
+        for (int i = 0; i < 10; i++)
+        {
+            vAddUpdate.push_back(make_pair(CAddrTxIndex(dest, i, 0, 1, uint256(uint64(i + 1))), txInfo));
+        }
+        BOOST_CHECK(db.RepairAddressTxIndex(vAddUpdate, vector<CAddrTxIndex>()));
+
+        int64 nTxCount = 0;
+        BOOST_CHECK(db.GetAddressTxCount(dest, nTxCount) && nTxCount == 10);
+
+        vector<pair<CAddrTxIndex, CAddrTxInfo>> vAddNew;
+        vAddNew.push_back(make_pair(CAddrTxIndex(dest, 10, 0, 1, uint256(uint64(11))), txInfo));
+        vector<CAddrTxIndex> vRemove;
+        vRemove.push_back(CAddrTxIndex(dest, 3, 0, 1, uint256(uint64(4))));
+        BOOST_CHECK(db.UpdateAddressTxIndex(vAddNew, vRemove));
+        BOOST_CHECK(db.GetAddressTxCount(dest, nTxCount) && nTxCount == 10);
+
+        // forward pages: 0 1 2 4, then 5 6 7 8, then 9 10
+        vector<int> vHeight;
+        int64 nCursor = -1;
+        for (;;)
+        {
+            vector<pair<CAddrTxIndex, CAddrTxInfo>> vTxIndex;
+            BOOST_CHECK(db.ListAddressTxIndex(dest, nCursor, false, 4, vTxIndex));
+            for (const auto& vd : vTxIndex)
+            {
+                vHeight.push_back(vd.first.GetHeight());
+            }
+            if (vTxIndex.size() < 4)
+            {
+                break;
+            }
+            nCursor = vTxIndex.back().first.nHeightSeq;
+        }
+        BOOST_CHECK(vHeight == vector<int>({ 0, 1, 2, 4, 5, 6, 7, 8, 9, 10 }));
+
+        // reverse pages once the cache reaches disk: 10 9 8, 7 6 5, 4 2 1, 0
+        BOOST_CHECK(db.Flush() && db.Flush());
+        BOOST_CHECK(db.GetAddressTxCount(dest, nTxCount) && nTxCount == 10);
+        vHeight.clear();
+        nCursor = -1;
+        for (;;)
+        {
+            vector<pair<CAddrTxIndex, CAddrTxInfo>> vTxIndex;
+            BOOST_CHECK(db.ListAddressTxIndex(dest, nCursor, true, 3, vTxIndex));
+            for (const auto& vd : vTxIndex)
+            {
+                vHeight.push_back(vd.first.GetHeight());
+            }
+            if (vTxIndex.size() < 3)
+            {
+                break;
+            }
+            nCursor = vTxIndex.back().first.nHeightSeq;
+        }
+        BOOST_CHECK(vHeight == vector<int>({ 10, 9, 8, 7, 6, 5, 4, 2, 1, 0 }));
+    }
+    remove_all(pathDB);
+}
+
+static size_t CountAddressUnspent(CForkAddressUnspentDB& db, const CDestination& dest)
+{
+    map<CTxOutPoint, CUnspentOut> mapUnspent;
+    uint256 hashLastBlock;
+    db.RetrieveAddressUnspent(dest, mapUnspent, hashLastBlock);
+    return mapUnspent.size();
+}
+
+BOOST_AUTO_TEST_CASE(sharedforkdb)
+{
+    path pathData = temp_directory_path() / unique_path();
+    uint256 hashForkA(uint64(0xa)), hashForkB(uint64(0xb));
+    CDestination dest(crypto::CPubKey(uint256(1)));
+
+    // per fork layout: 10 outputs in fork A, 3 in fork B
+    for (int nFork = 0; nFork < 2; nFork++)
+    {
+        const uint256& hashFork = (nFork == 0 ? hashForkA : hashForkB);
+        path pathFork = pathData / "addressunspent" / hashFork.GetHex();
+        create_directories(pathFork);
+        CForkAddressUnspentDB db(pathFork, nullptr, hashFork, uint256());
+        BOOST_CHECK(db.IsValid());
+
+        vector<pair<CAddrUnspentKey, CUnspentOut>> vAddUpdate;
+        for (int i = 0; i < (nFork == 0 ? 10 : 3); i++)
+        {
+            vAddUpdate.push_back(make_pair(CAddrUnspentKey(dest, CTxOutPoint(uint256(uint64(i + 1)), 0)),
+                                           CUnspentOut(100 + i, 0, i, 0, i)));
+        }
+        BOOST_CHECK(db.RepairAddressUnspent(vAddUpdate, vector<CAddrUnspentKey>()));
+    }
+
+    BOOST_CHECK(!CLevelDBShared::IsSharedLayout(pathData));
+    BOOST_CHECK(CLevelDBShared::Migrate(pathData));
+    BOOST_CHECK(CLevelDBShared::IsSharedLayout(pathData));
+    BOOST_CHECK(!exists(pathData / "addressunspent" / hashForkA.GetHex()));
+
+    {
+        std::shared_ptr<CLevelDBShared> spShared = CLevelDBShared::Open(pathData);
+        BOOST_CHECK(spShared != nullptr);
+        BOOST_CHECK(CLevelDBShared::Open(pathData) == spShared);
+
+        CForkAddressUnspentDB dbA(pathData / "addressunspent" / hashForkA.GetHex(), spShared, hashForkA, uint256());
+        CForkAddressUnspentDB dbB(pathData / "addressunspent" / hashForkB.GetHex(), spShared, hashForkB, uint256());
+        BOOST_CHECK(dbA.IsValid() && dbB.IsValid());
+        BOOST_CHECK(CountAddressUnspent(dbA, dest) == 10);
+        BOOST_CHECK(CountAddressUnspent(dbB, dest) == 3);
+
+        // clearing one fork leaves the other untouched
+        BOOST_CHECK(dbA.RemoveAll());
+        BOOST_CHECK(CountAddressUnspent(dbA, dest) == 0);
+        BOOST_CHECK(CountAddressUnspent(dbB, dest) == 3);
+    }
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(writebackflush)
+{
+    path pathData = temp_directory_path() / unique_path();
+    create_directories(pathData);
+    BOOST_CHECK(CLevelDBShared::Migrate(pathData));
+
+    uint256 hashFork(uint64(0xa));
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    {
+        CUnspentDB dbUnspent;
+        CAddressUnspentDB dbAddressUnspent;
+        BOOST_CHECK(dbUnspent.Initialize(pathData) && dbAddressUnspent.Initialize(pathData));
+        BOOST_CHECK(dbUnspent.AddNewFork(hashFork) && dbAddressUnspent.AddNewFork(hashFork));
+
+        CWriteBackFlusher flusher;
+        flusher.AddTable(&dbUnspent);
+        flusher.AddTable(&dbAddressUnspent);
+        BOOST_CHECK(flusher.Start(CLevelDBShared::Open(pathData), 3600, 0));
+
+        vector<CTxUnspent> vAddNew;
+        for (int i = 0; i < 10; i++)
+        {
+            vAddNew.push_back(CTxUnspent(CTxOutPoint(uint256(uint64(i + 1)), 0), CTxOut(dest, 100 + i, 0, 0), 0, i));
+        }
+        BOOST_CHECK(dbUnspent.Update(hashFork, vAddNew, vector<CTxUnspent>()));
+        BOOST_CHECK(dbAddressUnspent.UpdateAddressUnspent(hashFork, uint256(), vAddNew, vector<CTxUnspent>()));
+        BOOST_CHECK(flusher.Flush());
+
+        // a removal cached after the flush hides the flushed output
+        vector<CTxUnspent> vRemove(1, vAddNew[0]);
+        BOOST_CHECK(dbUnspent.Update(hashFork, vector<CTxUnspent>(), vRemove));
+        BOOST_CHECK(dbAddressUnspent.UpdateAddressUnspent(hashFork, uint256(), vector<CTxUnspent>(), vRemove));
+        CTxOut output;
+        BOOST_CHECK(!dbUnspent.Retrieve(hashFork, vAddNew[0], output));
+        BOOST_CHECK(dbUnspent.Retrieve(hashFork, vAddNew[1], output) && output.nAmount == 101);
+
+        // stop writes what is left
+        flusher.Stop();
+        dbUnspent.Deinitialize();
+        dbAddressUnspent.Deinitialize();
+    }
+    {
+        CUnspentDB dbUnspent;
+        CAddressUnspentDB dbAddressUnspent;
+        BOOST_CHECK(dbUnspent.Initialize(pathData) && dbAddressUnspent.Initialize(pathData));
+        BOOST_CHECK(dbUnspent.AddNewFork(hashFork) && dbAddressUnspent.AddNewFork(hashFork));
+
+        CTxOut output;
+        BOOST_CHECK(!dbUnspent.Retrieve(hashFork, CTxOutPoint(uint256(uint64(1)), 0), output));
+        BOOST_CHECK(dbUnspent.Retrieve(hashFork, CTxOutPoint(uint256(uint64(10)), 0), output) && output.nAmount == 109);
+
+        map<CTxOutPoint, CUnspentOut> mapUnspent;
+        uint256 hashLastBlock;
+        BOOST_CHECK(dbAddressUnspent.RetrieveAddressUnspent(hashFork, dest, mapUnspent, hashLastBlock));
+        BOOST_CHECK(mapUnspent.size() == 9);
+
+        dbUnspent.Deinitialize();
+        dbAddressUnspent.Deinitialize();
+    }
+    remove_all(pathData);
+}
+
+// replay blocks of unspent changes on the unspent db under each profile
+static void RunLevelDBProfile(const int nBlockCount, const int nOutputPerBlock, const int nSpendPerBlock,
+                              const int nMissPerBlock, bool fPrint)
+{
+    const CLevelDBProfile profileUnspent = CLevelDBArguments::GetProfile(CLevelDBArguments::PROFILE_UNSPENT);
+    const struct
+    {
+        const char* pszName;
+        int nProfile;
+        int nBloomBits;
+    } profiles[] = {
+        { "default without bloom", CLevelDBArguments::PROFILE_DEFAULT, 0 },
+        { "unspent", CLevelDBArguments::PROFILE_UNSPENT, 10 },
+        { "unspent without bloom", CLevelDBArguments::PROFILE_UNSPENT, 0 },
+        { "address", CLevelDBArguments::PROFILE_ADDRESS, 10 },
+        { "txindex", CLevelDBArguments::PROFILE_TXINDEX, 10 },
+        { "wallet", CLevelDBArguments::PROFILE_WALLET, 10 }
+    };
+
+    CDestination dest(crypto::CPubKey(uint256(1)));
+    for (const auto& prof : profiles)
+    {
+        CLevelDBArguments::SetProfile(CLevelDBArguments::PROFILE_UNSPENT, CLevelDBArguments::GetProfile(prof.nProfile));
+        CLevelDBArguments::SetBloomBits(prof.nBloomBits);
+
+        path pathDB = temp_directory_path() / unique_path();
+        {
+            CForkUnspentDB db(pathDB, nullptr, uint256());
+            BOOST_CHECK(db.IsValid());
+
+            // each block adds outputs, spends older ones and probes outputs that never existed
+            vector<CTxOutPoint> vUnspent;
+            size_t nSpent = 0, nFound = 0, nMissFound = 0;
+            uint32 nRand = 1;
+            boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+            for (int nBlock = 0; nBlock < nBlockCount; nBlock++)
+            {
+                vector<CTxUnspent> vAddNew, vRemove;
+                for (int i = 0; i < nOutputPerBlock; i++)
+                {
+                    CTxOutPoint out(uint256(uint64(nBlock * nOutputPerBlock + i + 1)) << 64, i % 2);
+                    vAddNew.push_back(CTxUnspent(out, CTxOut(dest, 100 + i, nBlock, 0)));
+                }
+                for (int i = 0; i < nSpendPerBlock && vUnspent.size() > nOutputPerBlock * 20; i++)
+                {
+                    nRand = nRand * 1103515245 + 12345;
+                    size_t n = (nRand >> 8) % (vUnspent.size() - nOutputPerBlock * 20);
+                    CTxOut output;
+                    nSpent++;
+                    if (db.ReadUnspent(vUnspent[n], output))
+                    {
+                        nFound++;
+                        vRemove.push_back(CTxUnspent(vUnspent[n], output));
+                    }
+                    vUnspent[n] = vUnspent.back();
+                    vUnspent.pop_back();
+                }
+                for (int i = 0; i < nMissPerBlock; i++)
+                {
+                    CTxOut output;
+                    if (db.ReadUnspent(CTxOutPoint(uint256(uint64(nBlock * nMissPerBlock + i + 1)), 0), output))
+                    {
+                        nMissFound++;
+                    }
+                }
+                BOOST_CHECK(db.UpdateUnspent(vAddNew, vRemove));
+                for (const CTxUnspent& unspent : vAddNew)
+                {
+                    vUnspent.push_back(unspent);
+                }
+                if (nBlock % 10 == 9)
+                {
+                    BOOST_CHECK(db.Flush());
+                    BOOST_CHECK(db.Flush());
+                }
+            }
+            boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::universal_time();
+            BOOST_CHECK(nSpent > 0 && nFound == nSpent && nMissFound == 0);
+
+            if (fPrint)
+            {
+                std::cout << "leveldb profile " << prof.pszName << " : " << nBlockCount << " blocks, "
+                          << nFound << " spent, " << nBlockCount * nMissPerBlock << " misses "
+                          << (t1 - t0).total_milliseconds() << "ms." << std::endl;
+            }
+        }
+        remove_all(pathDB);
+    }
+
+    CLevelDBArguments::SetProfile(CLevelDBArguments::PROFILE_UNSPENT, profileUnspent);
+    CLevelDBArguments::SetBloomBits(10);
+}
+
+BOOST_AUTO_TEST_CASE(leveldbprofile)
+{
+    RunLevelDBProfile(40, 20, 12, 20, false);
+}
+
+// utxo replay benchmark per profile, run with --run_test=storage_tests/leveldbprofile_bench
+BOOST_AUTO_TEST_CASE(leveldbprofile_bench, *boost::unit_test::disabled())
+{
+    RunLevelDBProfile(200, 200, 120, 200, true);
+}
+
+BOOST_AUTO_TEST_CASE(blockoutlineload)
+{
+    path pathData = temp_directory_path() / unique_path();
+    create_directories(pathData);
+    {
+        CBlockIndexDB db;
+        BOOST_CHECK(db.Initialize(pathData));
+
+        map<uint256, CBlockOutline> mapOutline;
+        for (int i = 0; i < 5000; i++)
+        {
+            CBlockOutline outline;
+            outline.hashBlock = uint256(uint64(i + 1));
+            outline.hashPrev = (i > 0 ? uint256(uint64(i)) : uint256());
+            outline.hashOrigin = uint256(uint64(1));
+            outline.nHeight = i;
+            outline.nFile = i / 100;
+            outline.nOffset = i * 32;
+            BOOST_CHECK(db.AddNewBlock(outline));
+            mapOutline[outline.hashBlock] = outline;
+        }
+
+        // a single worker decodes more than one batch, four workers decode one
+        for (size_t nWorker = 1; nWorker <= 4; nWorker += 3)
+        {
+            vector<CBlockOutline> vOutline;
+            BOOST_CHECK(db.LoadBlockOutline(vOutline, nWorker));
+            BOOST_CHECK(vOutline.size() == mapOutline.size());
+            for (const CBlockOutline& outline : vOutline)
+            {
+                const CBlockOutline& expected = mapOutline[outline.hashBlock];
+                BOOST_CHECK(outline.hashPrev == expected.hashPrev && outline.hashOrigin == expected.hashOrigin);
+                BOOST_CHECK(outline.nHeight == expected.nHeight && outline.nFile == expected.nFile && outline.nOffset == expected.nOffset);
+            }
+        }
+        db.Deinitialize();
+    }
+    remove_all(pathData);
+}
+
+BOOST_AUTO_TEST_CASE(blockindexmap)
+{
+    const size_t nCount = 10000;
+    vector<CBlockIndex> vIndex(nCount);
+    CBlockIndexMap mapIndex;
+    for (size_t i = 0; i < nCount; i++)
+    {
+        // heights live in the high bits of a block hash, vary both parts
+        vIndex[i].hashBlock = uint256(uint64(i / 3 + 1));
+        vIndex[i].hashBlock <<= 224;
+        vIndex[i].hashBlock |= uint256(uint64(i * 2654435761ULL));
+        BOOST_CHECK(mapIndex.insert(&vIndex[i]));
+    }
+    BOOST_CHECK(!mapIndex.insert(&vIndex[0]));
+    BOOST_CHECK(mapIndex.size() == nCount);
+
+    for (size_t i = 0; i < nCount; i += 2)
+    {
+        BOOST_CHECK(mapIndex.erase(vIndex[i].hashBlock) == 1);
+    }
+    BOOST_CHECK(mapIndex.erase(vIndex[0].hashBlock) == 0);
+    BOOST_CHECK(mapIndex.size() == nCount / 2);
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        BOOST_CHECK(mapIndex.find(vIndex[i].hashBlock) == ((i % 2) ? &vIndex[i] : nullptr));
+    }
+    set<CBlockIndex*> setIndex;
+    for (CBlockIndexMap::const_iterator it = mapIndex.begin(); it != mapIndex.end(); ++it)
+    {
+        BOOST_CHECK(setIndex.insert(*it).second);
+    }
+    BOOST_CHECK(setIndex.size() == nCount / 2);
+
+    mapIndex.clear();
+    BOOST_CHECK(mapIndex.empty() && mapIndex.find(vIndex[1].hashBlock) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot)
+{
+    path pathSrc = temp_directory_path() / unique_path();
+    path pathDst = temp_directory_path() / unique_path();
+    path pathFile = temp_directory_path() / unique_path();
+    create_directories(pathSrc / "block");
+    create_directories(pathDst);
+
+    // three block chain, genesis in the first block file and the others in the second
+    vector<CBlock> vBlock(3);
+    vector<uint256> vHash(3);
+    for (int i = 0; i < 3; i++)
+    {
+        vBlock[i].nType = (i == 0 ? CBlock::BLOCK_GENESIS : CBlock::BLOCK_PRIMARY);
+        vBlock[i].nTimeStamp = 1000 + i;
+        vBlock[i].hashPrev = (i > 0 ? vHash[i - 1] : uint256());
+        vBlock[i].hashMerkle = vBlock[i].CalcMerkleTreeRoot();
+        vHash[i] = vBlock[i].GetHash();
+    }
+    {
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathSrc / "block", BLOCKFILE_PREFIX));
+        CBlockIndexDB dbBlockIndex;
+        BOOST_CHECK(dbBlockIndex.Initialize(pathSrc));
+        for (int i = 0; i < 3; i++)
+        {
+            CBlockOutline outline;
+            BOOST_CHECK(tsBlock.Write(CBlockEx(vBlock[i]), outline.nFile, outline.nOffset));
+            outline.nFile = (i == 0 ? 1 : 2);
+            outline.hashBlock = vHash[i];
+            outline.hashPrev = vBlock[i].hashPrev;
+            outline.hashOrigin = vHash[0];
+            outline.nType = vBlock[i].nType;
+            outline.nHeight = i;
+            BOOST_CHECK(dbBlockIndex.AddNewBlock(outline));
+        }
+        dbBlockIndex.Deinitialize();
+        tsBlock.Deinitialize();
+        copy_file(pathSrc / "block" / "block_000001.dat", pathSrc / "block" / "block_000002.dat");
+
+        CForkDB dbFork;
+        BOOST_CHECK(dbFork.Initialize(pathSrc, vHash[0]));
+        BOOST_CHECK(dbFork.UpdateFork(vHash[0], vHash[2]));
+        dbFork.Deinitialize();
+    }
+    vector<char> vData(CSnapshot::SNAPSHOT_CHUNK_SIZE * 2 + 123);
+    for (size_t i = 0; i < vData.size(); i++)
+    {
+        vData[i] = (char)(i * 7);
+    }
+    {
+        FILE* fp = fopen((pathSrc / "block" / "extra.dat").string().c_str(), "wb");
+        BOOST_CHECK(fp != nullptr && fwrite(&vData[0], vData.size(), 1, fp) == 1);
+        fclose(fp);
+    }
+
+    CSnapshot::CHeader header;
+    BOOST_CHECK(CSnapshot(pathSrc, vHash[0]).Export(pathFile, 0, header));
+    BOOST_CHECK(header.hashLastBlock == vHash[2] && header.nHeight == 2 && header.nFirstBlockFile == 1);
+
+    // wrong network, mismatched checkpoint, last block not at a checkpoint
+    map<int, uint256> mapCheckPoint = { { 0, vHash[0] }, { 2, vHash[2] } };
+    BOOST_CHECK(!CSnapshot(pathDst, vHash[1]).Import(pathFile, mapCheckPoint, header));
+    map<int, uint256> mapMismatch = { { 0, vHash[0] }, { 1, vHash[2] }, { 2, vHash[2] } };
+    BOOST_CHECK(!CSnapshot(pathDst, vHash[0]).Import(pathFile, mapMismatch, header));
+    map<int, uint256> mapGenesis = { { 0, vHash[0] } };
+    BOOST_CHECK(!CSnapshot(pathDst, vHash[0]).Import(pathFile, mapGenesis, header));
+    BOOST_CHECK(!exists(pathDst / "blockindex") && !exists(pathDst / "snapshot.import"));
+
+    // corrupted content
+    path pathCorrupt = pathFile.string() + ".corrupt";
+    copy_file(pathFile, pathCorrupt);
+    {
+        FILE* fp = fopen(pathCorrupt.string().c_str(), "r+b");
+        fseek(fp, -100, SEEK_END);
+        fputc(0xff, fp);
+        fclose(fp);
+    }
+    BOOST_CHECK(!CSnapshot(pathDst, vHash[0]).Import(pathCorrupt, mapCheckPoint, header));
+
+    // a forged tip passes the content hash, but is not found in the block index
+    path pathForged = temp_directory_path() / unique_path();
+    {
+        uint256 hashForged = vHash[2];
+        hashForged ^= uint64(1);
+        CForkDB dbFork;
+        BOOST_CHECK(dbFork.Initialize(pathSrc, vHash[0]));
+        BOOST_CHECK(dbFork.UpdateFork(vHash[0], hashForged));
+        dbFork.Deinitialize();
+        CSnapshot::CHeader headerForged;
+        BOOST_CHECK(CSnapshot(pathSrc, vHash[0]).Export(pathForged, 0, headerForged));
+        map<int, uint256> mapForged = { { 0, vHash[0] }, { 2, hashForged } };
+        BOOST_CHECK(!CSnapshot(pathDst, vHash[0]).Import(pathForged, mapForged, headerForged));
+        BOOST_CHECK(!exists(pathDst / "blockindex") && !exists(pathDst / "snapshot.import"));
+    }
+
+    BOOST_CHECK(CSnapshot(pathDst, vHash[0]).Import(pathFile, mapCheckPoint, header));
+    BOOST_CHECK(header.hashLastBlock == vHash[2] && header.nHeight == 2);
+    BOOST_CHECK(!CSnapshot(pathDst, vHash[0]).Import(pathFile, mapCheckPoint, header));
+    {
+        vector<char> vRead(vData.size());
+        FILE* fp = fopen((pathDst / "block" / "extra.dat").string().c_str(), "rb");
+        BOOST_CHECK(fp != nullptr && fread(&vRead[0], vRead.size(), 1, fp) == 1 && fgetc(fp) == EOF);
+        fclose(fp);
+        BOOST_CHECK(vRead == vData);
+
+        CBlockIndexDB dbBlockIndex;
+        CBlockOutline outline;
+        BOOST_CHECK(dbBlockIndex.Initialize(pathDst));
+        BOOST_CHECK(dbBlockIndex.RetrieveBlock(vHash[2], outline) && outline.hashPrev == vHash[1]);
+        dbBlockIndex.Deinitialize();
+    }
+
+    // only the block file holding the last block is exported, the appender goes on after it
+    path pathPartial = temp_directory_path() / unique_path();
+    path pathPartialDst = temp_directory_path() / unique_path();
+    create_directories(pathPartialDst);
+    {
+        CForkDB dbFork;
+        BOOST_CHECK(dbFork.Initialize(pathSrc, vHash[0]));
+        BOOST_CHECK(dbFork.UpdateFork(vHash[0], vHash[2]));
+        dbFork.Deinitialize();
+        BOOST_CHECK(CSnapshot(pathSrc, vHash[0]).Export(pathPartial, 1, header));
+        BOOST_CHECK(header.nFirstBlockFile == 2);
+        BOOST_CHECK(CSnapshot(pathPartialDst, vHash[0]).Import(pathPartial, mapCheckPoint, header));
+        BOOST_CHECK(!exists(pathPartialDst / "block" / "block_000001.dat") && exists(pathPartialDst / "block" / "block_000002.dat"));
+
+        CTimeSeriesCached tsBlock;
+        BOOST_CHECK(tsBlock.Initialize(pathPartialDst / "block", BLOCKFILE_PREFIX));
+        BOOST_CHECK(tsBlock.GetFirstFile() == 2);
+        CBlockEx block;
+        uint32 nFile, nOffset;
+        BOOST_CHECK(tsBlock.Write(block, nFile, nOffset) && nFile == 2);
+        tsBlock.Deinitialize();
+        BOOST_CHECK(!exists(pathPartialDst / "block" / "block_000001.dat"));
+    }
+
+    remove_all(pathSrc);
+    remove_all(pathDst);
+    remove_all(pathPartialDst);
+    remove(pathFile);
+    remove(pathCorrupt);
+    remove(pathForged);
+    remove(pathPartial);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
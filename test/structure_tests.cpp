@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <boost/test/unit_test.hpp>
+#include <map>
 #include <set>
 #include <vector>
 
 #include "address.h"
+#include "structure/poolalloc.h"
 #include "structure/tree.h"
 #include "test_big.h"
 
@@ -192,4 +194,58 @@ BOOST_AUTO_TEST_CASE(tree)
     BOOST_CHECK(relation2.GetRelation(b4)->spParent.lock()->key == B);
 }
 
+BOOST_AUTO_TEST_CASE(poolalloc)
+{
+    typedef map<int, int, less<int>, CPooledAllocator<pair<const int, int>>> MapPooled;
+    const int nCount = CNodeArena::CHUNK_NODE_COUNT * (CNodeArena::SPARSE_CHUNK_COUNT + 4);
+
+    // the arenas outlive their containers
+    CNodeArena arena;
+    CNodeArena arenaNew;
+    {
+        MapPooled::allocator_type alloc(&arena);
+        MapPooled mapPooled(less<int>(), alloc);
+        for (int i = 0; i < nCount; i++)
+        {
+            mapPooled[i] = i;
+        }
+        BOOST_CHECK(arena.GetLiveCount() == (size_t)nCount);
+        BOOST_CHECK(!arena.IsSparse());
+
+        // freed nodes are reused before new chunks are carved
+        const size_t nChunk = arena.GetChunkCount();
+        mapPooled.erase(mapPooled.begin(), mapPooled.find(nCount / 2));
+        for (int i = 0; i < nCount / 2; i++)
+        {
+            mapPooled[-i - 1] = i;
+        }
+        BOOST_CHECK(arena.GetChunkCount() == nChunk);
+
+        mapPooled.erase(mapPooled.find(nCount / 8 - nCount / 2), mapPooled.end());
+        BOOST_CHECK(arena.IsSparse());
+
+        // a copy leaves the arena, an assigned container shares it
+        MapPooled mapCopy(mapPooled);
+        BOOST_CHECK(mapCopy.get_allocator().GetArena() == nullptr);
+        BOOST_CHECK(mapCopy == mapPooled);
+        MapPooled mapAssign;
+        mapAssign = mapPooled;
+        BOOST_CHECK(mapAssign.get_allocator().GetArena() == &arena);
+        BOOST_CHECK(arena.GetLiveCount() == mapPooled.size() * 2);
+
+        // move the live nodes to a new arena as the txpool view does
+        {
+            MapPooled::allocator_type allocNew(&arenaNew);
+            MapPooled mapNew(mapPooled.begin(), mapPooled.end(), less<int>(), allocNew);
+            mapNew.swap(mapPooled);
+        }
+        BOOST_CHECK(mapPooled.get_allocator().GetArena() == &arenaNew);
+        BOOST_CHECK(arenaNew.GetLiveCount() == mapPooled.size());
+        BOOST_CHECK(!arenaNew.IsSparse());
+        BOOST_CHECK(arena.GetLiveCount() == mapAssign.size());
+        mapAssign.clear();
+        BOOST_CHECK(arena.GetLiveCount() == 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include "block.h"
 #include "test_big.h"
 #include "transaction.h"
 #include "uint256.h"
@@ -227,4 +228,259 @@ BOOST_AUTO_TEST_CASE(txpoolview_test)
     BOOST_CHECK(involvedTxPoolView.IsSpent(CTxOutPoint(tx3.GetHash(), 0)));
     BOOST_CHECK(!involvedTxPoolView.IsSpent(CTxOutPoint(tx10.GetHash(), 0)));
 }
+
+BOOST_AUTO_TEST_CASE(txhash_memo_test)
+{
+    CTransaction tx;
+    tx.nTimeStamp = 2001;
+    tx.nAmount = 100;
+    const uint256 txid = tx.GetHash();
+    const uint256 hashSig = tx.GetSignatureHash();
+
+    // hashes are kept on first use, the later calls are saved
+    tx.MemoizeHash();
+    BOOST_CHECK(tx.GetHashSavedCount() == 0);
+    BOOST_CHECK(tx.GetHash() == txid);
+    BOOST_CHECK(tx.GetSignatureHash() == hashSig);
+    BOOST_CHECK(tx.GetHash() == txid);
+    BOOST_CHECK(tx.GetSignatureHash() == hashSig);
+    BOOST_CHECK(tx.GetHashSavedCount() == 2);
+
+    tx.SetLockUntil(10);
+    BOOST_CHECK(tx.GetHash() != txid);
+    BOOST_CHECK(tx.GetSignatureHash() != hashSig);
+
+    tx.vchSig.assign(64, 1);
+    tx.InvalidateHash();
+    CTransaction txCopy(tx);
+    BOOST_CHECK(txCopy.GetHash() == tx.GetHash());
+
+    xengine::CBufStream ss;
+    ss << tx;
+    CBlock block;
+    block.vtx.push_back(tx);
+    block.vtx[0].vchSig.clear();
+    block.vtx[0].InvalidateHash();
+    ss >> block.vtx[0];
+    BOOST_CHECK(block.vtx[0].GetHash() == tx.GetHash());
+
+    ss.Clear();
+    ss << block;
+    CBlock blockLoad;
+    ss >> blockLoad;
+    BOOST_CHECK(blockLoad.vtx[0].IsMemoizeHash());
+    BOOST_CHECK(blockLoad.GetTxHashSavedCount() == 0);
+    BOOST_CHECK(blockLoad.CalcMerkleTreeRoot() == block.CalcMerkleTreeRoot());
+    BOOST_CHECK(blockLoad.vtx[0].GetHash() == tx.GetHash());
+    BOOST_CHECK(blockLoad.GetTxHashSavedCount() == 1);
+
+    // a copy keeps the hashes but counts its own savings
+    CTransaction txLoad(blockLoad.vtx[0]);
+    BOOST_CHECK(txLoad.GetHashSavedCount() == 0);
+    BOOST_CHECK(txLoad.GetHash() == tx.GetHash());
+    BOOST_CHECK(txLoad.GetHashSavedCount() == 1);
+}
+
+static vector<uint256> GetTxidList(const vector<CTransaction>& vtx)
+{
+    vector<uint256> vTxid;
+    for (const CTransaction& tx : vtx)
+    {
+        vTxid.push_back(tx.GetHash());
+    }
+    return vTxid;
+}
+
+BOOST_AUTO_TEST_CASE(txpoolview_template)
+{
+    const size_t nTxCount = 1000;
+    const int nHeight = 100;
+    const uint256 hashPrev(uint64(99));
+
+    vector<CPooledTx> vTx;
+    vTx.reserve(nTxCount);
+    for (size_t i = 0; i < nTxCount; i++)
+    {
+        CTransaction tx;
+        tx.nTimeStamp = 1000 + i;
+        tx.nAmount = 100;
+        tx.nTxFee = 10;
+        tx.sendTo = CDestination(crypto::CPubKey(uint256(uint64(i % 50 + 1))));
+        if (i % 3 == 2)
+        {
+            tx.vInput.push_back(CTxIn(CTxOutPoint(vTx[i - 1].GetHash(), 0)));
+        }
+        else
+        {
+            tx.vInput.push_back(CTxIn(CTxOutPoint(uint256(uint64(i + 1)), 0)));
+        }
+        vTx.push_back(CPooledTx(tx, -1, (uint64(i + 1) << 24), CDestination(), 160));
+    }
+
+    CTxPoolView view;
+    map<CDestination, int> mapVoteCert;
+    map<CDestination, int64> mapVote;
+    vector<pair<uint256, vector<CTxIn>>> vTxRemove;
+
+    // half of the pool goes into the arranged template, the rest is appended
+    for (size_t i = 0; i < nTxCount / 2; i++)
+    {
+        BOOST_CHECK(view.AddNew(vTx[i].GetHash(), vTx[i]));
+    }
+    vector<CTransaction> vArrange;
+    int64 nArrangeFee = 0;
+    view.GetBlockTxList(vArrange, nArrangeFee, numeric_limits<int64>::max(), MAX_BLOCK_SIZE, uint256(), nHeight, mapVoteCert, mapVote, 0, false,
+                        vTxRemove, nullptr, hashPrev);
+    view.SetBlockTemplate(hashPrev, nHeight, false, MAX_BLOCK_SIZE, vArrange);
+    BOOST_CHECK(view.HasBlockTemplate(hashPrev, nHeight));
+    BOOST_CHECK(!view.HasBlockTemplate(hashPrev, nHeight + 1));
+    for (size_t i = nTxCount / 2; i < nTxCount; i++)
+    {
+        BOOST_CHECK(view.AddNew(vTx[i].GetHash(), vTx[i]));
+    }
+    BOOST_CHECK(view.HasBlockTemplate(hashPrev, nHeight));
+
+    // the template matches a full arrangement by block time and size
+    const int64 vBlockTime[] = { numeric_limits<int64>::max(), 1700, 1200 };
+    const size_t vMaxSize[] = { MAX_BLOCK_SIZE, 20000 };
+    for (int64 nBlockTime : vBlockTime)
+    {
+        for (size_t nMaxSize : vMaxSize)
+        {
+            vector<CTransaction> vtx, vtxTemplate;
+            int64 nFee = 0, nFeeTemplate = 0;
+            view.GetBlockTxList(vtx, nFee, nBlockTime, nMaxSize, uint256(), nHeight, mapVoteCert, mapVote, 0, false,
+                                vTxRemove, nullptr, hashPrev);
+            BOOST_CHECK(view.GetBlockTemplate(hashPrev, nHeight, nBlockTime, nMaxSize, vtxTemplate, nFeeTemplate));
+            BOOST_CHECK(GetTxidList(vtx) == GetTxidList(vtxTemplate));
+            BOOST_CHECK(nFee == nFeeTemplate);
+        }
+    }
+    BOOST_CHECK(vTxRemove.empty());
+
+    // removing a template tx drops the template
+    view.Remove(vTx[nTxCount - 1].GetHash());
+    BOOST_CHECK(!view.HasBlockTemplate(hashPrev, nHeight));
+    vector<CTransaction> vtx;
+    int64 nFee = 0;
+    BOOST_CHECK(!view.GetBlockTemplate(hashPrev, nHeight, numeric_limits<int64>::max(), MAX_BLOCK_SIZE, vtx, nFee));
+}
+
+// push, list, arrange and pop nTxCount txs over nDestCount addresses
+static void RunTxPoolView(const size_t nTxCount, const size_t nDestCount, bool fPrint)
+{
+    vector<CDestination> vDest;
+    for (size_t i = 0; i < nDestCount; i++)
+    {
+        vDest.push_back(CDestination(crypto::CPubKey(uint256(uint64(i + 1)))));
+    }
+
+    // every fourth tx spends the output of the previous one, others spend chain outputs
+    vector<CPooledTx> vTx;
+    vTx.reserve(nTxCount);
+    for (size_t i = 0; i < nTxCount; i++)
+    {
+        CTransaction tx;
+        tx.nTimeStamp = 1000 + i;
+        tx.nAmount = 100;
+        tx.nTxFee = 10;
+        tx.sendTo = vDest[(i * 7) % nDestCount];
+        CDestination destIn;
+        if (i % 4 == 3)
+        {
+            tx.vInput.push_back(CTxIn(CTxOutPoint(vTx[i - 1].GetHash(), 0)));
+            destIn = vTx[i - 1].sendTo;
+        }
+        else
+        {
+            uint256 hashPrev(uint64(i + 1));
+            hashPrev <<= 128;
+            tx.vInput.push_back(CTxIn(CTxOutPoint(hashPrev, 0)));
+            destIn = vDest[i % nDestCount];
+        }
+        vTx.push_back(CPooledTx(tx, -1, (uint64(i + 1) << 24), destIn, 160));
+    }
+
+    CTxPoolView view;
+    boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < nTxCount; i++)
+    {
+        BOOST_CHECK(view.AddNew(vTx[i].GetHash(), vTx[i]));
+    }
+    boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::universal_time();
+    BOOST_CHECK(view.Count() == nTxCount);
+
+    size_t nUnspent = 0;
+    for (size_t i = 0; i < nDestCount; i++)
+    {
+        vector<CTxUnspent> vUnspent;
+        view.ListUnspent(vDest[i], set<CTxUnspent>(), 0, vUnspent);
+        nUnspent += vUnspent.size();
+    }
+    boost::posix_time::ptime t2 = boost::posix_time::microsec_clock::universal_time();
+
+    // the destination index agrees with a full scan of the spent table
+    size_t nScanUnspent = 0;
+    for (const auto& kv : view.mapSpent)
+    {
+        if (!kv.second.IsSpent() && !kv.second.IsNull())
+        {
+            nScanUnspent++;
+        }
+    }
+    BOOST_CHECK(nUnspent == nScanUnspent);
+
+    vector<CTransaction> vtx;
+    int64 nTotalTxFee = 0;
+    map<CDestination, int> mapVoteCert;
+    map<CDestination, int64> mapVote;
+    vector<pair<uint256, vector<CTxIn>>> vTxRemove;
+    view.GetBlockTxList(vtx, nTotalTxFee, 1000 + nTxCount, MAX_BLOCK_SIZE, uint256(), 100, mapVoteCert, mapVote, 0, false,
+                        vTxRemove, nullptr, uint256());
+    boost::posix_time::ptime t3 = boost::posix_time::microsec_clock::universal_time();
+    BOOST_CHECK(!vtx.empty() && vTxRemove.empty());
+
+    // a view that mostly drained moves its nodes to a smaller arena
+    for (size_t i = nTxCount; i > nTxCount / 8; i--)
+    {
+        view.Remove(vTx[i - 1].GetHash());
+    }
+    const size_t nChunk = view.ptrArena->GetChunkCount();
+    const bool fSparse = view.ptrArena->IsSparse();
+    view.Compact();
+    BOOST_CHECK(view.Count() == nTxCount / 8);
+    BOOST_CHECK(!view.ptrArena->IsSparse());
+    BOOST_CHECK(!fSparse || view.ptrArena->GetChunkCount() < nChunk);
+    for (size_t i = 0; i < nTxCount / 8; i++)
+    {
+        BOOST_CHECK(view.Get(vTx[i].GetHash()) != nullptr);
+    }
+
+    for (size_t i = nTxCount / 8; i > 0; i--)
+    {
+        view.Remove(vTx[i - 1].GetHash());
+    }
+    boost::posix_time::ptime t4 = boost::posix_time::microsec_clock::universal_time();
+    BOOST_CHECK(view.Count() == 0);
+
+    if (fPrint)
+    {
+        std::cout << "txpool view " << nTxCount << " txs : push " << (t1 - t0).total_milliseconds()
+                  << "ms.; list unspent of " << nDestCount << " addresses " << (t2 - t1).total_milliseconds()
+                  << "ms.; arrange " << vtx.size() << " txs " << (t3 - t2).total_milliseconds()
+                  << "ms.; pop " << (t4 - t3).total_milliseconds() << "ms." << std::endl;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(txpoolviewindex)
+{
+    RunTxPoolView(2000, 50, false);
+}
+
+// throughput benchmark, run with --run_test=txpool_tests/txpoolview_bench
+BOOST_AUTO_TEST_CASE(txpoolview_bench, *boost::unit_test::disabled())
+{
+    RunTxPoolView(200000, 2000, true);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file